@@ -79,6 +79,8 @@ void InitializeSpellCheckThread()
 
 SpellCheckServiceResult CheckSpellings(const SpellCheckServiceRequest &request)
 {
+    PROFILE_THIS_FUNCTION;
+
     SpellCheckServiceResult result;
     result.timestamp = request.timestamp;
     result.text = request.text;
@@ -236,8 +236,9 @@ Rectangle {
                 model: Runtime.screenplayAdapter.screenplay ? 1 : 0
 
                 Item {
+                    id: screenplaySearchAgent
+
                     property string searchString
-                    property var searchResults: []
                     property int previousSceneIndex: -1
 
                     signal replaceCurrentRequest(string replacementText)
@@ -253,17 +254,16 @@ Rectangle {
 
                     SearchAgent.onSearchRequest: {
                         searchString = string
-                        searchResults = Runtime.screenplayAdapter.screenplay.search(string, 0)
-                        SearchAgent.searchResultCount = searchResults.length
+                        Runtime.screenplayAdapter.screenplay.reportSearchResults(string, screenplaySearchAgent.SearchAgent, 0)
                     }
 
                     SearchAgent.onCurrentSearchResultIndexChanged: {
                         if(SearchAgent.currentSearchResultIndex >= 0) {
-                            var searchResult = searchResults[SearchAgent.currentSearchResultIndex]
-                            var sceneIndex = searchResult["sceneIndex"]
+                            var searchResult = SearchAgent.searchResultAt(SearchAgent.currentSearchResultIndex)
+                            var sceneIndex = searchResult.block
                             if(sceneIndex !== previousSceneIndex)
                                 clearPreviousElementUserData()
-                            var sceneResultIndex = searchResult["sceneResultIndex"]
+                            var sceneResultIndex = searchResult.blockResultIndex
                             var screenplayElement = Runtime.screenplayAdapter.screenplay.elementAt(sceneIndex)
                             var data = {
                                 "searchString": searchString,
@@ -280,7 +280,6 @@ Rectangle {
                     SearchAgent.onClearSearchRequest: {
                         Runtime.screenplayAdapter.screenplay.currentElementIndex = previousSceneIndex
                         searchString = ""
-                        searchResults = []
                         clearPreviousElementUserData()
                     }
 
@@ -685,6 +684,8 @@ Rectangle {
                         cacheBuffer = Qt.binding( () => {
                                                      if(!model)
                                                         return defaultCacheBuffer
+                                                     if(Runtime.screenplayAdapter.virtualized)
+                                                        return defaultCacheBuffer
                                                      return (Runtime.screenplayEditorSettings.optimiseScrolling || contentView.loadAllDelegates) ? 2147483647 : defaultCacheBuffer
                                                  })
                     }
@@ -1449,6 +1450,12 @@ Rectangle {
                 opacity: 0.5
                 visible: !parent.screenplayElement.omitted
             }
+
+            MouseArea {
+                anchors.fill: parent
+                enabled: Runtime.screenplayAdapter.virtualized
+                onClicked: Runtime.screenplayAdapter.currentIndex = parent.spElementIndex
+            }
         }
     }
 
@@ -4602,8 +4609,18 @@ Rectangle {
                     Utils.execLater(contentViewDelegateLoader, 100, load)
             }
 
+            // When the adapter is virtualized, only rows around the current row are editable.
+            // Others show a placeholder, sized using the height hint.
+            property bool editable: model.editable
+            onEditableChanged: {
+                if(editable)
+                    Utils.execLater(contentViewDelegateLoader, 100, load)
+                else
+                    unload()
+            }
+
             function load() {
-                if(active || componentData === undefined)
+                if(active || componentData === undefined || !editable)
                     return
 
                 contentView.movingChanged.disconnect(load)
@@ -4613,16 +4630,18 @@ Rectangle {
                     active = true
             }
 
-            Component.onCompleted: {
-                const heightHint = componentData.screenplayElement.heightHint
-                if( componentData.screenplayElementType === ScreenplayElement.BreakElementType ||
-                    contentView.loadAllDelegates || Runtime.screenplayEditorSettings.optimiseScrolling ||
-                    componentData.scene.elementCount <= 1) {
-                        active = true
-                        initialized = true
-                        return
-                    }
+            function unload() {
+                if(!active || componentData === undefined || componentData.screenplayElementType === ScreenplayElement.BreakElementType)
+                    return
+
+                contentView.movingChanged.disconnect(load)
+                updateHeightHint()
+                active = false
+                createPlaceholder()
+            }
 
+            function createPlaceholder() {
+                const heightHint = componentData.screenplayElement.heightHint
                 const placeHolderSceneProps = {
                     "spElementIndex": componentIndex,
                     "spElementData": componentData,
@@ -4636,6 +4655,18 @@ Rectangle {
                     height = Qt.binding( () => { return placeHolderSceneItem.suggestedSceneHeight } )
                 else
                     height = heightHint * zoomLevel
+            }
+
+            Component.onCompleted: {
+                if( componentData.screenplayElementType === ScreenplayElement.BreakElementType ||
+                    (editable && (contentView.loadAllDelegates || Runtime.screenplayEditorSettings.optimiseScrolling ||
+                    componentData.scene.elementCount <= 1)) ) {
+                        active = true
+                        initialized = true
+                        return
+                    }
+
+                createPlaceholder()
 
                 active = false
                 initialized = true
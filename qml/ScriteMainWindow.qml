@@ -339,6 +339,13 @@ Item {
 
         function onJustLoaded() {
             Runtime.screenplayEditorSettings.firstSwitchToStructureTab = true
+            // With exact height hints, placeholders for all scenes can be laid out right
+            // away, so there is no need to fetch them in batches.
+            if(Scrite.document.screenplay.heightHintsAvailable) {
+                Runtime.screenplayAdapter.initialLoadTreshold = -1
+                return
+            }
+
             var firstElement = Scrite.document.screenplay.elementAt(Scrite.document.screenplay.firstSceneIndex())
             if(firstElement) {
                 var editorHints = firstElement.editorHints
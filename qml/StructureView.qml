@@ -1089,84 +1089,28 @@ Item {
             }
 
             property string groupCategory: Scrite.document.structure.preferredGroupCategory
-            property var groupBoxes: []
-            property var episodeBoxes: []
-            property bool groupsBeingMoved: false
-            Component.onCompleted: Utils.execLater(canvas, 250, reevaluateEpisodeAndGroupBoxes)
 
-            function reevaluateEpisodeAndGroupBoxes() {
-                if(groupsBeingMoved)
-                    return
-                var egBoxes = Scrite.document.structure.evaluateEpisodeAndGroupBoxes(Scrite.document.screenplay, canvas.groupCategory)
-                canvas.groupBoxes = egBoxes.groupBoxes
-                canvas.episodeBoxes = egBoxes.episodeBoxes
-            }
-
-            onGroupCategoryChanged: {
-                Scrite.document.structure.preferredGroupCategory = groupCategory
-                Utils.execLater(canvas, 250, reevaluateEpisodeAndGroupBoxes)
-            }
-
-            TrackerPack {
-                delay: 250
-
-                TrackProperty {
-                    target: elementItems
-                    property: "count"
-                }
-
-                TrackSignal {
-                    target: Scrite.document.screenplay
-                    signal: "elementsChanged()"
-                }
-
-                TrackSignal {
-                    target: Scrite.document.screenplay
-                    signal: "breakTitleChanged()"
-                }
-
-                TrackSignal {
-                    target: Scrite.document
-                    signal: "loadingChanged()"
-                }
-
-                TrackSignal {
-                    target: Scrite.document.structure
-                    signal: "structureChanged()"
-                }
-
-                TrackSignal {
-                    target: Scrite.document.screenplay
-                    signal: "elementSceneGroupsChanged(ScreenplayElement*)"
-                }
-
-                TrackSignal {
-                    target: Scrite.document.screenplay
-                    signal: "episodeCountChanged()"
-                }
-
-                onTracked: canvas.reevaluateEpisodeAndGroupBoxes()
-            }
+            onGroupCategoryChanged: Scrite.document.structure.preferredGroupCategory = groupCategory
 
             Repeater {
-                model: canvas.episodeBoxes
+                model: Scrite.document.structure.episodeBoxes
 
                 Rectangle {
                     id: canvasEpisodeBox
 
                     property real topMarginForStacks: Scrite.document.structure.elementStacks.objectCount > 0 ? 15 : 0
 
-                    x: modelData.geometry.x - 40
-                    y: modelData.geometry.y - 120 - topMarginForStacks
-                    width: modelData.geometry.width + 80
-                    height: modelData.geometry.height + 120 + topMarginForStacks + 40
+                    x: model.geometry.x - 40
+                    y: model.geometry.y - 120 - topMarginForStacks
+                    width: model.geometry.width + 80
+                    height: model.geometry.height + 120 + topMarginForStacks + 40
                     color: Scrite.app.translucent(Runtime.colors.accent.c100.background, Scrite.document.structure.forceBeatBoardLayout ? 0.3 : 0.1)
                     border.width: 2
                     border.color: Runtime.colors.accent.c600.background
                     enabled: !createItemMouseHandler.enabled && !currentElementItemShadow.visible && !annotationGripLoader.active
 
                     BoundingBoxItem.evaluator: canvasItemsBoundingBox
-                    BoundingBoxItem.stackOrder: 1.0 + (index/canvas.episodeBoxes.length)
+                    BoundingBoxItem.stackOrder: 1.0 + (index/Scrite.document.structure.episodeBoxes.count)
                     BoundingBoxItem.livePreview: false
                     BoundingBoxItem.previewFillColor: Qt.rgba(0,0,0,0.05)
                     BoundingBoxItem.previewBorderColor: Qt.rgba(0,0,0,0.5)
@@ -1191,21 +1135,21 @@ Item {
                         font.pointSize: Runtime.idealFontMetrics.font.pointSize + 8
                         font.bold: true
                         color: Runtime.colors.accent.c200.text
-                        text: "<b>" + modelData.name + "</b><font size=\"-2\">: " + modelData.sceneCount + (modelData.sceneCount === 1 ? " Scene": " Scenes") + "</font>"
+                        text: "<b>" + model.name + "</b><font size=\"-2\">: " + model.sceneCount + (model.sceneCount === 1 ? " Scene": " Scenes") + "</font>"
                     }
                 }
             }
 
             Repeater {
-                model: canvas.groupBoxes
+                model: Scrite.document.structure.groupBoxes
 
                 Rectangle {
                     id: canvasGroupBoxItem
                     property real topMarginForStacks: Scrite.document.structure.elementStacks.objectCount > 0 ? 15 : 0
-                    x: modelData.geometry.x - 20
-                    y: modelData.geometry.y - 20 - topMarginForStacks
-                    width: modelData.geometry.width + 40
-                    height: modelData.geometry.height + 40 + topMarginForStacks
+                    x: model.geometry.x - 20
+                    y: model.geometry.y - 20 - topMarginForStacks
+                    width: model.geometry.width + 40
+                    height: model.geometry.height + 40 + topMarginForStacks
                     radius: 0
                     color: Scrite.app.translucent(Runtime.colors.accent.c100.background, Scrite.document.structure.forceBeatBoardLayout ? 0.3 : 0.1)
                     border.width: 1
@@ -1213,7 +1157,7 @@ Item {
                     enabled: !createItemMouseHandler.enabled && !annotationGripLoader.active
 
                     BoundingBoxItem.evaluator: canvasItemsBoundingBox
-                    BoundingBoxItem.stackOrder: 2.0 + (index/canvas.groupBoxes.length)
+                    BoundingBoxItem.stackOrder: 2.0 + (index/Scrite.document.structure.groupBoxes.count)
                     BoundingBoxItem.livePreview: false
                     BoundingBoxItem.previewFillColor: Qt.rgba(0,0,0,0)
                     BoundingBoxItem.previewBorderColor: Qt.rgba(0,0,0,0)
@@ -1227,8 +1171,8 @@ Item {
                     function moveBeat() {
                         var dx = x - refX
                         var dy = y - refY
-                        var nrElements = modelData.sceneCount
-                        var idxList = modelData.sceneIndexes
+                        var nrElements = model.sceneCount
+                        var idxList = model.sceneIndexes
                         var movedIdxList = []
                         for(var i=0; i<nrElements; i++) {
                             var idx = idxList[i]
@@ -1245,8 +1189,8 @@ Item {
 
                     function selectBeatItems() {
                         var items = []
-                        var nrElements = modelData.sceneCount
-                        var idxList = modelData.sceneIndexes
+                        var nrElements = model.sceneCount
+                        var idxList = model.sceneIndexes
                         var selIdxList = []
                         for(var i=0; i<nrElements; i++) {
                             var idx = idxList[i]
@@ -1263,6 +1207,12 @@ Item {
                     property real refX: x
                     property real refY: y
 
+                    // Dragging the box assigns x and y, which breaks their bindings.
+                    function bindToGeometry() {
+                        x = Qt.binding( () => { return model.geometry.x - 20 } )
+                        y = Qt.binding( () => { return model.geometry.y - 20 - topMarginForStacks } )
+                    }
+
                     MouseArea {
                         id: canvasBeatMouseArea
                         anchors.fill: parent
@@ -1282,7 +1232,8 @@ Item {
                             selection.clear()
                             canvasGroupBoxItem.refX = canvasGroupBoxItem.x
                             canvasGroupBoxItem.refY = canvasGroupBoxItem.y
-                            canvas.groupsBeingMoved = drag.active
+                            if(!drag.active)
+                                canvasGroupBoxItem.bindToGeometry()
                         }
                         onDoubleClicked: canvasGroupBoxItem.selectBeatItems()
                     }
@@ -1312,7 +1263,8 @@ Item {
                                 selection.clear()
                                 canvasGroupBoxItem.refX = canvasGroupBoxItem.x
                                 canvasGroupBoxItem.refY = canvasGroupBoxItem.y
-                                canvas.groupsBeingMoved = drag.active
+                                if(!drag.active)
+                                    canvasGroupBoxItem.bindToGeometry()
                             }
                             onDoubleClicked: canvasGroupBoxItem.selectBeatItems()
                         }
@@ -1320,7 +1272,7 @@ Item {
 
                     VclLabel {
                         id: beatLabel
-                        text: "<b>" + modelData.name + "</b><font size=\"-2\">: " + modelData.sceneCount + (modelData.sceneCount === 1 ? " Scene": " Scenes") + "</font>"
+                        text: "<b>" + model.name + "</b><font size=\"-2\">: " + model.sceneCount + (model.sceneCount === 1 ? " Scene": " Scenes") + "</font>"
                         font.pointSize: Runtime.idealFontMetrics.font.pointSize + 3
                         anchors.bottom: parent.top
                         anchors.left: parent.left
@@ -2098,8 +2050,8 @@ Item {
                 if(!canvasScroll.interactive)
                     return "Canvas Locked While Index Card Has Focus. Hit ESC To Release Focus."
                 var ret = Scrite.document.structure.elementCount + " Scenes";
-                if(canvas.episodeBoxes.length > 0)
-                    ret += ", " + canvas.episodeBoxes.length + " Episodes";
+                if(Scrite.document.structure.episodeBoxes.count > 0)
+                    ret += ", " + Scrite.document.structure.episodeBoxes.count + " Episodes";
                 if(Scrite.document.structure.forceBeatBoardLayout)
                     ret += ", Scenes Not Movable"
                 ret += "."
@@ -273,6 +273,15 @@ Item {
                     onTextEdited: Scrite.document.maxBackupCount = parseInt(text)
                 }
 
+                VclCheckBox {
+                    Layout.columnSpan: 2
+
+                    text: "Deduplicate Backups (Saves Disk Space)"
+                    width: parent.width
+                    checked: Scrite.document.deduplicatedBackups
+                    onToggled: Scrite.document.deduplicatedBackups = checked
+                }
+
                 VclCheckBox {
                     Layout.columnSpan: 2
 
@@ -115,6 +115,18 @@ Item {
                     ToolTip.text: "Checking this option will make scrolling in screenplay editor smooth, but uses a lot of RAM and can cause application to freeze at times while scrolling is being computed."
                 }
 
+                VclCheckBox {
+                    Layout.preferredWidth: (parent.width-parent.columnSpacing) / parent.columns
+
+                    text: "Light Weight Editing"
+                    checked: Runtime.screenplayEditorSettings.virtualizeEditor
+                    onToggled: Runtime.screenplayEditorSettings.virtualizeEditor = checked
+                    hoverEnabled: true
+
+                    ToolTip.visible: hovered
+                    ToolTip.text: "Checking this option will keep only the current scene and a few scenes around it editable, other scenes are shown as previews. This keeps memory usage low for long screenplays."
+                }
+
                 VclCheckBox {
                     Layout.preferredWidth: (parent.width-parent.columnSpacing) / parent.columns
 
@@ -123,6 +123,8 @@ Item {
         property bool highlightCurrentLine: true
         property bool applyUserDefinedLanguageFonts: true
         property bool optimiseScrolling: false
+        property bool virtualizeEditor: false
+        property int editorPoolSize: 2
 
         property bool copyAsFountain: true
         property bool copyFountainUsingStrictSyntax: true
@@ -542,6 +544,8 @@ Item {
     // This model is how the screenplay of the current ScriteDocument is accessed.
     readonly property ScreenplayAdapter screenplayAdapter: ScreenplayAdapter {
         property string sessionId
+        virtualized: Runtime.screenplayEditorSettings.virtualizeEditor
+        editorPoolSize: Runtime.screenplayEditorSettings.editorPoolSize
         source: {
             if(Scrite.document.sessionId !== sessionId)
             return null
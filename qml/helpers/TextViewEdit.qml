@@ -72,19 +72,16 @@ Loader {
             rightPadding: textViewEdit.rightPadding
             bottomPadding: textViewEdit.bottomPadding
 
-            property var searchResults: []
             SearchAgent.engine: searchEngine
             SearchAgent.sequenceNumber: searchSequenceNumber
-            SearchAgent.searchResultCount: searchResults.length
-            SearchAgent.onSearchRequest: searchResults = SearchAgent.indexesOf(string, text)
+            SearchAgent.onSearchRequest: SearchAgent.addSearchResultsIn(text)
             SearchAgent.onCurrentSearchResultIndexChanged: {
                 if(SearchAgent.currentSearchResultIndex < 0)
                     return
-                var result = searchResults[SearchAgent.currentSearchResultIndex]
+                var result = SearchAgent.searchResultAt(SearchAgent.currentSearchResultIndex)
                 markupText = SearchAgent.createMarkupText(textViewEdit.text, result.from, result.to, Scrite.app.palette.highlight, Scrite.app.palette.highlightedText)
                 textViewEdit.highlightRequest()
             }
-            SearchAgent.onClearSearchRequest: searchResults = []
             SearchAgent.onClearHighlight: markupText = ""
         }
     }
@@ -66,7 +66,6 @@ Rectangle {
 
     onVisibleChanged: {
         if(visible) {
-            canvas.reloadIfDirty()
             canvas.zoomFit()
             canvas.selectedNodeItem = canvas.mainCharacterNodeItem
         }
@@ -118,11 +117,8 @@ Rectangle {
 
             MouseArea {
                 anchors.fill: parent
-                enabled: canvas.selectedNodeItem || crGraph.dirty
-                onClicked: {
-                    canvas.selectedNodeItem = null;
-                    canvas.reloadIfDirty();
-                }
+                enabled: canvas.selectedNodeItem
+                onClicked: canvas.selectedNodeItem = null
             }
 
             property Character activeCharacter: selectedNodeItem ? selectedNodeItem.character : null
@@ -145,11 +141,6 @@ Rectangle {
                 id: nodeItemsBoxEvaluator
             }
 
-            function reloadIfDirty() {
-                if(crGraph.dirty)
-                    crGraph.reload()
-            }
-
             function zoomFit() {
                 if(nodeItemsBox.width > canvasScroll.width || nodeItemsBox.height > canvasScroll.height)
                     canvasScroll.zoomFit(Qt.rect(nodeItemsBox.x,nodeItemsBox.y,nodeItemsBox.width,nodeItemsBox.height))
@@ -235,7 +226,7 @@ Rectangle {
 
                             FlatToolButton {
                                 id: floatingAddButton
-                                onClicked: { canvas.reloadIfDirty(); addNewRelationshipRequest(this) }
+                                onClicked: addNewRelationshipRequest(this)
                                 iconSource: "qrc:/icons/content/add_circle_outline.png"
                                 autoRepeat: false
                                 ToolTip.text: "Add A New Relationship"
@@ -331,7 +322,6 @@ Rectangle {
                                         focusPolicy: Qt.NoFocus
                                         onClicked: {
                                             removeRelationshipWithRequest(canvas.activeCharacter, this);
-                                            canvas.reloadIfDirty();
                                             removeRelationshipConfirmation.active = false
                                         }
                                     }
@@ -382,7 +372,6 @@ Rectangle {
 
             FlatToolButton {
                 onClicked: {
-                    canvas.reloadIfDirty()
                     var item = canvas.selectedNodeItem
                     if(item)
                         canvasScroll.zoomOneToItem(item)
@@ -397,7 +386,7 @@ Rectangle {
             }
 
             FlatToolButton {
-                onClicked: { canvas.reloadIfDirty(); canvas.zoomFit() }
+                onClicked: canvas.zoomFit()
                 iconSource: "qrc:/icons/navigation/zoom_fit.png"
                 autoRepeat: true
                 ToolTip.text: "Zoom Fit"
@@ -425,27 +414,6 @@ Rectangle {
         }
     }
 
-    Item {
-        anchors.fill: parent
-        visible: crGraph.dirty
-
-        VclLabel {
-            anchors.left: parent.left
-            anchors.bottom: parent.bottom
-            anchors.margins: 25
-            font.pointSize: Runtime.idealFontMetrics.font.pointSize
-            width: parent.width * 0.65
-            wrapMode: Text.WrapAtWordBoundaryOrAnywhere
-            text: "Graph will be refreshed when you use it next."
-            color: Runtime.colors.primary.c900.background
-        }
-
-        MouseArea {
-            anchors.fill: parent
-            enabled: crGraph.busy
-        }
-    }
-
     BusyIcon {
         running: crGraph.busy || showBusyIndicator
         anchors.centerIn: parent
@@ -548,7 +516,6 @@ Rectangle {
                 onPressed: {
                     canvasScroll.interactive = false
                     canvas.selectedNodeItem = parent
-                    canvas.reloadIfDirty()
                 }
                 onReleased: canvasScroll.interactive = true
                 onDoubleClicked: characterDoubleClicked(character.name, parent)
@@ -20,7 +20,7 @@ CONFIG(release, debug|release) {
     CONFIG += qtquickcompiler
 }
 
-INCLUDEPATH += ../apikeys ../profilingtools . \
+INCLUDEPATH += ../apikeys . \
         ./src \
         ./src/core \
         ./src/network \
@@ -53,10 +53,12 @@ HEADERS += \
     src/automation/automation.h \
     src/automation/automationrecorder.h \
     src/automation/eventautomationstep.h \
+    src/automation/opendocumentstep.h \
     src/automation/pausestep.h \
     src/automation/scriptautomationstep.h \
     src/automation/windowcapture.h \
     src/core/appwindow.h \
+    src/core/eventloopmonitor.h \
     src/core/filelocker.h \
     src/core/localstorage.h \
     src/core/pdfexportablegraphicsscene.h \
@@ -71,6 +73,8 @@ HEADERS += \
     src/document/form.h \
     src/document/notebookmodel.h \
     src/document/notes.h \
+    src/document/sceneincidenceindex.h \
+    src/document/structureboxmodel.h \
     src/document/screenplaytextdocumentoffsets.h \
     src/document/scritedocumentvault.h \
     src/document/scritefileinfo.h \
@@ -130,6 +134,9 @@ HEADERS += \
     src/reports/scenecharactermatrixreport.h \
     src/reports/statisticsreport.h \
     src/reports/statisticsreport_p.h \
+    src/utils/callgraph.h \
+    src/utils/deferredworkscheduler.h \
+    src/utils/durationhistogram.h \
     src/utils/execlatertimer.h \
     src/utils/fountain.h \
     src/utils/graphlayout.h \
@@ -138,11 +145,13 @@ HEADERS += \
     src/utils/genericarraymodel.h \
     src/utils/qobjectfactory.h \
     src/utils/qobjectserializer.h \
+    src/utils/timeprofiler.h \
     src/utils/modifiable.h \
     src/document/formatting.h \
     src/document/transliteration.h \
     src/document/scritedocument.h \
     src/document/documentfilesystem.h \
+    src/document/documentbackupstore.h \
     src/document/structure.h \
     src/document/screenplaytextdocument.h \
     src/document/undoredo.h \
@@ -187,11 +196,13 @@ SOURCES += \
     src/automation/automation_module.cpp \
     src/automation/automationrecorder.cpp \
     src/automation/eventautomationstep.cpp \
+    src/automation/opendocumentstep.cpp \
     src/automation/pausestep.cpp \
     src/automation/scriptautomationstep.cpp \
     src/automation/windowcapture.cpp \
     src/core/application_build_timestamp.cpp \
     src/core/appwindow.cpp \
+    src/core/eventloopmonitor.cpp \
     src/core/filelocker.cpp \
     src/core/localstorage.cpp \
     src/core/pdfexportablegraphicsscene.cpp \
@@ -205,6 +216,8 @@ SOURCES += \
     src/document/form.cpp \
     src/document/notebookmodel.cpp \
     src/document/notes.cpp \
+    src/document/sceneincidenceindex.cpp \
+    src/document/structureboxmodel.cpp \
     src/document/screenplaytextdocumentoffsets.cpp \
     src/document/scritedocumentvault.cpp \
     src/document/scritefileinfo.cpp \
@@ -264,16 +277,20 @@ SOURCES += \
     src/reports/scenecharactermatrixreport.cpp \
     src/reports/statisticsreport.cpp \
     src/reports/statisticsreport_p.cpp \
+    src/utils/callgraph.cpp \
+    src/utils/deferredworkscheduler.cpp \
     src/utils/execlatertimer.cpp \
     src/utils/fountain.cpp \
     src/utils/genericarraymodel.cpp \
     src/utils/graphlayout.cpp \
     src/utils/garbagecollector.cpp \
     src/utils/qobjectserializer.cpp \
+    src/utils/timeprofiler.cpp \
     src/document/scritedocument.cpp \
     src/document/screenplay.cpp \
     src/document/scene.cpp \
     src/document/documentfilesystem.cpp \
+    src/document/documentbackupstore.cpp \
     src/document/structure.cpp \
     src/document/screenplaytextdocument.cpp \
     src/document/undoredo.cpp \
@@ -323,16 +340,6 @@ RESOURCES += \
     scrite_images.qrc \
     scrite_ui.qrc
 
-exists(../profilingtools/timeprofiler.cpp) {
-    HEADERS += ../profilingtools/timeprofiler.h
-    SOURCES += ../profilingtools/timeprofiler.cpp
-}
-
-exists(../profilingtools/callgraph.cpp) {
-    HEADERS += ../profilingtools/callgraph.h
-    SOURCES += ../profilingtools/callgraph.cpp
-}
-
 # https://doc.qt.io/qt-5/qtwebengine-deploying.html#javascript-files-in-qt-resource-files
 QTQUICK_COMPILER_SKIPPED_RESOURCES += scrite_misc.qrc
 
@@ -357,7 +364,7 @@ win32 {
     RC_ICONS = appicon.ico
     HEADERS += src/core/systemtextinputmanager_windows.h
     SOURCES += src/core/systemtextinputmanager_windows.cpp
-    LIBS += User32.lib
+    LIBS += User32.lib Psapi.lib
 }
 
 linux {
@@ -13,8 +13,23 @@
 
 #include "automation.h"
 #include "application.h"
+#include "deferredworkscheduler.h"
 
+#include <QFile>
 #include <QFileInfo>
+#include <QQuickWindow>
+#include <QGuiApplication>
+#include <QJsonDocument>
+
+#include <numeric>
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include <Windows.h>
+#include <Psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
 
 AbstractAutomationStep::AbstractAutomationStep(QObject *parent) : QObject(parent) { }
 
@@ -56,9 +71,37 @@ void AbstractAutomationStep::setErrorMessage(const QString &val)
 
 ///////////////////////////////////////////////////////////////////////////////
 
-Automation::Automation(QObject *parent) : QObject(parent) { }
+static qint64 peakResidentSetSize()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return qint64(pmc.PeakWorkingSetSize);
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MAC
+        return qint64(usage.ru_maxrss); // bytes
+#else
+        return qint64(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+    }
+#endif
+    return -1;
+}
+
+static inline qreal nsToMs(qint64 ns)
+{
+    return qreal(ns) / 1e6;
+}
+
+Automation::Automation(QObject *parent) : QObject(parent), m_window(this, "window") { }
 
-Automation::~Automation() { }
+Automation::~Automation()
+{
+    for (const QMetaObject::Connection &connection : qAsConst(m_frameConnections))
+        disconnect(connection);
+}
 
 void Automation::setAutoRun(bool val)
 {
@@ -78,6 +121,34 @@ void Automation::setQuitAppWhenFinished(bool val)
     emit quitAppWhenFinishedChanged();
 }
 
+void Automation::setReportFileName(const QString &val)
+{
+    if (m_reportFileName == val || m_running)
+        return;
+
+    m_reportFileName = val;
+    emit reportFileNameChanged();
+}
+
+void Automation::setWindow(QQuickWindow *val)
+{
+    if (m_window == val || m_running)
+        return;
+
+    m_window = val;
+    emit windowChanged();
+}
+
+void Automation::setSettleTimeout(int val)
+{
+    val = qMax(val, 0);
+    if (m_settleTimeout == val)
+        return;
+
+    m_settleTimeout = val;
+    emit settleTimeoutChanged();
+}
+
 void Automation::start()
 {
     if (m_running)
@@ -85,8 +156,11 @@ void Automation::start()
 
     this->setRunning(true);
 
+    if (this->isReporting())
+        this->beginReport();
+
     m_pendingSteps = m_steps;
-    this->startNextStep();
+    this->takeNextStep();
 }
 
 QString Automation::pathOf(const QString &absFileName) const
@@ -186,13 +260,53 @@ void Automation::componentComplete()
         this->start();
 }
 
+void Automation::timerEvent(QTimerEvent *te)
+{
+    if (te->timerId() != m_settleTimer.timerId()) {
+        QObject::timerEvent(te);
+        return;
+    }
+
+    const qint64 nowNs = m_clock.nsecsElapsed();
+    const bool settled = DeferredWorkScheduler::instance()->queueDepth() == 0
+            || nowNs - m_stepFinishNs >= qint64(m_settleTimeout) * 1000000;
+    if (!settled)
+        return;
+
+    m_settleTimer.stop();
+
+    AbstractAutomationStep *step = m_finishedStep;
+    m_finishedStep = nullptr;
+    if (step != nullptr)
+        this->recordStep(step, nowNs);
+    this->takeNextStep();
+}
+
 void Automation::startNextStep()
 {
     AbstractAutomationStep *step = qobject_cast<AbstractAutomationStep *>(this->sender());
-    if (step != nullptr)
+    if (step != nullptr) {
         disconnect(step, &AbstractAutomationStep::finished, this, &Automation::startNextStep);
 
+        // Work deferred by a step is part of what it costs, so while reporting the
+        // next step waits for the deferred work queue to drain.
+        if (this->isReporting()) {
+            m_finishedStep = step;
+            m_stepFinishNs = m_clock.nsecsElapsed();
+            m_settleTimer.start(10, this);
+            return;
+        }
+    }
+
+    this->takeNextStep();
+}
+
+void Automation::takeNextStep()
+{
     if (m_pendingSteps.isEmpty()) {
+        if (this->isReporting())
+            this->finishReport();
+
         this->setRunning(false);
 
         if (m_quitAppWhenFinished)
@@ -201,8 +315,10 @@ void Automation::startNextStep()
         return;
     }
 
-    step = m_pendingSteps.takeFirst();
+    AbstractAutomationStep *step = m_pendingSteps.takeFirst();
     connect(step, &AbstractAutomationStep::finished, this, &Automation::startNextStep);
+    if (this->isReporting())
+        m_stepStartNs = m_clock.nsecsElapsed();
     step->start();
 }
 
@@ -215,4 +331,115 @@ void Automation::setRunning(bool val)
     emit runningChanged();
 }
 
+void Automation::resetWindow()
+{
+    m_window = nullptr;
+    emit windowChanged();
+}
+
+void Automation::beginReport()
+{
+    m_stepReports = QJsonArray();
+    m_frames.clear();
+    m_frameStartNs = -1;
+    m_clock.start();
+
+    DeferredWorkScheduler::instance()->resetMetrics();
+
+    if (!m_window.isNull()) {
+        // Both signals are emitted from the render thread, if there is one. The time
+        // between them is what it took to synchronize, render and swap a frame.
+        m_frameConnections << connect(
+                m_window, &QQuickWindow::beforeSynchronizing, this,
+                [=]() { m_frameStartNs = m_clock.nsecsElapsed(); }, Qt::DirectConnection);
+        m_frameConnections << connect(
+                m_window, &QQuickWindow::frameSwapped, this,
+                [=]() {
+                    if (m_frameStartNs < 0)
+                        return;
+                    QMutexLocker locker(&m_framesMutex);
+                    m_frames.append(qMakePair(m_frameStartNs, m_clock.nsecsElapsed()));
+                },
+                Qt::DirectConnection);
+    }
+}
+
+void Automation::recordStep(AbstractAutomationStep *step, qint64 settledNs)
+{
+    QJsonObject item;
+    item.insert(QStringLiteral("index"), m_stepReports.size());
+    item.insert(QStringLiteral("type"), QString::fromLatin1(step->metaObject()->className()));
+    if (!step->objectName().isEmpty())
+        item.insert(QStringLiteral("name"), step->objectName());
+    item.insert(QStringLiteral("latency"), nsToMs(m_stepFinishNs - m_stepStartNs));
+    item.insert(QStringLiteral("settleTime"), nsToMs(settledNs - m_stepFinishNs));
+    item.insert(QStringLiteral("frames"), this->evaluateFrameTimes(m_stepStartNs, settledNs));
+    item.insert(QStringLiteral("peakRss"), peakResidentSetSize());
+    if (step->hasError())
+        item.insert(QStringLiteral("errorMessage"), step->errorMessage());
+
+    m_stepReports.append(item);
+}
+
+void Automation::finishReport()
+{
+    for (const QMetaObject::Connection &connection : qAsConst(m_frameConnections))
+        disconnect(connection);
+    m_frameConnections.clear();
+
+    const qint64 totalNs = m_clock.nsecsElapsed();
+
+    QJsonObject report;
+    report.insert(QStringLiteral("platform"), QGuiApplication::platformName());
+    report.insert(QStringLiteral("qtVersion"), QString::fromLatin1(qVersion()));
+    report.insert(QStringLiteral("appVersion"),
+                  Application::instance()->versionNumber().toString());
+    report.insert(QStringLiteral("totalTime"), nsToMs(totalNs));
+    report.insert(QStringLiteral("peakRss"), peakResidentSetSize());
+    report.insert(QStringLiteral("frames"), this->evaluateFrameTimes(0, totalNs));
+    report.insert(QStringLiteral("deferredWork"), DeferredWorkScheduler::instance()->metrics());
+    report.insert(QStringLiteral("steps"), m_stepReports);
+
+    m_report = report;
+    emit reportChanged();
+
+    QFile file(m_reportFileName);
+    if (file.open(QFile::WriteOnly))
+        file.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+    else
+        qWarning("Automation: could not write report to %s", qPrintable(m_reportFileName));
+}
+
+QJsonObject Automation::evaluateFrameTimes(qint64 fromNs, qint64 toNs)
+{
+    QVector<qint64> frameTimes;
+    {
+        QMutexLocker locker(&m_framesMutex);
+        for (const QPair<qint64, qint64> &frame : qAsConst(m_frames)) {
+            if (frame.second >= fromNs && frame.second <= toNs)
+                frameTimes << frame.second - frame.first;
+        }
+    }
+
+    QJsonObject ret;
+    ret.insert(QStringLiteral("count"), frameTimes.size());
+    if (frameTimes.isEmpty())
+        return ret;
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    const qint64 totalNs = std::accumulate(frameTimes.begin(), frameTimes.end(), qint64(0));
+    const qint64 budgetNs = 16666667; // 60 fps
+    const int overBudget = int(frameTimes.end()
+                               - std::upper_bound(frameTimes.begin(), frameTimes.end(), budgetNs));
+    const int p95 = qMin(frameTimes.size() - 1, int(qreal(frameTimes.size()) * 0.95));
+
+    ret.insert(QStringLiteral("average"), nsToMs(totalNs / frameTimes.size()));
+    ret.insert(QStringLiteral("median"), nsToMs(frameTimes.at(frameTimes.size() / 2)));
+    ret.insert(QStringLiteral("p95"), nsToMs(frameTimes.at(p95)));
+    ret.insert(QStringLiteral("maximum"), nsToMs(frameTimes.last()));
+    ret.insert(QStringLiteral("overBudget"), overBudget);
+    return ret;
+}
+
 #endif // SCRITE_ENABLE_AUTOMATION
@@ -15,11 +15,21 @@
 #define AUTOMATION_H
 
 #include <QUrl>
+#include <QMutex>
+#include <QPointer>
 #include <QObject>
+#include <QVector>
+#include <QJsonArray>
+#include <QBasicTimer>
+#include <QJsonObject>
+#include <QElapsedTimer>
 #include <QQmlParserStatus>
 #include <QQmlListProperty>
 
+#include "qobjectproperty.h"
+
 class QQuickView;
+class QQuickWindow;
 
 class Automation;
 class AbstractAutomationStep : public QObject
@@ -63,6 +73,14 @@ private:
 
 #ifdef SCRITE_ENABLE_AUTOMATION
 
+/**
+ * Runs steps one after the other. When reportFileName is set, the run doubles up as a
+ * performance replay: each step is timed from the moment it starts till the deferred
+ * work it caused has drained, frames rendered by window are timed, and peak resident
+ * set size is sampled after every step. All of it is written out as JSON once the last
+ * step finishes, so recorded sessions can be replayed headless (for instance with
+ * QT_QPA_PLATFORM=offscreen) and compared across builds.
+ */
 class Automation : public QObject, public QQmlParserStatus
 {
     Q_OBJECT
@@ -88,6 +106,27 @@ public:
     bool isQuitAppWhenFinished() const { return m_quitAppWhenFinished; }
     Q_SIGNAL void quitAppWhenFinishedChanged();
 
+    Q_PROPERTY(QString reportFileName READ reportFileName WRITE setReportFileName NOTIFY reportFileNameChanged)
+    void setReportFileName(const QString &val);
+    QString reportFileName() const { return m_reportFileName; }
+    Q_SIGNAL void reportFileNameChanged();
+
+    // Window whose frames are timed, while reporting
+    Q_PROPERTY(QQuickWindow *window READ window WRITE setWindow RESET resetWindow NOTIFY windowChanged)
+    void setWindow(QQuickWindow *val);
+    QQuickWindow *window() const { return m_window; }
+    Q_SIGNAL void windowChanged();
+
+    // Longest time to wait for deferred work to drain after a step, in milliseconds
+    Q_PROPERTY(int settleTimeout READ settleTimeout WRITE setSettleTimeout NOTIFY settleTimeoutChanged)
+    void setSettleTimeout(int val);
+    int settleTimeout() const { return m_settleTimeout; }
+    Q_SIGNAL void settleTimeoutChanged();
+
+    Q_PROPERTY(QJsonObject report READ report NOTIFY reportChanged)
+    QJsonObject report() const { return m_report; }
+    Q_SIGNAL void reportChanged();
+
     Q_INVOKABLE void start();
 
     // Helper methods
@@ -121,14 +160,43 @@ public:
     void classBegin();
     void componentComplete();
 
+protected:
+    void timerEvent(QTimerEvent *te);
+
 private:
     void startNextStep();
+    void takeNextStep();
     void setRunning(bool val);
+    void resetWindow();
+
+    bool isReporting() const { return !m_reportFileName.isEmpty(); }
+    void beginReport();
+    void recordStep(AbstractAutomationStep *step, qint64 settledNs);
+    void finishReport();
+    QJsonObject evaluateFrameTimes(qint64 fromNs, qint64 toNs);
 
 private:
     bool m_autoRun = true;
     bool m_running = false;
     bool m_quitAppWhenFinished = true;
+
+    QString m_reportFileName;
+    QObjectProperty<QQuickWindow> m_window;
+    int m_settleTimeout = 2000;
+    QJsonObject m_report;
+
+    QElapsedTimer m_clock;
+    QBasicTimer m_settleTimer;
+    QJsonArray m_stepReports;
+    QPointer<AbstractAutomationStep> m_finishedStep;
+    qint64 m_stepStartNs = 0;
+    qint64 m_stepFinishNs = 0;
+
+    // Written from the render thread
+    QMutex m_framesMutex;
+    qint64 m_frameStartNs = -1;
+    QVector<QPair<qint64, qint64>> m_frames; // start, end
+    QList<QMetaObject::Connection> m_frameConnections;
 };
 
 #else
@@ -14,11 +14,13 @@
 #include <QQmlEngine>
 #include <QQuickView>
 #include <QQmlContext>
+#include <QQmlComponent>
 
 #include "pausestep.h"
 #include "automation.h"
 #include "application.h"
 #include "windowcapture.h"
+#include "opendocumentstep.h"
 #include "automationrecorder.h"
 #include "eventautomationstep.h"
 #include "scriptautomationstep.h"
@@ -35,14 +37,38 @@ void Automation::init(QQuickView *qmlWindow)
     qmlRegisterType<Automation>("Scrite", 1, 0, "Automation");
     qmlRegisterType<EventAutomationStep>("Scrite", 1, 0, "EventStep");
     qmlRegisterType<ScriptAutomationStep>("Scrite", 1, 0, "ScriptStep");
+    qmlRegisterType<OpenDocumentStep>("Scrite", 1, 0, "OpenDocumentStep");
 
     new AutomationRecorder(qmlWindow);
 
+    QQmlContext *rootContext = qmlWindow->engine()->rootContext();
+    rootContext->setContextProperty("qmlWindow", qmlWindow);
+
+    // Scripts can use this as reportFileName, so that where the report goes can be
+    // decided by whoever launches the replay.
+    const QString automationReport = QString::fromLocal8Bit(qgetenv("SCRITE_AUTOMATION_REPORT"));
+    rootContext->setContextProperty("automationReport", automationReport);
+
     const QString automationScript = QString::fromLatin1(qgetenv("SCRITE_AUTOMATION_SCRIPT"));
-    if (QFile::exists(automationScript))
-        qmlWindow->engine()->rootContext()->setContextProperty(
-                "automationScript", QUrl::fromLocalFile(automationScript));
-    else
+    if (QFile::exists(automationScript)) {
+        const QUrl automationScriptUrl = QUrl::fromLocalFile(automationScript);
+        rootContext->setContextProperty("automationScript", automationScriptUrl);
+
+        // The script is instantiated once the main QML has loaded, so that steps act
+        // on a fully constructed UI.
+        QObject::connect(qmlWindow, &QQuickView::statusChanged, qmlWindow,
+                         [=](QQuickView::Status status) {
+                             if (status != QQuickView::Ready)
+                                 return;
+
+                             QQmlComponent component(qmlWindow->engine(), automationScriptUrl);
+                             QObject *automation = component.create(rootContext);
+                             if (automation == nullptr)
+                                 qWarning("Automation: %s", qPrintable(component.errorString()));
+                             else
+                                 automation->setParent(qmlWindow);
+                         });
+    } else
 #else
     Q_UNUSED(qmlWindow)
 #endif
@@ -153,8 +153,10 @@ bool AutomationRecorder::eventFilter(QObject *object, QEvent *event)
             QMouseEvent *me = static_cast<QMouseEvent *>(event);
             addSleepStatement();
             if (me->pos() != m_pressPos) {
-                m_recordedStatements << QStringLiteral("mousePress(") + QString::number(me->x())
-                                + comma + QString::number(me->y()) + comma
+                // Drags are replayed from where the button was pressed
+                m_recordedStatements << QStringLiteral("mousePress(")
+                                + QString::number(m_pressPos.x()) + comma
+                                + QString::number(m_pressPos.y()) + comma
                                 + QString::number(me->button()) + comma
                                 + QString::number(me->modifiers()) + closingBracket;
                 m_recordedStatements << QStringLiteral("mouseMove(") + QString::number(me->x())
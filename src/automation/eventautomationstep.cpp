@@ -117,9 +117,14 @@ void EventAutomationStep::keyClick(int key, int modifiers)
 
 void EventAutomationStep::keyClicks(const QString &text, int modifiers)
 {
-    Q_UNUSED(m_window)
-    Q_UNUSED(text)
-    Q_UNUSED(modifiers)
+    if (m_window.isNull())
+        return;
+
+    // QTest::keyClicks() only accepts widgets, hence the key events are sent one
+    // character at a time.
+    for (const QChar ch : text)
+        QTest::sendKeyEvent(QTest::Click, m_window, Qt::Key(ch.toUpper().unicode()),
+                            QString(ch), Qt::KeyboardModifiers(modifiers));
 }
 
 void EventAutomationStep::sleep(int msecs)
@@ -0,0 +1,61 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifdef SCRITE_ENABLE_AUTOMATION
+
+#include "opendocumentstep.h"
+#include "scritedocument.h"
+
+#include <QFileInfo>
+
+OpenDocumentStep::OpenDocumentStep(QObject *parent) : AbstractAutomationStep(parent) { }
+
+OpenDocumentStep::~OpenDocumentStep() { }
+
+void OpenDocumentStep::setFileName(const QString &val)
+{
+    if (m_fileName == val)
+        return;
+
+    m_fileName = val;
+    emit fileNameChanged();
+}
+
+void OpenDocumentStep::setAnonymous(bool val)
+{
+    if (m_anonymous == val)
+        return;
+
+    m_anonymous = val;
+    emit anonymousChanged();
+}
+
+void OpenDocumentStep::run()
+{
+    const QFileInfo fi(m_fileName);
+    if (!fi.exists()) {
+        this->setErrorMessage(QStringLiteral("File not found: ") + m_fileName);
+        this->finish();
+        return;
+    }
+
+    ScriteDocument *document = ScriteDocument::instance();
+    const bool success = m_anonymous ? document->openAnonymously(fi.absoluteFilePath())
+                                     : document->open(fi.absoluteFilePath());
+    if (!success)
+        this->setErrorMessage(QStringLiteral("Could not open: ") + m_fileName);
+
+    this->finish();
+}
+
+#endif // SCRITE_ENABLE_AUTOMATION
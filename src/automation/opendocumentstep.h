@@ -0,0 +1,53 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifdef SCRITE_ENABLE_AUTOMATION
+
+#ifndef OPENDOCUMENTSTEP_H
+#define OPENDOCUMENTSTEP_H
+
+#include "automation.h"
+
+// Loads a fixture document, so that replayed events always act on the same content.
+class OpenDocumentStep : public AbstractAutomationStep
+{
+    Q_OBJECT
+
+public:
+    explicit OpenDocumentStep(QObject *parent = nullptr);
+    ~OpenDocumentStep();
+
+    Q_PROPERTY(QString fileName READ fileName WRITE setFileName NOTIFY fileNameChanged)
+    void setFileName(const QString &val);
+    QString fileName() const { return m_fileName; }
+    Q_SIGNAL void fileNameChanged();
+
+    // Anonymously opened documents are neither locked nor auto-saved, which keeps
+    // the fixture unchanged across runs.
+    Q_PROPERTY(bool anonymous READ isAnonymous WRITE setAnonymous NOTIFY anonymousChanged)
+    void setAnonymous(bool val);
+    bool isAnonymous() const { return m_anonymous; }
+    Q_SIGNAL void anonymousChanged();
+
+protected:
+    // AbstractAutomationStep interface
+    void run();
+
+private:
+    QString m_fileName;
+    bool m_anonymous = true;
+};
+
+#endif // OPENDOCUMENTSTEP_H
+
+#endif // SCRITE_ENABLE_AUTOMATION
@@ -18,6 +18,9 @@
 #include "application.h"
 #include "notification.h"
 #include "localstorage.h"
+#include "timeprofiler.h"
+#include "eventloopmonitor.h"
+#include "deferredworkscheduler.h"
 #include "scritedocument.h"
 
 #ifdef ENABLE_CRASHPAD_CRASH_TEST
@@ -121,6 +124,8 @@ Application::Application(int &argc, char **argv, const QVersionNumber &version)
     QFontDatabase::addApplicationFont(QStringLiteral(":font/Rubik/Rubik-Bold.ttf"));
     this->setFont(QFont(QStringLiteral("Rubik")));
 
+    m_eventLoopMonitor = new EventLoopMonitor(this);
+
     connect(m_undoGroup, &QUndoGroup::canUndoChanged, this, &Application::canUndoChanged);
     connect(m_undoGroup, &QUndoGroup::canRedoChanged, this, &Application::canRedoChanged);
     connect(m_undoGroup, &QUndoGroup::undoTextChanged, this, &Application::undoTextChanged);
@@ -1103,6 +1108,24 @@ bool QtApplicationEventNotificationCallback(void **cbdata)
 
 bool Application::notify(QObject *object, QEvent *event)
 {
+    EventLoopMonitor::Dispatch dispatch(m_eventLoopMonitor, object, event);
+
+    switch (event->type()) {
+    case QEvent::KeyPress:
+    case QEvent::InputMethod:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::Wheel:
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+        // Idle-priority deferred work waits for user input to settle
+        DeferredWorkScheduler::instance()->noteUserInput();
+        break;
+    default:
+        break;
+    }
+
     // Note that notifyInternal() will be called first before we get here.
     if (event->type() == QEvent::DeferredDelete)
         return QtApplicationClass::notify(object, event);
@@ -1156,7 +1179,13 @@ bool Application::notify(QObject *object, QEvent *event)
         QChildEvent *childEvent = reinterpret_cast<QChildEvent *>(event);
         QObject *childObject = childEvent->child();
 
-        if (!childObject->isWidgetType() && !childObject->isWindowType()) {
+        if (m_parentChangeBatchDepth > 0 && !childObject->isWidgetType()
+            && !childObject->isWindowType()) {
+            // While its constructor is running, a child is only a QObject, so its own
+            // event() would not get to see a ParentChange anyway.
+            if (childObject->metaObject() != &QObject::staticMetaObject)
+                m_pendingParentChanges.append(childObject);
+        } else if (!childObject->isWidgetType() && !childObject->isWindowType()) {
             /**
              * For whatever reason, ParentChange event is only sent
              * if the child is a widget or window or declarative-item.
@@ -1176,6 +1205,42 @@ bool Application::notify(QObject *object, QEvent *event)
     return ret;
 }
 
+Application::ParentChangeBatch::ParentChangeBatch()
+{
+    static const bool disabled = qEnvironmentVariableIsSet("SCRITE_NO_PARENT_CHANGE_BATCH");
+
+    Application *app = Application::instance();
+    if (app != nullptr && !disabled)
+        ++app->m_parentChangeBatchDepth;
+}
+
+Application::ParentChangeBatch::~ParentChangeBatch()
+{
+    static const bool disabled = qEnvironmentVariableIsSet("SCRITE_NO_PARENT_CHANGE_BATCH");
+
+    Application *app = Application::instance();
+    if (app == nullptr || disabled || --app->m_parentChangeBatchDepth > 0)
+        return;
+
+    const QList<QPointer<QObject>> pendingParentChanges = app->m_pendingParentChanges;
+    app->m_pendingParentChanges.clear();
+
+    // A child may have been re-parented more than once in the batch, but it only needs
+    // to resolve its final parent.
+    QSet<QObject *> notifiedObjects;
+    for (const QPointer<QObject> &childObject : pendingParentChanges) {
+        if (childObject.isNull() || childObject->parent() == nullptr)
+            continue;
+
+        if (notifiedObjects.contains(childObject.data()))
+            continue;
+        notifiedObjects.insert(childObject.data());
+
+        QEvent parentChangeEvent(QEvent::ParentChange);
+        app->QtApplicationClass::notify(childObject, &parentChangeEvent);
+    }
+}
+
 bool Application::notifyInternal(QObject *object, QEvent *event)
 {
 #ifndef QT_NO_DEBUG_OUTPUT
@@ -1209,9 +1274,9 @@ bool Application::notifyInternal(QObject *object, QEvent *event)
     } else if (event->type() == QEvent::Timer) {
         const QString objectName = evaluateObjectName(object, objectNameMap);
         QTimerEvent *te = static_cast<QTimerEvent *>(event);
-        ExecLaterTimer *timer = ExecLaterTimer::get(te->timerId());
+        const ExecLaterTimerEvent *ete = dynamic_cast<const ExecLaterTimerEvent *>(te);
         qDebug() << "TimerEventDespatch: " << te->timerId() << " on " << objectName << " is "
-                 << (timer ? qPrintable(timer->name()) : "Qt Timer.");
+                 << (ete ? qPrintable(ete->timerName()) : "Qt Timer.");
     } else if (event->type() == QEvent::Shortcut) {
         const QString objectName = evaluateObjectName(object, objectNameMap);
         QShortcutEvent *se = static_cast<QShortcutEvent *>(event);
@@ -1406,6 +1471,55 @@ void Application::log(const QString &message)
 #endif
 }
 
+void Application::setProfilingEnabled(bool val)
+{
+    if (TimeProfiler::isEnabled() == val)
+        return;
+
+    TimeProfiler::setEnabled(val);
+    emit profilingEnabledChanged();
+}
+
+bool Application::isProfilingEnabled() const
+{
+    return TimeProfiler::isEnabled();
+}
+
+bool Application::saveProfilingTrace(const QString &fileName)
+{
+    return TimeProfiler::saveChromeTrace(fileName);
+}
+
+QJsonArray Application::profilingSummary()
+{
+    QJsonArray ret;
+
+    const QList<TimeProfiler::Stats> summary = TimeProfiler::summary();
+    for (const TimeProfiler::Stats &stats : summary) {
+        QJsonObject item;
+        item.insert(QStringLiteral("function"), stats.context);
+        item.insert(QStringLiteral("count"), qint64(stats.count));
+        item.insert(QStringLiteral("totalMs"), double(stats.totalNs) / 1e6);
+        item.insert(QStringLiteral("minMs"), double(stats.minNs) / 1e6);
+        item.insert(QStringLiteral("maxMs"), double(stats.maxNs) / 1e6);
+        item.insert(QStringLiteral("p50Ms"), double(stats.p50Ns) / 1e6);
+        item.insert(QStringLiteral("p99Ms"), double(stats.p99Ns) / 1e6);
+        ret.append(item);
+    }
+
+    return ret;
+}
+
+void Application::resetProfilingData()
+{
+    TimeProfiler::reset();
+}
+
+DeferredWorkScheduler *Application::deferredWorkScheduler() const
+{
+    return DeferredWorkScheduler::instance();
+}
+
 bool Application::event(QEvent *event)
 {
 #ifdef Q_OS_MAC
@@ -15,6 +15,8 @@
 #define APPLICATION_H
 
 #include <QUrl>
+#include <QSet>
+#include <QPointer>
 #include <QTime>
 #include <QRectF>
 #include <QColor>
@@ -37,6 +39,8 @@ typedef QApplication QtApplicationClass;
 
 class Forms;
 class QSettings;
+class EventLoopMonitor;
+class DeferredWorkScheduler;
 class QQuickItem;
 class AutoUpdate;
 class QNetworkConfigurationManager;
@@ -332,6 +336,24 @@ public:
 
     // Although public, please do not call it.
     bool notifyInternal(QObject *object, QEvent *event);
+
+    /**
+     * notify() sends a ParentChange event to every non-widget child added to an
+     * object, because document classes resolve their parent pointers from it. While
+     * a batch is open (for instance while a document is being deserialized), that is
+     * skipped for children still in their constructor, since they resolve parents
+     * there. Children re-parented after construction are sent one ParentChange each,
+     * when the outermost batch closes.
+     *
+     * Setting SCRITE_NO_PARENT_CHANGE_BATCH in the environment disables batching, to
+     * compare load times with and without it.
+     */
+    class ParentChangeBatch
+    {
+    public:
+        ParentChangeBatch();
+        ~ParentChangeBatch();
+    };
     void computeIdealFontPointSize();
 
 #ifdef Q_OS_MAC
@@ -353,6 +375,23 @@ public:
 
     Q_INVOKABLE static void log(const QString &message);
 
+    Q_PROPERTY(bool profilingEnabled READ isProfilingEnabled WRITE setProfilingEnabled NOTIFY
+                       profilingEnabledChanged)
+    void setProfilingEnabled(bool val);
+    bool isProfilingEnabled() const;
+    Q_SIGNAL void profilingEnabledChanged();
+
+    Q_INVOKABLE static bool saveProfilingTrace(const QString &fileName);
+    Q_INVOKABLE static QJsonArray profilingSummary();
+    Q_INVOKABLE static void resetProfilingData();
+
+    Q_PROPERTY(EventLoopMonitor *eventLoopMonitor READ eventLoopMonitor CONSTANT STORED false)
+    EventLoopMonitor *eventLoopMonitor() const { return m_eventLoopMonitor; }
+
+    Q_PROPERTY(DeferredWorkScheduler *deferredWorkScheduler READ deferredWorkScheduler CONSTANT
+                       STORED false)
+    DeferredWorkScheduler *deferredWorkScheduler() const;
+
     bool event(QEvent *event);
 
 signals:
@@ -381,6 +420,10 @@ private:
     bool registerFileTypes();
 
 private:
+    // Declared first, because notify() looks at these while other members are constructed.
+    EventLoopMonitor *m_eventLoopMonitor = nullptr;
+    int m_parentChangeBatchDepth = 0;
+    QList<QPointer<QObject>> m_pendingParentChanges;
 #ifdef Q_OS_MAC
     QString m_fileToOpen;
     bool m_handleFileOpenEvents = false;
@@ -0,0 +1,366 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "eventloopmonitor.h"
+#include "timeprofiler.h"
+#include "execlatertimer.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+#include <QThread>
+#include <QDateTime>
+#include <QMetaEnum>
+#include <QTimerEvent>
+#include <QJsonDocument>
+#include <QStandardPaths>
+
+static const int MaxRecentStalls = 100;
+
+EventLoopMonitor::EventLoopMonitor(QObject *parent) : QAbstractListModel(parent)
+{
+    m_enabled.storeRelaxed(qEnvironmentVariableIntValue("SCRITE_EVENT_LOOP_MONITOR") != 0);
+    if (this->isEnabled())
+        m_refreshTimer.start(1000, this);
+}
+
+EventLoopMonitor::~EventLoopMonitor() { }
+
+void EventLoopMonitor::setEnabled(bool val)
+{
+    if (this->isEnabled() == val)
+        return;
+
+    m_enabled.storeRelaxed(val);
+    if (val)
+        m_refreshTimer.start(1000, this);
+    else
+        m_refreshTimer.stop();
+
+    emit enabledChanged();
+}
+
+void EventLoopMonitor::setStallThreshold(int val)
+{
+    val = qMax(val, 1);
+    if (m_stallThreshold == val)
+        return;
+
+    m_stallThreshold = val;
+    emit stallThresholdChanged();
+}
+
+QJsonArray EventLoopMonitor::recentStalls() const
+{
+    QJsonArray ret;
+    for (const Stall &stall : m_stalls)
+        ret.append(this->toJson(stall));
+    return ret;
+}
+
+QJsonObject EventLoopMonitor::report() const
+{
+    QJsonArray events, timers;
+    for (const Entry &entry : m_entries) {
+        if (entry.isTimer)
+            timers.append(this->toJson(entry));
+        else
+            events.append(this->toJson(entry));
+    }
+
+    QJsonObject ret;
+    ret.insert(QStringLiteral("timestamp"), QDateTime::currentDateTime().toString(Qt::ISODate));
+    ret.insert(QStringLiteral("stallThreshold"), m_stallThreshold);
+    ret.insert(QStringLiteral("stallCount"), m_stallCount);
+    ret.insert(QStringLiteral("events"), events);
+    ret.insert(QStringLiteral("timers"), timers);
+    ret.insert(QStringLiteral("recentStalls"), this->recentStalls());
+    return ret;
+}
+
+QString EventLoopMonitor::saveReport(const QString &fileName) const
+{
+    QString filePath = fileName;
+    if (filePath.isEmpty()) {
+        const QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+        filePath = dir.absoluteFilePath(QStringLiteral("eventloopmonitor.json"));
+    }
+
+    QFile file(filePath);
+    if (!file.open(QFile::WriteOnly))
+        return QString();
+
+    file.write(QJsonDocument(this->report()).toJson());
+    return filePath;
+}
+
+void EventLoopMonitor::reset()
+{
+    this->beginResetModel();
+    m_entries.clear();
+    m_eventTypeEntries.clear();
+    m_timerEntries.clear();
+    m_timerClassEntries.clear();
+    m_nrModelRows = 0;
+    m_modelDirty = false;
+    this->endResetModel();
+
+    m_stalls.clear();
+    m_stallCount = 0;
+    emit stallsChanged();
+}
+
+int EventLoopMonitor::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_nrModelRows;
+}
+
+QVariant EventLoopMonitor::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_nrModelRows)
+        return QVariant();
+
+    const Entry &entry = m_entries.at(index.row());
+    const DurationHistogram &histogram = entry.histogram;
+    switch (role) {
+    case KindRole:
+        return entry.isTimer ? QStringLiteral("timer") : QStringLiteral("event");
+    case Qt::DisplayRole:
+    case NameRole:
+        return entry.name;
+    case CountRole:
+        return histogram.count;
+    case TotalRole:
+        return qreal(histogram.totalNs) / 1e6;
+    case AverageRole:
+        return histogram.count > 0 ? qreal(histogram.totalNs) / 1e6 / qreal(histogram.count) : 0;
+    case MedianRole:
+        return qreal(histogram.percentile(0.5)) / 1e6;
+    case P99Role:
+        return qreal(histogram.percentile(0.99)) / 1e6;
+    case MaximumRole:
+        return qreal(histogram.maxNs) / 1e6;
+    case StallCountRole:
+        return entry.stallCount;
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> EventLoopMonitor::roleNames() const
+{
+    return { { KindRole, QByteArrayLiteral("kind") },
+             { NameRole, QByteArrayLiteral("name") },
+             { CountRole, QByteArrayLiteral("count") },
+             { TotalRole, QByteArrayLiteral("total") },
+             { AverageRole, QByteArrayLiteral("average") },
+             { MedianRole, QByteArrayLiteral("median") },
+             { P99Role, QByteArrayLiteral("p99") },
+             { MaximumRole, QByteArrayLiteral("maximum") },
+             { StallCountRole, QByteArrayLiteral("stallCount") } };
+}
+
+void EventLoopMonitor::timerEvent(QTimerEvent *te)
+{
+    if (te->timerId() == m_refreshTimer.timerId()) {
+        if (!m_modelDirty)
+            return;
+
+        m_modelDirty = false;
+
+        const int nrRows = m_entries.size();
+        if (nrRows > m_nrModelRows) {
+            this->beginInsertRows(QModelIndex(), m_nrModelRows, nrRows - 1);
+            m_nrModelRows = nrRows;
+            this->endInsertRows();
+        }
+
+        if (m_nrModelRows > 0)
+            emit dataChanged(this->index(0, 0), this->index(m_nrModelRows - 1, 0));
+    } else
+        QAbstractListModel::timerEvent(te);
+}
+
+void EventLoopMonitor::beginDispatch(Dispatch *dispatch, QObject *object, QEvent *event)
+{
+    // Recording events delivered to the monitor would keep its model changing, even
+    // when nothing else happens.
+    if (object == this)
+        return;
+
+    // Only the GUI thread's event loop is of interest here.
+    QThread *thread = QThread::currentThread();
+    if (thread != this->thread())
+        return;
+
+    const int loopLevel = thread->loopLevel();
+    if (m_loopLevel >= 0 && loopLevel > m_loopLevel)
+        ++m_nestedLoopSerial;
+
+    dispatch->m_monitor = this;
+    dispatch->m_eventType = event->type();
+    dispatch->m_className = object->metaObject()->className();
+    dispatch->m_stallCount = m_stallCount;
+    dispatch->m_outerLoopLevel = m_loopLevel;
+    dispatch->m_nestedLoopSerial = m_nestedLoopSerial;
+    m_loopLevel = loopLevel;
+
+    // Names are only shared here, not built. Class names are turned into strings only
+    // the first time they show up.
+    if (event->type() == QEvent::Timer) {
+        const ExecLaterTimerEvent *execLaterTimerEvent =
+                dynamic_cast<const ExecLaterTimerEvent *>(event);
+        if (execLaterTimerEvent != nullptr)
+            dispatch->m_timerName = execLaterTimerEvent->timerName();
+        else {
+            const QTimer *timer = qobject_cast<QTimer *>(object);
+            if (timer != nullptr)
+                dispatch->m_timerName = timer->objectName();
+            if (dispatch->m_timerName.isEmpty())
+                dispatch->m_timerClassName = dispatch->m_className;
+        }
+    }
+
+    dispatch->m_startNs = TimeProfiler::timestampNs();
+}
+
+void EventLoopMonitor::endDispatch(Dispatch *dispatch)
+{
+    const qint64 durationNs = TimeProfiler::timestampNs() - dispatch->m_startNs;
+    m_loopLevel = dispatch->m_outerLoopLevel;
+
+    // Dispatches that ran a nested event loop (modal dialogs, QEventLoop::exec() and
+    // such) were not blocking the GUI, so they would only skew the numbers.
+    if (dispatch->m_nestedLoopSerial != m_nestedLoopSerial)
+        return;
+
+    m_modelDirty = true;
+
+    // Indexes rather than references, since adding an entry may grow m_entries
+    const int eventEntryIndex = this->entryForEventType(dispatch->m_eventType);
+    const int timerEntryIndex = !dispatch->m_timerName.isEmpty()
+            ? this->entryForTimer(dispatch->m_timerName)
+            : (dispatch->m_timerClassName != nullptr
+                       ? this->entryForTimerClass(dispatch->m_timerClassName)
+                       : -1);
+
+    Entry &eventEntry = m_entries[eventEntryIndex];
+    eventEntry.histogram.add(durationNs);
+
+    Entry *timerEntry = timerEntryIndex < 0 ? nullptr : &m_entries[timerEntryIndex];
+    if (timerEntry != nullptr)
+        timerEntry->histogram.add(durationNs);
+
+    // A stall is reported against the innermost dispatch that took too long, so that
+    // it is attributed to whatever actually did the work.
+    if (durationNs < qint64(m_stallThreshold) * 1000000 || dispatch->m_stallCount != m_stallCount)
+        return;
+
+    ++m_stallCount;
+    ++eventEntry.stallCount;
+    if (timerEntry != nullptr)
+        ++timerEntry->stallCount;
+
+    Stall stall;
+    stall.timestamp = QDateTime::currentMSecsSinceEpoch();
+    stall.durationNs = durationNs;
+    stall.eventType = eventEntry.name;
+    stall.className = QLatin1String(dispatch->m_className);
+    stall.timerName = timerEntry != nullptr ? timerEntry->name : QString();
+    m_stalls.append(stall);
+    if (m_stalls.size() > MaxRecentStalls)
+        m_stalls.removeFirst();
+
+    emit stallDetected(stall.eventType, stall.className, stall.timerName,
+                       qreal(durationNs) / 1e6);
+    emit stallsChanged();
+}
+
+QString EventLoopMonitor::eventTypeName(QEvent::Type type)
+{
+    static const QMetaEnum typeEnum = QMetaEnum::fromType<QEvent::Type>();
+    const char *key = typeEnum.valueToKey(type);
+    if (key != nullptr)
+        return QLatin1String(key);
+
+    if (type >= QEvent::User && type <= QEvent::MaxUser)
+        return QStringLiteral("User+") + QString::number(type - QEvent::User);
+
+    return QStringLiteral("Event ") + QString::number(type);
+}
+
+int EventLoopMonitor::entryForEventType(QEvent::Type type)
+{
+    auto it = m_eventTypeEntries.find(type);
+    if (it != m_eventTypeEntries.end())
+        return it.value();
+
+    Entry entry;
+    entry.name = eventTypeName(type);
+    m_entries.append(entry);
+    m_eventTypeEntries.insert(type, m_entries.size() - 1);
+    return m_entries.size() - 1;
+}
+
+int EventLoopMonitor::entryForTimer(const QString &name)
+{
+    auto it = m_timerEntries.find(name);
+    if (it != m_timerEntries.end())
+        return it.value();
+
+    Entry entry;
+    entry.isTimer = true;
+    entry.name = name;
+    m_entries.append(entry);
+    m_timerEntries.insert(name, m_entries.size() - 1);
+    return m_entries.size() - 1;
+}
+
+int EventLoopMonitor::entryForTimerClass(const char *className)
+{
+    auto it = m_timerClassEntries.find(className);
+    if (it != m_timerClassEntries.end())
+        return it.value();
+
+    const int ret = this->entryForTimer(QLatin1String(className));
+    m_timerClassEntries.insert(className, ret);
+    return ret;
+}
+
+QJsonObject EventLoopMonitor::toJson(const Entry &entry) const
+{
+    const DurationHistogram &histogram = entry.histogram;
+
+    QJsonObject ret;
+    ret.insert(QStringLiteral("name"), entry.name);
+    ret.insert(QStringLiteral("count"), qint64(histogram.count));
+    ret.insert(QStringLiteral("totalMs"), qreal(histogram.totalNs) / 1e6);
+    ret.insert(QStringLiteral("maxMs"), qreal(histogram.maxNs) / 1e6);
+    ret.insert(QStringLiteral("p50Ms"), qreal(histogram.percentile(0.5)) / 1e6);
+    ret.insert(QStringLiteral("p99Ms"), qreal(histogram.percentile(0.99)) / 1e6);
+    ret.insert(QStringLiteral("stallCount"), entry.stallCount);
+    return ret;
+}
+
+QJsonObject EventLoopMonitor::toJson(const Stall &stall) const
+{
+    QJsonObject ret;
+    ret.insert(QStringLiteral("timestamp"),
+               QDateTime::fromMSecsSinceEpoch(stall.timestamp).toString(Qt::ISODateWithMs));
+    ret.insert(QStringLiteral("durationMs"), qreal(stall.durationNs) / 1e6);
+    ret.insert(QStringLiteral("eventType"), stall.eventType);
+    ret.insert(QStringLiteral("className"), stall.className);
+    if (!stall.timerName.isEmpty())
+        ret.insert(QStringLiteral("timerName"), stall.timerName);
+    return ret;
+}
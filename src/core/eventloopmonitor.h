@@ -0,0 +1,171 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef EVENTLOOPMONITOR_H
+#define EVENTLOOPMONITOR_H
+
+#include <QHash>
+#include <QEvent>
+#include <QVector>
+#include <QAtomicInt>
+#include <QBasicTimer>
+#include <QJsonArray>
+#include <QQmlEngine>
+#include <QJsonObject>
+#include <QAbstractListModel>
+
+#include "durationhistogram.h"
+
+/**
+ * Measures how long the GUI thread spends dispatching each event. Durations are
+ * recorded into one histogram per event type, and one per named timer (ExecLaterTimer
+ * name, QTimer object name or receiver class). Dispatches longer than stallThreshold
+ * are reported as stalls, along with the receiver's class and the timer's name.
+ *
+ * Each row in this model is one histogram. Rows are refreshed about once a second.
+ *
+ * The monitor is off by default, set SCRITE_EVENT_LOOP_MONITOR=1 or the enabled
+ * property to switch it on. While it is off, dispatches only check one flag. Events
+ * delivered to the monitor itself, like its refresh timer, are never recorded.
+ */
+class EventLoopMonitor : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Instantiation from QML not allowed.")
+
+public:
+    explicit EventLoopMonitor(QObject *parent = nullptr);
+    ~EventLoopMonitor();
+
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    void setEnabled(bool val);
+    bool isEnabled() const { return m_enabled.loadRelaxed() != 0; }
+    Q_SIGNAL void enabledChanged();
+
+    Q_PROPERTY(int stallThreshold READ stallThreshold WRITE setStallThreshold NOTIFY
+                       stallThresholdChanged)
+    void setStallThreshold(int val);
+    int stallThreshold() const { return m_stallThreshold; }
+    Q_SIGNAL void stallThresholdChanged();
+
+    Q_PROPERTY(int stallCount READ stallCount NOTIFY stallsChanged)
+    int stallCount() const { return m_stallCount; }
+
+    // Most recent stalls, newest last.
+    Q_PROPERTY(QJsonArray recentStalls READ recentStalls NOTIFY stallsChanged)
+    QJsonArray recentStalls() const;
+
+    Q_SIGNAL void stallsChanged();
+    Q_SIGNAL void stallDetected(const QString &eventType, const QString &className,
+                                const QString &timerName, qreal duration);
+
+    Q_INVOKABLE QJsonObject report() const;
+
+    // Writes report() as JSON into fileName, or into a file in the app-data folder
+    // if fileName is empty. Returns the path of the file written, or an empty string.
+    Q_INVOKABLE QString saveReport(const QString &fileName = QString()) const;
+
+    Q_INVOKABLE void reset();
+
+    // Place one of these on the stack in QCoreApplication::notify()
+    class Dispatch
+    {
+    public:
+        Dispatch(EventLoopMonitor *monitor, QObject *object, QEvent *event)
+        {
+            if (monitor != nullptr && monitor->m_enabled.loadRelaxed() != 0)
+                monitor->beginDispatch(this, object, event);
+        }
+        ~Dispatch()
+        {
+            if (m_monitor != nullptr)
+                m_monitor->endDispatch(this);
+        }
+
+    private:
+        friend class EventLoopMonitor;
+        EventLoopMonitor *m_monitor = nullptr;
+        QEvent::Type m_eventType = QEvent::None;
+        const char *m_className = nullptr;
+        QString m_timerName; // of ExecLaterTimer or QTimer
+        const char *m_timerClassName = nullptr; // of other receivers of timer events
+        qint64 m_startNs = 0;
+        int m_stallCount = 0;
+        int m_outerLoopLevel = -1;
+        quint64 m_nestedLoopSerial = 0;
+    };
+
+    // QAbstractItemModel interface
+    enum Roles {
+        KindRole = Qt::UserRole,
+        NameRole,
+        CountRole,
+        TotalRole,
+        AverageRole,
+        MedianRole,
+        P99Role,
+        MaximumRole,
+        StallCountRole
+    };
+    int rowCount(const QModelIndex &parent) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QHash<int, QByteArray> roleNames() const;
+
+protected:
+    void timerEvent(QTimerEvent *te);
+
+private:
+    void beginDispatch(Dispatch *dispatch, QObject *object, QEvent *event);
+    void endDispatch(Dispatch *dispatch);
+    static QString eventTypeName(QEvent::Type type);
+
+    struct Entry
+    {
+        bool isTimer = false;
+        QString name;
+        DurationHistogram histogram;
+        int stallCount = 0;
+    };
+    int entryForEventType(QEvent::Type type);
+    int entryForTimer(const QString &name);
+    int entryForTimerClass(const char *className);
+    QJsonObject toJson(const Entry &entry) const;
+
+    struct Stall
+    {
+        qint64 timestamp = 0; // msecs since epoch
+        qint64 durationNs = 0;
+        QString eventType;
+        QString className;
+        QString timerName;
+    };
+    QJsonObject toJson(const Stall &stall) const;
+
+private:
+    QAtomicInt m_enabled { 0 }; // read by dispatches in all threads
+    int m_stallThreshold = 100; // msecs
+    int m_stallCount = 0;
+    int m_loopLevel = -1; // of the innermost dispatch in progress
+    quint64 m_nestedLoopSerial = 0;
+    bool m_modelDirty = false;
+    int m_nrModelRows = 0;
+    QVector<Entry> m_entries; // first m_nrModelRows are visible in the model
+    QHash<int, int> m_eventTypeEntries;
+    QHash<QString, int> m_timerEntries;
+    QHash<const char *, int> m_timerClassEntries; // class names are static strings
+    QList<Stall> m_stalls;
+    QBasicTimer m_refreshTimer;
+};
+
+#endif // EVENTLOOPMONITOR_H
@@ -321,14 +321,14 @@ void CharacterRelationshipGraph::setStructure(Structure *val)
 
     if (!m_structure.isNull())
         disconnect(m_structure, &Structure::characterCountChanged, this,
-                   &CharacterRelationshipGraph::markDirty);
+                   &CharacterRelationshipGraph::updateLater);
 
     m_structure = val;
     emit structureChanged();
 
     if (!m_structure.isNull())
         connect(m_structure, &Structure::characterCountChanged, this,
-                &CharacterRelationshipGraph::markDirty);
+                &CharacterRelationshipGraph::updateLater);
 
     this->loadLater();
 }
@@ -340,14 +340,14 @@ void CharacterRelationshipGraph::setScene(Scene *val)
 
     if (!m_scene.isNull())
         disconnect(m_scene, &Scene::characterNamesChanged, this,
-                   &CharacterRelationshipGraph::markDirty);
+                   &CharacterRelationshipGraph::updateLater);
 
     m_scene = val;
     emit sceneChanged();
 
     if (!m_scene.isNull())
         connect(m_scene, &Scene::characterNamesChanged, this,
-                &CharacterRelationshipGraph::markDirty);
+                &CharacterRelationshipGraph::updateLater);
 
     this->loadLater();
 }
@@ -359,7 +359,7 @@ void CharacterRelationshipGraph::setCharacter(Character *val)
 
     if (!m_character.isNull()) {
         disconnect(m_character, &Character::relationshipCountChanged, this,
-                   &CharacterRelationshipGraph::loadLater);
+                   &CharacterRelationshipGraph::updateLater);
         disconnect(m_character, &Character::nameChanged, this, &CharacterRelationshipGraph::reset);
     }
 
@@ -368,7 +368,7 @@ void CharacterRelationshipGraph::setCharacter(Character *val)
 
     if (!m_character.isNull()) {
         connect(m_character, &Character::relationshipCountChanged, this,
-                &CharacterRelationshipGraph::loadLater);
+                &CharacterRelationshipGraph::updateLater);
         connect(m_character, &Character::nameChanged, this, &CharacterRelationshipGraph::reset);
     }
 
@@ -517,7 +517,10 @@ void CharacterRelationshipGraph::timerEvent(QTimerEvent *te)
 {
     if (te->timerId() == m_loadTimer.timerId()) {
         m_loadTimer.stop();
-        this->load();
+        if (m_loadRequired)
+            this->load();
+        else
+            this->update();
     }
 }
 
@@ -558,11 +561,12 @@ void CharacterRelationshipGraph::load()
     HourGlass hourGlass;
     this->setBusy(true);
 
+    m_loadRequired = false;
+
     QList<CharacterRelationshipGraphEdge *> edges = m_edges.list();
     m_edges.clear();
     for (CharacterRelationshipGraphEdge *edge : qAsConst(edges)) {
-        disconnect(edge->relationship(), &Relationship::aboutToDelete, this,
-                   &CharacterRelationshipGraph::loadLater);
+        this->trackEdge(edge, false);
         GarbageCollector::instance()->add(edge);
     }
     edges.clear();
@@ -570,27 +574,20 @@ void CharacterRelationshipGraph::load()
     QList<CharacterRelationshipGraphNode *> nodes = m_nodes.list();
     m_nodes.clear();
     for (CharacterRelationshipGraphNode *node : qAsConst(nodes)) {
-        disconnect(node->character(), &Character::aboutToDelete, this,
-                   &CharacterRelationshipGraph::loadLater);
+        this->trackNode(node, false);
         GarbageCollector::instance()->add(node);
     }
     nodes.clear();
 
     if (m_structure.isNull() || !m_componentLoaded) {
         this->setBusy(false);
-        this->setDirty(false);
         this->setGraphBoundingRect(QRectF(0, 0, 0, 0));
         emit updated();
         return;
     }
 
-    // If the graph is being requested for a specific scene, then we will have
-    // to consider this character, only and only if it shows up in the scene
-    // or is related to one of the characters in the scene.
-    const QStringList sceneCharacterNames = m_character.isNull()
-            ? (m_scene.isNull() ? QStringList() : m_scene->characterNames())
-            : QStringList() << m_character->name();
-    const QList<Character *> sceneCharacters = m_structure->findCharacters(sceneCharacterNames);
+    QList<Character *> sceneCharacters;
+    const QList<Character *> characters = this->evaluateCharacters(sceneCharacters);
 
     // Lets fetch information about the graph as previously placed by the user.
     const QJsonObject previousGraphJson =
@@ -606,34 +603,7 @@ void CharacterRelationshipGraph::load()
     // dont have any relationship with anybody else in the screenplay.
     graphs.append(GraphLayout::Graph());
 
-    const QList<Character *> characters = m_structure->charactersModel()->list();
     for (Character *character : characters) {
-        // If the graph is being requested for a specific scene, then we will have
-        // to consider this character, only and only if it shows up in the scene
-        // or is related to one of the characters in the scene.
-        if (!m_scene.isNull()) {
-            bool include = sceneCharacters.contains(character);
-            if (!include) {
-                for (Character *sceneCharacter : sceneCharacters) {
-                    include = character->isRelatedTo(sceneCharacter);
-                    if (include)
-                        break;
-                }
-            }
-
-            if (!include)
-                continue;
-        }
-
-        // If graph is being requested for a specific character, then we have to
-        // consider only those characters with whom it has a direct relationship.
-        if (!m_character.isNull()) {
-            const bool include = (m_character == character
-                                  || m_character->findRelationship(character) != nullptr);
-            if (!include)
-                continue;
-        }
-
         CharacterRelationshipGraphNode *node = new CharacterRelationshipGraphNode(this);
         node->setCharacter(character);
         node->setRect(QRectF(QPointF(0, 0), m_nodeSize));
@@ -720,10 +690,7 @@ void CharacterRelationshipGraph::load()
                 CharacterRelationshipGraphEdge *edge =
                         new CharacterRelationshipGraphEdge(node1, node2, this);
                 edge->setRelationship(relationship);
-                edge->setForwardLabel(relationship->name());
-                const Relationship *reverseRelationship = with->findRelationship(character);
-                if (reverseRelationship != nullptr)
-                    edge->setReverseLabel(reverseRelationship->name());
+                updateEdgeLabels(edge);
                 edges.append(edge);
                 graph.edges.append(edge);
             }
@@ -767,19 +734,7 @@ void CharacterRelationshipGraph::load()
             CharacterRelationshipGraphNode *gnode =
                     qobject_cast<CharacterRelationshipGraphNode *>(agnode->containerObject());
 
-            const Character *character = gnode->character();
-
-            const QJsonValue rectJsonValue = previousGraphJson.value(character->name());
-            if (!rectJsonValue.isUndefined() && rectJsonValue.isObject()) {
-                const QJsonObject rectJson = rectJsonValue.toObject();
-                const QRectF rect(rectJson.value("x").toDouble(), rectJson.value("y").toDouble(),
-                                  rectJson.value("width").toDouble(),
-                                  rectJson.value("height").toDouble());
-                if (rect.isValid()) {
-                    gnode->setRect(rect);
-                    gnode->m_placedByUser = true;
-                }
-            }
+            this->restoreNodePlacement(gnode, previousGraphJson);
 
             graphRect |= gnode->rect();
         }
@@ -804,12 +759,10 @@ void CharacterRelationshipGraph::load()
     }
 
     for (CharacterRelationshipGraphNode *node : qAsConst(nodes))
-        connect(node->character(), &Character::aboutToDelete, this,
-                &CharacterRelationshipGraph::loadLater, Qt::UniqueConnection);
+        this->trackNode(node, true);
 
     for (CharacterRelationshipGraphEdge *edge : qAsConst(edges)) {
-        connect(edge->relationship(), &Relationship::aboutToDelete, this,
-                &CharacterRelationshipGraph::loadLater, Qt::UniqueConnection);
+        this->trackEdge(edge, true);
         edge->setEvaluatePathAllowed(true);
     }
 
@@ -822,16 +775,393 @@ void CharacterRelationshipGraph::load()
     this->setGraphBoundingRect(boundingRect);
 
     this->setBusy(false);
-    this->setDirty(false);
 
     emit updated();
 }
 
 void CharacterRelationshipGraph::loadLater()
 {
+    m_loadRequired = true;
     m_loadTimer.start(0, this);
 }
 
+void CharacterRelationshipGraph::update()
+{
+    if (m_structure.isNull() || !m_componentLoaded || m_nodes.isEmpty()) {
+        this->load();
+        return;
+    }
+
+    this->setBusy(true);
+
+    QList<Character *> sceneCharacters;
+    const QList<Character *> characters = this->evaluateCharacters(sceneCharacters);
+    const QSet<Character *> characterSet(characters.begin(), characters.end());
+
+    const QJsonObject previousGraphJson =
+            this->graphJsonObject()->property("characterRelationshipGraph").value<QJsonObject>();
+
+    bool changed = false;
+    QSet<CharacterRelationshipGraphNode *> affectedNodes;
+    QHash<Character *, CharacterRelationshipGraphNode *> nodeMap;
+
+    // Retain nodes of characters that are still in the graph, and drop the rest. Retained
+    // nodes resume layout from where they are on the canvas now.
+    for (int i = m_nodes.size() - 1; i >= 0; i--) {
+        CharacterRelationshipGraphNode *node = m_nodes.at(i);
+        Character *character = node->character();
+        if (character != nullptr && characterSet.contains(character)
+            && !nodeMap.contains(character)) {
+            nodeMap.insert(character, node);
+            node->setPosition(node->rect().center());
+            continue;
+        }
+
+        this->trackNode(node, false);
+        m_nodes.removeAt(i);
+        GarbageCollector::instance()->add(node);
+        changed = true;
+    }
+
+    QList<CharacterRelationshipGraphNode *> newNodes;
+    for (Character *character : characters) {
+        CharacterRelationshipGraphNode *node = nodeMap.value(character);
+        if (node == nullptr) {
+            node = new CharacterRelationshipGraphNode(this);
+            node->setCharacter(character);
+            node->setRect(QRectF(QPointF(0, 0), m_nodeSize));
+            if (this->restoreNodePlacement(node, previousGraphJson))
+                node->setPosition(node->rect().center());
+            nodeMap.insert(character, node);
+            newNodes.append(node);
+            affectedNodes.insert(node);
+        }
+
+        if (!m_scene.isNull())
+            node->setMarked(sceneCharacters.contains(character));
+    }
+
+    // Retain edges whose relationship still joins the same nodes, and drop the rest.
+    // Nodes at either end of an edge that was added or dropped are laid out again.
+    typedef QPair<CharacterRelationshipGraphNode *, CharacterRelationshipGraphNode *> NodePair;
+    QHash<Relationship *, NodePair> wantedEdges;
+    for (auto it = nodeMap.constBegin(); it != nodeMap.constEnd(); ++it) {
+        const QList<Relationship *> relationships = it.key()->relationshipsModel()->list();
+        for (Relationship *relationship : relationships) {
+            if (relationship->direction() != Relationship::OfWith)
+                continue;
+
+            CharacterRelationshipGraphNode *node2 = nodeMap.value(relationship->with());
+            if (node2 != nullptr)
+                wantedEdges.insert(relationship, qMakePair(it.value(), node2));
+        }
+    }
+
+    for (int i = m_edges.size() - 1; i >= 0; i--) {
+        CharacterRelationshipGraphEdge *edge = m_edges.at(i);
+        auto it = wantedEdges.find(edge->relationship());
+        if (it != wantedEdges.end() && it.value().first == edge->m_fromNode
+            && it.value().second == edge->m_toNode) {
+            updateEdgeLabels(edge);
+            wantedEdges.erase(it);
+            continue;
+        }
+
+        for (CharacterRelationshipGraphNode *node :
+             { edge->m_fromNode.data(), edge->m_toNode.data() }) {
+            if (node != nullptr && nodeMap.value(node->character()) == node)
+                affectedNodes.insert(node);
+        }
+
+        this->trackEdge(edge, false);
+        m_edges.removeAt(i);
+        GarbageCollector::instance()->add(edge);
+        changed = true;
+    }
+
+    QList<CharacterRelationshipGraphEdge *> newEdges;
+    for (auto it = wantedEdges.constBegin(); it != wantedEdges.constEnd(); ++it) {
+        CharacterRelationshipGraphEdge *edge =
+                new CharacterRelationshipGraphEdge(it.value().first, it.value().second, this);
+        edge->setRelationship(it.key());
+        updateEdgeLabels(edge);
+        affectedNodes.insert(it.value().first);
+        affectedNodes.insert(it.value().second);
+        newEdges.append(edge);
+    }
+
+    changed |= !newNodes.isEmpty() || !newEdges.isEmpty();
+
+    const QList<CharacterRelationshipGraphNode *> allNodes = m_nodes.list() + newNodes;
+    const QList<CharacterRelationshipGraphEdge *> allEdges = m_edges.list() + newEdges;
+
+    QHash<CharacterRelationshipGraphNode *, QList<CharacterRelationshipGraphEdge *>> nodeEdges;
+    for (CharacterRelationshipGraphEdge *edge : allEdges) {
+        nodeEdges[edge->m_fromNode].append(edge);
+        nodeEdges[edge->m_toNode].append(edge);
+    }
+
+    // Components that are entirely new are placed in a row below the rest of the graph
+    QRectF placedRect;
+    for (CharacterRelationshipGraphNode *node : qAsConst(m_nodes))
+        placedRect |= node->rect();
+    if (placedRect.isNull())
+        placedRect = QRectF(m_leftMargin, m_topMargin, 0, 0);
+    QPointF islandPos(placedRect.left(), placedRect.bottom() + 100);
+
+    // Lay out again only connected components that have affected nodes in them, and within
+    // them move only the affected nodes.
+    const QFontMetricsF fm(qApp->font());
+    QSet<CharacterRelationshipGraphNode *> visitedNodes;
+    for (CharacterRelationshipGraphNode *seed : allNodes) {
+        if (!affectedNodes.contains(seed) || visitedNodes.contains(seed))
+            continue;
+
+        GraphLayout::Graph graph;
+        QList<CharacterRelationshipGraphNode *> componentNodes;
+        QSet<CharacterRelationshipGraphEdge *> componentEdges;
+        QString longestRelationshipName;
+        bool hasPositionedNodes = false;
+
+        QList<CharacterRelationshipGraphNode *> queue({ seed });
+        visitedNodes.insert(seed);
+        while (!queue.isEmpty()) {
+            CharacterRelationshipGraphNode *node = queue.takeFirst();
+            componentNodes.append(node);
+            graph.nodes.append(node);
+            hasPositionedNodes |= node->isPositioned();
+
+            const QList<CharacterRelationshipGraphEdge *> edges = nodeEdges.value(node);
+            for (CharacterRelationshipGraphEdge *edge : edges) {
+                if (componentEdges.contains(edge))
+                    continue;
+
+                componentEdges.insert(edge);
+                graph.edges.append(edge);
+                for (const QString &label : { edge->forwardLabel(), edge->reverseLabel() }) {
+                    if (label.length() > longestRelationshipName.length())
+                        longestRelationshipName = label;
+                }
+
+                CharacterRelationshipGraphNode *other =
+                        edge->m_fromNode == node ? edge->m_toNode : edge->m_fromNode;
+                if (!visitedNodes.contains(other)) {
+                    visitedNodes.insert(other);
+                    queue.append(other);
+                }
+            }
+        }
+
+        GraphLayout::ForceDirectedLayout layout;
+        layout.setMaxTime(m_maxTime);
+        layout.setMaxIterations(m_maxIterations);
+        layout.setMinimumEdgeLength(fm.horizontalAdvance(longestRelationshipName) * 0.5);
+
+        if (hasPositionedNodes) {
+            QVector<GraphLayout::AbstractNode *> movableNodes;
+            for (CharacterRelationshipGraphNode *node : qAsConst(componentNodes)) {
+                if (affectedNodes.contains(node))
+                    movableNodes.append(node);
+            }
+
+            layout.setWarmStart(true);
+            layout.setMovableNodes(movableNodes);
+            if (graph.edges.isEmpty() || layout.layout(graph))
+                continue;
+
+            // There was nothing to warm-start from, as when a character already in the
+            // graph gets its first relationship. New nodes are placed around the others.
+            QPointF center;
+            QList<CharacterRelationshipGraphNode *> unpositionedNodes;
+            for (CharacterRelationshipGraphNode *node : qAsConst(componentNodes)) {
+                if (node->isPositioned())
+                    center += node->rect().center();
+                else
+                    unpositionedNodes.append(node);
+            }
+            center /= qreal(componentNodes.size() - unpositionedNodes.size());
+
+            const qreal radius = layout.minimumEdgeLength()
+                    + QLineF(QPointF(0, 0), QPointF(m_nodeSize.width(), m_nodeSize.height()))
+                              .length();
+            for (int i = 0; i < unpositionedNodes.size(); i++) {
+                const qreal angle = 2 * M_PI * qreal(i) / qreal(unpositionedNodes.size());
+                unpositionedNodes.at(i)->setPosition(center
+                                                     + QPointF(qCos(angle), qSin(angle)) * radius);
+            }
+            continue;
+        }
+
+        layout.layout(graph);
+
+        QRectF graphRect;
+        for (CharacterRelationshipGraphNode *node : qAsConst(componentNodes))
+            graphRect |= node->rect();
+
+        const QPointF dp = islandPos - graphRect.topLeft();
+        for (CharacterRelationshipGraphNode *node : qAsConst(componentNodes))
+            node->setRect(node->rect().translated(dp));
+        islandPos.setX(islandPos.x() + graphRect.width() + 100);
+    }
+
+    for (CharacterRelationshipGraphNode *node : qAsConst(newNodes)) {
+        this->trackNode(node, true);
+        m_nodes.append(node);
+    }
+
+    for (CharacterRelationshipGraphEdge *edge : qAsConst(newEdges)) {
+        this->trackEdge(edge, true);
+        edge->setEvaluatePathAllowed(true);
+        m_edges.append(edge);
+    }
+
+    this->setGraphBoundingRect(this->evaluateBoundingRect());
+
+    this->setBusy(false);
+
+    if (changed)
+        emit updated();
+}
+
+void CharacterRelationshipGraph::updateLater()
+{
+    m_loadTimer.start(0, this);
+}
+
+QList<Character *>
+CharacterRelationshipGraph::evaluateCharacters(QList<Character *> &sceneCharacters) const
+{
+    // If the graph is being requested for a specific scene, then we will have
+    // to consider this character, only and only if it shows up in the scene
+    // or is related to one of the characters in the scene.
+    const QStringList sceneCharacterNames = m_character.isNull()
+            ? (m_scene.isNull() ? QStringList() : m_scene->characterNames())
+            : QStringList() << m_character->name();
+    sceneCharacters = m_structure->findCharacters(sceneCharacterNames);
+
+    QList<Character *> ret;
+
+    const QList<Character *> characters = m_structure->charactersModel()->list();
+    for (Character *character : characters) {
+        if (!m_scene.isNull()) {
+            bool include = sceneCharacters.contains(character);
+            if (!include) {
+                for (Character *sceneCharacter : qAsConst(sceneCharacters)) {
+                    include = character->isRelatedTo(sceneCharacter);
+                    if (include)
+                        break;
+                }
+            }
+
+            if (!include)
+                continue;
+        }
+
+        // If graph is being requested for a specific character, then we have to
+        // consider only those characters with whom it has a direct relationship.
+        if (!m_character.isNull()) {
+            const bool include = (m_character == character
+                                  || m_character->findRelationship(character) != nullptr);
+            if (!include)
+                continue;
+        }
+
+        ret.append(character);
+    }
+
+    return ret;
+}
+
+bool CharacterRelationshipGraph::restoreNodePlacement(CharacterRelationshipGraphNode *node,
+                                                      const QJsonObject &graphJson) const
+{
+    const QJsonValue rectJsonValue = graphJson.value(node->character()->name());
+    if (rectJsonValue.isUndefined() || !rectJsonValue.isObject())
+        return false;
+
+    const QJsonObject rectJson = rectJsonValue.toObject();
+    const QRectF rect(rectJson.value("x").toDouble(), rectJson.value("y").toDouble(),
+                      rectJson.value("width").toDouble(), rectJson.value("height").toDouble());
+    if (!rect.isValid())
+        return false;
+
+    node->setRect(rect);
+    node->m_placedByUser = true;
+    return true;
+}
+
+void CharacterRelationshipGraph::trackNode(CharacterRelationshipGraphNode *node, bool track)
+{
+    Character *character = node->character();
+    if (character == nullptr)
+        return;
+
+    // Relationships of the character whose graph this is are tracked by setCharacter()
+    const bool trackRelationships = character != m_character;
+
+    if (track) {
+        connect(character, &Character::aboutToDelete, this,
+                &CharacterRelationshipGraph::updateLater, Qt::UniqueConnection);
+        if (trackRelationships)
+            connect(character, &Character::relationshipCountChanged, this,
+                    &CharacterRelationshipGraph::updateLater, Qt::UniqueConnection);
+    } else {
+        disconnect(character, &Character::aboutToDelete, this,
+                   &CharacterRelationshipGraph::updateLater);
+        if (trackRelationships)
+            disconnect(character, &Character::relationshipCountChanged, this,
+                       &CharacterRelationshipGraph::updateLater);
+    }
+}
+
+void CharacterRelationshipGraph::trackEdge(CharacterRelationshipGraphEdge *edge, bool track)
+{
+    Relationship *relationship = edge->relationship();
+    if (relationship == nullptr)
+        return;
+
+    if (track) {
+        connect(relationship, &Relationship::aboutToDelete, this,
+                &CharacterRelationshipGraph::updateLater, Qt::UniqueConnection);
+        connect(relationship, &Relationship::nameChanged, this,
+                &CharacterRelationshipGraph::updateLater, Qt::UniqueConnection);
+    } else {
+        disconnect(relationship, &Relationship::aboutToDelete, this,
+                   &CharacterRelationshipGraph::updateLater);
+        disconnect(relationship, &Relationship::nameChanged, this,
+                   &CharacterRelationshipGraph::updateLater);
+    }
+}
+
+void CharacterRelationshipGraph::updateEdgeLabels(CharacterRelationshipGraphEdge *edge)
+{
+    const Relationship *relationship = edge->relationship();
+    if (relationship == nullptr)
+        return;
+
+    edge->setForwardLabel(relationship->name());
+
+    Character *of = edge->m_fromNode ? edge->m_fromNode->character() : nullptr;
+    Character *with = edge->m_toNode ? edge->m_toNode->character() : nullptr;
+    const Relationship *reverseRelationship =
+            of && with ? with->findRelationship(of) : nullptr;
+    edge->setReverseLabel(reverseRelationship ? reverseRelationship->name() : QString());
+}
+
+QRectF CharacterRelationshipGraph::evaluateBoundingRect() const
+{
+    QRectF boundingRect;
+    for (int i = 0; i < m_nodes.size(); i++)
+        boundingRect |= m_nodes.at(i)->rect();
+
+    if (boundingRect.isNull())
+        return QRectF(m_leftMargin, m_topMargin, 0, 0);
+
+    boundingRect.setRight(boundingRect.right() + m_rightMargin);
+    boundingRect.setBottom(boundingRect.bottom() + m_bottomMargin);
+    return boundingRect;
+}
+
 void CharacterRelationshipGraph::evaluateTitle()
 {
     const QString defaultTitle = QStringLiteral("Character Relationship Graph");
@@ -853,15 +1183,6 @@ void CharacterRelationshipGraph::evaluateTitle()
     emit titleChanged();
 }
 
-void CharacterRelationshipGraph::setDirty(bool val)
-{
-    if (m_dirty == val)
-        return;
-
-    m_dirty = val;
-    emit dirtyChanged();
-}
-
 void CharacterRelationshipGraph::setBusy(bool val)
 {
     if (m_busy == val)
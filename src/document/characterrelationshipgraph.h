@@ -154,6 +154,13 @@ private:
     QPointer<CharacterRelationshipGraphNode> m_fromNode;
 };
 
+/**
+ * Nodes of characters and edges of relationships between them, laid out using a force
+ * directed layout. The graph is built and laid out afresh when what it shows changes
+ * (structure, scene, character), or its geometry does. Changes to characters and
+ * relationships after that are patched into the existing nodes and edges; only the
+ * neighbourhood of what changed is laid out again, starting from current positions.
+ */
 class CharacterRelationshipGraph : public QObject, public QQmlParserStatus
 {
     Q_OBJECT
@@ -240,10 +247,6 @@ public:
     qreal bottomMargin() const { return m_bottomMargin; }
     Q_SIGNAL void bottomMarginChanged();
 
-    Q_PROPERTY(bool dirty READ isDirty NOTIFY dirtyChanged)
-    bool isDirty() const { return m_dirty; }
-    Q_SIGNAL void dirtyChanged();
-
     Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged)
     bool isBusy() const { return m_busy; }
     Q_SIGNAL void busyChanged();
@@ -274,14 +277,21 @@ private:
     void resetCharacter();
     void load();
     void loadLater();
+    void update();
+    void updateLater();
     void evaluateTitle();
-    void markDirty() { this->setDirty(true); }
-    void setDirty(bool val);
     void setBusy(bool val);
 
+    QList<Character *> evaluateCharacters(QList<Character *> &sceneCharacters) const;
+    bool restoreNodePlacement(CharacterRelationshipGraphNode *node,
+                              const QJsonObject &graphJson) const;
+    void trackNode(CharacterRelationshipGraphNode *node, bool track);
+    void trackEdge(CharacterRelationshipGraphEdge *edge, bool track);
+    static void updateEdgeLabels(CharacterRelationshipGraphEdge *edge);
+    QRectF evaluateBoundingRect() const;
+
 private:
     bool m_busy = false;
-    bool m_dirty = false;
     int m_maxTime = 100;
     QString m_title;
     QSizeF m_nodeSize = QSizeF(100, 100);
@@ -294,6 +304,7 @@ private:
     bool m_componentLoaded = false;
     QRectF m_graphBoundingRect = QRectF(0, 0, 500, 500);
     ExecLaterTimer m_loadTimer;
+    bool m_loadRequired = true; // else, m_loadTimer only patches the graph
     ErrorReport *m_errorReport = new ErrorReport(this);
     QObjectProperty<Character> m_character;
     QObjectProperty<Structure> m_structure;
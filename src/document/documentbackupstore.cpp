@@ -0,0 +1,291 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+
+#include "documentbackupstore.h"
+#include "documentfilesystem.h"
+#include "timeprofiler.h"
+
+#include <QSet>
+#include <QFile>
+#include <QMutex>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDirIterator>
+#include <QCryptographicHash>
+#include <QtConcurrentRun>
+
+#include "quazip.h"
+#include "quazipfile.h"
+
+const QString DocumentBackupStore::manifestSuffix = QStringLiteral("scrite-backup");
+
+Q_GLOBAL_STATIC(QMutex, BackgroundJobMutex)
+
+DocumentBackupStore::DocumentBackupStore(const QString &backupDirPath)
+    : m_dir(backupDirPath), m_blobsDir(backupDirPath + QStringLiteral("/.blobs"))
+{
+}
+
+DocumentBackupStore::~DocumentBackupStore() { }
+
+bool DocumentBackupStore::add(const QString &documentFileName, const QString &manifestFileName)
+{
+    PROFILE_THIS_FUNCTION;
+
+    QuaZip qzip(documentFileName);
+    qzip.setUtf8Enabled(true);
+    if (!qzip.open(QuaZip::mdUnzip))
+        return false;
+
+    QJsonArray entries;
+    for (bool more = qzip.goToFirstFile(); more; more = qzip.goToNextFile()) {
+        const QString path = qzip.getCurrentFileName();
+
+        QuaZipFile file(&qzip);
+        if (!file.open(QFile::ReadOnly)) {
+            qInfo("Could not open '%s' for reading.", qPrintable(path));
+            return false;
+        }
+
+        const QByteArray bytes = file.readAll();
+        file.close();
+        if (file.getZipError() != UNZ_OK)
+            return false;
+
+        const QString hash = QString::fromLatin1(
+                QCryptographicHash::hash(bytes, QCryptographicHash::Sha1).toHex());
+        if (!this->storeBlob(hash, bytes))
+            return false;
+
+        QJsonObject entry;
+        entry.insert(QStringLiteral("path"), path);
+        entry.insert(QStringLiteral("hash"), hash);
+        entry.insert(QStringLiteral("size"), bytes.size());
+        entries.append(entry);
+    }
+
+    qzip.close();
+
+    if (entries.isEmpty())
+        return false;
+
+    // Metadata and element counts are copied into the manifest, so that backups can be
+    // listed without reading any of the blobs. Counts are those the backups model shows
+    // for plain backups, which it finds by loading them.
+    const QFileInfo documentFileInfo(documentFileName);
+
+    int structureElementCount = 0;
+    int screenplayElementCount = 0;
+    DocumentFileSystem::peekHeader(documentFileName, [&](QIODevice *device) {
+        const QJsonObject docObj = QJsonDocument::fromJson(device->readAll()).object();
+        structureElementCount = docObj.value(QStringLiteral("structure"))
+                                        .toObject()
+                                        .value(QStringLiteral("elements"))
+                                        .toArray()
+                                        .size();
+        screenplayElementCount = docObj.value(QStringLiteral("screenplay"))
+                                         .toObject()
+                                         .value(QStringLiteral("elements"))
+                                         .toArray()
+                                         .size();
+    });
+
+    QJsonObject manifest;
+    manifest.insert(QStringLiteral("version"), 1);
+    manifest.insert(QStringLiteral("fileName"), documentFileInfo.fileName());
+    manifest.insert(QStringLiteral("fileSize"), documentFileInfo.size());
+    manifest.insert(QStringLiteral("structureElementCount"), structureElementCount);
+    manifest.insert(QStringLiteral("screenplayElementCount"), screenplayElementCount);
+    manifest.insert(QStringLiteral("metadata"),
+                    QJsonDocument::fromJson(DocumentFileSystem::peekMetadata(documentFileName))
+                            .object());
+    manifest.insert(QStringLiteral("entries"), entries);
+
+    QSaveFile manifestFile(manifestFileName);
+    if (!manifestFile.open(QFile::WriteOnly))
+        return false;
+
+    manifestFile.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact));
+    return manifestFile.commit();
+}
+
+QFuture<bool> DocumentBackupStore::addInBackground(const QString &documentCopyFileName,
+                                                   const QString &manifestFileName,
+                                                   bool collectGarbage)
+{
+    return QtConcurrent::run([=]() -> bool {
+        QMutexLocker jobMutexLocker(BackgroundJobMutex);
+
+        DocumentBackupStore store(QFileInfo(manifestFileName).absolutePath());
+
+        const bool ret = store.add(documentCopyFileName, manifestFileName);
+        if (ret)
+            QFile::remove(documentCopyFileName);
+        else
+            QFile::remove(manifestFileName);
+
+        if (collectGarbage)
+            store.collectGarbage();
+
+        return ret;
+    });
+}
+
+QFuture<int> DocumentBackupStore::collectGarbageInBackground(const QString &backupDirPath)
+{
+    return QtConcurrent::run([=]() -> int {
+        QMutexLocker jobMutexLocker(BackgroundJobMutex);
+
+        DocumentBackupStore store(backupDirPath);
+        return store.collectGarbage();
+    });
+}
+
+int DocumentBackupStore::collectGarbage()
+{
+    PROFILE_THIS_FUNCTION;
+
+    QSet<QString> hashes;
+
+    const QFileInfoList manifestFiles = m_dir.entryInfoList(
+            { QStringLiteral("*.") + manifestSuffix }, QDir::Files, QDir::Name);
+    for (const QFileInfo &manifestFile : manifestFiles) {
+        const QJsonObject manifest = readManifest(manifestFile.absoluteFilePath());
+        const QJsonArray entries = manifest.value(QStringLiteral("entries")).toArray();
+
+        // A manifest that cannot be read may still refer to blobs, so nothing is removed.
+        if (entries.isEmpty())
+            return 0;
+
+        for (const QJsonValue &entry : entries)
+            hashes.insert(entry.toObject().value(QStringLiteral("hash")).toString());
+    }
+
+    int ret = 0;
+
+    QDirIterator it(m_blobsDir.absolutePath(), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        if (!hashes.contains(it.fileName()) && QFile::remove(it.filePath()))
+            ++ret;
+    }
+
+    return ret;
+}
+
+bool DocumentBackupStore::restore(const QString &manifestFileName,
+                                  const QString &documentFileName)
+{
+    PROFILE_THIS_FUNCTION;
+
+    const QJsonArray entries =
+            readManifest(manifestFileName).value(QStringLiteral("entries")).toArray();
+    if (entries.isEmpty())
+        return false;
+
+    const QDir blobsDir(QFileInfo(manifestFileName).absolutePath() + QStringLiteral("/.blobs"));
+
+    QuaZip qzip(documentFileName);
+    qzip.setUtf8Enabled(true);
+    if (!qzip.open(QuaZip::mdCreate)) {
+        qInfo("Could not create %s", qPrintable(documentFileName));
+        return false;
+    }
+
+    bool success = true;
+    for (const QJsonValue &entryValue : entries) {
+        const QJsonObject entry = entryValue.toObject();
+        const QString path = entry.value(QStringLiteral("path")).toString();
+        const QString hash = entry.value(QStringLiteral("hash")).toString();
+
+        // Blobs are checked against their hash, so that a damaged store doesn't quietly
+        // produce a damaged document.
+        QByteArray bytes;
+        success = !path.isEmpty() && readBlob(blobsDir, hash, bytes)
+                && QCryptographicHash::hash(bytes, QCryptographicHash::Sha1).toHex()
+                        == hash.toLatin1();
+        if (!success) {
+            qInfo("Backup entry '%s' is missing or damaged.", qPrintable(path));
+            break;
+        }
+
+        QuaZipFile dstFile(&qzip);
+        success = dstFile.open(QFile::WriteOnly, QuaZipNewInfo(path));
+        if (success) {
+            success = dstFile.write(bytes) == bytes.size();
+            dstFile.close();
+            success &= dstFile.getZipError() == ZIP_OK;
+        }
+
+        if (!success) {
+            qInfo("Could not write '%s'.", qPrintable(path));
+            break;
+        }
+    }
+
+    qzip.close();
+    success &= qzip.getZipError() == ZIP_OK;
+
+    if (!success)
+        QFile::remove(documentFileName);
+
+    return success;
+}
+
+QJsonObject DocumentBackupStore::readManifest(const QString &manifestFileName)
+{
+    QFile manifestFile(manifestFileName);
+    if (!manifestFile.open(QFile::ReadOnly))
+        return QJsonObject();
+
+    return QJsonDocument::fromJson(manifestFile.readAll()).object();
+}
+
+QString DocumentBackupStore::blobFilePath(const QDir &blobsDir, const QString &hash)
+{
+    // Blobs are spread across sub-folders named after the first two characters of
+    // their hash, so that no single folder gets too large.
+    return blobsDir.filePath(hash.left(2) + QStringLiteral("/") + hash);
+}
+
+bool DocumentBackupStore::storeBlob(const QString &hash, const QByteArray &bytes)
+{
+    const QString filePath = blobFilePath(m_blobsDir, hash);
+    if (QFile::exists(filePath))
+        return true;
+
+    m_blobsDir.mkpath(hash.left(2));
+
+    QSaveFile blobFile(filePath);
+    if (!blobFile.open(QFile::WriteOnly))
+        return false;
+
+    blobFile.write(qCompress(bytes));
+    return blobFile.commit();
+}
+
+bool DocumentBackupStore::readBlob(const QDir &blobsDir, const QString &hash, QByteArray &bytes)
+{
+    if (hash.isEmpty())
+        return false;
+
+    QFile blobFile(blobFilePath(blobsDir, hash));
+    if (!blobFile.open(QFile::ReadOnly))
+        return false;
+
+    bytes = qUncompress(blobFile.readAll());
+    return true;
+}
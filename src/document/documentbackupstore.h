@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+
+#ifndef DOCUMENTBACKUPSTORE_H
+#define DOCUMENTBACKUPSTORE_H
+
+#include <QDir>
+#include <QFuture>
+#include <QString>
+#include <QJsonObject>
+
+/**
+ * Backups of a Scrite document stored as content addressed blobs. Each backup is a small
+ * JSON manifest listing entries of the document (header, metadata, attachments) against
+ * hashes of their content. An entry that didn't change since the previous backup is
+ * stored only once. Blobs live in a hidden ".blobs" folder next to the manifests, and are
+ * removed once no manifest refers to them.
+ *
+ * Deduplication works per entry, and all scene content is in the header entry. So what
+ * is shared between backups is mostly attachments (photos, images, files); the header
+ * is stored afresh, compressed, in every backup in which anything changed.
+ */
+class DocumentBackupStore
+{
+public:
+    explicit DocumentBackupStore(const QString &backupDirPath);
+    ~DocumentBackupStore();
+
+    static const QString manifestSuffix;
+
+    QString backupDirPath() const { return m_dir.absolutePath(); }
+
+    // Stores a saved document as a backup described by the given manifest. Only documents
+    // in the ZIP format can be stored, false is returned for others.
+    bool add(const QString &documentFileName, const QString &manifestFileName);
+
+    // Turns a plain copy of a document in the store's folder into a deduplicated backup, in
+    // a worker thread. The copy is removed once its manifest is written, and left as it is
+    // otherwise. Jobs run one after the other, so garbage collected afterwards (if asked)
+    // never removes blobs of a backup still being added.
+    static QFuture<bool> addInBackground(const QString &documentCopyFileName,
+                                         const QString &manifestFileName,
+                                         bool collectGarbage);
+    static QFuture<int> collectGarbageInBackground(const QString &backupDirPath);
+
+    // Removes blobs that no manifest in the store refers to, returns how many were removed.
+    int collectGarbage();
+
+    // Writes the document described by a manifest into a Scrite file.
+    static bool restore(const QString &manifestFileName, const QString &documentFileName);
+
+    static QJsonObject readManifest(const QString &manifestFileName);
+
+private:
+    static QString blobFilePath(const QDir &blobsDir, const QString &hash);
+    bool storeBlob(const QString &hash, const QByteArray &bytes);
+    static bool readBlob(const QDir &blobsDir, const QString &hash, QByteArray &bytes);
+
+private:
+    QDir m_dir;
+    QDir m_blobsDir;
+};
+
+#endif // DOCUMENTBACKUPSTORE_H
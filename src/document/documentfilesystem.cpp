@@ -12,17 +12,22 @@
 ****************************************************************************/
 
 #include "documentfilesystem.h"
+#include "timeprofiler.h"
 
 #include <QDir>
+#include <QBuffer>
 #include <QtDebug>
 #include <QDateTime>
 #include <QDataStream>
+#include <QJsonObject>
+#include <QJsonDocument>
 #include <QTemporaryDir>
 #include <QFutureWatcher>
 #include <QStandardPaths>
 #include <QtConcurrentRun>
 
 #include "quazip.h"
+#include "quacrc32.h"
 #include "quazipfile.h"
 #include "simplecrypt.h"
 #include "restapikey/restapikey.h"
@@ -30,6 +35,7 @@
 struct DocumentFileSystemData
 {
     QByteArray header;
+    QByteArray metadata;
     QList<DocumentFile *> files;
     QMutex folderMutex;
     QScopedPointer<QTemporaryDir> folder;
@@ -37,6 +43,8 @@ struct DocumentFileSystemData
 
     static const QString normalHeaderFile;
     static const QString encryptedHeaderFile;
+    static const QString normalMetadataFile;
+    static const QString encryptedMetadataFile;
 
     void pack(QDataStream &ds, const QString &path);
 
@@ -54,6 +62,9 @@ private:
 const QString DocumentFileSystemData::normalHeaderFile = QStringLiteral("_header.json");
 const QString DocumentFileSystemData::encryptedHeaderFile =
         QStringLiteral("_header.json_encrypted");
+const QString DocumentFileSystemData::normalMetadataFile = QStringLiteral("_metadata.json");
+const QString DocumentFileSystemData::encryptedMetadataFile =
+        QStringLiteral("_metadata.json_encrypted");
 
 void DocumentFileSystemData::pack(QDataStream &ds, const QString &path)
 {
@@ -136,6 +147,7 @@ void DocumentFileSystem::hardReset()
 void DocumentFileSystem::reset()
 {
     d->header.clear();
+    d->metadata.clear();
     d->fileNameCounter = QDateTime::currentMSecsSinceEpoch();
 
     while (!d->files.isEmpty()) {
@@ -325,9 +337,11 @@ bool doZip(const QFileInfo &fileInfo, const QDir &rootDir)
     return true;
 }
 
-bool saveTask(const QByteArray &header, bool encrypt, const QDir &folder,
-              const QString &targetFileName, QMutex *mutex)
+bool saveTask(const QByteArray &header, const QByteArray &metadata, bool encrypt,
+              const QDir &folder, const QString &targetFileName, QMutex *mutex)
 {
+    PROFILE_THIS_FUNCTION;
+
     QMutexLocker mutexLocker(mutex);
 
     QByteArray headerData = header;
@@ -347,6 +361,35 @@ bool saveTask(const QByteArray &header, bool encrypt, const QDir &folder,
     if (!headerFile.commit())
         return false;
 
+    // Metadata is only an accelerator for file lists, readers fall back to scanning the
+    // header if it is missing. So failing to write it doesn't fail the save.
+    QFile::remove(folder.filePath(encrypt ? DocumentFileSystemData::normalMetadataFile
+                                          : DocumentFileSystemData::encryptedMetadataFile));
+    if (!metadata.isEmpty()) {
+        // Older versions of Scrite zip up whatever they find in the folder, including
+        // metadata they don't update. So metadata carries the CRC and size of the header
+        // it was made from, and readers can tell when it is stale.
+        QJsonObject metadataObj = QJsonDocument::fromJson(metadata).object();
+        metadataObj.insert(QStringLiteral("headerCrc32"),
+                           qint64(QuaCrc32().calculate(headerData)));
+        metadataObj.insert(QStringLiteral("headerSize"), headerData.size());
+
+        QByteArray metadataBytes = QJsonDocument(metadataObj).toJson(QJsonDocument::Compact);
+        if (encrypt) {
+            SimpleCrypt sc(REST_CRYPT_KEY);
+            metadataBytes = sc.encryptToByteArray(metadataBytes);
+        }
+
+        QSaveFile metadataFile(
+                folder.filePath(encrypt ? DocumentFileSystemData::encryptedMetadataFile
+                                        : DocumentFileSystemData::normalMetadataFile));
+        if (metadataFile.open(QFile::WriteOnly)) {
+            metadataFile.write(metadataBytes);
+            if (!metadataFile.commit())
+                qInfo("Could not write document metadata.");
+        }
+    }
+
     const QString tmpFileName = QStandardPaths::writableLocation(QStandardPaths::TempLocation)
             + QStringLiteral("/scrite_") + QString::number(QDateTime::currentMSecsSinceEpoch())
             + QStringLiteral("_temp.scrite");
@@ -423,14 +466,19 @@ bool DocumentFileSystem::save(const QString &fileName, bool encrypt, SaveMode mo
         watcher->setObjectName(saveTaskWatcher);
         connect(watcher, &QFutureWatcher<bool>::finished, this,
                 &DocumentFileSystem::saveTaskFinished);
-        watcher->setFuture(QtConcurrent::run(saveTask, d->header, encrypt, QDir(d->folder->path()),
-                                             fileName, &d->folderMutex));
+        const QByteArray header = d->header;
+        const QByteArray metadata = d->metadata;
+        const QDir folder(d->folder->path());
+        QMutex *folderMutex = &d->folderMutex;
+        watcher->setFuture(QtConcurrent::run([=]() {
+            return saveTask(header, metadata, encrypt, folder, fileName, folderMutex);
+        }));
 
         return true;
     }
 
-    const bool ret =
-            saveTask(d->header, encrypt, QDir(d->folder->path()), fileName, &d->folderMutex);
+    const bool ret = saveTask(d->header, d->metadata, encrypt, QDir(d->folder->path()), fileName,
+                              &d->folderMutex);
     return ret;
 #endif
 }
@@ -445,6 +493,129 @@ QByteArray DocumentFileSystem::header() const
     return d->header;
 }
 
+void DocumentFileSystem::setMetadata(const QByteArray &metadata)
+{
+    d->metadata = metadata;
+}
+
+QByteArray DocumentFileSystem::metadata() const
+{
+    return d->metadata;
+}
+
+bool doPeek(const QString &zipFileName, const QString &path,
+            const std::function<void(QIODevice *)> &reader)
+{
+    QuaZip qzip(zipFileName);
+    qzip.setUtf8Enabled(true);
+    if (!qzip.open(QuaZip::mdUnzip))
+        return false;
+
+    if (!qzip.setCurrentFile(path))
+        return false;
+
+    QuaZipFile file(&qzip);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    reader(&file);
+
+    file.close();
+    qzip.close();
+
+    return true;
+}
+
+QByteArray DocumentFileSystem::peek(const QString &fileName, const QString &path)
+{
+    QByteArray ret;
+    if (fileName.isEmpty() || path.isEmpty())
+        return ret;
+
+    doPeek(fileName, path, [&ret](QIODevice *device) { ret = device->readAll(); });
+    return ret;
+}
+
+QByteArray DocumentFileSystem::peekMetadata(const QString &fileName)
+{
+    if (fileName.isEmpty())
+        return QByteArray();
+
+    QuaZip qzip(fileName);
+    qzip.setUtf8Enabled(true);
+    if (!qzip.open(QuaZip::mdUnzip))
+        return QByteArray();
+
+    const bool encrypted = !qzip.setCurrentFile(DocumentFileSystemData::normalMetadataFile);
+    if (encrypted && !qzip.setCurrentFile(DocumentFileSystemData::encryptedMetadataFile))
+        return QByteArray();
+
+    QByteArray ret;
+    {
+        QuaZipFile file(&qzip);
+        if (!file.open(QFile::ReadOnly))
+            return QByteArray();
+
+        ret = file.readAll();
+        file.close();
+    }
+
+    if (encrypted) {
+        SimpleCrypt sc(REST_CRYPT_KEY);
+        ret = sc.decryptToByteArray(ret);
+    }
+
+    // Metadata is used only if the header in the archive is the one it was made from. The
+    // central directory has the CRC and size of the header, so nothing is decompressed.
+    QuaZipFileInfo64 headerInfo;
+    if (!qzip.setCurrentFile(encrypted ? DocumentFileSystemData::encryptedHeaderFile
+                                       : DocumentFileSystemData::normalHeaderFile)
+        || !qzip.getCurrentFileInfo(&headerInfo))
+        return QByteArray();
+
+    const QJsonObject metadataObj = QJsonDocument::fromJson(ret).object();
+    const qint64 headerCrc32 =
+            metadataObj.value(QStringLiteral("headerCrc32")).toVariant().toLongLong();
+    const qint64 headerSize =
+            metadataObj.value(QStringLiteral("headerSize")).toVariant().toLongLong();
+    if (headerCrc32 != qint64(headerInfo.crc)
+        || headerSize != qint64(headerInfo.uncompressedSize)) {
+        qInfo("Metadata in '%s' doesn't match its header, ignoring it.", qPrintable(fileName));
+        return QByteArray();
+    }
+
+    return ret;
+}
+
+bool DocumentFileSystem::peekHeader(const QString &fileName,
+                                    const std::function<void(QIODevice *)> &reader)
+{
+    if (fileName.isEmpty() || !reader)
+        return false;
+
+    // Plain headers are streamed straight out of the archive, so readers can stop
+    // decompressing once they have what they need.
+    if (doPeek(fileName, DocumentFileSystemData::normalHeaderFile, reader))
+        return true;
+
+    const QByteArray encryptedHeader =
+            peek(fileName, DocumentFileSystemData::encryptedHeaderFile);
+    if (encryptedHeader.isEmpty())
+        return false;
+
+    SimpleCrypt sc(REST_CRYPT_KEY);
+    QByteArray header = sc.decryptToByteArray(encryptedHeader);
+    if (header.isEmpty())
+        return false;
+
+    QBuffer buffer(&header);
+    if (!buffer.open(QBuffer::ReadOnly))
+        return false;
+
+    reader(&buffer);
+    return true;
+}
+
 QFile *DocumentFileSystem::open(const QString &path, QFile::OpenMode mode)
 {
     if (path.isEmpty())
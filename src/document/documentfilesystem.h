@@ -21,6 +21,8 @@
 #include <QImage>
 #include <QFileInfo>
 
+#include <functional>
+
 class DocumentFile;
 
 struct DocumentFileSystemData;
@@ -45,6 +47,21 @@ public:
     void setHeader(const QByteArray &header);
     QByteArray header() const;
 
+    // Small JSON document saved next to the header, so that file lists can show title,
+    // counts and cover without having to load the whole document. It is saved with the
+    // CRC and size of the header, and peekMetadata() returns nothing if the header in the
+    // archive doesn't match them.
+    void setMetadata(const QByteArray &metadata);
+    QByteArray metadata() const;
+
+    // Read one entry straight out of a saved document, using the ZIP central directory,
+    // without extracting anything else. Documents in the pre-ZIP format are not
+    // supported, these functions return empty/false for them.
+    static QByteArray peek(const QString &fileName, const QString &path);
+    static QByteArray peekMetadata(const QString &fileName);
+    static bool peekHeader(const QString &fileName,
+                           const std::function<void(QIODevice *)> &reader);
+
     QFile *open(const QString &path, QFile::OpenMode mode = QFile::ReadOnly);
 
     QByteArray read(const QString &path);
@@ -18,6 +18,7 @@
 #include "scritedocument.h"
 #include "qobjectserializer.h"
 #include "qobjectserializer.h"
+#include "timeprofiler.h"
 
 #include <QPointer>
 #include <QMarginsF>
@@ -25,6 +26,7 @@
 #include <QMetaEnum>
 #include <QMimeData>
 #include <QClipboard>
+#include <QDataStream>
 #include <QPdfWriter>
 #include <QScopeGuard>
 #include <QTextCursor>
@@ -32,6 +34,7 @@
 #include <QFontDatabase>
 #include <QJsonDocument>
 #include <QTextBlockUserData>
+#include <QCryptographicHash>
 #include <QTextBoundaryFinder>
 #include <QScopedValueRollback>
 #include <QTextDocumentFragment>
@@ -708,6 +711,24 @@ qreal ScreenplayFormat::devicePixelRatio() const
     return m_fontZoomLevels.at(index).toDouble() * this->screenDevicePixelRatio();
 }
 
+QString ScreenplayFormat::layoutFingerprint() const
+{
+    QByteArray data;
+    {
+        QDataStream ds(&data, QIODevice::WriteOnly);
+        ds << m_defaultFont.toString() << m_defaultFontMetrics.height()
+           << m_defaultFontMetrics.averageCharWidth() << this->screenDevicePixelRatio()
+           << int(m_pageLayout->paperSize()) << m_pageLayout->contentWidth();
+
+        for (const SceneElementFormat *format : m_elementFormats)
+            ds << format->font().toString() << format->lineHeight()
+               << format->lineSpacingBefore() << format->leftMargin() << format->rightMargin()
+               << int(format->textAlignment());
+    }
+
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+}
+
 void ScreenplayFormat::setDefaultLanguage(TransliterationEngine::Language val)
 {
 #if 0
@@ -1786,7 +1807,7 @@ void SceneDocumentBinder::setTextDocument(QQuickTextDocument *val)
         disconnect(this->document(), &QTextDocument::contentsChange, this,
                    &SceneDocumentBinder::onContentsChange);
         disconnect(this->document(), &QTextDocument::blockCountChanged, this,
-                   &SceneDocumentBinder::syncSceneFromDocument);
+                   &SceneDocumentBinder::onBlockCountChanged);
 
         if (m_scene != nullptr)
             disconnect(m_scene, &Scene::sceneElementChanged, this,
@@ -1815,7 +1836,7 @@ void SceneDocumentBinder::setTextDocument(QQuickTextDocument *val)
         connect(this->document(), &QTextDocument::contentsChange, this,
                 &SceneDocumentBinder::onContentsChange, Qt::UniqueConnection);
         connect(this->document(), &QTextDocument::blockCountChanged, this,
-                &SceneDocumentBinder::syncSceneFromDocument, Qt::UniqueConnection);
+                &SceneDocumentBinder::onBlockCountChanged, Qt::UniqueConnection);
 
         if (m_scene != nullptr)
             connect(m_scene, &Scene::sceneElementChanged, this,
@@ -1948,7 +1969,8 @@ void SceneDocumentBinder::setCursorPosition(int val)
 
     SceneDocumentBlockUserData *userData = SceneDocumentBlockUserData::get(block);
     if (userData == nullptr) {
-        this->syncSceneFromDocument();
+        // A block without user-data was split off from one of its neighbours.
+        this->syncSceneFromBlocks(block.blockNumber() - 1, block.blockNumber() + 1);
         userData = SceneDocumentBlockUserData::get(block);
     }
 
@@ -2779,7 +2801,8 @@ void SceneDocumentBinder::highlightBlock(const QString &text)
     QTextBlock block = this->QSyntaxHighlighter::currentBlock();
     SceneDocumentBlockUserData *userData = SceneDocumentBlockUserData::get(block);
     if (userData == nullptr) {
-        this->syncSceneFromDocument();
+        // A block without user-data was split off from one of its neighbours.
+        this->syncSceneFromBlocks(block.blockNumber() - 1, block.blockNumber() + 1);
         userData = SceneDocumentBlockUserData::get(block);
     }
 
@@ -3310,8 +3333,18 @@ void SceneDocumentBinder::onContentsChange(int from, int charsRemoved, int chars
           paragraphs in our internal Scene data structure, then we better sync it once.
           This can happen when user pastes more than 1 paragraphs at once or if the user
           deletes more than 1 paragraphs at once.
+
+          Only paragraphs within the changed range can have different text, so only
+          those are synced. Paragraphs outside it merely get their elements listed.
           */
-        this->syncSceneFromDocument();
+        const QTextBlock fromBlock = this->document()->findBlock(from);
+        QTextBlock toBlock = this->document()->findBlock(from + charsAdded);
+        if (!toBlock.isValid())
+            toBlock = this->document()->lastBlock();
+        if (fromBlock.isValid())
+            this->syncSceneFromBlocks(fromBlock.blockNumber(), toBlock.blockNumber());
+        else
+            this->syncSceneFromDocument();
         return;
     }
 
@@ -3349,7 +3382,9 @@ void SceneDocumentBinder::onContentsChange(int from, int charsRemoved, int chars
         QTextBlock block = cursor.block();
         SceneDocumentBlockUserData *userData = SceneDocumentBlockUserData::get(block);
         if (userData == nullptr) {
-            this->syncSceneFromDocument();
+            const QTextBlock toBlock = this->document()->findBlock(from + charsAdded);
+            this->syncSceneFromBlocks(block.blockNumber(),
+                                      toBlock.isValid() ? toBlock.blockNumber() : INT_MAX);
             return;
         }
 
@@ -3377,7 +3412,20 @@ void SceneDocumentBinder::onContentsChange(int from, int charsRemoved, int chars
     }
 }
 
-void SceneDocumentBinder::syncSceneFromDocument(int nrBlocks)
+void SceneDocumentBinder::onBlockCountChanged(int nrBlocks)
+{
+    // onContentsChange() would have already synced blocks in the changed range. The
+    // whole document is synced only if that didn't happen for some reason.
+    if (m_scene != nullptr && m_scene->elementCount() != nrBlocks)
+        this->syncSceneFromDocument();
+}
+
+void SceneDocumentBinder::syncSceneFromDocument()
+{
+    this->syncSceneFromBlocks(0, INT_MAX);
+}
+
+void SceneDocumentBinder::syncSceneFromBlocks(int fromBlockNr, int toBlockNr)
 {
     if (m_initializingDocument || m_sceneIsBeingReset)
         return;
@@ -3385,47 +3433,73 @@ void SceneDocumentBinder::syncSceneFromDocument(int nrBlocks)
     if (m_textDocument == nullptr || m_scene == nullptr)
         return;
 
+    PROFILE_THIS_FUNCTION2;
+
     // Ofcourse we are refreshing the scene because the document changed.
     // But when we refresh the scene, the scene emits sceneRefreshed() signal
     // which will cause SceneDocumentBinder::onSceneRefreshed() to be called,
     // which is entirely unnecessary. We use this boolean to avoid that.
     QScopedValueRollback<bool> rollback(m_sceneIsBeingRefreshed, true);
 
-    if (nrBlocks < 0)
-        nrBlocks = this->document()->blockCount();
+    QTextDocument *doc = this->document();
+    const int nrBlocks = doc->blockCount();
+    const int nrElements = m_scene->elementCount();
 
     /*
-     * Ensure that blocks on the QTextDocument are in sync with
-     * SceneElements in the Scene. I know that we are using a for loop
-     * to make this happen, so we are (many-times) needlessly looping
-     * over blocks that have already been touched, thereby making
-     * this function slow. Still, I feel that this is better. A scene
-     * would not have more than a few blocks, atbest 100 blocks.
-     * So its better we sync it like this.
+     * Ensure that blocks on the QTextDocument are in sync with SceneElements
+     * in the Scene. Blocks before fromBlockNr and after toBlockNr didn't
+     * change, they are backed by the first and last elements of the scene as
+     * they are. Elements between them, whose count differs from that of the
+     * blocks by the number of blocks added or removed, are matched against
+     * blocks in the range. Elements whose blocks were removed are removed,
+     * blocks without user-data are new and get new elements.
+     *
+     * If the blocks just outside the range are not backed by the elements we
+     * expect, the whole document is synced instead.
      */
+    const auto elementOfBlock = [doc](int blockNr) -> SceneElement * {
+        const SceneDocumentBlockUserData *userData =
+                SceneDocumentBlockUserData::get(doc->findBlockByNumber(blockNr));
+        return userData ? userData->sceneElement() : nullptr;
+    };
+    const auto isBlockBackedBy = [=](int blockNr, int elementNr) {
+        SceneElement *element = elementOfBlock(blockNr);
+        return element != nullptr && element == m_scene->elementAt(elementNr);
+    };
 
-    bool doPolishElements = false;
+    fromBlockNr = qBound(0, fromBlockNr, nrBlocks - 1);
+    toBlockNr = qBound(fromBlockNr, toBlockNr, nrBlocks - 1);
 
-    m_scene->beginUndoCapture();
+    int toElementNr = toBlockNr - (nrBlocks - nrElements);
+    const bool rangeIsValid = toElementNr >= fromBlockNr - 1 && toElementNr < nrElements
+            && (fromBlockNr == 0 || isBlockBackedBy(fromBlockNr - 1, fromBlockNr - 1))
+            && (toBlockNr == nrBlocks - 1 || isBlockBackedBy(toBlockNr + 1, toElementNr + 1));
+    if (!rangeIsValid) {
+        fromBlockNr = 0;
+        toBlockNr = nrBlocks - 1;
+        toElementNr = nrElements - 1;
+    }
 
-    QList<SceneElement *> elementList;
-    elementList.reserve(nrBlocks);
+    QList<SceneElement *> removedElements;
+    removedElements.reserve(toElementNr - fromBlockNr + 1);
+    for (int i = fromBlockNr; i <= toElementNr; i++)
+        removedElements.append(m_scene->elementAt(i));
 
-    QTextBlock block = this->document()->begin();
-    QTextBlock previousBlock;
-    while (block.isValid()) {
+    QList<QPair<int, SceneDocumentBlockUserData *>> newBlocks;
+    QList<QTextBlock> changedBlocks;
+    changedBlocks.reserve(toBlockNr - fromBlockNr + 1);
+
+    QTextBlock block = doc->findBlockByNumber(fromBlockNr);
+    SceneElement *previousElement = fromBlockNr > 0 ? elementOfBlock(fromBlockNr - 1) : nullptr;
+    for (int blockNr = fromBlockNr; blockNr <= toBlockNr && block.isValid(); blockNr++) {
         SceneDocumentBlockUserData *userData = SceneDocumentBlockUserData::get(block);
-        if (userData == nullptr) {
+        if (userData == nullptr || !removedElements.removeOne(userData->sceneElement())) {
             SceneElement *newElement = new SceneElement(m_scene);
-
-            if (previousBlock.isValid()) {
-                SceneDocumentBlockUserData *prevUserData =
-                        SceneDocumentBlockUserData::get(previousBlock);
-                SceneElement *prevElement = prevUserData->sceneElement();
-                switch (prevElement->type()) {
+            if (previousElement != nullptr) {
+                switch (previousElement->type()) {
                 case SceneElement::Action:
                     newElement->setType(SceneElement::Action);
-                    newElement->setAlignment(prevElement->alignment());
+                    newElement->setAlignment(previousElement->alignment());
                     break;
                 case SceneElement::Character:
                     newElement->setType(SceneElement::Dialogue);
@@ -3446,32 +3520,46 @@ void SceneDocumentBinder::syncSceneFromDocument(int nrBlocks)
                     newElement->setType(SceneElement::Action);
                     break;
                 }
-
-                m_scene->insertElementAfter(newElement, prevElement);
-            } else {
+            } else
                 newElement->setType(SceneElement::Action);
-                m_scene->insertElementAt(newElement, 0);
-            }
 
             userData = new SceneDocumentBlockUserData(block, newElement, this);
             block.setUserData(userData);
-            doPolishElements = true;
+            newBlocks.append(qMakePair(blockNr, userData));
         }
 
-        elementList.append(userData->sceneElement());
-        userData->sceneElement()->setText(block.text());
-        userData->sceneElement()->setTextFormats(block.textFormats());
-        userData->autoCapitalizeLater();
-
-        previousBlock = block;
+        changedBlocks.append(block);
+        previousElement = userData->sceneElement();
         block = block.next();
     }
 
-    m_scene->setElementsList(elementList);
-    m_scene->endUndoCapture();
+    // Only elements are added and removed here, but undo restores whole scenes. So a
+    // capture is taken only if there is something to add or remove.
+    const bool elementsChanged = !removedElements.isEmpty() || !newBlocks.isEmpty();
+    if (elementsChanged)
+        m_scene->beginUndoCapture();
+
+    // Elements left in the range were backing blocks that are gone now. Once they are
+    // removed, kept elements in the range are where their blocks are, and new elements
+    // can be inserted at the numbers of their blocks.
+    for (SceneElement *element : qAsConst(removedElements))
+        m_scene->removeElement(element);
+
+    for (const QPair<int, SceneDocumentBlockUserData *> &newBlock : qAsConst(newBlocks))
+        m_scene->insertElementAt(newBlock.second->sceneElement(), newBlock.first);
+
+    for (const QTextBlock &changedBlock : qAsConst(changedBlocks)) {
+        SceneDocumentBlockUserData *userData = SceneDocumentBlockUserData::get(changedBlock);
+        userData->sceneElement()->setText(changedBlock.text());
+        userData->sceneElement()->setTextFormats(changedBlock.textFormats());
+        userData->autoCapitalizeLater();
+    }
+
+    if (elementsChanged)
+        m_scene->endUndoCapture();
 
-    if (doPolishElements)
-        this->polishAllSceneElements();
+    for (const QPair<int, SceneDocumentBlockUserData *> &newBlock : qAsConst(newBlocks))
+        newBlock.second->polishTextLater();
 }
 
 void SceneDocumentBinder::evaluateAutoCompleteHintsAndCompletionPrefix()
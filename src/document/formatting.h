@@ -380,6 +380,10 @@ public:
     Q_INVOKABLE SceneElementFormat *elementFormat(int type) const;
     Q_SIGNAL void formatChanged();
 
+    // Changes whenever a change in format could change the height at which scenes
+    // are laid out on this computer, other than zooming in or out.
+    QString layoutFingerprint() const;
+
     Q_PROPERTY(QQmlListProperty<SceneElementFormat> elementFormats READ elementFormats)
     QQmlListProperty<SceneElementFormat> elementFormats();
 
@@ -791,7 +795,9 @@ private:
     void onSceneElementChanged(SceneElement *element, Scene::SceneElementChangeType type);
     Q_SLOT void onSpellCheckUpdated();
     void onContentsChange(int from, int charsRemoved, int charsAdded);
-    void syncSceneFromDocument(int nrBlocks = -1);
+    void onBlockCountChanged(int nrBlocks);
+    void syncSceneFromDocument();
+    void syncSceneFromBlocks(int fromBlockNr, int toBlockNr);
 
     void evaluateAutoCompleteHintsAndCompletionPrefix();
     void setAutoCompleteHintsFor(SceneElement::Type val);
@@ -20,9 +20,12 @@
 #include "application.h"
 #include "timeprofiler.h"
 #include "scritedocument.h"
+#include "deferredworkscheduler.h"
 
 #include <QScopedValueRollback>
 
+#include <functional>
+
 static int nextItemId()
 {
     static int id = 1000;
@@ -143,6 +146,74 @@ private:
     StoryNode();
 };
 
+// Identifies an item across syncs: by the object it represents, or by its text for items
+// that represent no object.
+typedef QPair<QObject *, QString> ItemKey;
+
+static ItemKey itemKey(const QStandardItem *item)
+{
+    QObject *object = item->data(NotebookModel::ObjectRole).value<QObject *>();
+    return object ? ItemKey(object, QString()) : ItemKey(nullptr, item->text());
+}
+
+static int findChildRow(const QStandardItem *parentItem, const ItemKey &key, int from)
+{
+    const int nrRows = parentItem->rowCount();
+    for (int row = from; row < nrRows; row++) {
+        if (itemKey(parentItem->child(row)) == key)
+            return row;
+    }
+
+    return -1;
+}
+
+/**
+ * Brings child rows of parentItem in line with keys, by removing, moving and inserting only
+ * rows that differ. Rows already in place are left alone, so that views retain their
+ * expansion and current-item state. createItem() is called for keys that have no row yet,
+ * syncItem() for rows that were retained.
+ */
+static void syncChildItems(QStandardItem *parentItem, const QList<ItemKey> &keys,
+                           const std::function<QStandardItem *(int)> &createItem,
+                           const std::function<void(QStandardItem *, int)> &syncItem = nullptr)
+{
+    const QSet<ItemKey> keySet(keys.begin(), keys.end());
+    for (int row = parentItem->rowCount() - 1; row >= 0; row--) {
+        if (!keySet.contains(itemKey(parentItem->child(row))))
+            parentItem->removeRow(row);
+    }
+
+    for (int i = 0; i < keys.size(); i++) {
+        const ItemKey &key = keys.at(i);
+
+        QStandardItem *item = parentItem->child(i);
+        if (item != nullptr && itemKey(item) != key) {
+            const int row = findChildRow(parentItem, key, i + 1);
+            const int laterIndex = keys.indexOf(itemKey(item), i + 1);
+            if (row == i + 1 && laterIndex > i) {
+                // The row here was moved further down, move just that row.
+                const QList<QStandardItem *> items = parentItem->takeRow(i);
+                parentItem->insertRow(qMin(laterIndex, parentItem->rowCount()), items);
+            } else if (row > i)
+                parentItem->insertRow(i, parentItem->takeRow(row));
+
+            item = parentItem->child(i);
+        }
+
+        if (item == nullptr || itemKey(item) != key) {
+            parentItem->insertRow(i, createItem(i));
+            continue;
+        }
+
+        if (syncItem)
+            syncItem(item, i);
+    }
+
+    // Repeated keys can leave surplus rows behind
+    if (parentItem->rowCount() > keys.size())
+        parentItem->removeRows(keys.size(), parentItem->rowCount() - keys.size());
+}
+
 NotebookModel::NotebookModel(QObject *parent)
     : QStandardItemModel(parent),
       m_document(this, "document"),
@@ -166,7 +237,10 @@ NotebookModel::NotebookModel(QObject *parent)
     Forms::global();
 }
 
-NotebookModel::~NotebookModel() { }
+NotebookModel::~NotebookModel()
+{
+    DeferredWorkScheduler::instance()->cancel(this, "NotebookModel.reload");
+}
 
 void NotebookModel::setDocument(ScriteDocument *val)
 {
@@ -174,19 +248,19 @@ void NotebookModel::setDocument(ScriteDocument *val)
         return;
 
     if (m_document != nullptr) {
-        disconnect(m_document, &ScriteDocument::justReset, this, &NotebookModel::reload);
-        disconnect(m_document, &ScriteDocument::justLoaded, this, &NotebookModel::reload);
+        disconnect(m_document, &ScriteDocument::justReset, this, &NotebookModel::reloadLater);
+        disconnect(m_document, &ScriteDocument::justLoaded, this, &NotebookModel::reloadLater);
     }
 
     m_document = val;
     emit documentChanged();
 
     if (m_document != nullptr) {
-        connect(m_document, &ScriteDocument::justReset, this, &NotebookModel::reload);
-        connect(m_document, &ScriteDocument::justLoaded, this, &NotebookModel::reload);
+        connect(m_document, &ScriteDocument::justReset, this, &NotebookModel::reloadLater);
+        connect(m_document, &ScriteDocument::justLoaded, this, &NotebookModel::reloadLater);
     }
 
-    this->reload();
+    this->reloadLater();
 }
 
 QVariant NotebookModel::modelIndexData(const QModelIndex &index) const
@@ -215,6 +289,8 @@ QStandardItem *recursivelyFindItemForOnwer(QStandardItem *root, QObject *owner)
 
 QModelIndex NotebookModel::findModelIndexFor(QObject *owner) const
 {
+    this->reloadIfScheduled();
+
     QStandardItem *item = ::recursivelyFindItemForOnwer(this->invisibleRootItem(), owner);
     if (item == nullptr)
         return QModelIndex();
@@ -224,6 +300,8 @@ QModelIndex NotebookModel::findModelIndexFor(QObject *owner) const
 
 QModelIndex NotebookModel::findModelIndexForTopLevelItem(const QString &label) const
 {
+    this->reloadIfScheduled();
+
     QList<QStandardItem *> items = this->findItems(label, Qt::MatchExactly);
     if (items.isEmpty())
         return QModelIndex();
@@ -233,14 +311,13 @@ QModelIndex NotebookModel::findModelIndexForTopLevelItem(const QString &label) c
 
 QModelIndex NotebookModel::findModelIndexForCategory(ItemCategory cat) const
 {
-    const int nrItems = this->rowCount();
-    for (int i = 0; i < nrItems; i++) {
-        QStandardItem *row = this->item(i, 0);
-        if (row->data(CategoryRole).toInt() == cat)
-            return this->indexFromItem(row);
-    }
+    this->reloadIfScheduled();
+
+    QStandardItem *item = this->findItemForCategory(cat);
+    if (item == nullptr)
+        return QModelIndex();
 
-    return QModelIndex();
+    return this->indexFromItem(item);
 }
 
 void NotebookModel::refresh()
@@ -298,8 +375,46 @@ void NotebookModel::resetDocument()
     this->reload();
 }
 
+void NotebookModel::reloadLater()
+{
+    // Building the whole tree for a large document takes a while, so it is put off till
+    // user input settles. Changes after that are applied to the tree incrementally.
+    this->clear();
+    m_syncScenesTimer.stop();
+    m_syncCharactersTimer.stop();
+
+    if (m_document == nullptr) {
+        DeferredWorkScheduler::instance()->cancel(this, "NotebookModel.reload");
+        return;
+    }
+
+    DeferredWorkScheduler::instance()->schedule(this, "NotebookModel.reload",
+                                                DeferredWorkScheduler::IdlePriority, 0,
+                                                [=]() { this->reload(); });
+}
+
+void NotebookModel::reloadIfScheduled() const
+{
+    DeferredWorkScheduler::instance()->runNow(const_cast<NotebookModel *>(this),
+                                              "NotebookModel.reload");
+}
+
+QStandardItem *NotebookModel::findItemForCategory(ItemCategory cat) const
+{
+    const int nrItems = this->rowCount();
+    for (int i = 0; i < nrItems; i++) {
+        QStandardItem *row = this->item(i, 0);
+        if (row->data(TypeRole).toInt() == CategoryType && row->data(CategoryRole).toInt() == cat)
+            return row;
+    }
+
+    return nullptr;
+}
+
 void NotebookModel::reload()
 {
+    DeferredWorkScheduler::instance()->cancel(this, "NotebookModel.reload");
+
     this->clear();
     m_syncScenesTimer.stop();
     m_syncCharactersTimer.stop();
@@ -445,20 +560,60 @@ void NotebookModel::loadOthers()
 #endif
 }
 
-static inline void removeTopLevelItems(QStandardItemModel *model, QList<QStandardItem *> &items)
+static ItemKey nodeKey(const StoryNode *node)
+{
+    if (node->scene != nullptr)
+        return ItemKey(node->scene->scene()->notes(), QString());
+    if (node->unusedScene != nullptr)
+        return ItemKey(node->unusedScene->scene()->notes(), QString());
+    if (node->episode != nullptr)
+        return ItemKey(node->episode, QString());
+    if (node->act != nullptr)
+        return ItemKey(node->act, QString());
+    if (!node->episodeName.isEmpty())
+        return ItemKey(nullptr, node->episodeName);
+    return ItemKey(nullptr, node->actName);
+}
+
+static void syncItemWithNode(QStandardItem *item, StoryNode *node)
 {
-    QList<int> rows;
-    while (!items.isEmpty()) {
-        QStandardItem *item = items.takeLast();
-        rows << item->row();
-    }
-    std::sort(rows.begin(), rows.end());
-    while (!rows.isEmpty())
-        model->removeRow(rows.takeLast());
-};
+    Notes *nodeNotes = nullptr;
+    if (node->episode != nullptr)
+        nodeNotes = node->episode->notes();
+    else if (node->act != nullptr)
+        nodeNotes = node->act->notes();
+
+    const int offset = nodeNotes ? 1 : 0;
+
+    QList<ItemKey> keys;
+    keys.reserve(node->childNodes.size() + offset);
+    if (nodeNotes != nullptr)
+        keys << ItemKey(nodeNotes, QString());
+    for (StoryNode *childNode : qAsConst(node->childNodes))
+        keys << nodeKey(childNode);
+
+    syncChildItems(
+            item, keys,
+            [=](int index) -> QStandardItem * {
+                if (index < offset)
+                    return new NotesItem(nodeNotes);
+                return createItemForNode(node->childNodes.at(index - offset));
+            },
+            [=](QStandardItem *childItem, int index) {
+                // Rows of scenes hold notes, which are kept in sync by NotesItem itself.
+                StoryNode *childNode = index < offset ? nullptr : node->childNodes.at(index - offset);
+                if (childNode != nullptr && childNode->scene == nullptr
+                    && childNode->unusedScene == nullptr)
+                    syncItemWithNode(childItem, childNode);
+            });
+}
 
 void NotebookModel::syncScenes()
 {
+    if (m_document == nullptr
+        || DeferredWorkScheduler::instance()->isScheduled(this, "NotebookModel.reload"))
+        return;
+
     QScopedPointer<StoryNode> storyNodes(StoryNode::create(m_document));
     if (storyNodes.isNull())
         return;
@@ -471,22 +626,33 @@ void NotebookModel::syncScenes()
             screenplayNode = storyNode;
     }
 
-    QList<QStandardItem *> unusedScenesItem =
-            this->findItems(QStringLiteral("Unused Scenes"), Qt::MatchExactly, 0);
-    QList<QStandardItem *> screenplayScenesItem =
-            this->findItems(QStringLiteral("Screenplay"), Qt::MatchExactly, 0);
-    bool hasScenes = unusedScenesItem.size() + screenplayScenesItem.size() > 0;
+    QStandardItem *screenplayItem = this->findItemForCategory(ScreenplayCategory);
+    QStandardItem *unusedScenesItem = this->findItemForCategory(UnusedScenesCategory);
+    const bool hasScenes = screenplayItem != nullptr || unusedScenesItem != nullptr;
 
     if (hasScenes)
         emit aboutToReloadScenes();
 
-    removeTopLevelItems(this, unusedScenesItem);
-    if (structureNode != nullptr)
-        this->insertRow(2, createItemForNode(structureNode));
-
-    removeTopLevelItems(this, screenplayScenesItem);
-    if (screenplayNode != nullptr)
-        this->insertRow(2, createItemForNode(screenplayNode));
+    // Only rows that differ from the story are touched, so that adding, removing or moving
+    // a scene doesn't collapse the rest of the tree.
+    if (screenplayNode == nullptr) {
+        if (screenplayItem != nullptr)
+            this->removeRow(screenplayItem->row());
+        screenplayItem = nullptr;
+    } else if (screenplayItem == nullptr) {
+        screenplayItem = createItemForNode(screenplayNode);
+        this->insertRow(2, screenplayItem);
+    } else
+        syncItemWithNode(screenplayItem, screenplayNode);
+
+    if (structureNode == nullptr) {
+        if (unusedScenesItem != nullptr)
+            this->removeRow(unusedScenesItem->row());
+    } else if (unusedScenesItem == nullptr) {
+        const int row = screenplayItem ? screenplayItem->row() + 1 : 2;
+        this->insertRow(row, createItemForNode(structureNode));
+    } else
+        syncItemWithNode(unusedScenesItem, structureNode);
 
     if (hasScenes)
         emit justReloadedScenes();
@@ -494,22 +660,24 @@ void NotebookModel::syncScenes()
 
 void NotebookModel::syncCharacters()
 {
+    if (m_document == nullptr
+        || DeferredWorkScheduler::instance()->isScheduled(this, "NotebookModel.reload"))
+        return;
+
     Structure *structure = m_document->structure();
     QObjectListModel<Character *> *charactersModel = structure->charactersModel();
 
-    QList<QStandardItem *> characterItems =
-            this->findItems(QStringLiteral("Characters"), Qt::MatchExactly, 0);
-    const bool hasCharacterItems = !characterItems.isEmpty();
+    QStandardItem *charactersItem = this->findItemForCategory(CharactersCategory);
+    const bool hasCharacterItems = charactersItem != nullptr;
 
     if (hasCharacterItems)
         emit aboutToReloadCharacters();
-
-    removeTopLevelItems(this, characterItems);
-
-    QStandardItem *charactersItem = new StandardItemWithId(4);
-    charactersItem->setText(QStringLiteral("Characters"));
-    charactersItem->setData(CategoryType, TypeRole);
-    charactersItem->setData(CharactersCategory, CategoryRole);
+    else {
+        charactersItem = new StandardItemWithId(4);
+        charactersItem->setText(QStringLiteral("Characters"));
+        charactersItem->setData(CategoryType, TypeRole);
+        charactersItem->setData(CharactersCategory, CategoryRole);
+    }
 
     QList<Character *> characters = charactersModel->list();
     std::sort(characters.begin(), characters.end(), [](Character *a, Character *b) {
@@ -518,17 +686,19 @@ void NotebookModel::syncCharacters()
         return a->priority() > b->priority();
     });
 
-    for (Character *character : qAsConst(characters)) {
-        Notes *characterNotes = character->notes();
+    QList<ItemKey> keys;
+    keys.reserve(characters.size());
+    for (Character *character : qAsConst(characters))
+        keys << ItemKey(character->notes(), QString());
 
-        NotesItem *notesItem = new NotesItem(characterNotes);
-        charactersItem->appendRow(notesItem);
-    }
-
-    this->appendRow(charactersItem);
+    syncChildItems(charactersItem, keys, [=](int index) -> QStandardItem * {
+        return new NotesItem(characters.at(index)->notes());
+    });
 
     if (hasCharacterItems)
         emit justReloadedCharacters();
+    else
+        this->appendRow(charactersItem);
 }
 
 void NotebookModel::onDataChanged(const QModelIndex &start, const QModelIndex &end,
@@ -673,24 +843,15 @@ NotesItem::~NotesItem()
 
 void NotesItem::sync()
 {
-    if (this->rowCount() > m_notes->noteCount()) {
-        m_syncTimer.start();
-        return;
-    }
-
     const int noteCount = m_notes->noteCount();
-    for (int i = 0; i < noteCount; i++) {
-        Note *actualNote = m_notes->at(i);
-        QStandardItem *noteItem = this->child(i);
-        Note *assignedNote = noteItem
-                ? qobject_cast<Note *>(noteItem->data(NotebookModel::ObjectRole).value<QObject *>())
-                : nullptr;
-
-        if (actualNote != assignedNote) {
-            noteItem = new NoteItem(actualNote);
-            this->insertRow(i, noteItem);
-        }
-    }
+
+    QList<ItemKey> keys;
+    keys.reserve(noteCount);
+    for (int i = 0; i < noteCount; i++)
+        keys << ItemKey(m_notes->at(i), QString());
+
+    syncChildItems(this, keys,
+                   [=](int index) -> QStandardItem * { return new NoteItem(m_notes->at(index)); });
 }
 
 void NotesItem::updateText()
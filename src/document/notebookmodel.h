@@ -30,6 +30,13 @@ class ScriteDocument;
 class BookmarkedNotes;
 class AbstractQObjectListModel;
 
+/**
+ * Tree of notes in the document: bookmarks, story notes, notes of episodes, acts and scenes
+ * (in screenplay order, followed by unused scenes) and notes of characters. The tree is
+ * built once, after user input settles, when a document is loaded. After that, changes to
+ * notes, screenplay, structure and characters only insert, move or remove rows that are
+ * affected, so that views retain their expansion state.
+ */
 class NotebookModel : public QStandardItemModel
 {
     Q_OBJECT
@@ -98,8 +105,12 @@ signals:
 
 private:
     void resetDocument();
+    void reloadLater();
+    void reloadIfScheduled() const;
     void reload();
 
+    QStandardItem *findItemForCategory(ItemCategory cat) const;
+
     void loadBookmarks();
     void loadStory();
     void loadScenes();
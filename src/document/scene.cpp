@@ -20,6 +20,7 @@
 #include "timeprofiler.h"
 #include "scritedocument.h"
 #include "garbagecollector.h"
+#include "deferredworkscheduler.h"
 #include "qobjectserializer.h"
 #include "screenplaytextdocument.h"
 
@@ -319,15 +320,6 @@ void SceneHeading::parseFrom(const QString &text)
     this->setMoment(_moment);
 }
 
-void SceneHeading::timerEvent(QTimerEvent *event)
-{
-    if (event->timerId() == m_wordCountTimer.timerId()) {
-        m_wordCountTimer.stop();
-        this->evaluateWordCount();
-    } else
-        QObject::timerEvent(event);
-}
-
 void SceneHeading::renameCharacter(const QString &from, const QString &to)
 {
     int nrReplacements = 0;
@@ -374,7 +366,9 @@ void SceneHeading::evaluateWordCount()
 
 void SceneHeading::evaluateWordCountLater()
 {
-    m_wordCountTimer.start(100, this);
+    DeferredWorkScheduler::instance()->schedule(this, "SceneHeading.evaluateWordCount",
+                                                DeferredWorkScheduler::NormalPriority, 100,
+                                                [=]() { this->evaluateWordCount(); });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -908,9 +902,6 @@ void SceneElement::timerEvent(QTimerEvent *event)
                 emit m_scene->sceneElementChanged(this, Scene::ElementTextChange);
         }
         m_changeCounters.clear();
-    } else if (event->timerId() == m_wordCountTimer.timerId()) {
-        m_wordCountTimer.stop();
-        this->evaluateWordCount();
     } else
         QObject::timerEvent(event);
 }
@@ -968,7 +959,9 @@ void SceneElement::evaluateWordCount()
 
 void SceneElement::evaluateWordCountLater()
 {
-    m_wordCountTimer.start(100, this);
+    DeferredWorkScheduler::instance()->schedule(this, "SceneElement.evaluateWordCount",
+                                                DeferredWorkScheduler::NormalPriority, 100,
+                                                [=]() { this->evaluateWordCount(); });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -2415,15 +2408,6 @@ bool Scene::event(QEvent *event)
     return QObject::event(event);
 }
 
-void Scene::timerEvent(QTimerEvent *event)
-{
-    if (event->timerId() == m_wordCountTimer.timerId()) {
-        m_wordCountTimer.stop();
-        this->evaluateWordCount();
-    } else
-        QObject::timerEvent(event);
-}
-
 void Scene::setStructureElement(StructureElement *ptr)
 {
     if (m_structureElement == ptr)
@@ -2595,7 +2579,9 @@ void Scene::evaluateWordCount()
 
 void Scene::evaluateWordCountLater()
 {
-    m_wordCountTimer.start(100, this);
+    DeferredWorkScheduler::instance()->schedule(this, "Scene.evaluateWordCount",
+                                                DeferredWorkScheduler::NormalPriority, 100,
+                                                [=]() { this->evaluateWordCount(); });
 }
 
 void Scene::trimIndexCardFieldValues()
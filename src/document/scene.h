@@ -97,9 +97,6 @@ public:
     int wordCount() const { return m_wordCount; }
     Q_SIGNAL void wordCountChanged();
 
-protected:
-    void timerEvent(QTimerEvent *event);
-
 private:
     friend class Scene;
     void renameCharacter(const QString &from, const QString &to);
@@ -118,7 +115,6 @@ private:
     QString m_location = "Somewhere";
     QString m_locationType = "EXT";
     int m_wordCount = 0;
-    QBasicTimer m_wordCountTimer;
 };
 
 class SceneElement : public QObject, public Modifiable, public QObjectSerializer::Interface
@@ -233,7 +229,6 @@ private:
     int m_wordCount = 0;
     mutable SpellCheckService *m_spellCheck = nullptr;
     QBasicTimer m_changeTimer;
-    QBasicTimer m_wordCountTimer;
     QMap<int, int> m_changeCounters;
 };
 
@@ -551,7 +546,6 @@ public:
 
 protected:
     bool event(QEvent *event);
-    void timerEvent(QTimerEvent *event);
 
 private:
     void setStructureElement(StructureElement *ptr);
@@ -587,7 +581,6 @@ private:
     int m_actIndex = -1;
     int m_episodeIndex = -1;
     int m_wordCount = 0;
-    QBasicTimer m_wordCountTimer;
     QString m_episode;
     StructureElement *m_structureElement = nullptr;
     QString m_summary;
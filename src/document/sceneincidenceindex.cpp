@@ -0,0 +1,315 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "sceneincidenceindex.h"
+#include "scene.h"
+
+#include <QTimerEvent>
+#include <algorithm>
+
+SceneIncidenceIndex::SceneIncidenceIndex(QObject *parent)
+    : QObject(parent), m_indexChangedTimer("SceneIncidenceIndex.m_indexChangedTimer")
+{
+}
+
+SceneIncidenceIndex::~SceneIncidenceIndex() { }
+
+bool SceneIncidenceIndex::hasCharacter(Scene *scene, const QString &characterName) const
+{
+    return this->cell(scene, characterName) != nullptr;
+}
+
+int SceneIncidenceIndex::characterPresence(Scene *scene, const QString &characterName) const
+{
+    const Cell *cell = this->cell(scene, characterName);
+    return cell ? cell->presence : 0;
+}
+
+int SceneIncidenceIndex::dialogueCount(Scene *scene, const QString &characterName) const
+{
+    const Cell *cell = this->cell(scene, characterName);
+    return cell ? cell->dialogueCount : 0;
+}
+
+int SceneIncidenceIndex::dialogueWordCount(Scene *scene, const QString &characterName) const
+{
+    const Cell *cell = this->cell(scene, characterName);
+    return cell ? cell->dialogueWordCount : 0;
+}
+
+QStringList SceneIncidenceIndex::characterNames(Scene *scene) const
+{
+    QStringList ret;
+
+    const Row *row = this->row(scene);
+    if (row == nullptr)
+        return ret;
+
+    ret.reserve(row->cells.size());
+    for (const Cell &cell : row->cells)
+        ret << m_characterNames.at(cell.character);
+
+    return ret;
+}
+
+QString SceneIncidenceIndex::location(Scene *scene) const
+{
+    const Row *row = this->row(scene);
+    return row == nullptr || row->location < 0 ? QString() : m_locations.at(row->location);
+}
+
+bool SceneIncidenceIndex::hasLocation(Scene *scene, const QString &location) const
+{
+    const int locationId = m_locationIds.value(location, -1);
+    if (locationId < 0)
+        return false;
+
+    const Row *row = this->row(scene);
+    return row != nullptr && row->location == locationId;
+}
+
+QVector<QVector<int>>
+SceneIncidenceIndex::characterPresenceMatrix(const QList<Scene *> &scenes,
+                                             const QStringList &characterNames) const
+{
+    QVector<QVector<int>> ret(characterNames.size(), QVector<int>(scenes.size(), 0));
+    QVector<int> ids(characterNames.size(), -1);
+
+    for (int c = 0; c < scenes.size(); c++) {
+        const Row *row = this->row(scenes.at(c));
+        if (row == nullptr || row->cells.isEmpty())
+            continue;
+
+        for (int r = 0; r < ids.size(); r++) {
+            // Evaluating a row may intern names we have not seen so far.
+            int &id = ids[r];
+            if (id < 0)
+                id = this->characterId(characterNames.at(r));
+            if (id < 0)
+                continue;
+
+            auto it = std::lower_bound(row->cells.begin(), row->cells.end(), id,
+                                       [](const Cell &a, int b) { return a.character < b; });
+            if (it != row->cells.end() && it->character == id)
+                ret[r][c] = it->presence;
+        }
+    }
+
+    return ret;
+}
+
+QList<int> SceneIncidenceIndex::characterPresence(const QList<Scene *> &scenes,
+                                                  const QString &characterName) const
+{
+    return this->characterPresenceMatrix(scenes, QStringList({ characterName })).first().toList();
+}
+
+int SceneIncidenceIndex::sceneCount(const QString &characterName) const
+{
+    int ret = 0;
+
+    auto it = m_rows.begin();
+    auto end = m_rows.end();
+    for (; it != end; ++it) {
+        Row &row = it.value();
+        if (row.dirty)
+            this->evaluateRow(it.key(), row);
+    }
+
+    const int id = this->characterId(characterName);
+    if (id < 0)
+        return 0;
+
+    for (const Row &row : qAsConst(m_rows)) {
+        auto cit = std::lower_bound(row.cells.begin(), row.cells.end(), id,
+                                    [](const Cell &a, int b) { return a.character < b; });
+        if (cit != row.cells.end() && cit->character == id)
+            ++ret;
+    }
+
+    return ret;
+}
+
+void SceneIncidenceIndex::timerEvent(QTimerEvent *te)
+{
+    if (te->timerId() == m_indexChangedTimer.timerId()) {
+        m_indexChangedTimer.stop();
+        emit indexChanged();
+    } else
+        QObject::timerEvent(te);
+}
+
+void SceneIncidenceIndex::trackScene(Scene *scene)
+{
+    if (scene == nullptr || m_rows.contains(scene))
+        return;
+
+    m_rows.insert(scene, Row());
+
+    auto markDirty = [=]() { this->markSceneDirty(scene); };
+    connect(scene, &Scene::sceneChanged, this, markDirty);
+    connect(scene, &Scene::sceneRefreshed, this, markDirty);
+    connect(scene, &Scene::wordCountChanged, this, markDirty);
+    connect(scene, &Scene::elementCountChanged, this, markDirty);
+    connect(scene->heading(), &SceneHeading::enabledChanged, this, markDirty);
+    connect(scene->heading(), &SceneHeading::locationChanged, this, markDirty);
+    connect(scene, &Scene::aboutToDelete, this, &SceneIncidenceIndex::untrackScene);
+
+    m_indexChangedTimer.start(0, this);
+}
+
+void SceneIncidenceIndex::untrackScene(Scene *scene)
+{
+    if (scene == nullptr || !m_rows.remove(scene))
+        return;
+
+    disconnect(scene, nullptr, this, nullptr);
+    disconnect(scene->heading(), nullptr, this, nullptr);
+
+    m_indexChangedTimer.start(0, this);
+}
+
+void SceneIncidenceIndex::markSceneDirty(Scene *scene)
+{
+    auto it = m_rows.find(scene);
+    if (it == m_rows.end() || it.value().dirty)
+        return;
+
+    it.value().dirty = true;
+    m_indexChangedTimer.start(0, this);
+}
+
+const SceneIncidenceIndex::Row *SceneIncidenceIndex::row(const Scene *scene) const
+{
+    if (scene == nullptr)
+        return nullptr;
+
+    auto it = m_rows.find(scene);
+    if (it == m_rows.end()) {
+        // Scenes outside of the structure (for example, those on the clipboard)
+        // are evaluated every time they are queried.
+        this->evaluateRow(scene, m_untrackedRow);
+        return &m_untrackedRow;
+    }
+
+    Row &row = it.value();
+    if (row.dirty)
+        this->evaluateRow(scene, row);
+
+    return &row;
+}
+
+const SceneIncidenceIndex::Cell *SceneIncidenceIndex::cell(const Scene *scene,
+                                                           const QString &characterName) const
+{
+    const Row *row = this->row(scene);
+    if (row == nullptr)
+        return nullptr;
+
+    const int id = this->characterId(characterName);
+    if (id < 0)
+        return nullptr;
+
+    auto it = std::lower_bound(row->cells.begin(), row->cells.end(), id,
+                               [](const Cell &a, int b) { return a.character < b; });
+    return it != row->cells.end() && it->character == id ? &(*it) : nullptr;
+}
+
+void SceneIncidenceIndex::evaluateRow(const Scene *scene, Row &row) const
+{
+    row.cells.clear();
+    row.location = -1;
+    row.dirty = false;
+
+    const SceneHeading *heading = scene->heading();
+    if (heading->isEnabled() && !heading->location().isEmpty())
+        row.location = this->internLocation(heading->location());
+
+    auto cellAt = [&row](int character) -> Cell & {
+        auto it = std::lower_bound(row.cells.begin(), row.cells.end(), character,
+                                   [](const Cell &a, int b) { return a.character < b; });
+        if (it == row.cells.end() || it->character != character) {
+            Cell cell;
+            cell.character = character;
+            it = row.cells.insert(it, cell);
+        }
+        return *it;
+    };
+
+    // Same attribution rules as Scene::dialogueElements(), so that reports built
+    // on top of this index match those built by walking scene elements.
+    int speaker = -1;
+    const int nrElements = scene->elementCount();
+    for (int i = 0; i < nrElements; i++) {
+        const SceneElement *element = scene->elementAt(i);
+        switch (element->type()) {
+        case SceneElement::Character: {
+            const QString name = element->formattedText().section('(', 0, 0).trimmed();
+            speaker = name.isEmpty() ? -1 : this->internCharacter(name);
+            if (speaker >= 0)
+                ++cellAt(speaker).presence;
+        } break;
+        case SceneElement::Dialogue:
+            if (speaker >= 0) {
+                Cell &cell = cellAt(speaker);
+                ++cell.dialogueCount;
+                cell.dialogueWordCount += element->wordCount();
+            }
+            break;
+        case SceneElement::Parenthetical:
+            break;
+        default:
+            speaker = -1;
+        }
+    }
+
+    // Mute characters are only in the scene's character element map, they are never
+    // part of the element list. Scene::characterPresence() counts them once.
+    const CharacterElementMap &characterElementMap = scene->characterElementMap();
+    const QStringList names = characterElementMap.characterNames();
+    for (const QString &name : names) {
+        if (scene->isCharacterMute(name))
+            ++cellAt(this->internCharacter(name)).presence;
+    }
+}
+
+int SceneIncidenceIndex::internCharacter(const QString &name) const
+{
+    // Character names are case insensitive, just like in Scene::hasCharacter()
+    const QString upperName = name.toUpper();
+    auto it = m_characterIds.find(upperName);
+    if (it != m_characterIds.end())
+        return it.value();
+
+    const int id = m_characterNames.size();
+    m_characterNames.append(upperName);
+    m_characterIds.insert(upperName, id);
+    return id;
+}
+
+int SceneIncidenceIndex::characterId(const QString &name) const
+{
+    return m_characterIds.value(name.toUpper(), -1);
+}
+
+int SceneIncidenceIndex::internLocation(const QString &location) const
+{
+    auto it = m_locationIds.find(location);
+    if (it != m_locationIds.end())
+        return it.value();
+
+    const int id = m_locations.size();
+    m_locations.append(location);
+    m_locationIds.insert(location, id);
+    return id;
+}
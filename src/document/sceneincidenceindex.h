@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef SCENEINCIDENCEINDEX_H
+#define SCENEINCIDENCEINDEX_H
+
+#include <QHash>
+#include <QVector>
+#include <QObject>
+#include <QQmlEngine>
+#include <QStringList>
+
+#include "execlatertimer.h"
+
+class Scene;
+class Structure;
+
+/**
+ * Keeps track of which character speaks (or is present) in which scene and the
+ * location of each scene. Rows are sparse, sorted by interned character id, and are
+ * re-evaluated lazily only for scenes that changed since the last query. Reports and
+ * QML can use this instead of walking scene elements each time they need presence data.
+ */
+class SceneIncidenceIndex : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Instantiation from QML not allowed.")
+
+public:
+    explicit SceneIncidenceIndex(QObject *parent = nullptr);
+    ~SceneIncidenceIndex();
+
+    Q_PROPERTY(Structure *structure READ structure CONSTANT)
+    Structure *structure() const { return m_structure; }
+
+    Q_INVOKABLE bool hasCharacter(Scene *scene, const QString &characterName) const;
+    Q_INVOKABLE int characterPresence(Scene *scene, const QString &characterName) const;
+    Q_INVOKABLE int dialogueCount(Scene *scene, const QString &characterName) const;
+    Q_INVOKABLE int dialogueWordCount(Scene *scene, const QString &characterName) const;
+    Q_INVOKABLE QStringList characterNames(Scene *scene) const;
+
+    Q_INVOKABLE QString location(Scene *scene) const;
+    Q_INVOKABLE bool hasLocation(Scene *scene, const QString &location) const;
+
+    // Returns one row per name, with one column per scene. Each value is the number
+    // of times the character is introduced in that scene (zero if absent).
+    QVector<QVector<int>> characterPresenceMatrix(const QList<Scene *> &scenes,
+                                                  const QStringList &characterNames) const;
+    QList<int> characterPresence(const QList<Scene *> &scenes,
+                                 const QString &characterName) const;
+
+    // Number of scenes in the structure in which the character is present
+    Q_INVOKABLE int sceneCount(const QString &characterName) const;
+
+    // Emitted once after a batch of scenes have changed.
+    Q_SIGNAL void indexChanged();
+
+protected:
+    void timerEvent(QTimerEvent *te);
+
+private:
+    friend class Structure;
+    void trackScene(Scene *scene);
+    void untrackScene(Scene *scene);
+    void markSceneDirty(Scene *scene);
+
+    struct Cell
+    {
+        int character = -1;
+        int presence = 0;
+        int dialogueCount = 0;
+        int dialogueWordCount = 0;
+    };
+    struct Row
+    {
+        bool dirty = true;
+        int location = -1;
+        QVector<Cell> cells; // sorted by character id
+    };
+
+    const Row *row(const Scene *scene) const;
+    const Cell *cell(const Scene *scene, const QString &characterName) const;
+    void evaluateRow(const Scene *scene, Row &row) const;
+    int internCharacter(const QString &name) const;
+    int characterId(const QString &name) const;
+    int internLocation(const QString &location) const;
+
+private:
+    Structure *m_structure = nullptr;
+    mutable QHash<const Scene *, Row> m_rows;
+    mutable Row m_untrackedRow;
+    mutable QHash<QString, int> m_characterIds;
+    mutable QStringList m_characterNames;
+    mutable QHash<QString, int> m_locationIds;
+    mutable QStringList m_locations;
+    ExecLaterTimer m_indexChangedTimer;
+};
+
+#endif // SCENEINCIDENCEINDEX_H
@@ -19,13 +19,142 @@
 #include "application.h"
 #include "scritedocument.h"
 #include "garbagecollector.h"
+#include "deferredworkscheduler.h"
 
+#include <QCborMap>
 #include <QMimeData>
 #include <QSettings>
 #include <QClipboard>
+#include <QCborArray>
 #include <QJsonDocument>
+#include <QCborStreamReader>
 #include <QScopedValueRollback>
 
+/**
+ * Clipboard data of scenes copied from the screenplay. Scenes are carried as JSON for
+ * pasting within this instance, and encoded as CBOR (scrite/screenplay) or rendered as
+ * Fountain (text/plain) only when some other application asks for them.
+ */
+class ScreenplayMimeData : public QMimeData
+{
+    Q_OBJECT
+
+public:
+    explicit ScreenplayMimeData(const QJsonObject &clipboardJson, const Fountain::Body &body);
+    ~ScreenplayMimeData();
+
+    static const QString mimeType;
+    static QString appString();
+
+    // Checks only the leading "app" and "source" entries of encoded data
+    static bool isCompatible(const QByteArray &data);
+
+    QJsonObject clipboardJson() const { return m_clipboardJson; }
+
+    // QMimeData interface
+    QStringList formats() const;
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QVariant::Type preferredType) const;
+
+private:
+    QJsonObject m_clipboardJson;
+    Fountain::Body m_fountainBody;
+    mutable QByteArray m_encodedData;
+    mutable QString m_fountainText;
+};
+
+const QString ScreenplayMimeData::mimeType = QStringLiteral("scrite/screenplay");
+
+ScreenplayMimeData::ScreenplayMimeData(const QJsonObject &clipboardJson,
+                                       const Fountain::Body &body)
+    : m_clipboardJson(clipboardJson), m_fountainBody(body)
+{
+}
+
+ScreenplayMimeData::~ScreenplayMimeData() { }
+
+QString ScreenplayMimeData::appString()
+{
+    return qApp->applicationName() + QLatin1String("-") + qApp->applicationVersion();
+}
+
+static QString readCborString(QCborStreamReader &reader)
+{
+    QString ret;
+    if (!reader.isString())
+        return ret;
+
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        ret += chunk.data;
+        chunk = reader.readString();
+    }
+
+    return chunk.status == QCborStreamReader::EndOfString ? ret : QString();
+}
+
+bool ScreenplayMimeData::isCompatible(const QByteArray &data)
+{
+    QCborStreamReader reader(data);
+    if (!reader.isMap() || !reader.enterContainer())
+        return false;
+
+    QString app, source;
+    while (reader.hasNext() && (app.isEmpty() || source.isEmpty())) {
+        const QString key = readCborString(reader);
+        if (key == QLatin1String("app"))
+            app = readCborString(reader);
+        else if (key == QLatin1String("source"))
+            source = readCborString(reader);
+        else if (key.isEmpty() || !reader.next())
+            return false;
+    }
+
+    // We dont want to support copy/paste between different versions of Scrite.
+    return app == appString() && source == QLatin1String("Screenplay");
+}
+
+QStringList ScreenplayMimeData::formats() const
+{
+    QStringList ret = { mimeType };
+    if (!m_fountainBody.isEmpty())
+        ret << QStringLiteral("text/plain");
+    return ret;
+}
+
+QVariant ScreenplayMimeData::retrieveData(const QString &mimeType,
+                                          QVariant::Type preferredType) const
+{
+    if (mimeType == ScreenplayMimeData::mimeType) {
+        if (m_encodedData.isEmpty()) {
+            // "app" and "source" go first, so that isCompatible() can stop reading early
+            QCborMap map;
+            map.insert(QStringLiteral("app"),
+                       m_clipboardJson.value(QLatin1String("app")).toString());
+            map.insert(QStringLiteral("source"),
+                       m_clipboardJson.value(QLatin1String("source")).toString());
+            map.insert(QStringLiteral("data"),
+                       QCborArray::fromJsonArray(
+                               m_clipboardJson.value(QLatin1String("data")).toArray()));
+            map.insert(QStringLiteral("scenes"),
+                       QCborMap::fromJsonObject(
+                               m_clipboardJson.value(QLatin1String("scenes")).toObject()));
+            m_encodedData = QCborValue(map).toCbor();
+        }
+
+        return m_encodedData;
+    }
+
+    if (mimeType == QLatin1String("text/plain") && !m_fountainBody.isEmpty()) {
+        if (m_fountainText.isEmpty())
+            m_fountainText = Fountain::Writer(m_fountainBody).toString();
+        return m_fountainText;
+    }
+
+    return QMimeData::retrieveData(mimeType, preferredType);
+}
+
 ScreenplayElement::ScreenplayElement(QObject *parent)
     : QObject(parent), m_scene(this, "scene"), m_screenplay(this, "screenplay")
 {
@@ -223,6 +352,8 @@ void ScreenplayElement::setScene(Scene *val)
     connect(m_scene, &Scene::sceneAboutToReset, this, &ScreenplayElement::sceneAboutToReset);
     connect(m_scene, &Scene::sceneReset, this, &ScreenplayElement::sceneReset);
     connect(m_scene, &Scene::typeChanged, this, &ScreenplayElement::sceneTypeChanged);
+    connect(m_scene, &Scene::elementCountChanged, this,
+            &ScreenplayElement::sceneElementCountChanged);
     connect(m_scene, &Scene::groupsChanged, this, &ScreenplayElement::onSceneGroupsChanged);
     connect(m_scene, &Scene::wordCountChanged, this, &ScreenplayElement::wordCountChanged);
 
@@ -262,7 +393,12 @@ void ScreenplayElement::setUserData(const QJsonValue &val)
 
 void ScreenplayElement::setHeightHint(qreal val)
 {
-    if (qFuzzyCompare(m_heightHint, val))
+    // A hint set by the editor is always measured with the current format, so it is
+    // no longer stale even if it hasn't changed.
+    const bool wasStale = m_heightHintStale;
+    m_heightHintStale = false;
+
+    if (qFuzzyCompare(m_heightHint, val) && !wasStale)
         return;
 
     m_heightHint = val;
@@ -429,8 +565,7 @@ void ScreenplayElement::setElementIndex(int val)
 Screenplay::Screenplay(QObject *parent)
     : QAbstractListModel(parent),
       m_scriteDocument(qobject_cast<ScriteDocument *>(parent)),
-      m_activeScene(this, "activeScene"),
-      m_sceneNumberEvaluationTimer("Screenplay.m_sceneNumberEvaluationTimer")
+      m_activeScene(this, "activeScene")
 {
     connect(this, &Screenplay::titleChanged, this, &Screenplay::emptyChanged);
     connect(this, &Screenplay::emailChanged, this, &Screenplay::emptyChanged);
@@ -447,14 +582,36 @@ Screenplay::Screenplay(QObject *parent)
     connect(this, &Screenplay::emptyChanged, this, &Screenplay::screenplayChanged);
     connect(this, &Screenplay::coverPagePhotoChanged, this, &Screenplay::screenplayChanged);
     connect(this, &Screenplay::elementsChanged, this, &Screenplay::evaluateSceneNumbersLater);
-    connect(this, &Screenplay::elementsChanged, this, &Screenplay::evaluateParagraphCountsLater);
+    connect(this, &QAbstractListModel::rowsInserted, this,
+            [=](const QModelIndex &, int first) { this->markSceneNumbersDirty(first); });
+    connect(this, &QAbstractListModel::rowsRemoved, this,
+            [=](const QModelIndex &, int first) { this->markSceneNumbersDirty(first); });
+    connect(this, &Screenplay::elementInserted, this, [=](ScreenplayElement *element) {
+        m_paragraphCountDirtyElements += element;
+        this->evaluateParagraphCountsLater();
+    });
+    connect(this, &Screenplay::elementRemoved, this, [=](ScreenplayElement *element) {
+        m_paragraphCountDirtyElements.remove(element);
+        this->removeParagraphCount(element);
+        this->evaluateParagraphCountsLater();
+    });
     connect(this, &Screenplay::elementsChanged, this,
             &Screenplay::evaluateIfHeightHintsAreAvailableLater);
+    if (m_scriteDocument != nullptr && m_scriteDocument->formatting() != nullptr) {
+        // While a document is loading, its formatting is loaded after the screenplay
+        // and then fixed up. Height hints are validated once all that is done.
+        ScreenplayFormat *format = m_scriteDocument->formatting();
+        connect(format, &ScreenplayFormat::formatChanged, this,
+                &Screenplay::validateHeightHintsIfNotLoading);
+        connect(format, &ScreenplayFormat::screenChanged, this,
+                &Screenplay::validateHeightHintsIfNotLoading);
+        connect(m_scriteDocument, &ScriteDocument::loadingChanged, this,
+                &Screenplay::validateHeightHintsIfNotLoading);
+    }
     connect(this, &Screenplay::coverPagePhotoSizeChanged, this, &Screenplay::screenplayChanged);
     connect(this, &Screenplay::titlePageIsCenteredChanged, this, &Screenplay::screenplayChanged);
     connect(this, &Screenplay::screenplayChanged, [=]() {
         this->evaluateHasTitlePageAttributes();
-        this->evaluateParagraphCountsLater();
         this->evaluateWordCountLater();
         this->markAsModified();
     });
@@ -491,6 +648,8 @@ Screenplay::Screenplay(QObject *parent)
 
 Screenplay::~Screenplay()
 {
+    this->cancelPendingPaste();
+
     GarbageCollector::instance()->avoidChildrenOf(this);
     emit aboutToDelete(this);
 }
@@ -906,14 +1065,18 @@ void Screenplay::removeElement(ScreenplayElement *ptr)
 
     Scene *scene = ptr->scene();
     if (scene != nullptr) {
-        scene->setAct(QString());
-        scene->setActIndex(-1);
-        scene->setEpisode(QString());
-        scene->setEpisodeIndex(-1);
-        scene->setScreenplayElementIndexList(QList<int>());
+        QList<int> indexList = scene->screenplayElementIndexList();
+        indexList.removeAll(row);
+        if (indexList.isEmpty()) {
+            scene->setAct(QString());
+            scene->setActIndex(-1);
+            scene->setEpisode(QString());
+            scene->setEpisodeIndex(-1);
+        }
+        scene->setScreenplayElementIndexList(indexList);
 
         // If this scene still exists as another element in the screenplay, then
-        // it is going to get the above properties set in evaluateSceneNumbers() shortly.
+        // indexes that follow the removed one are updated in evaluateSceneNumbers() shortly.
     }
 
     this->disconnectFromScreenplayElementSignals(ptr);
@@ -990,11 +1153,15 @@ void Screenplay::removeElements(const QList<ScreenplayElement *> &givenElements)
 
             Scene *scene = ptr->scene();
             if (scene != nullptr) {
-                scene->setAct(QString());
-                scene->setActIndex(-1);
-                scene->setEpisode(QString());
-                scene->setEpisodeIndex(-1);
-                scene->setScreenplayElementIndexList(QList<int>());
+                QList<int> indexList = scene->screenplayElementIndexList();
+                indexList.removeAll(row);
+                if (indexList.isEmpty()) {
+                    scene->setAct(QString());
+                    scene->setActIndex(-1);
+                    scene->setEpisode(QString());
+                    scene->setEpisodeIndex(-1);
+                }
+                scene->setScreenplayElementIndexList(indexList);
             }
 
             this->disconnectFromScreenplayElementSignals(ptr);
@@ -1217,6 +1384,8 @@ void Screenplay::moveSelectedElements(int toRow)
 
     emit aboutToMoveElements(toRow);
 
+    const QList<ScreenplayElement *> oldElements = m_elements;
+
     QList<ScreenplayElement *> selectedElements;
     QHash<ScreenplayElement *, QPair<int, int>> movement;
     for (int i = m_elements.size() - 1; i >= 0; i--) {
@@ -1249,6 +1418,8 @@ void Screenplay::moveSelectedElements(int toRow)
 
     this->endResetModel();
 
+    this->markSceneNumbersDirty(oldElements);
+
     emit elementsChanged();
 
     this->updateBreakTitlesLater();
@@ -1603,6 +1774,8 @@ void Screenplay::clearElements()
 
     this->endResetModel();
 
+    this->markSceneNumbersDirty(0);
+
     emit elementCountChanged();
     emit elementsChanged();
     this->evaluateSceneNumbersLater();
@@ -2094,6 +2267,8 @@ bool Screenplay::setElements(const QList<ScreenplayElement *> &list)
     m_elements = list;
     this->endResetModel();
 
+    this->markSceneNumbersDirty(copy);
+
     emit elementsChanged();
 
     return true;
@@ -2211,9 +2386,21 @@ void Screenplay::connectToScreenplayElementSignals(ScreenplayElement *ptr)
     connect(ptr, &ScreenplayElement::sceneReset, this, &Screenplay::onSceneReset,
             Qt::UniqueConnection);
     connect(ptr, &ScreenplayElement::evaluateSceneNumberRequest, this,
-            &Screenplay::evaluateSceneNumbersLater, Qt::UniqueConnection);
-    connect(ptr, &ScreenplayElement::sceneTypeChanged, this, &Screenplay::evaluateSceneNumbersLater,
-            Qt::UniqueConnection);
+            &Screenplay::onElementSceneNumberingChanged, Qt::UniqueConnection);
+    connect(ptr, &ScreenplayElement::sceneTypeChanged, this,
+            &Screenplay::onElementSceneNumberingChanged, Qt::UniqueConnection);
+    connect(ptr, &ScreenplayElement::elementTypeChanged, this,
+            &Screenplay::onElementSceneNumberingChanged, Qt::UniqueConnection);
+    connect(ptr, &ScreenplayElement::breakTypeChanged, this,
+            &Screenplay::onElementSceneNumberingChanged, Qt::UniqueConnection);
+    connect(ptr, &ScreenplayElement::breakTitleChanged, this,
+            &Screenplay::onElementSceneNumberingChanged, Qt::UniqueConnection);
+    connect(ptr, &ScreenplayElement::breakSubtitleChanged, this,
+            &Screenplay::onElementSceneNumberingChanged, Qt::UniqueConnection);
+    connect(ptr, &ScreenplayElement::sceneChanged, this,
+            &Screenplay::onElementParagraphCountChanged, Qt::UniqueConnection);
+    connect(ptr, &ScreenplayElement::sceneElementCountChanged, this,
+            &Screenplay::onElementParagraphCountChanged, Qt::UniqueConnection);
     connect(ptr, &ScreenplayElement::sceneGroupsChanged, this,
             &Screenplay::elementSceneGroupsChanged, Qt::UniqueConnection);
     connect(ptr, &ScreenplayElement::elementTypeChanged, this, &Screenplay::updateBreakTitlesLater,
@@ -2243,9 +2430,21 @@ void Screenplay::disconnectFromScreenplayElementSignals(ScreenplayElement *ptr)
     disconnect(ptr, &ScreenplayElement::aboutToDelete, this, &Screenplay::removeElement);
     disconnect(ptr, &ScreenplayElement::sceneReset, this, &Screenplay::onSceneReset);
     disconnect(ptr, &ScreenplayElement::evaluateSceneNumberRequest, this,
-               &Screenplay::evaluateSceneNumbersLater);
+               &Screenplay::onElementSceneNumberingChanged);
     disconnect(ptr, &ScreenplayElement::sceneTypeChanged, this,
-               &Screenplay::evaluateSceneNumbersLater);
+               &Screenplay::onElementSceneNumberingChanged);
+    disconnect(ptr, &ScreenplayElement::elementTypeChanged, this,
+               &Screenplay::onElementSceneNumberingChanged);
+    disconnect(ptr, &ScreenplayElement::breakTypeChanged, this,
+               &Screenplay::onElementSceneNumberingChanged);
+    disconnect(ptr, &ScreenplayElement::breakTitleChanged, this,
+               &Screenplay::onElementSceneNumberingChanged);
+    disconnect(ptr, &ScreenplayElement::breakSubtitleChanged, this,
+               &Screenplay::onElementSceneNumberingChanged);
+    disconnect(ptr, &ScreenplayElement::sceneChanged, this,
+               &Screenplay::onElementParagraphCountChanged);
+    disconnect(ptr, &ScreenplayElement::sceneElementCountChanged, this,
+               &Screenplay::onElementParagraphCountChanged);
     disconnect(ptr, &ScreenplayElement::sceneGroupsChanged, this,
                &Screenplay::elementSceneGroupsChanged);
     disconnect(ptr, &ScreenplayElement::elementTypeChanged, this,
@@ -2291,13 +2490,13 @@ void Screenplay::evaluateWordCount()
 
 void Screenplay::evaluateWordCountLater()
 {
-    m_wordCountTimer.start(100, this);
+    DeferredWorkScheduler::instance()->schedule(this, "Screenplay.evaluateWordCount",
+                                                DeferredWorkScheduler::NormalPriority, 100,
+                                                [=]() { this->evaluateWordCount(); });
 }
 
-bool Screenplay::getPasteDataFromClipboard(QJsonObject &clipboardJson) const
+bool Screenplay::hasPasteDataInClipboard() const
 {
-    clipboardJson = QJsonObject();
-
     ScriteDocument *sdoc = ScriteDocument::instance();
     if (sdoc->isReadOnly())
         return false;
@@ -2307,33 +2506,32 @@ bool Screenplay::getPasteDataFromClipboard(QJsonObject &clipboardJson) const
     if (mimeData == nullptr)
         return false;
 
-    const QString screenplayMimeType = QLatin1String("scrite/screenplay");
-    if (!mimeData->hasFormat(screenplayMimeType))
-        return false;
-
-    const QByteArray clipboardText = mimeData->data(screenplayMimeType);
-    if (clipboardText.isEmpty())
-        return false;
-
-    QJsonParseError parseError;
-    const QJsonDocument jsonDoc = QJsonDocument::fromJson(clipboardText, &parseError);
-    if (parseError.error != QJsonParseError::NoError)
-        return false;
+    if (qobject_cast<const ScreenplayMimeData *>(mimeData) != nullptr)
+        return true;
 
-    const QString appString =
-            qApp->applicationName() + QLatin1String("-") + qApp->applicationVersion();
+    return mimeData->hasFormat(ScreenplayMimeData::mimeType)
+            && ScreenplayMimeData::isCompatible(mimeData->data(ScreenplayMimeData::mimeType));
+}
 
-    const QJsonObject jsonObj = jsonDoc.object();
-    if (jsonObj.value(QLatin1String("app")).toString() != appString)
-        return false; // We dont want to support copy/paste between different versions of
-                      // Scrite.
+bool Screenplay::getPasteDataFromClipboard(QJsonObject &clipboardJson) const
+{
+    clipboardJson = QJsonObject();
 
-    if (jsonObj.value(QLatin1String("source")).toString() != QLatin1String("Screenplay"))
+    if (!this->hasPasteDataInClipboard())
         return false;
 
-    clipboardJson = jsonObj;
+    // Scenes copied within this instance are pasted without encoding or decoding them
+    const QMimeData *mimeData = qApp->clipboard()->mimeData();
+    const ScreenplayMimeData *screenplayMimeData =
+            qobject_cast<const ScreenplayMimeData *>(mimeData);
+    if (screenplayMimeData != nullptr)
+        clipboardJson = screenplayMimeData->clipboardJson();
+    else
+        clipboardJson = QCborValue::fromCbor(mimeData->data(ScreenplayMimeData::mimeType))
+                                .toMap()
+                                .toJsonObject();
 
-    return true;
+    return !clipboardJson.isEmpty();
 }
 
 void Screenplay::setHeightHintsAvailable(bool val)
@@ -2353,7 +2551,7 @@ void Screenplay::evaluateIfHeightHintsAreAvailable()
         if (element->elementType() != ScreenplayElement::SceneElementType)
             continue;
 
-        available &= !qFuzzyIsNull(element->heightHint());
+        available &= !qFuzzyIsNull(element->heightHint()) && !element->m_heightHintStale;
         if (!available)
             break;
     }
@@ -2366,6 +2564,36 @@ void Screenplay::evaluateIfHeightHintsAreAvailableLater()
     m_evalHeightHintsAvailableTimer.start(100, this);
 }
 
+QString Screenplay::evaluateHeightHintsKey() const
+{
+    const ScreenplayFormat *format = m_scriteDocument ? m_scriteDocument->formatting() : nullptr;
+    return format ? format->layoutFingerprint() : QString();
+}
+
+void Screenplay::validateHeightHints()
+{
+    // Height hints measured with another format (or on another computer) are still
+    // good estimates for the editor, but they are no longer exact. They stay stale
+    // until the editor measures them again.
+    const QString key = this->evaluateHeightHintsKey();
+    if (key.isEmpty() || key != m_heightHintsKey) {
+        for (ScreenplayElement *element : qAsConst(m_elements)) {
+            if (element->elementType() == ScreenplayElement::SceneElementType)
+                element->m_heightHintStale = true;
+        }
+
+        m_heightHintsKey = key;
+    }
+
+    this->evaluateIfHeightHintsAreAvailable();
+}
+
+void Screenplay::validateHeightHintsIfNotLoading()
+{
+    if (m_scriteDocument == nullptr || !m_scriteDocument->isLoading())
+        this->validateHeightHints();
+}
+
 void Screenplay::setCurrentElementIndex(int val)
 {
     val = qBound(-1, val, m_elements.size() - 1);
@@ -2469,22 +2697,16 @@ QJsonArray Screenplay::search(const QString &text, int flags) const
         for (int j = 0; j < nrElements; j++) {
             SceneElement *element = scene->elementAt(j);
 
-            const QJsonArray results = element->find(text, flags);
-            if (!results.isEmpty()) {
-                for (int r = 0; r < results.size(); r++) {
-                    const QJsonObject result = results.at(r).toObject();
-
-                    QJsonObject item;
-                    item.insert(QStringLiteral("sceneIndex"), i);
-                    item.insert(QStringLiteral("elementIndex"), j);
-                    item.insert(QStringLiteral("sceneResultIndex"), sceneResultIndex++);
-
-                    const QString _from = QStringLiteral("from");
-                    const QString _to = QStringLiteral("to");
-                    item.insert(_from, _from);
-                    item.insert(_to, _to);
-                    ret.append(item);
-                }
+            const QVector<QPair<int, int>> ranges =
+                    SearchEngine::rangesOf(text, element->text(), flags);
+            for (const QPair<int, int> &range : ranges) {
+                QJsonObject item;
+                item.insert(QStringLiteral("sceneIndex"), i);
+                item.insert(QStringLiteral("elementIndex"), j);
+                item.insert(QStringLiteral("sceneResultIndex"), sceneResultIndex++);
+                item.insert(QStringLiteral("from"), range.first);
+                item.insert(QStringLiteral("to"), range.first + range.second - 1);
+                ret.append(item);
             }
         }
     }
@@ -2492,6 +2714,34 @@ QJsonArray Screenplay::search(const QString &text, int flags) const
     return ret;
 }
 
+int Screenplay::reportSearchResults(const QString &text, SearchAgent *agent, int flags) const
+{
+    if (agent == nullptr)
+        return 0;
+
+    HourGlass hourGlass;
+
+    int counter = 0;
+
+    const int nrScenes = m_elements.size();
+    for (int i = 0; i < nrScenes; i++) {
+        Scene *scene = m_elements.at(i)->scene();
+        if (scene == nullptr)
+            continue;
+
+        const int nrElements = scene->elementCount();
+        for (int j = 0; j < nrElements; j++) {
+            const QVector<QPair<int, int>> ranges =
+                    SearchEngine::rangesOf(text, scene->elementAt(j)->text(), flags);
+            for (const QPair<int, int> &range : ranges)
+                agent->addSearchResult(i, range.first, range.second);
+            counter += ranges.size();
+        }
+    }
+
+    return counter;
+}
+
 int Screenplay::replace(const QString &text, const QString &replacementText, int flags)
 {
     HourGlass hourGlass;
@@ -2509,10 +2759,13 @@ int Screenplay::replace(const QString &text, const QString &replacementText, int
         const int nrElements = scene->elementCount();
         for (int j = 0; j < nrElements; j++) {
             SceneElement *element = scene->elementAt(j);
-            const QJsonArray results = element->find(text, flags);
-            counter += results.size();
+            QString elementText = element->text();
 
-            if (results.isEmpty())
+            const QVector<QPair<int, int>> ranges =
+                    SearchEngine::rangesOf(text, elementText, flags);
+            counter += ranges.size();
+
+            if (ranges.isEmpty())
                 continue;
 
             if (!begunUndoCapture) {
@@ -2520,15 +2773,8 @@ int Screenplay::replace(const QString &text, const QString &replacementText, int
                 begunUndoCapture = true;
             }
 
-            QString elementText = element->text();
-            for (int r = results.size() - 1; r >= 0; r--) {
-                const QString _from = QStringLiteral("from");
-                const QString _to = QStringLiteral("to");
-                const QJsonObject result = results.at(r).toObject();
-                const int from = result.value(_from).toInt();
-                const int to = result.value(_to).toInt();
-                elementText = elementText.replace(from, to - from + 1, replacementText);
-            }
+            for (int r = ranges.size() - 1; r >= 0; r--)
+                elementText.replace(ranges.at(r).first, ranges.at(r).second, replacementText);
 
             element->setText(elementText);
         }
@@ -2583,8 +2829,7 @@ bool Screenplay::capitalizeSentences()
 
 bool Screenplay::canPaste() const
 {
-    QJsonObject clipboardJson;
-    if (this->getPasteDataFromClipboard(clipboardJson))
+    if (this->hasPasteDataInClipboard())
         return true;
 
     const QClipboard *clipboard = qApp->clipboard();
@@ -2601,8 +2846,7 @@ bool Screenplay::canPaste() const
 void Screenplay::copySelection()
 {
     QJsonObject clipboardJson;
-    clipboardJson.insert(QLatin1String("app"),
-                         qApp->applicationName() + QLatin1String("-") + qApp->applicationVersion());
+    clipboardJson.insert(QLatin1String("app"), ScreenplayMimeData::appString());
     clipboardJson.insert(QLatin1String("source"), QLatin1String("Screenplay"));
 
     QJsonArray data;
@@ -2627,11 +2871,7 @@ void Screenplay::copySelection()
     clipboardJson.insert(QLatin1String("data"), data);
     clipboardJson.insert(QLatin1String("scenes"), scenes);
 
-    const QByteArray clipboardText = QJsonDocument(clipboardJson).toJson();
-
-    QMimeData *mimeData = new QMimeData;
-    mimeData->setData(QLatin1String("scrite/screenplay"), clipboardText);
-    mimeData->setText(Fountain::Writer(fBody).toString());
+    ScreenplayMimeData *mimeData = new ScreenplayMimeData(clipboardJson, fBody);
 
     QClipboard *clipboard = qApp->clipboard();
     clipboard->setMimeData(mimeData);
@@ -2645,6 +2885,10 @@ public:
                                         int pasteAfter);
     ~ScreenplayPasteUndoCommand();
 
+    // Creates the next few pasted elements, and scenes they need, without adding them to
+    // the screenplay or structure yet. Returns true once all of them are created.
+    bool prepare(int batchSize);
+
     void redo();
     void undo();
 
@@ -2652,9 +2896,13 @@ private:
     Structure *m_structure = nullptr;
     Screenplay *m_screenplay = nullptr;
     int m_pasteAfter = -1;
+    QPointer<ScreenplayElement> m_pasteAfterElement;
+    int m_preparedCount = 0;
+    bool m_pasted = false;
     QJsonObject m_scenesData;
     QJsonArray m_screenplayElementsData;
     QList<Scene *> m_scenes;
+    QHash<QString, Scene *> m_sceneIdMap;
     QList<ScreenplayElement *> m_screenplayElements;
 };
 
@@ -2664,19 +2912,31 @@ ScreenplayPasteUndoCommand::ScreenplayPasteUndoCommand(Screenplay *screenplay, S
     : m_structure(structure),
       m_screenplay(screenplay),
       m_pasteAfter(pasteAfter),
+      m_pasteAfterElement(screenplay->elementAt(pasteAfter)),
       m_scenesData(scenes),
       m_screenplayElementsData(elements)
 {
 }
 
-ScreenplayPasteUndoCommand::~ScreenplayPasteUndoCommand() { }
+ScreenplayPasteUndoCommand::~ScreenplayPasteUndoCommand()
+{
+    // Elements prepared for a paste that never happened are not owned by anybody else
+    if (!m_pasted) {
+        qDeleteAll(m_screenplayElements);
+        for (Scene *scene : qAsConst(m_scenes))
+            delete scene->structureElement();
+    }
+}
 
-void ScreenplayPasteUndoCommand::redo()
+bool ScreenplayPasteUndoCommand::prepare(int batchSize)
 {
-    for (int i = 0; i < m_screenplayElementsData.size(); i++) {
-        const QJsonObject elementJson = m_screenplayElementsData.at(i).toObject();
+    const int count = qMin(m_screenplayElementsData.size() - m_preparedCount, qMax(batchSize, 1));
+    for (int i = 0; i < count; i++) {
+        const QJsonObject elementJson = m_screenplayElementsData.at(m_preparedCount++).toObject();
         const QString sceneId = elementJson.value(QLatin1String("sceneID")).toString();
-        if (!m_structure->findElementBySceneID(sceneId)) {
+
+        Scene *scene = m_sceneIdMap.value(sceneId);
+        if (scene == nullptr && !m_structure->findElementBySceneID(sceneId)) {
             const QJsonObject sceneJson = m_scenesData.value(sceneId).toObject();
             if (sceneJson.isEmpty())
                 continue;
@@ -2685,7 +2945,7 @@ void ScreenplayPasteUndoCommand::redo()
             factory.addClass<SceneElement>();
 
             StructureElement *structureElement = new StructureElement(m_structure);
-            Scene *scene = new Scene(structureElement);
+            scene = new Scene(structureElement);
             if (!QObjectSerializer::fromJson(sceneJson, scene, &factory)) {
                 delete scene;
                 delete structureElement;
@@ -2693,7 +2953,8 @@ void ScreenplayPasteUndoCommand::redo()
             }
 
             structureElement->setScene(scene);
-            m_structure->addElement(structureElement);
+            m_sceneIdMap.insert(sceneId, scene);
+            m_scenes.append(scene);
         }
 
         ScreenplayElement *screenplayElement = new ScreenplayElement(m_screenplay);
@@ -2702,12 +2963,35 @@ void ScreenplayPasteUndoCommand::redo()
             continue;
         }
 
+        // Scenes created above are not in the structure yet, so they cannot be looked up
+        // by their ID while loading the element.
+        if (scene != nullptr && screenplayElement->scene() == nullptr)
+            screenplayElement->setScene(scene);
+
         m_screenplayElements.append(screenplayElement);
     }
 
+    return m_preparedCount >= m_screenplayElementsData.size();
+}
+
+void ScreenplayPasteUndoCommand::redo()
+{
+    this->prepare(m_screenplayElementsData.size());
+
+    for (Scene *scene : qAsConst(m_scenes))
+        m_structure->addElement(scene->structureElement());
+    m_pasted = true;
+
     if (m_screenplayElements.isEmpty())
         return;
 
+    // Elements may have been inserted or removed while pasted scenes were being
+    // prepared, so paste after the same element if it is still in the screenplay.
+    const int pasteAfter = m_screenplay->indexOfElement(m_pasteAfterElement);
+    if (pasteAfter >= 0)
+        m_pasteAfter = pasteAfter;
+    m_pasteAfter = qBound(-1, m_pasteAfter, m_screenplay->elementCount() - 1);
+
     m_screenplay->insertElementsAt(m_screenplayElements, m_pasteAfter + 1);
     m_screenplay->setSelection(m_screenplayElements);
 }
@@ -2722,6 +3006,11 @@ void ScreenplayPasteUndoCommand::undo()
         structureElements.append(scene->structureElement());
     m_structure->removeElements(structureElements);
     m_scenes.clear();
+
+    // Redo creates everything afresh from the pasted data
+    m_sceneIdMap.clear();
+    m_preparedCount = 0;
+    m_pasted = false;
 }
 
 class ScreenplayPasteFromFountainUndoCommand : public QUndoCommand
@@ -2790,8 +3079,21 @@ void ScreenplayPasteFromFountainUndoCommand::undo()
     m_scenes.clear();
 }
 
+static void pushPasteUndoCommand(QUndoCommand *cmd)
+{
+    if (UndoStack::active()) {
+        UndoStack::active()->push(cmd);
+    } else {
+        cmd->redo();
+        delete cmd;
+    }
+}
+
 void Screenplay::pasteAfter(int index)
 {
+    // A paste that is still being prepared must happen before this one
+    this->completePendingPaste();
+
     ScriteDocument *sdoc = ScriteDocument::instance();
     Structure *structure = sdoc->structure();
 
@@ -2803,7 +3105,9 @@ void Screenplay::pasteAfter(int index)
         // structured JSON data.
         const QJsonObject scenes = clipboardJson.value(QLatin1String("scenes")).toObject();
         const QJsonArray elements = clipboardJson.value(QLatin1String("data")).toArray();
-        cmd = new ScreenplayPasteUndoCommand(this, structure, elements, scenes, index);
+        m_pendingPaste = new ScreenplayPasteUndoCommand(this, structure, elements, scenes, index);
+        this->continuePendingPaste();
+        return;
     } else {
         const int pasteOptions = Screenplay::fountainPasteOptions();
 
@@ -2825,20 +3129,60 @@ void Screenplay::pasteAfter(int index)
     if (cmd == nullptr)
         return;
 
-    if (UndoStack::active()) {
-        UndoStack::active()->push(cmd);
-    } else {
-        cmd->redo();
-        delete cmd;
+    pushPasteUndoCommand(cmd);
+}
+
+void Screenplay::continuePendingPaste()
+{
+    if (m_pendingPaste == nullptr)
+        return;
+
+    // Pasted scenes are created a few at a time, so that pasting a lot of them doesn't
+    // block the event loop. They are inserted all at once, when all of them are ready.
+    if (!m_pendingPaste->prepare(8)) {
+        DeferredWorkScheduler::instance()->schedule(this, "Screenplay.continuePendingPaste",
+                                                    DeferredWorkScheduler::NormalPriority, 0,
+                                                    [=]() { this->continuePendingPaste(); });
+        return;
+    }
+
+    QUndoCommand *cmd = m_pendingPaste;
+    m_pendingPaste = nullptr;
+    pushPasteUndoCommand(cmd);
+}
+
+void Screenplay::completePendingPaste()
+{
+    DeferredWorkScheduler::instance()->cancel(this, "Screenplay.continuePendingPaste");
+
+    if (m_pendingPaste != nullptr) {
+        m_pendingPaste->prepare(INT_MAX);
+        this->continuePendingPaste();
     }
 }
 
+void Screenplay::cancelPendingPaste()
+{
+    DeferredWorkScheduler::instance()->cancel(this, "Screenplay.continuePendingPaste");
+
+    delete m_pendingPaste;
+    m_pendingPaste = nullptr;
+}
+
 void Screenplay::serializeToJson(QJsonObject &json) const
 {
     json.insert("hasCoverPagePhoto", !m_coverPagePhoto.isEmpty());
+
+    // Height hints are saved as exact only if all of them were measured with the
+    // current format, otherwise they are taken as estimates when loaded again.
+    const bool hasStaleHeightHints =
+            std::any_of(m_elements.begin(), m_elements.end(),
+                        [](ScreenplayElement *element) { return element->m_heightHintStale; });
+    json.insert("heightHintsKey",
+                hasStaleHeightHints ? QString() : this->evaluateHeightHintsKey());
 }
 
-void Screenplay::deserializeFromJson(const QJsonObject &)
+void Screenplay::deserializeFromJson(const QJsonObject &json)
 {
     const QString cpPhotoPath =
             m_scriteDocument->fileSystem()->absolutePath(standardCoverPathPhotoPath());
@@ -2859,7 +3203,10 @@ void Screenplay::deserializeFromJson(const QJsonObject &)
 #endif
 
     this->evaluateWordCountLater();
-    this->evaluateIfHeightHintsAreAvailableLater();
+
+    // Validated against the formatting once the document has finished loading, see
+    // validateHeightHintsIfNotLoading().
+    m_heightHintsKey = json.value("heightHintsKey").toString();
 }
 
 bool Screenplay::canSetPropertyFromObjectList(const QString &propName) const
@@ -2890,6 +3237,8 @@ void Screenplay::setPropertyFromObjectList(const QString &propName, const QList<
 
         this->endResetModel();
 
+        this->markSceneNumbersDirty(0);
+
         emit elementCountChanged();
         emit elementsChanged();
 
@@ -3064,18 +3413,9 @@ bool Screenplay::event(QEvent *event)
 
 void Screenplay::timerEvent(QTimerEvent *te)
 {
-    if (te->timerId() == m_sceneNumberEvaluationTimer.timerId()) {
-        m_sceneNumberEvaluationTimer.stop();
-        this->evaluateSceneNumbers();
-    } else if (te->timerId() == m_updateBreakTitlesTimer.timerId()) {
+    if (te->timerId() == m_updateBreakTitlesTimer.timerId()) {
         m_updateBreakTitlesTimer.stop();
         this->updateBreakTitles();
-    } else if (te->timerId() == m_paragraphCountEvaluationTimer.timerId()) {
-        m_paragraphCountEvaluationTimer.stop();
-        this->evaluateParagraphCounts();
-    } else if (te->timerId() == m_wordCountTimer.timerId()) {
-        m_wordCountTimer.stop();
-        this->evaluateWordCount();
     } else if (te->timerId() == m_evalHeightHintsAvailableTimer.timerId()) {
         m_evalHeightHintsAvailableTimer.stop();
         this->evaluateIfHeightHintsAreAvailable();
@@ -3135,107 +3475,219 @@ void Screenplay::evaluateSceneNumbers(bool minorAlso)
     if (m_scriteDocument == nullptr)
         return;
 
-    int actIndex = -1, totalActIndex = -1;
-    int episodeIndex = -1;
-    int elementIndex = -1;
-    int nrScenes = 0;
-    bool containsNonStandardScenes = false;
+    if (minorAlso)
+        this->markSceneNumbersDirty(0);
 
-    ScreenplayElement *lastEpisodeElement = nullptr;
-    ScreenplayElement *lastActElement = nullptr;
-    QString lastEpisodeName;
-    QString lastActName;
+    const int nrElements = m_elements.size();
+    if (m_sceneNumbersDirtyFrom < 0 && m_sceneNumberingStates.size() == nrElements)
+        return;
 
+    // States of elements that follow the dirty range can be trusted only if no element
+    // was added or removed since they were evaluated.
+    const bool statesAligned = m_sceneNumberingStates.size() == nrElements;
+    const int from =
+            qMin(m_sceneNumbersDirtyFrom < 0 ? nrElements : m_sceneNumbersDirtyFrom,
+                 m_sceneNumberingStates.size());
+    const int to = !minorAlso && statesAligned && m_sceneNumbersDirtyTo >= 0
+            ? m_sceneNumbersDirtyTo
+            : nrElements;
+    m_sceneNumbersDirtyFrom = -1;
+    m_sceneNumbersDirtyTo = -1;
+
+    // Scenes whose elements were, or are now, in the range of elements evaluated here
     QHash<Scene *, QList<int>> indexListMap;
 
-    for (ScreenplayElement *element : qAsConst(m_elements))
-        if (element->scene())
-            indexListMap[element->scene()] = QList<int>();
+    SceneNumberingState state = from > 0 ? m_sceneNumberingStates.at(from - 1)
+                                         : SceneNumberingState();
 
-    int index = -1;
-    ScreenplayElement::SceneNumber sceneNumber;
-    for (ScreenplayElement *element : qAsConst(m_elements)) {
-        ++index;
+    int index = from;
+    while (index < nrElements) {
+        ScreenplayElement *element = m_elements.at(index);
+        state.scene = nullptr;
 
         if (element->elementType() == ScreenplayElement::SceneElementType) {
-            if (actIndex < 0 && element->scene()->heading()->isEnabled())
-                ++actIndex;
-            if (episodeIndex < 0 && element->scene()->heading()->isEnabled())
-                ++episodeIndex;
+            if (state.actIndex < 0 && element->scene()->heading()->isEnabled())
+                ++state.actIndex;
+            if (state.episodeIndex < 0 && element->scene()->heading()->isEnabled())
+                ++state.episodeIndex;
 
-            element->setElementIndex(++elementIndex);
-            element->setActIndex(actIndex);
-            element->setEpisodeIndex(episodeIndex);
+            element->setElementIndex(++state.elementIndex);
+            element->setActIndex(state.actIndex);
+            element->setEpisodeIndex(state.episodeIndex);
 
             // This should never happen!
             if (element->scene() == nullptr)
                 element->setScene(new Scene(element));
 
             Scene *scene = element->scene();
-            scene->setAct(lastActElement         ? lastActName
-                                  : actIndex < 0 ? QStringLiteral("No Act")
-                                                 : QStringLiteral("ACT 1"));
-            scene->setActIndex(actIndex);
-            scene->setEpisode(lastEpisodeElement         ? lastEpisodeName
-                                      : episodeIndex < 0 ? QStringLiteral("No Episode")
-                                                         : QStringLiteral("EPISODE 1"));
-            scene->setEpisodeIndex(episodeIndex);
             indexListMap[scene].append(index);
+            state.scene = scene;
 
             if (scene->heading()->isEnabled()) {
-                ++nrScenes;
-                element->evaluateSceneNumber(sceneNumber, minorAlso);
+                ++state.sceneCount;
+                element->evaluateSceneNumber(state.sceneNumber, minorAlso);
             }
         } else {
             element->setElementIndex(-1);
             if (element->breakType() == Screenplay::Act) {
-                ++actIndex;
-                if (totalActIndex < 0)
-                    ++totalActIndex;
-                ++totalActIndex;
+                ++state.actIndex;
+                if (state.totalActIndex < 0)
+                    ++state.totalActIndex;
+                ++state.totalActIndex;
 
-                lastActElement = element;
-                lastActName = element->breakTitle();
+                state.hasActBreak = true;
+                state.actName = element->breakTitle();
                 if (!element->breakSubtitle().isEmpty())
-                    lastActName += ": " + element->breakSubtitle();
+                    state.actName += ": " + element->breakSubtitle();
             } else if (element->breakType() == Screenplay::Episode) {
-                ++episodeIndex;
+                ++state.episodeIndex;
 
-                actIndex = 0;
+                state.actIndex = 0;
 
-                lastActElement = nullptr;
-                lastEpisodeElement = element;
-                lastEpisodeName = element->breakTitle();
+                state.hasActBreak = false;
+                state.hasEpisodeBreak = true;
+                state.episodeName = element->breakTitle();
                 if (!element->breakSubtitle().isEmpty())
-                    lastEpisodeName += ": " + element->breakSubtitle();
+                    state.episodeName += ": " + element->breakSubtitle();
             }
 
-            element->setActIndex(actIndex);
-            element->setEpisodeIndex(episodeIndex);
+            element->setActIndex(state.actIndex);
+            element->setEpisodeIndex(state.episodeIndex);
         }
 
-        if (!containsNonStandardScenes && element->scene()
-            && element->scene()->type() != Scene::Standard)
-            containsNonStandardScenes = true;
+        if (element->scene() && element->scene()->type() != Scene::Standard)
+            ++state.nonStandardSceneCount;
+
+        bool converged = false;
+        if (index < m_sceneNumberingStates.size()) {
+            SceneNumberingState &oldState = m_sceneNumberingStates[index];
+            if (!oldState.scene.isNull() && !indexListMap.contains(oldState.scene))
+                indexListMap.insert(oldState.scene, QList<int>());
+
+            // Past the last changed element, numbers of all elements that follow are going
+            // to be the same as before, if the state is.
+            converged = index >= to && oldState == state && oldState.scene == state.scene;
+            oldState = state;
+        } else
+            m_sceneNumberingStates.append(state);
+
+        ++index;
+
+        if (converged)
+            break;
+    }
+
+    // Scenes of elements that are no longer in the screenplay
+    for (int i = nrElements; i < m_sceneNumberingStates.size(); i++) {
+        const QPointer<Scene> &scene = m_sceneNumberingStates.at(i).scene;
+        if (!scene.isNull() && !indexListMap.contains(scene))
+            indexListMap.insert(scene, QList<int>());
     }
+    m_sceneNumberingStates.resize(nrElements);
 
+    // Indexes outside the evaluated range remain as they were. Act and episode of a scene
+    // are those of its last element, as if all elements had been evaluated in order.
     QHash<Scene *, QList<int>>::const_iterator it = indexListMap.constBegin();
     QHash<Scene *, QList<int>>::const_iterator end = indexListMap.constEnd();
     while (it != end) {
-        it.key()->setScreenplayElementIndexList(it.value());
+        Scene *scene = it.key();
+        const QList<int> oldIndexList = scene->screenplayElementIndexList();
+
+        QList<int> indexList;
+        for (int i : oldIndexList)
+            if (i < from)
+                indexList.append(i);
+        indexList += it.value();
+        for (int i : oldIndexList)
+            if (i >= index && i < nrElements)
+                indexList.append(i);
+
+        if (indexList.isEmpty()) {
+            scene->setAct(QString());
+            scene->setActIndex(-1);
+            scene->setEpisode(QString());
+            scene->setEpisodeIndex(-1);
+        } else {
+            const SceneNumberingState &sceneState = m_sceneNumberingStates.at(indexList.last());
+            scene->setAct(sceneState.hasActBreak ? sceneState.actName
+                                  : sceneState.actIndex < 0 ? QStringLiteral("No Act")
+                                                            : QStringLiteral("ACT 1"));
+            scene->setActIndex(sceneState.actIndex);
+            scene->setEpisode(sceneState.hasEpisodeBreak ? sceneState.episodeName
+                                      : sceneState.episodeIndex < 0
+                                      ? QStringLiteral("No Episode")
+                                      : QStringLiteral("EPISODE 1"));
+            scene->setEpisodeIndex(sceneState.episodeIndex);
+        }
+
+        scene->setScreenplayElementIndexList(indexList);
         ++it;
     }
 
-    this->setSceneCount(nrScenes);
-    this->setEpisodeCount(lastEpisodeElement ? episodeIndex + 1 : 0);
-    this->setActCount(lastEpisodeElement ? totalActIndex + 1 : (lastActElement ? actIndex + 1 : 0));
+    const SceneNumberingState lastState =
+            nrElements > 0 ? m_sceneNumberingStates.last() : SceneNumberingState();
+    this->setSceneCount(lastState.sceneCount);
+    this->setEpisodeCount(lastState.hasEpisodeBreak ? lastState.episodeIndex + 1 : 0);
+    this->setActCount(lastState.hasEpisodeBreak
+                              ? lastState.totalActIndex + 1
+                              : (lastState.hasActBreak ? lastState.actIndex + 1 : 0));
 
-    this->setHasNonStandardScenes(containsNonStandardScenes);
+    this->setHasNonStandardScenes(lastState.nonStandardSceneCount > 0);
 }
 
 void Screenplay::evaluateSceneNumbersLater()
 {
-    m_sceneNumberEvaluationTimer.start(0, this);
+    DeferredWorkScheduler::instance()->schedule(this, "Screenplay.evaluateSceneNumbers",
+                                                DeferredWorkScheduler::NormalPriority, 0,
+                                                [=]() { this->evaluateSceneNumbers(); });
+}
+
+void Screenplay::markSceneNumbersDirty(int from, int to)
+{
+    from = qMax(from, 0);
+
+    if (m_sceneNumbersDirtyFrom < 0) {
+        m_sceneNumbersDirtyFrom = from;
+        m_sceneNumbersDirtyTo = to;
+        return;
+    }
+
+    m_sceneNumbersDirtyFrom = qMin(m_sceneNumbersDirtyFrom, from);
+    m_sceneNumbersDirtyTo = (to < 0 || m_sceneNumbersDirtyTo < 0)
+            ? -1
+            : qMax(m_sceneNumbersDirtyTo, to);
+}
+
+void Screenplay::markSceneNumbersDirty(const QList<ScreenplayElement *> &oldElements)
+{
+    // Elements were reordered, only those between the first and last element whose
+    // position changed need to be evaluated.
+    if (oldElements.size() != m_elements.size()) {
+        this->markSceneNumbersDirty(0);
+        return;
+    }
+
+    int first = 0;
+    while (first < m_elements.size() && oldElements.at(first) == m_elements.at(first))
+        ++first;
+
+    int last = m_elements.size() - 1;
+    while (last > first && oldElements.at(last) == m_elements.at(last))
+        --last;
+
+    if (first <= last)
+        this->markSceneNumbersDirty(first, last + 1);
+}
+
+void Screenplay::onElementSceneNumberingChanged()
+{
+    ScreenplayElement *element = qobject_cast<ScreenplayElement *>(this->sender());
+    const int index = m_elements.indexOf(element);
+    if (index < 0)
+        return;
+
+    this->markSceneNumbersDirty(index, index + 1);
+    this->evaluateSceneNumbersLater();
 }
 
 void Screenplay::validateCurrentElementIndex()
@@ -3257,30 +3709,32 @@ void Screenplay::validateCurrentElementIndex()
 
 void Screenplay::evaluateParagraphCounts()
 {
-    int min = -1, max = -1, avg = 0, total = 0, count = 0;
-    for (ScreenplayElement *element : qAsConst(m_elements)) {
+    const QSet<ScreenplayElement *> elements = m_paragraphCountDirtyElements;
+    m_paragraphCountDirtyElements.clear();
+
+    for (ScreenplayElement *element : elements) {
+        this->removeParagraphCount(element);
+
         Scene *scene = element->scene();
         if (scene == nullptr)
             continue;
 
-        if (min < 0)
-            min = scene->elementCount();
-        else
-            min = qMin(min, scene->elementCount());
-
-        if (max < 0)
-            max = scene->elementCount();
-        else
-            max = qMax(max, scene->elementCount());
+        const int count = scene->elementCount();
+        m_paragraphCounts.insert(element, count);
+        ++m_paragraphCountHistogram[count];
+        m_totalParagraphCount += count;
+    }
 
-        total += scene->elementCount();
-        ++count;
+    int min = -1, max = -1, avg = 0;
+    if (!m_paragraphCounts.isEmpty()) {
+        min = m_paragraphCountHistogram.firstKey();
+        max = m_paragraphCountHistogram.lastKey();
+        avg = qRound(qreal(m_totalParagraphCount) / qreal(m_paragraphCounts.size()));
     }
 
-    if (count > 0)
-        avg = qRound(qreal(total) / qreal(count));
-    else
-        avg = 0;
+    if (m_minimumParagraphCount == min && m_maximumParagraphCount == max
+        && m_averageParagraphCount == avg)
+        return;
 
     m_minimumParagraphCount = min;
     m_maximumParagraphCount = max;
@@ -3290,7 +3744,34 @@ void Screenplay::evaluateParagraphCounts()
 
 void Screenplay::evaluateParagraphCountsLater()
 {
-    m_paragraphCountEvaluationTimer.start(0, this);
+    DeferredWorkScheduler::instance()->schedule(this, "Screenplay.evaluateParagraphCounts",
+                                                DeferredWorkScheduler::NormalPriority, 0,
+                                                [=]() { this->evaluateParagraphCounts(); });
+}
+
+void Screenplay::onElementParagraphCountChanged()
+{
+    ScreenplayElement *element = qobject_cast<ScreenplayElement *>(this->sender());
+    if (element == nullptr)
+        return;
+
+    m_paragraphCountDirtyElements += element;
+    this->evaluateParagraphCountsLater();
+}
+
+void Screenplay::removeParagraphCount(ScreenplayElement *element)
+{
+    auto it = m_paragraphCounts.find(element);
+    if (it == m_paragraphCounts.end())
+        return;
+
+    const int count = it.value();
+    m_paragraphCounts.erase(it);
+    m_totalParagraphCount -= count;
+
+    auto hit = m_paragraphCountHistogram.find(count);
+    if (hit != m_paragraphCountHistogram.end() && --hit.value() <= 0)
+        m_paragraphCountHistogram.erase(hit);
 }
 
 void Screenplay::setHasNonStandardScenes(bool val)
@@ -3546,3 +4027,5 @@ void ScreenplayTracks::refreshLater()
 {
     m_refreshTimer.start(0, this);
 }
+
+#include "screenplay.moc"
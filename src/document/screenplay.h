@@ -16,9 +16,11 @@
 
 #include "scene.h"
 #include "modifiable.h"
+#include "searchengine.h"
 #include "execlatertimer.h"
 #include "qobjectproperty.h"
 
+#include <QSet>
 #include <QJsonArray>
 #include <QJsonValue>
 #include <QQmlListProperty>
@@ -27,6 +29,7 @@ class Screenplay;
 class ScriteDocument;
 class AbstractImporter;
 class ScreenplayTextDocument;
+class ScreenplayPasteUndoCommand;
 class AbstractScreenplaySubsetReport;
 
 class ScreenplayElement : public QObject, public Modifiable, public QObjectSerializer::Interface
@@ -166,6 +169,7 @@ public:
     Q_SIGNAL void sceneReset(int elementIndex);
     Q_SIGNAL void evaluateSceneNumberRequest();
     Q_SIGNAL void sceneTypeChanged();
+    Q_SIGNAL void sceneElementCountChanged();
     Q_SIGNAL void sceneGroupsChanged(ScreenplayElement *ptr);
 
     // QObjectSerializer::Interface interface
@@ -201,6 +205,11 @@ protected:
             ret = QString::number(qMax(major, 1)) + ret;
             return ret;
         }
+
+        bool operator==(const SceneNumber &other) const
+        {
+            return major == other.major && minor == other.minor;
+        }
     };
     bool event(QEvent *event);
     void evaluateSceneNumber(SceneNumber &number, bool minorAlso = false);
@@ -235,6 +244,7 @@ private:
     QString m_breakTitle;
     QJsonValue m_userData;
     qreal m_heightHint = 0;
+    bool m_heightHintStale = false; // measured with a different format
     QString m_breakSummary;
     QString m_breakSubtitle;
     int m_customSceneNumber = -1;
@@ -480,6 +490,11 @@ public:
     Q_SIGNAL void sceneReset(int sceneIndex, int sceneElementIndex);
 
     Q_INVOKABLE QJsonArray search(const QString &text, int flags = 0) const;
+
+    // Reports matches to the agent instead of returning them, with the scene index as
+    // block and offset within the paragraph as start. Returns the number of matches.
+    Q_INVOKABLE int reportSearchResults(const QString &text, SearchAgent *agent,
+                                        int flags = 0) const;
     Q_INVOKABLE int replace(const QString &text, const QString &replacementText, int flags = 0);
 
     Q_PROPERTY(int minimumParagraphCount READ minimumParagraphCount NOTIFY paragraphCountChanged)
@@ -509,6 +524,10 @@ public:
     Q_INVOKABLE void copySelection();
     Q_INVOKABLE void pasteAfter(int index);
 
+    // Discards a paste whose scenes are still being prepared. This must be called
+    // before the structure into which they are being pasted is deleted.
+    void cancelPendingPaste();
+
     // QObjectSerializer::Interface interface
     void serializeToJson(QJsonObject &) const;
     void deserializeFromJson(const QJsonObject &);
@@ -549,9 +568,14 @@ protected:
     void onScreenplayElementOmittedChanged();
     void evaluateSceneNumbers(bool minorAlso = false);
     void evaluateSceneNumbersLater();
+    void markSceneNumbersDirty(int from, int to = -1);
+    void markSceneNumbersDirty(const QList<ScreenplayElement *> &oldElements);
+    void onElementSceneNumberingChanged();
     void validateCurrentElementIndex();
     void evaluateParagraphCounts();
     void evaluateParagraphCountsLater();
+    void onElementParagraphCountChanged();
+    void removeParagraphCount(ScreenplayElement *element);
     void setHasNonStandardScenes(bool val);
     void setHasTitlePageAttributes(bool val);
     void evaluateHasTitlePageAttributes();
@@ -565,10 +589,16 @@ protected:
     void setWordCount(int val);
     void evaluateWordCount();
     void evaluateWordCountLater();
+    bool hasPasteDataInClipboard() const;
     bool getPasteDataFromClipboard(QJsonObject &clipboardJson) const;
+    void continuePendingPaste();
+    void completePendingPaste();
     void setHeightHintsAvailable(bool val);
     void evaluateIfHeightHintsAreAvailable();
     void evaluateIfHeightHintsAreAvailableLater();
+    QString evaluateHeightHintsKey() const;
+    void validateHeightHints();
+    void validateHeightHintsIfNotLoading();
 
 private:
     QString m_title;
@@ -590,6 +620,7 @@ private:
     int m_averageParagraphCount = 0;
     bool m_hasTitlePageAttributes = false;
     bool m_heightHintsAvailable = false;
+    QString m_heightHintsKey;
     ScriteDocument *m_scriteDocument = nullptr;
     CoverPagePhotoSize m_coverPagePhotoSize = LargeCoverPhoto;
     friend class ScreenplayTextDocument;
@@ -610,11 +641,48 @@ private:
     int m_actCount = 0;
     int m_sceneCount = 0;
     int m_wordCount = 0;
+    ScreenplayPasteUndoCommand *m_pendingPaste = nullptr;
+
+    // State of evaluateSceneNumbers() after each element. Evaluation resumes from the
+    // state before the first changed element, and stops once past the last changed
+    // element, if the state is the same as the one evaluated before.
+    struct SceneNumberingState
+    {
+        int actIndex = -1;
+        int totalActIndex = -1;
+        int episodeIndex = -1;
+        int elementIndex = -1;
+        int sceneCount = 0;
+        int nonStandardSceneCount = 0;
+        bool hasActBreak = false;
+        bool hasEpisodeBreak = false;
+        QString actName;
+        QString episodeName;
+        ScreenplayElement::SceneNumber sceneNumber;
+        QPointer<Scene> scene; // of the element, not part of the state
+
+        bool operator==(const SceneNumberingState &other) const
+        {
+            return actIndex == other.actIndex && totalActIndex == other.totalActIndex
+                    && episodeIndex == other.episodeIndex && elementIndex == other.elementIndex
+                    && sceneCount == other.sceneCount
+                    && nonStandardSceneCount == other.nonStandardSceneCount
+                    && hasActBreak == other.hasActBreak && hasEpisodeBreak == other.hasEpisodeBreak
+                    && actName == other.actName && episodeName == other.episodeName
+                    && sceneNumber == other.sceneNumber;
+        }
+    };
+    QVector<SceneNumberingState> m_sceneNumberingStates;
+    int m_sceneNumbersDirtyFrom = 0; // -1 if nothing changed
+    int m_sceneNumbersDirtyTo = -1; // exclusive, -1 means till the last element
+
+    // Paragraph counts of scenes as last evaluated, and number of scenes with each count
+    QHash<ScreenplayElement *, int> m_paragraphCounts;
+    QMap<int, int> m_paragraphCountHistogram;
+    qint64 m_totalParagraphCount = 0;
+    QSet<ScreenplayElement *> m_paragraphCountDirtyElements;
 
-    ExecLaterTimer m_wordCountTimer;
     ExecLaterTimer m_updateBreakTitlesTimer;
-    ExecLaterTimer m_sceneNumberEvaluationTimer;
-    ExecLaterTimer m_paragraphCountEvaluationTimer;
     ExecLaterTimer m_evalHeightHintsAvailableTimer;
     ExecLaterTimer m_selectedElementsOmitStatusChangedTimer;
 };
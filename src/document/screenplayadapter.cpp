@@ -16,6 +16,7 @@
 #include "scritedocument.h"
 #include "garbagecollector.h"
 #include "screenplayadapter.h"
+#include "deferredworkscheduler.h"
 
 ScreenplayAdapter::ScreenplayAdapter(QObject *parent)
     : QIdentityProxyModel(parent),
@@ -29,6 +30,15 @@ ScreenplayAdapter::ScreenplayAdapter(QObject *parent)
     connect(this, &ScreenplayAdapter::rowsInserted, this,
             &ScreenplayAdapter::updateCurrentIndexAndCount);
 
+    // Rows shift about when rows are inserted or removed, so editable rows have to be
+    // reported afresh.
+    const auto onRowsShifted = [=]() {
+        m_editableRowsShifted = true;
+        this->updateEditableRowsLater();
+    };
+    connect(this, &ScreenplayAdapter::rowsRemoved, this, onRowsShifted);
+    connect(this, &ScreenplayAdapter::rowsInserted, this, onRowsShifted);
+
     connect(this, &ScreenplayAdapter::modelAboutToBeReset, this,
             &ScreenplayAdapter::clearCurrentIndex);
     connect(this, &ScreenplayAdapter::rowsAboutToBeRemoved, this,
@@ -41,7 +51,10 @@ ScreenplayAdapter::ScreenplayAdapter(QObject *parent)
             &ScreenplayAdapter::heightHintsAvailableChanged);
 }
 
-ScreenplayAdapter::~ScreenplayAdapter() { }
+ScreenplayAdapter::~ScreenplayAdapter()
+{
+    DeferredWorkScheduler::instance()->cancel(this, "ScreenplayAdapter.updateEditableRows");
+}
 
 void ScreenplayAdapter::setSource(QObject *val)
 {
@@ -202,6 +215,34 @@ void ScreenplayAdapter::setInitialLoadTreshold(int val)
     emit initialLoadTresholdChanged();
 }
 
+void ScreenplayAdapter::setVirtualized(bool val)
+{
+    if (m_virtualized == val)
+        return;
+
+    m_virtualized = val;
+    emit virtualizedChanged();
+
+    this->updateEditableRowsLater();
+}
+
+void ScreenplayAdapter::setEditorPoolSize(int val)
+{
+    val = qMax(val, 0);
+    if (m_editorPoolSize == val)
+        return;
+
+    m_editorPoolSize = val;
+    emit editorPoolSizeChanged();
+
+    this->updateEditableRowsLater();
+}
+
+bool ScreenplayAdapter::isEditable(int row) const
+{
+    return this->isEditable(row, m_editableCenter, m_editablePoolSize);
+}
+
 ScreenplayElement *ScreenplayAdapter::splitElement(ScreenplayElement *ptr, SceneElement *element,
                                                    int textPosition)
 {
@@ -264,6 +305,7 @@ QHash<int, QByteArray> ScreenplayAdapter::roleNames() const
         roles[ModelDataRole] = "modelData";
         roles[ScreenplayElementRole] = "screenplayElement";
         roles[ScreenplayElementTypeRole] = "screenplayElementType";
+        roles[EditableRole] = "editable";
     }
 
     return roles;
@@ -348,6 +390,7 @@ void ScreenplayAdapter::setCurrentIndexInternal(int val)
         return;
 
     m_currentIndex = val;
+    this->updateEditableRowsLater();
 
     if (m_currentIndex >= 0) {
         const QModelIndex index = this->index(m_currentIndex, 0);
@@ -383,13 +426,17 @@ QVariant ScreenplayAdapter::data(ScreenplayElement *element, int row, int role)
         return element->breakType();
     case SceneRole:
         return QVariant::fromValue<Scene *>(element->scene());
+    case EditableRole:
+        return this->isEditable(row);
     case ModelDataRole: {
+        // Editable changes as the current row moves about, it is deliberately left out
+        // so that modelData of rows doesn't change when that happens.
         QVariantMap ret;
         const QHash<int, QByteArray> roles = this->roleNames();
         QHash<int, QByteArray>::const_iterator it = roles.begin();
         QHash<int, QByteArray>::const_iterator end = roles.end();
         while (it != end) {
-            if (it.key() != ModelDataRole)
+            if (it.key() != ModelDataRole && it.key() != EditableRole)
                 ret[QString::fromLatin1(it.value())] = this->data(element, row, it.key());
             ++it;
         }
@@ -432,6 +479,57 @@ void ScreenplayAdapter::updateCurrentIndexAndCount()
     emit elementCountChanged();
 }
 
+void ScreenplayAdapter::updateEditableRowsLater()
+{
+    // Current index changes while rows are being inserted or removed, and several times
+    // in a row while the user navigates with the keyboard. Editable rows are reported
+    // only after things have settled.
+    DeferredWorkScheduler::instance()->schedule(this, "ScreenplayAdapter.updateEditableRows",
+                                                DeferredWorkScheduler::NormalPriority, 50,
+                                                [=]() { this->updateEditableRows(); });
+}
+
+void ScreenplayAdapter::updateEditableRows()
+{
+    const int oldCenter = m_editableCenter;
+    const int oldPoolSize = m_editablePoolSize;
+    const int newCenter = qMax(m_currentIndex, 0);
+    const int newPoolSize = m_virtualized ? m_editorPoolSize : -1;
+    const bool rowsShifted = m_editableRowsShifted && newPoolSize >= 0;
+    m_editableRowsShifted = false;
+    if (oldCenter == newCenter && oldPoolSize == newPoolSize && !rowsShifted)
+        return;
+
+    m_editableCenter = newCenter;
+    m_editablePoolSize = newPoolSize;
+
+    const int nrRows = this->rowCount();
+    if (nrRows <= 0)
+        return;
+
+    if (oldPoolSize < 0 || newPoolSize < 0 || rowsShifted) {
+        emit dataChanged(this->index(0, 0), this->index(nrRows - 1, 0), { EditableRole });
+        return;
+    }
+
+    // Only rows that entered or left the window need to be reported.
+    const int from = qMax(qMin(oldCenter - oldPoolSize, newCenter - newPoolSize), 0);
+    const int to = qMin(qMax(oldCenter + oldPoolSize, newCenter + newPoolSize), nrRows - 1);
+    for (int row = from; row <= to; row++) {
+        if (this->isEditable(row, oldCenter, oldPoolSize)
+            == this->isEditable(row, newCenter, newPoolSize))
+            continue;
+
+        const QModelIndex index = this->index(row, 0);
+        emit dataChanged(index, index, { EditableRole });
+    }
+}
+
+bool ScreenplayAdapter::isEditable(int row, int center, int poolSize) const
+{
+    return poolSize < 0 || qAbs(row - center) <= poolSize;
+}
+
 void ScreenplayAdapter::resetSource()
 {
     this->setSourceModel(nullptr);
@@ -86,6 +86,22 @@ public:
     int initialLoadTreshold() const { return m_initialLoadTreshold; }
     Q_SIGNAL void initialLoadTresholdChanged();
 
+    // When virtualized, only rows within editorPoolSize of the current row are reported
+    // as editable. Delegates of other rows are expected to show a static preview, sized
+    // using the height hint of their screenplay element.
+    Q_PROPERTY(bool virtualized READ isVirtualized WRITE setVirtualized NOTIFY virtualizedChanged)
+    void setVirtualized(bool val);
+    bool isVirtualized() const { return m_virtualized; }
+    Q_SIGNAL void virtualizedChanged();
+
+    Q_PROPERTY(int editorPoolSize READ editorPoolSize WRITE setEditorPoolSize NOTIFY
+                       editorPoolSizeChanged)
+    void setEditorPoolSize(int val);
+    int editorPoolSize() const { return m_editorPoolSize; }
+    Q_SIGNAL void editorPoolSizeChanged();
+
+    Q_INVOKABLE bool isEditable(int row) const;
+
     Q_INVOKABLE ScreenplayElement *splitElement(ScreenplayElement *ptr, SceneElement *element,
                                                 int textPosition);
     Q_INVOKABLE ScreenplayElement *mergeElementWithPrevious(ScreenplayElement *ptr);
@@ -100,7 +116,8 @@ public:
         ScreenplayElementTypeRole,
         BreakTypeRole,
         SceneRole,
-        ModelDataRole
+        ModelDataRole,
+        EditableRole
     };
     Q_ENUM(Roles)
     QHash<int, QByteArray> roleNames() const;
@@ -118,11 +135,19 @@ private:
     void clearCurrentIndex();
     void continueFetchingMore();
     void updateCurrentIndexAndCount();
+    void updateEditableRowsLater();
+    void updateEditableRows();
+    bool isEditable(int row, int center, int poolSize) const;
 
 private:
     int m_adapterRowCount = MAX_ELEMENT_COUNT;
     int m_currentIndex = -1;
     int m_initialLoadTreshold = -1;
+    bool m_virtualized = false;
+    int m_editorPoolSize = 2;
+    int m_editableCenter = 0; // row around which editable rows were last reported
+    int m_editablePoolSize = -1; // pool size with which they were reported, -1 if not virtualized
+    bool m_editableRowsShifted = false;
     QPointer<QTimer> m_fetchMoreTimer;
     QObjectProperty<QObject> m_source;
     QObjectProperty<ScreenplayElement> m_currentElement;
@@ -46,6 +46,7 @@
 #include "printerobject.h"
 #include "scritedocument.h"
 #include "timeprofiler.h"
+#include "deferredworkscheduler.h"
 
 inline QTime secondsToTime(int seconds)
 {
@@ -238,7 +239,6 @@ ScreenplayTextDocument::~ScreenplayTextDocument()
 {
     m_sceneResetTimer.stop();
     m_loadScreenplayTimer.stop();
-    m_pageBoundaryEvalTimer.stop();
 
     if (m_textDocument != nullptr && m_textDocument->parent() == this)
         m_textDocument->setUndoRedoEnabled(true);
@@ -1048,9 +1048,6 @@ void ScreenplayTextDocument::timerEvent(QTimerEvent *event)
         this->syncNow();
         this->connectToScreenplaySignals();
         this->connectToScreenplayFormatSignals();
-    } else if (event->timerId() == m_pageBoundaryEvalTimer.timerId()) {
-        m_pageBoundaryEvalTimer.stop();
-        this->evaluatePageBoundaries();
     } else if (event->timerId() == m_sceneResetTimer.timerId()) {
         m_sceneResetTimer.stop();
         this->processSceneResetList();
@@ -1134,6 +1131,8 @@ void ScreenplayTextDocument::setCurrentPageAndPosition(int page, qreal pos)
 
 void ScreenplayTextDocument::loadScreenplay()
 {
+    PROFILE_THIS_FUNCTION;
+
 #ifdef DISPLAY_DOCUMENT_IN_TEXTEDIT
     static QTextEdit *textEdit = nullptr;
     if (m_purpose == ForDisplay) {
@@ -1166,7 +1165,8 @@ void ScreenplayTextDocument::loadScreenplay()
     m_textDocument->clear();
     m_textDocument->setProperty("#characterImageResourceUrls", QVariant());
     m_sceneResetTimer.stop();
-    m_pageBoundaryEvalTimer.stop();
+    DeferredWorkScheduler::instance()->cancel(this,
+                                              "ScreenplayTextDocument.evaluatePageBoundaries");
 
     if (m_screenplay == nullptr)
         return;
@@ -2204,8 +2204,10 @@ void ScreenplayTextDocument::evaluateCurrentPageAndPosition()
 
 void ScreenplayTextDocument::evaluatePageBoundaries(bool revalCurrentPageAndPosition)
 {
+    PROFILE_THIS_FUNCTION;
+
     // NOTE: Please do not call this function from anywhere other than
-    // timerEvent(), while handling m_pageBoundaryEvalTimer
+    // the deferred work scheduled by evaluatePageBoundariesLater()
     QList<QPair<int, int>> pgBoundaries;
 
     if (m_formatting != nullptr && m_textDocument != nullptr && m_screenplay != nullptr) {
@@ -2272,7 +2274,10 @@ void ScreenplayTextDocument::evaluatePageBoundaries(bool revalCurrentPageAndPosi
 
 void ScreenplayTextDocument::evaluatePageBoundariesLater()
 {
-    m_pageBoundaryEvalTimer.start(500, this);
+    DeferredWorkScheduler::instance()->schedule(this,
+                                                "ScreenplayTextDocument.evaluatePageBoundaries",
+                                                DeferredWorkScheduler::IdlePriority, 500,
+                                                [=]() { this->evaluatePageBoundaries(); });
 }
 
 void ScreenplayTextDocument::formatAllBlocks()
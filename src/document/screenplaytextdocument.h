@@ -380,7 +380,6 @@ private:
     bool m_includeActBreaks = false;
     ExecLaterTimer m_loadScreenplayTimer;
     QStringList m_highlightDialoguesOf;
-    ExecLaterTimer m_pageBoundaryEvalTimer;
     QTextFrameFormat m_sceneFrameFormat;
     QObjectProperty<QObject> m_injection;
     bool m_connectedToScreenplaySignals = false;
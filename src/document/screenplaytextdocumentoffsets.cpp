@@ -156,6 +156,8 @@ ScreenplayTextDocumentOffsets::ScreenplayTextDocumentOffsets(QObject *parent)
     m_reloadTimer->setInterval(0);
     m_reloadTimer->setSingleShot(true);
     connect(m_reloadTimer, &QTimer::timeout, this, &ScreenplayTextDocumentOffsets::reloadDocument);
+    connect(this, &ScreenplayTextDocumentOffsets::arrayChanged, this,
+            [=]() { m_offsetIndexStale = true; });
 
     m_document = new QTextDocument(this);
 }
@@ -256,19 +258,7 @@ QJsonObject ScreenplayTextDocumentOffsets::offsetInfoAtPoint(const QPointF &pos)
     if (offsets.isEmpty() || pos.x() < 0 || pos.x() >= m_document->textWidth())
         return ret.json();
 
-    if (offsets.size() > 1) {
-        for (int i = 0; i < offsets.size(); i++) {
-            const OffsetItem item(offsets[i].toObject());
-            if (item.pixelOffset() >= pos.y()) {
-                if (qFuzzyCompare(item.pixelOffset(), pos.y()))
-                    return offsets[i].toObject();
-
-                return offsets[qMax(i - 1, 0)].toObject();
-            }
-        }
-    }
-
-    return offsets.last().toObject();
+    return offsets[this->rowAtPoint(pos.y())].toObject();
 }
 
 QJsonObject ScreenplayTextDocumentOffsets::offsetInfoAtTime(int timeInMs, int rowHint) const
@@ -279,21 +269,7 @@ QJsonObject ScreenplayTextDocumentOffsets::offsetInfoAtTime(int timeInMs, int ro
     if (offsets.isEmpty() || timeInMs < 0)
         return ret.json();
 
-    if (offsets.size() > 1) {
-        const int startRow = qBound(0, rowHint, offsets.size() - 1);
-        for (int i = startRow; i < offsets.size(); i++) {
-            const OffsetItem item(offsets[i].toObject());
-
-            if (item.timestamp() >= timeInMs) {
-                if (item.timestamp() == timeInMs)
-                    return offsets[i].toObject();
-
-                return offsets[qMax(i - 1, 0)].toObject();
-            }
-        }
-    }
-
-    return offsets.last().toObject();
+    return offsets[this->rowAtTime(timeInMs, rowHint)].toObject();
 }
 
 const qreal lastScenePixelLength = 20.0;
@@ -301,7 +277,7 @@ const int lastSceneTimeLength = 500;
 
 int ScreenplayTextDocumentOffsets::evaluateTimeAtPoint(const QPointF &pos, int rowHint) const
 {
-    const QJsonArray &offsets = this->internalArray();
+    const QVector<OffsetIndexItem> &offsets = this->offsetIndex();
 
     if (offsets.isEmpty() || pos.y() < 0)
         return 0;
@@ -309,32 +285,29 @@ int ScreenplayTextDocumentOffsets::evaluateTimeAtPoint(const QPointF &pos, int r
     if (qFuzzyIsNull(pos.y()))
         return 0;
 
-    const OffsetItem lastOffset(offsets.last());
-    if (pos.y() >= lastOffset.pixelOffset() + lastScenePixelLength)
-        return lastOffset.timestamp() + lastSceneTimeLength;
+    const OffsetIndexItem &lastOffset = offsets.last();
+    if (pos.y() >= lastOffset.pixelOffset + lastScenePixelLength)
+        return lastOffset.timestamp + lastSceneTimeLength;
 
     if (rowHint < 0) {
-        const OffsetItem item(this->offsetInfoAtPoint(pos));
-        rowHint = item.row();
+        const bool validX = pos.x() >= 0 && pos.x() < m_document->textWidth();
+        rowHint = validX ? this->rowAtPoint(pos.y()) : 0;
     }
 
-    auto computeTime = [](const qreal p1, const qreal p, const qreal p2, const QTime &t1,
-                          const QTime &t2) {
-        return t1.msecsSinceStartOfDay()
-                + qAbs(((p - p1) / (p2 - p1))
-                       * qreal(t2.msecsSinceStartOfDay() - t1.msecsSinceStartOfDay()));
+    auto computeTime = [](const qreal p1, const qreal p, const qreal p2, int t1, int t2) {
+        return t1 + qAbs(((p - p1) / (p2 - p1)) * qreal(t2 - t1));
     };
 
     if (rowHint >= 0 && rowHint < offsets.size()) {
-        const OffsetItem i1(offsets[rowHint]);
-        const OffsetItem i2(offsets[qMin(rowHint + 1, offsets.size() - 1)]);
+        const OffsetIndexItem &i1 = offsets.at(rowHint);
+        const OffsetIndexItem &i2 = offsets.at(qMin(rowHint + 1, offsets.size() - 1));
 
-        const qreal cpo = i1.pixelOffset();
+        const qreal cpo = i1.pixelOffset;
         const qreal npo =
-                i2.pixelOffset() + (rowHint < offsets.size() - 1 ? 0 : lastScenePixelLength);
-        const QTime t1 = i1.time();
-        const QTime t2 =
-                rowHint < offsets.size() - 1 ? i2.time() : i2.time().addMSecs(lastSceneTimeLength);
+                i2.pixelOffset + (rowHint < offsets.size() - 1 ? 0 : lastScenePixelLength);
+        const int t1 = i1.timestamp;
+        const int t2 = rowHint < offsets.size() - 1 ? i2.timestamp
+                                                    : i2.timestamp + lastSceneTimeLength;
         if (cpo <= pos.y() && pos.y() <= npo)
             return computeTime(cpo, pos.y(), npo, t1, t2);
     }
@@ -344,33 +317,31 @@ int ScreenplayTextDocumentOffsets::evaluateTimeAtPoint(const QPointF &pos, int r
 
 QPointF ScreenplayTextDocumentOffsets::evaluatePointAtTime(int timeInMs, int rowHint) const
 {
-    const QJsonArray &offsets = this->internalArray();
+    const QVector<OffsetIndexItem> &offsets = this->offsetIndex();
     if (offsets.isEmpty() || timeInMs <= 0)
         return QPointF(10, 0);
 
-    const OffsetItem lastOffset(offsets.last());
-    if (timeInMs >= lastOffset.timestamp() + lastSceneTimeLength)
-        return QPointF(10, lastOffset.pixelOffset() + lastScenePixelLength);
+    const OffsetIndexItem &lastOffset = offsets.last();
+    if (timeInMs >= lastOffset.timestamp + lastSceneTimeLength)
+        return QPointF(10, lastOffset.pixelOffset + lastScenePixelLength);
 
-    if (rowHint < 0) {
-        const OffsetItem item(this->offsetInfoAtTime(timeInMs));
-        rowHint = item.row();
-    }
+    if (rowHint < 0)
+        rowHint = this->rowAtTime(timeInMs, -1);
 
     auto computePoint = [](int t1, int t, int t2, qreal p1, qreal p2) {
         return QPointF(10, p1 + ((qreal(t - t1) / qreal(t2 - t1)) * (p2 - p1)));
     };
 
     if (rowHint >= 0 && rowHint < offsets.size()) {
-        const OffsetItem i1(offsets[rowHint]);
-        const OffsetItem i2(offsets[qMin(rowHint + 1, offsets.size() - 1)]);
+        const OffsetIndexItem &i1 = offsets.at(rowHint);
+        const OffsetIndexItem &i2 = offsets.at(qMin(rowHint + 1, offsets.size() - 1));
 
-        const int ct = i1.timestamp();
-        const int nt = rowHint < offsets.size() - 1 ? i2.timestamp()
-                                                    : i2.timestamp() + lastSceneTimeLength;
-        const qreal p1 = i1.pixelOffset();
+        const int ct = i1.timestamp;
+        const int nt = rowHint < offsets.size() - 1 ? i2.timestamp
+                                                    : i2.timestamp + lastSceneTimeLength;
+        const qreal p1 = i1.pixelOffset;
         const qreal p2 =
-                i2.pixelOffset() + (rowHint < offsets.size() - 1 ? 0 : lastScenePixelLength);
+                i2.pixelOffset + (rowHint < offsets.size() - 1 ? 0 : lastScenePixelLength);
         if (ct <= timeInMs && timeInMs <= nt)
             return computePoint(ct, timeInMs, nt, p1, p2);
     }
@@ -617,6 +588,92 @@ int ScreenplayTextDocumentOffsets::previousSceneHeadingIndex(int row) const
     return 0;
 }
 
+const QVector<ScreenplayTextDocumentOffsets::OffsetIndexItem> &
+ScreenplayTextDocumentOffsets::offsetIndex() const
+{
+    if (!m_offsetIndexStale)
+        return m_offsetIndex;
+
+    const QJsonArray &offsets = this->internalArray();
+
+    m_offsetIndex.resize(offsets.size());
+    m_pixelOffsetsSorted = true;
+    m_timestampsSorted = true;
+    for (int i = 0; i < offsets.size(); i++) {
+        const OffsetItem item(offsets[i]);
+        OffsetIndexItem &indexItem = m_offsetIndex[i];
+        indexItem.pixelOffset = item.pixelOffset();
+        indexItem.timestamp = item.timestamp();
+
+        if (i > 0) {
+            const OffsetIndexItem &prevIndexItem = m_offsetIndex.at(i - 1);
+            m_pixelOffsetsSorted &= prevIndexItem.pixelOffset <= indexItem.pixelOffset;
+            m_timestampsSorted &= prevIndexItem.timestamp <= indexItem.timestamp;
+        }
+    }
+
+    m_offsetIndexStale = false;
+    return m_offsetIndex;
+}
+
+int ScreenplayTextDocumentOffsets::rowAtPoint(qreal y) const
+{
+    // Returns the row whose pixel offset is y, or the one before the first row whose
+    // pixel offset is beyond y.
+    const QVector<OffsetIndexItem> &offsets = this->offsetIndex();
+    if (offsets.isEmpty())
+        return -1;
+
+    if (offsets.size() == 1)
+        return 0;
+
+    auto it = offsets.constEnd();
+    if (m_pixelOffsetsSorted)
+        it = std::lower_bound(offsets.constBegin(), offsets.constEnd(), y,
+                              [](const OffsetIndexItem &item, qreal val) {
+                                  return item.pixelOffset < val;
+                              });
+    else
+        it = std::find_if(offsets.constBegin(), offsets.constEnd(),
+                          [y](const OffsetIndexItem &item) { return item.pixelOffset >= y; });
+
+    if (it == offsets.constEnd())
+        return offsets.size() - 1;
+
+    const int row = int(std::distance(offsets.constBegin(), it));
+    return qFuzzyCompare(it->pixelOffset, y) ? row : qMax(row - 1, 0);
+}
+
+int ScreenplayTextDocumentOffsets::rowAtTime(int timeInMs, int rowHint) const
+{
+    // Returns the row at timeInMs, or the one before the first row after timeInMs,
+    // looking only at rows from rowHint onwards.
+    const QVector<OffsetIndexItem> &offsets = this->offsetIndex();
+    if (offsets.isEmpty())
+        return -1;
+
+    if (offsets.size() == 1)
+        return 0;
+
+    const auto begin = offsets.constBegin() + qBound(0, rowHint, offsets.size() - 1);
+    auto it = offsets.constEnd();
+    if (m_timestampsSorted)
+        it = std::lower_bound(begin, offsets.constEnd(), timeInMs,
+                              [](const OffsetIndexItem &item, int val) {
+                                  return item.timestamp < val;
+                              });
+    else
+        it = std::find_if(begin, offsets.constEnd(), [timeInMs](const OffsetIndexItem &item) {
+            return item.timestamp >= timeInMs;
+        });
+
+    if (it == offsets.constEnd())
+        return offsets.size() - 1;
+
+    const int row = int(std::distance(offsets.constBegin(), it));
+    return it->timestamp == timeInMs ? row : qMax(row - 1, 0);
+}
+
 void ScreenplayTextDocumentOffsets::setBusy(bool val)
 {
     if (m_busy == val)
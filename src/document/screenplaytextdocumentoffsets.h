@@ -92,6 +92,17 @@ private:
     void loadOffsets();
     void saveOffsets();
 
+    // Pixel offsets and timestamps of all rows, packed for lookups. It is rebuilt
+    // from the array lazily, after the array changes.
+    struct OffsetIndexItem
+    {
+        qreal pixelOffset = 0;
+        int timestamp = 0;
+    };
+    const QVector<OffsetIndexItem> &offsetIndex() const;
+    int rowAtPoint(qreal y) const;
+    int rowAtTime(int timeInMs, int rowHint) const;
+
 private:
     bool m_busy = false;
     QTimer *m_reloadTimer = nullptr;
@@ -101,6 +112,11 @@ private:
 
     QString m_fileName;
     QString m_errorMessage;
+
+    mutable bool m_offsetIndexStale = true;
+    mutable bool m_pixelOffsetsSorted = true;
+    mutable bool m_timestampsSorted = true;
+    mutable QVector<OffsetIndexItem> m_offsetIndex;
 };
 
 #endif // SCREENPLAYTEXTDOCUMENTOFFSETS_H
@@ -19,7 +19,10 @@
 #include "undoredo.h"
 #include "fountain.h"
 #include "callgraph.h"
+#include "timeprofiler.h"
 #include "filelocker.h"
+#include "scritefileinfo.h"
+#include "documentbackupstore.h"
 #include "hourglass.h"
 #include "aggregation.h"
 #include "application.h"
@@ -49,6 +52,7 @@
 #include <QUuid>
 #include <QFuture>
 #include <QPainter>
+#include <QEventLoop>
 #include <QMimeData>
 #include <QDateTime>
 #include <QFileInfo>
@@ -59,6 +63,7 @@
 #include <QElapsedTimer>
 #include <QJsonDocument>
 #include <QFutureWatcher>
+#include <QTemporaryDir>
 #include <QStandardPaths>
 #include <QtConcurrentRun>
 #include <QRandomGenerator>
@@ -119,8 +124,11 @@ QVariant ScriteDocumentBackups::data(const QModelIndex &index, int role) const
         return fi.absoluteFilePath();
     case RelativeTimeRole:
         return relativeTime(fi.birthTime());
-    case FileSizeRole:
-        return fi.size();
+    case FileSizeRole: {
+        // Deduplicated backups report the size of the document they restore to
+        const qint64 fileSize = m_metaDataList.at(index.row()).fileSize;
+        return fileSize >= 0 ? fileSize : fi.size();
+    }
     case MetaDataRole:
         if (!m_metaDataList.at(index.row()).loaded)
             (const_cast<ScriteDocumentBackups *>(this))->loadMetaData(index.row());
@@ -209,21 +217,49 @@ void ScriteDocumentBackups::reloadBackupFileInformation()
      * We push directory query to a separate thread and update the model whenever its job is
      * done.
      */
-    QFutureWatcher<QFileInfoList> *futureWatcher = new QFutureWatcher<QFileInfoList>(this);
+    QFutureWatcher<BackupList> *futureWatcher = new QFutureWatcher<BackupList>(this);
     futureWatcher->setObjectName(futureWatcherName);
-    connect(futureWatcher, &QFutureWatcher<QFileInfoList>::finished, this, [=]() {
+    connect(futureWatcher, &QFutureWatcher<BackupList>::finished, this, [=]() {
         futureWatcher->deleteLater();
 
+        const BackupList backupList = futureWatcher->result();
+
         this->beginResetModel();
-        m_backupFiles = futureWatcher->result();
-        m_metaDataList.resize(m_backupFiles.size());
+        m_backupFiles = backupList.first;
+        m_metaDataList = backupList.second;
         this->endResetModel();
 
         emit countChanged();
     });
-    QFuture<QFileInfoList> future = QtConcurrent::run([=]() -> QFileInfoList {
-        return m_backupFilesDir.entryInfoList({ QStringLiteral("*.scrite") }, QDir::Files,
-                                              QDir::Time);
+    QFuture<BackupList> future = QtConcurrent::run([=]() -> BackupList {
+        BackupList ret;
+        const QStringList nameFilters = {
+            QStringLiteral("*.scrite"), QStringLiteral("*.") + DocumentBackupStore::manifestSuffix
+        };
+        ret.first = m_backupFilesDir.entryInfoList(nameFilters, QDir::Files, QDir::Time);
+
+        // Copies are turned into deduplicated backups in the background. Until a copy is
+        // removed, it is listed only once, by its manifest.
+        for (int i = ret.first.size() - 1; i >= 0; i--) {
+            const QFileInfo &fi = ret.first.at(i);
+            if (fi.suffix() != DocumentBackupStore::manifestSuffix
+                && m_backupFilesDir.exists(fi.completeBaseName() + QStringLiteral(".")
+                                           + DocumentBackupStore::manifestSuffix))
+                ret.first.removeAt(i);
+        }
+
+        ret.second.resize(ret.first.size());
+
+        // Manifests of deduplicated backups are small, and carry everything the list
+        // shows. So they are read right away.
+        for (int i = 0; i < ret.first.size(); i++) {
+            const QFileInfo &fi = ret.first.at(i);
+            if (fi.suffix() == DocumentBackupStore::manifestSuffix)
+                ret.second[i] = MetaData::fromManifest(
+                        DocumentBackupStore::readManifest(fi.absoluteFilePath()));
+        }
+
+        return ret;
     });
     futureWatcher->setFuture(future);
 }
@@ -751,6 +787,10 @@ ScriteDocument::ScriteDocument(QObject *parent)
     if (!mbc.isNull())
         m_maxBackupCount = mbc.toInt();
 
+    const QVariant dbs = settings->value(QStringLiteral("Installation/deduplicatedBackups"));
+    if (!dbs.isNull())
+        m_deduplicatedBackups = dbs.toBool();
+
     connect(this, &ScriteDocument::collaboratorsChanged, this,
             &ScriteDocument::canModifyCollaboratorsChanged);
 
@@ -1143,6 +1183,18 @@ void ScriteDocument::setMaxBackupCount(int val)
     settings->setValue(QStringLiteral("Installation/maxBackupCount"), m_maxBackupCount);
 }
 
+void ScriteDocument::setDeduplicatedBackups(bool val)
+{
+    if (m_deduplicatedBackups == val)
+        return;
+
+    m_deduplicatedBackups = val;
+    emit deduplicatedBackupsChanged();
+
+    QSettings *settings = Application::instance()->settings();
+    settings->setValue(QStringLiteral("Installation/deduplicatedBackups"), m_deduplicatedBackups);
+}
+
 bool ScriteDocument::canImportFromClipboard() const
 {
     const QClipboard *clipboard = qApp->clipboard();
@@ -1188,6 +1240,8 @@ void ScriteDocument::reset()
     }
 
     if (m_screenplay != nullptr) {
+        m_screenplay->cancelPendingPaste();
+
         disconnect(m_screenplay, &Screenplay::currentElementIndexChanged, this,
                    &ScriteDocument::screenplayElementIndexChanged);
         disconnect(m_screenplay, &Screenplay::screenplayChanged, this,
@@ -1358,6 +1412,23 @@ bool ScriteDocument::open(const QString &fileName)
 
 bool ScriteDocument::openAnonymously(const QString &fileName)
 {
+    // Deduplicated backups are restored into a temporary document first
+    const QFileInfo fi(fileName);
+    if (fi.suffix() == DocumentBackupStore::manifestSuffix) {
+        HourGlass hourGlass;
+
+        const QTemporaryDir tmpDir;
+        const QString tmpFileName =
+                tmpDir.filePath(fi.completeBaseName() + QStringLiteral(".scrite"));
+        if (!tmpDir.isValid() || !DocumentBackupStore::restore(fileName, tmpFileName)) {
+            m_errorReport->setErrorMessage(
+                    QStringLiteral("Couldn't restore backup \"%1\".").arg(fi.completeBaseName()));
+            return false;
+        }
+
+        return this->openAnonymously(tmpFileName);
+    }
+
     HourGlass hourGlass;
 
     this->setBusyMessage("Loading ...");
@@ -1416,6 +1487,7 @@ void ScriteDocument::saveAs(const QString &givenFileName)
     const QJsonObject json = QObjectSerializer::toJson(this);
     const QByteArray bytes = QJsonDocument(json).toJson();
     m_docFileSystem.setHeader(bytes);
+    m_docFileSystem.setMetadata(ScriteFileInfo::createMetadata(json, &m_docFileSystem));
 
 #ifndef QT_NO_DEBUG_OUTPUT
     const bool saveJson = true;
@@ -1504,27 +1576,44 @@ void ScriteDocument::save()
 
         const QDir backupDir(backupDirPath);
         QFileInfoList backupEntries = backupDir.entryInfoList(
-                QStringList() << QStringLiteral("*.scrite"), QDir::Files, QDir::Name);
+                QStringList() << QStringLiteral("*.scrite")
+                              << QStringLiteral("*.") + DocumentBackupStore::manifestSuffix,
+                QDir::Files, QDir::Name);
         const bool firstBackup = backupEntries.isEmpty();
+        bool manifestsRemoved = false;
+        auto removeEntry = [&manifestsRemoved](const QFileInfo &entry) {
+            if (QFile::remove(entry.absoluteFilePath()))
+                manifestsRemoved |= entry.suffix() == DocumentBackupStore::manifestSuffix;
+        };
+
         if (!backupEntries.isEmpty()) {
             const int maxBackups = m_maxBackupCount;
             if (maxBackups > 0) {
-                while (backupEntries.size() > maxBackups - 1) {
-                    const QFileInfo oldestEntry = backupEntries.takeFirst();
-                    QFile::remove(oldestEntry.absoluteFilePath());
-                }
+                while (backupEntries.size() > maxBackups - 1)
+                    removeEntry(backupEntries.takeFirst());
             }
 
-            const QFileInfo latestEntry = backupEntries.takeLast();
-            if (latestEntry.suffix() == QStringLiteral("scrite")) {
+            if (!backupEntries.isEmpty()) {
+                const QFileInfo latestEntry = backupEntries.takeLast();
                 if (timeGapInSeconds(latestEntry) < 60)
-                    QFile::remove(latestEntry.absoluteFilePath());
+                    removeEntry(latestEntry);
             }
         }
 
-        const QString backupFileName = backupDirPath + "/" + fi.completeBaseName() + " ["
-                + QString::number(now) + "].scrite";
-        const bool backupSuccessful = QFile::copy(m_fileName, backupFileName);
+        const QString backupFileName =
+                backupDirPath + "/" + fi.completeBaseName() + " [" + QString::number(now) + "]";
+
+        // The document is copied whole first, which is all that saving waits for. Copies
+        // are then turned into deduplicated backups in a worker thread. Documents in the
+        // pre-ZIP format cannot be deduplicated, their copies are kept as they are.
+        const QString backupCopyFileName = backupFileName + ".scrite";
+        const bool backupSuccessful = QFile::copy(m_fileName, backupCopyFileName);
+        if (backupSuccessful && m_deduplicatedBackups)
+            DocumentBackupStore::addInBackground(
+                    backupCopyFileName, backupFileName + "." + DocumentBackupStore::manifestSuffix,
+                    manifestsRemoved);
+        else if (manifestsRemoved)
+            DocumentBackupStore::collectGarbageInBackground(backupDirPath);
 
         if (firstBackup && backupSuccessful)
             m_documentBackupsModel.loadBackupFileInformation();
@@ -1932,7 +2021,8 @@ void ScriteDocument::timerEvent(QTimerEvent *event)
     }
 
     if (event->timerId() == m_autoSaveTimer.timerId()) {
-        if (m_modified && !m_fileName.isEmpty() && QFileInfo(m_fileName).isWritable()) {
+        if (m_modified && !m_loading && !m_fileName.isEmpty()
+            && QFileInfo(m_fileName).isWritable()) {
             QScopedValueRollback<bool> autoSave(m_autoSaveMode, true);
             this->save();
         }
@@ -2213,8 +2303,27 @@ void ScriteDocument::setFileName(const QString &val)
     m_fileLocker->setFilePath(m_fileName);
 }
 
+// Waits for a loading job running in a worker thread, while the event loop keeps the busy
+// message and progress bar alive. User input is not processed meanwhile. Callers must have
+// put the document in loading state before, so that nothing reacts to its half-reset state.
+template<typename T>
+static T waitForLoadingJob(const QFuture<T> &future)
+{
+    if (!future.isFinished()) {
+        QFutureWatcher<T> watcher;
+        QEventLoop eventLoop;
+        QObject::connect(&watcher, &QFutureWatcher<T>::finished, &eventLoop, &QEventLoop::quit);
+        watcher.setFuture(future);
+        if (!future.isFinished())
+            eventLoop.exec(QEventLoop::ExcludeUserInputEvents);
+    }
+    return future.result();
+}
+
 bool ScriteDocument::load(const QString &fileName)
 {
+    PROFILE_THIS_FUNCTION;
+
     m_errorReport->clear();
 
     QJsonObject details;
@@ -2249,7 +2358,9 @@ bool ScriteDocument::load(const QString &fileName)
             if (m_loadBegun) {
                 m_document->m_progressReport->finish();
                 m_document->setLoading(false);
-            } else
+            }
+
+            if (!m_applyBegun)
                 m_document->m_docFileSystem.hardReset();
         }
 
@@ -2260,8 +2371,11 @@ bool ScriteDocument::load(const QString &fileName)
             m_document->setLoading(true);
         }
 
+        void beginApply() { m_applyBegun = true; }
+
     private:
         bool m_loadBegun = false;
+        bool m_applyBegun = false;
         ScriteDocument *m_document;
     } loadCleanup(this);
 
@@ -2276,9 +2390,20 @@ bool ScriteDocument::load(const QString &fileName)
         return false;
     }
 
-    const QJsonDocument jsonDoc = format == DocumentFileSystem::ZipFormat
-            ? QJsonDocument::fromJson(m_docFileSystem.header())
-            : QJsonDocument::fromBinaryData(m_docFileSystem.header());
+    // The document has been reset by now. It stays in loading state from here on, because
+    // the event loop runs while the header is parsed and decoded in worker threads below.
+    loadCleanup.begin();
+
+    // Parsing the header happens in a worker thread. Only checks on the parsed meta
+    // information happen in this thread, before the (much costlier) decode begins.
+    const bool zipFormat = format == DocumentFileSystem::ZipFormat;
+    const QJsonObject json =
+            waitForLoadingJob(QtConcurrent::run([header = m_docFileSystem.header(), zipFormat]() {
+                TimeProfiler profiler("ScriteDocument::load [parse header]");
+                const QJsonDocument jsonDoc = zipFormat ? QJsonDocument::fromJson(header)
+                                                        : QJsonDocument::fromBinaryData(header);
+                return jsonDoc.object();
+            }));
 
 #ifndef QT_NO_DEBUG_OUTPUT
     {
@@ -2286,11 +2411,10 @@ bool ScriteDocument::load(const QString &fileName)
         const QString fileName2 = fi.absolutePath() + "/" + fi.completeBaseName() + ".json";
         QFile file2(fileName2);
         file2.open(QFile::WriteOnly);
-        file2.write(jsonDoc.toJson());
+        file2.write(QJsonDocument(json).toJson());
     }
 #endif
 
-    const QJsonObject json = jsonDoc.object();
     if (json.isEmpty()) {
         m_errorReport->setErrorMessage(QStringLiteral("%1 is not a Scrite document.").arg(fileName),
                                        details);
@@ -2348,6 +2472,15 @@ bool ScriteDocument::load(const QString &fileName)
         }
     }
 
+    // Looking up and converting property values for QObjectSerializer happens in worker
+    // threads too, long lists in the header (scenes, screenplay elements, notes) are
+    // decoded in parallel. Only instantiating objects happens in this thread.
+    const QObjectSerializer::DecodedObjectPtr decoded =
+            waitForLoadingJob(QtConcurrent::run([json]() {
+                TimeProfiler profiler("ScriteDocument::load [decode header]");
+                return QObjectSerializer::decode(json, &ScriteDocument::staticMetaObject);
+            }));
+
     m_fileName = fileName;
     emit fileNameChanged();
 
@@ -2355,10 +2488,15 @@ bool ScriteDocument::load(const QString &fileName)
     this->setReadOnly(ro);
     this->setModified(false);
 
-    loadCleanup.begin();
+    loadCleanup.beginApply();
 
     UndoStack::ignoreUndoCommands = true;
-    const bool ret = QObjectSerializer::fromJson(json, this);
+    bool ret = false;
+    {
+        TimeProfiler profiler("ScriteDocument::load [apply header]");
+        Application::ParentChangeBatch parentChangeBatch;
+        ret = QObjectSerializer::fromDecoded(json, decoded, this);
+    }
     if (m_screenplay->currentElementIndex() == 0)
         m_screenplay->setCurrentElementIndex(-1);
     UndoStack::ignoreUndoCommands = false;
@@ -2999,6 +3137,17 @@ QJsonObject ScriteDocumentBackups::MetaData::toJson() const
     return ret;
 }
 
+ScriteDocumentBackups::MetaData
+ScriteDocumentBackups::MetaData::fromManifest(const QJsonObject &manifest)
+{
+    MetaData ret;
+    ret.loaded = true;
+    ret.structureElementCount = manifest.value(QStringLiteral("structureElementCount")).toInt();
+    ret.screenplayElementCount = manifest.value(QStringLiteral("screenplayElementCount")).toInt();
+    ret.fileSize = manifest.value(QStringLiteral("fileSize")).toVariant().toLongLong();
+    return ret;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 ScriteDocumentCollaborators::ScriteDocumentCollaborators(QObject *parent)
@@ -128,8 +128,11 @@ private:
         bool loaded = false;
         int structureElementCount = 0;
         int screenplayElementCount = 0;
+        qint64 fileSize = -1; // of the document, for deduplicated backups
         QJsonObject toJson() const;
+        static MetaData fromManifest(const QJsonObject &manifest);
     };
+    typedef QPair<QFileInfoList, QVector<MetaData>> BackupList;
 
     QTimer m_reloadTimer;
     QDir m_backupFilesDir;
@@ -490,6 +493,12 @@ public:
     int maxBackupCount() const { return m_maxBackupCount; }
     Q_SIGNAL void maxBackupCountChanged();
 
+    // Whether backups are stored as deduplicated blobs, instead of whole copies
+    Q_PROPERTY(bool deduplicatedBackups READ isDeduplicatedBackups WRITE setDeduplicatedBackups NOTIFY deduplicatedBackupsChanged)
+    void setDeduplicatedBackups(bool val);
+    bool isDeduplicatedBackups() const { return m_deduplicatedBackups; }
+    Q_SIGNAL void deduplicatedBackupsChanged();
+
     Q_PROPERTY(bool canImportFromClipboard READ canImportFromClipboard NOTIFY canImportFromClipboardChanged)
     bool canImportFromClipboard() const;
     Q_SIGNAL void canImportFromClipboardChanged();
@@ -604,6 +613,7 @@ private:
     bool m_readOnly = false;
     bool m_autoSaveMode = false;
     int m_maxBackupCount = 20;
+    bool m_deduplicatedBackups = false;
     QString m_sessionId;
     bool m_fromScriptalay = false;
     QString m_documentId;
@@ -27,6 +27,7 @@
 #include <QFutureWatcher>
 #include <QStandardPaths>
 #include <QtConcurrentRun>
+#include <QtConcurrentMap>
 #include <QFileSystemWatcher>
 
 ScriteDocumentVault *ScriteDocumentVault::instance()
@@ -218,6 +219,7 @@ void ScriteDocumentVault::saveToVault()
         const QByteArray bytes = QJsonDocument(json).toJson();
         const bool encrypt = m_document->hasCollaborators();
         dfs->setHeader(bytes);
+        dfs->setMetadata(ScriteFileInfo::createMetadata(json, dfs));
         dfs->save(fileName, encrypt);
 
         this->updateModelFromFolderLater();
@@ -234,6 +236,14 @@ void ScriteDocumentVault::cleanup()
     m_document = nullptr;
 }
 
+static ScriteFileInfo loadVaultFileInfo(const QString &filePath)
+{
+    ScriteFileInfo ret = ScriteFileInfo::load(filePath);
+    if (ret.title.isEmpty())
+        ret.title = QStringLiteral("Untitled Screenplay");
+    return ret;
+}
+
 void ScriteDocumentVault::updateModelFromFolder()
 {
     auto fetchInfoAboutFilesInVault = [](const QString &currentDocumentId, const QString &folder,
@@ -241,6 +251,8 @@ void ScriteDocumentVault::updateModelFromFolder()
         Q_UNUSED(currentDocumentId);
 
         QList<ScriteFileInfo> ret;
+        QList<int> newFileIndexes;
+        QStringList newFilePaths;
         const QFileInfoList fiList =
                 QDir(folder).entryInfoList({ QStringLiteral("*.scrite") }, QDir::Files, QDir::Time);
 
@@ -257,14 +269,18 @@ void ScriteDocumentVault::updateModelFromFolder()
             if (oldIndex >= 0)
                 ret.append(oldList.takeAt(oldIndex));
             else {
-                ScriteFileInfo sfi = ScriteFileInfo::load(fi.absoluteFilePath());
-                if (sfi.title.isEmpty())
-                    sfi.title = QStringLiteral("Untitled Screenplay");
-
-                ret.append(sfi);
+                newFileIndexes.append(ret.size());
+                newFilePaths.append(fi.absoluteFilePath());
+                ret.append(ScriteFileInfo());
             }
         }
 
+        // Files new to the list are loaded in parallel, each one is independent.
+        const QList<ScriteFileInfo> newFileInfos =
+                QtConcurrent::blockingMapped(newFilePaths, loadVaultFileInfo);
+        for (int i = 0; i < newFileIndexes.size() && i < newFileInfos.size(); i++)
+            ret[newFileIndexes.at(i)] = newFileInfos.at(i);
+
         return ret;
     };
 
@@ -13,13 +13,467 @@
 
 #include "documentfilesystem.h"
 #include "scritefileinfo.h"
+#include "timeprofiler.h"
 #include "screenplay.h"
 
+#include <QMutex>
+#include <QBuffer>
+#include <QDateTime>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
 
+#include <cctype>
+#include <functional>
+
+/**
+ * Reads just enough of a document's JSON header to fill a ScriteFileInfo. Objects and
+ * arrays that are not needed are skipped without being parsed, and scanning stops as
+ * soon as documentId and the screenplay object have been seen, which is long before
+ * the structure, notes and other bulky parts of the header.
+ */
+class JsonHeaderScanner
+{
+public:
+    explicit JsonHeaderScanner(QIODevice *device) : m_device(device) { }
+
+    bool scan(ScriteFileInfo &info);
+
+private:
+    typedef std::function<bool(const QString &key, bool *stop)> KeyHandler;
+    bool scanObject(const KeyHandler &onKey);
+    bool scanScreenplay(ScriteFileInfo &info);
+    bool scanElements(int *sceneCount);
+
+    bool readString(QString *value);
+    bool readStringValue(QString *value);
+    bool readHex4(uint *value);
+    bool skipValue();
+    void skipWhitespace();
+    bool expect(char ch);
+
+    int peek()
+    {
+        if (m_pos >= m_length) {
+            m_pos = 0;
+            m_length = m_device->atEnd() ? 0 : int(m_device->read(m_buffer, sizeof(m_buffer)));
+            if (m_length <= 0) {
+                m_length = 0;
+                return -1;
+            }
+        }
+        return uchar(m_buffer[m_pos]);
+    }
+    int next()
+    {
+        const int ret = this->peek();
+        if (ret >= 0)
+            ++m_pos;
+        return ret;
+    }
+
+private:
+    QIODevice *m_device = nullptr;
+    char m_buffer[16384];
+    int m_pos = 0;
+    int m_length = 0;
+};
+
+bool JsonHeaderScanner::scan(ScriteFileInfo &info)
+{
+    bool screenplayFound = false;
+    const bool success = this->scanObject([&](const QString &key, bool *stop) {
+        bool ret = true;
+        if (key == QStringLiteral("documentId"))
+            ret = this->readStringValue(&info.documentId);
+        else if (key == QStringLiteral("screenplay"))
+            ret = screenplayFound = this->scanScreenplay(info);
+        else
+            ret = this->skipValue();
+
+        *stop = screenplayFound && !info.documentId.isEmpty();
+        return ret;
+    });
+
+    return success && screenplayFound;
+}
+
+bool JsonHeaderScanner::scanObject(const KeyHandler &onKey)
+{
+    this->skipWhitespace();
+    if (!this->expect('{'))
+        return false;
+
+    while (1) {
+        this->skipWhitespace();
+        if (this->peek() == '}') {
+            this->next();
+            return true;
+        }
+
+        QString key;
+        if (!this->readString(&key))
+            return false;
+
+        this->skipWhitespace();
+        if (!this->expect(':'))
+            return false;
+
+        this->skipWhitespace();
+
+        bool stop = false;
+        if (!onKey(key, &stop))
+            return false;
+        if (stop)
+            return true;
+
+        this->skipWhitespace();
+        const int ch = this->next();
+        if (ch == '}')
+            return true;
+        if (ch != ',')
+            return false;
+    }
+
+    return false;
+}
+
+bool JsonHeaderScanner::scanScreenplay(ScriteFileInfo &info)
+{
+    return this->scanObject([&](const QString &key, bool *) {
+        if (key == QStringLiteral("title"))
+            return this->readStringValue(&info.title);
+        if (key == QStringLiteral("subtitle"))
+            return this->readStringValue(&info.subtitle);
+        if (key == QStringLiteral("author"))
+            return this->readStringValue(&info.author);
+        if (key == QStringLiteral("logline"))
+            return this->readStringValue(&info.logline);
+        if (key == QStringLiteral("version"))
+            return this->readStringValue(&info.version);
+        if (key == QStringLiteral("elements"))
+            return this->scanElements(&info.sceneCount);
+        return this->skipValue();
+    });
+}
+
+bool JsonHeaderScanner::scanElements(int *sceneCount)
+{
+    if (this->peek() != '[')
+        return this->skipValue();
+
+    this->next();
+
+    while (1) {
+        this->skipWhitespace();
+        const int ch = this->peek();
+        if (ch == ']') {
+            this->next();
+            return true;
+        }
+
+        if (ch == '{') {
+            QString elementType;
+            const bool success = this->scanObject([&](const QString &key, bool *) {
+                if (key == QStringLiteral("elementType"))
+                    return this->readStringValue(&elementType);
+                return this->skipValue();
+            });
+            if (!success)
+                return false;
+
+            if (elementType == QStringLiteral("SceneElementType"))
+                ++(*sceneCount);
+        } else if (!this->skipValue())
+            return false;
+
+        this->skipWhitespace();
+        const int ch2 = this->next();
+        if (ch2 == ']')
+            return true;
+        if (ch2 != ',')
+            return false;
+    }
+
+    return false;
+}
+
+bool JsonHeaderScanner::readString(QString *value)
+{
+    if (this->next() != '"')
+        return false;
+
+    QByteArray bytes;
+    while (1) {
+        int ch = this->next();
+        if (ch < 0)
+            return false;
+        if (ch == '"')
+            break;
+
+        if (ch == '\\') {
+            ch = this->next();
+            switch (ch) {
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            case 'b':
+                ch = '\b';
+                break;
+            case 'f':
+                ch = '\f';
+                break;
+            case 'n':
+                ch = '\n';
+                break;
+            case 'r':
+                ch = '\r';
+                break;
+            case 't':
+                ch = '\t';
+                break;
+            case 'u': {
+                uint codePoint = 0;
+                if (!this->readHex4(&codePoint))
+                    return false;
+
+                if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                    uint lowSurrogate = 0;
+                    if (this->next() != '\\' || this->next() != 'u'
+                        || !this->readHex4(&lowSurrogate) || lowSurrogate < 0xDC00
+                        || lowSurrogate > 0xDFFF)
+                        return false;
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                }
+
+                if (value)
+                    bytes += QString::fromUcs4(&codePoint, 1).toUtf8();
+                continue;
+            }
+            default:
+                return false;
+            }
+        }
+
+        if (value)
+            bytes += char(ch);
+    }
+
+    if (value)
+        *value = QString::fromUtf8(bytes);
+
+    return true;
+}
+
+bool JsonHeaderScanner::readStringValue(QString *value)
+{
+    if (this->peek() == '"')
+        return this->readString(value);
+
+    return this->skipValue();
+}
+
+bool JsonHeaderScanner::readHex4(uint *value)
+{
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        const int ch = this->next();
+        uint digit = 0;
+        if (ch >= '0' && ch <= '9')
+            digit = uint(ch - '0');
+        else if (ch >= 'a' && ch <= 'f')
+            digit = uint(ch - 'a' + 10);
+        else if (ch >= 'A' && ch <= 'F')
+            digit = uint(ch - 'A' + 10);
+        else
+            return false;
+        *value = (*value << 4) | digit;
+    }
+
+    return true;
+}
+
+bool JsonHeaderScanner::skipValue()
+{
+    this->skipWhitespace();
+
+    int depth = 0;
+    do {
+        const int ch = this->peek();
+        if (ch < 0)
+            return false;
+
+        if (ch == '"') {
+            if (!this->readString(nullptr))
+                return false;
+        } else if (ch == '{' || ch == '[') {
+            ++depth;
+            ++m_pos;
+        } else if (ch == '}' || ch == ']') {
+            if (depth == 0)
+                return false;
+            --depth;
+            ++m_pos;
+        } else if (depth == 0) {
+            // Numbers, true, false and null
+            int ch2 = ch;
+            while (ch2 >= 0 && ch2 != ',' && ch2 != '}' && ch2 != ']' && !isspace(ch2)) {
+                ++m_pos;
+                ch2 = this->peek();
+            }
+            return true;
+        } else
+            ++m_pos;
+    } while (depth > 0);
+
+    return true;
+}
+
+void JsonHeaderScanner::skipWhitespace()
+{
+    int ch = this->peek();
+    while (ch >= 0 && isspace(ch)) {
+        ++m_pos;
+        ch = this->peek();
+    }
+}
+
+bool JsonHeaderScanner::expect(char ch)
+{
+    return this->next() == ch;
+}
+
+static const int CoverThumbnailSize = 512;
+
+static void setCoverPageImage(ScriteFileInfo &info, const QImage &image)
+{
+    info.coverPageImage = image.isNull() ? QImage()
+                                         : image.scaled(CoverThumbnailSize, CoverThumbnailSize,
+                                                        Qt::KeepAspectRatio,
+                                                        Qt::SmoothTransformation);
+    info.hasCoverPage = !info.coverPageImage.isNull();
+}
+
+static void trimTextFields(ScriteFileInfo &info)
+{
+    info.title = info.title.trimmed();
+    info.subtitle = info.subtitle.trimmed();
+    info.author = info.author.trimmed();
+    info.logline = info.logline.trimmed();
+    info.version = info.version.trimmed();
+}
+
+struct CoverThumbnailCache
+{
+    QMutex mutex;
+    QString path;
+    QDateTime lastModified;
+    qint64 size = -1;
+    QByteArray jpeg;
+};
+Q_GLOBAL_STATIC(CoverThumbnailCache, TheCoverThumbnailCache)
+
+static QByteArray coverThumbnail(const QString &coverPath)
+{
+    if (coverPath.isEmpty())
+        return QByteArray();
+
+    const QFileInfo fi(coverPath);
+    if (!fi.exists())
+        return QByteArray();
+
+    // Auto-save calls this every few seconds, the cover rarely changes in between.
+    CoverThumbnailCache *cache = ::TheCoverThumbnailCache;
+    QMutexLocker locker(&cache->mutex);
+    if (cache->path == fi.absoluteFilePath() && cache->lastModified == fi.lastModified()
+        && cache->size == fi.size())
+        return cache->jpeg;
+
+    const QImage image(coverPath);
+    QByteArray jpeg;
+    if (!image.isNull()) {
+        QBuffer buffer(&jpeg);
+        buffer.open(QBuffer::WriteOnly);
+        image.scaled(CoverThumbnailSize, CoverThumbnailSize, Qt::KeepAspectRatio,
+                     Qt::SmoothTransformation)
+                .save(&buffer, "JPG", 85);
+    }
+
+    cache->path = fi.absoluteFilePath();
+    cache->lastModified = fi.lastModified();
+    cache->size = fi.size();
+    cache->jpeg = jpeg;
+
+    return jpeg;
+}
+
+static int countScenes(const QJsonArray &screenplayElementsArr)
+{
+    return std::count_if(screenplayElementsArr.begin(), screenplayElementsArr.end(),
+                         [](const QJsonValue &item) {
+                             const QJsonObject &itemObj = item.toObject();
+                             return itemObj.value("elementType").toString()
+                                     == QStringLiteral("SceneElementType");
+                         });
+}
+
+static bool loadFromMetadata(ScriteFileInfo &info, const QByteArray &metadataBytes)
+{
+    if (metadataBytes.isEmpty())
+        return false;
+
+    const QJsonObject metadata = QJsonDocument::fromJson(metadataBytes).object();
+    info.documentId = metadata.value("documentId").toString();
+    if (info.documentId.isEmpty())
+        return false;
+
+    info.title = metadata.value("title").toString();
+    info.subtitle = metadata.value("subtitle").toString();
+    info.author = metadata.value("author").toString();
+    info.logline = metadata.value("logline").toString();
+    info.version = metadata.value("version").toString();
+    info.sceneCount = metadata.value("sceneCount").toInt();
+    trimTextFields(info);
+
+    const QByteArray thumbnail =
+            QByteArray::fromBase64(metadata.value("coverThumbnail").toString().toLatin1());
+    info.coverPageImage = thumbnail.isEmpty() ? QImage() : QImage::fromData(thumbnail, "JPG");
+    info.hasCoverPage = !info.coverPageImage.isNull();
+
+    return true;
+}
+
+static ScriteFileInfo fullLoad(const QFileInfo &fileInfo)
+{
+    ScriteFileInfo ret = ScriteFileInfo::quickLoad(fileInfo);
+    if (ret.filePath.isEmpty())
+        return ret;
+
+    DocumentFileSystem dfs;
+    if (!dfs.load(fileInfo.absoluteFilePath()))
+        return ScriteFileInfo();
+
+    const QJsonDocument jsonDoc = QJsonDocument::fromJson(dfs.header());
+    const QJsonObject docObj = jsonDoc.object();
+    const QJsonObject screenplayObj = docObj.value("screenplay").toObject();
+
+    ret.documentId = docObj.value("documentId").toString();
+    ret.title = screenplayObj.value("title").toString();
+    ret.subtitle = screenplayObj.value("subtitle").toString();
+    ret.author = screenplayObj.value("author").toString();
+    ret.logline = screenplayObj.value("logline").toString();
+    ret.version = screenplayObj.value("version").toString();
+    ret.sceneCount = countScenes(screenplayObj.value("elements").toArray());
+    trimTextFields(ret);
+
+    const QString coverPagePath = dfs.absolutePath(Screenplay::standardCoverPathPhotoPath());
+    setCoverPageImage(ret, QFile::exists(coverPagePath) ? QImage(coverPagePath) : QImage());
+
+    return ret;
+}
+
 bool ScriteFileInfo::isValid() const
 {
     return !filePath.isEmpty() && !fileName.isEmpty() && !baseFileName.isEmpty()
@@ -56,43 +510,55 @@ ScriteFileInfo ScriteFileInfo::load(const QString &filePath)
 
 ScriteFileInfo ScriteFileInfo::load(const QFileInfo &fileInfo)
 {
-    ScriteFileInfo ret;
-    if (!fileInfo.exists() && fileInfo.suffix().toLower() != QLatin1String("scrite")
-        && !fileInfo.isReadable())
+    PROFILE_THIS_FUNCTION;
+
+    ScriteFileInfo ret = quickLoad(fileInfo);
+    if (ret.filePath.isEmpty())
         return ret;
 
-    DocumentFileSystem dfs;
-    if (!dfs.load(fileInfo.absoluteFilePath()))
+    // Documents saved with metadata are described by just that one entry. Metadata that
+    // doesn't match the header in the archive is not returned, such documents are scanned.
+    if (loadFromMetadata(ret, DocumentFileSystem::peekMetadata(ret.filePath)))
         return ret;
 
-    const QJsonDocument jsonDoc = QJsonDocument::fromJson(dfs.header());
-    const QJsonObject docObj = jsonDoc.object();
-    const QJsonObject screenplayObj = docObj.value("screenplay").toObject();
-    const QJsonArray screenplayElementsArr = screenplayObj.value("elements").toArray();
+    // Other ZIP documents have their header scanned, but only up to the screenplay
+    bool scanned = false;
+    DocumentFileSystem::peekHeader(ret.filePath, [&](QIODevice *device) {
+        scanned = JsonHeaderScanner(device).scan(ret);
+    });
+    if (scanned) {
+        trimTextFields(ret);
 
-    ret.filePath = fileInfo.absoluteFilePath();
-    ret.fileName = fileInfo.fileName();
-    ret.baseFileName = fileInfo.completeBaseName();
-    ret.fileSize = fileInfo.size();
-    ret.fileInfo = fileInfo;
-    ret.documentId = docObj.value("documentId").toString();
-    ret.title = screenplayObj.value("title").toString().trimmed();
-    ret.subtitle = screenplayObj.value("subtitle").toString().trimmed();
-    ret.author = screenplayObj.value("author").toString().trimmed();
-    ret.logline = screenplayObj.value("logline").toString().trimmed();
-    ret.version = screenplayObj.value("version").toString().trimmed();
-    ret.sceneCount = std::count_if(screenplayElementsArr.begin(), screenplayElementsArr.end(),
-                                   [](const QJsonValue &item) {
-                                       const QJsonObject &itemObj = item.toObject();
-                                       return itemObj.value("elementType").toString()
-                                               == QStringLiteral("SceneElementType");
-                                   });
+        const QByteArray coverBytes =
+                DocumentFileSystem::peek(ret.filePath, Screenplay::standardCoverPathPhotoPath());
+        setCoverPageImage(ret, coverBytes.isEmpty() ? QImage() : QImage::fromData(coverBytes));
+        return ret;
+    }
 
-    const QString coverPagePath = dfs.absolutePath(Screenplay::standardCoverPathPhotoPath());
-    ret.coverPageImage = QFile::exists(coverPagePath)
-            ? QImage(coverPagePath).scaled(512, 512, Qt::KeepAspectRatio, Qt::SmoothTransformation)
-            : QImage();
-    ret.hasCoverPage = !ret.coverPageImage.isNull();
+    // Documents in the older format have to be unpacked completely
+    return fullLoad(fileInfo);
+}
 
-    return ret;
+QByteArray ScriteFileInfo::createMetadata(const QJsonObject &documentJson, DocumentFileSystem *dfs)
+{
+    const QJsonObject screenplayObj = documentJson.value("screenplay").toObject();
+
+    QJsonObject metadata;
+    metadata.insert("metadataVersion", 1);
+    metadata.insert("documentId", documentJson.value("documentId").toString());
+    metadata.insert("title", screenplayObj.value("title").toString().trimmed());
+    metadata.insert("subtitle", screenplayObj.value("subtitle").toString().trimmed());
+    metadata.insert("author", screenplayObj.value("author").toString().trimmed());
+    metadata.insert("logline", screenplayObj.value("logline").toString().trimmed());
+    metadata.insert("version", screenplayObj.value("version").toString().trimmed());
+    metadata.insert("sceneCount", countScenes(screenplayObj.value("elements").toArray()));
+
+    if (dfs != nullptr) {
+        const QByteArray thumbnail =
+                coverThumbnail(dfs->absolutePath(Screenplay::standardCoverPathPhotoPath()));
+        if (!thumbnail.isEmpty())
+            metadata.insert("coverThumbnail", QString::fromLatin1(thumbnail.toBase64()));
+    }
+
+    return QJsonDocument(metadata).toJson(QJsonDocument::Compact);
 }
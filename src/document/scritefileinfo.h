@@ -18,6 +18,9 @@
 #include <QString>
 #include <QImage>
 #include <QFileInfo>
+#include <QJsonObject>
+
+class DocumentFileSystem;
 
 struct ScriteFileInfo
 {
@@ -89,6 +92,9 @@ public:
     static ScriteFileInfo load(const QString &filePath);
     static ScriteFileInfo load(const QFileInfo &fileInfo);
 
+    // Metadata saved into documents, for load() to pick up without parsing the header
+    static QByteArray createMetadata(const QJsonObject &documentJson, DocumentFileSystem *dfs);
+
     bool operator==(const ScriteFileInfo &other) const { return this->filePath == other.filePath; }
 };
 
@@ -21,11 +21,13 @@
 #include "deltadocument.h"
 #include "scritedocument.h"
 #include "garbagecollector.h"
+#include "deferredworkscheduler.h"
 #include "structureexporter.h"
 #include "screenplaytextdocument.h"
 
 #include <QDir>
 #include <QtMath>
+#include <QSet>
 #include <QStack>
 #include <QBuffer>
 #include <QJSValue>
@@ -2602,8 +2604,7 @@ void Annotation::onDfsAuction(const QString &filePath, int *claims)
 
 Structure::Structure(QObject *parent)
     : QObject(parent),
-      m_scriteDocument(qobject_cast<ScriteDocument *>(parent)),
-      m_locationHeadingsMapTimer("Structure.m_locationHeadingsMapTimer")
+      m_scriteDocument(qobject_cast<ScriteDocument *>(parent))
 {
     connect(m_notes, &Notes::notesModified, this, &Structure::structureChanged);
     connect(this, &Structure::zoomLevelChanged, this, &Structure::structureChanged);
@@ -2646,6 +2647,9 @@ Structure::Structure(QObject *parent)
             &Structure::annotationsBoundingBoxChanged);
 
     m_elementStacks.m_structure = this;
+    m_incidenceIndex.m_structure = this;
+    m_episodeBoxes.setup(this, StructureBoxModel::EpisodeBoxes);
+    m_groupBoxes.setup(this, StructureBoxModel::GroupBoxes);
 
     if (m_scriteDocument != nullptr) {
         Screenplay *screenplay = m_scriteDocument->screenplay();
@@ -2962,9 +2966,11 @@ void Structure::removeElement(StructureElement *ptr)
     for (SceneElement *sceneElement : sceneElements)
         this->onAboutToRemoveSceneElement(sceneElement);
     this->updateCharacterNamesShotsTransitionsAndTagsLater();
+    m_incidenceIndex.untrackScene(ptr->scene());
 
     m_elements.removeAt(index);
 
+    disconnect(ptr, &StructureElement::sceneChanged, this, nullptr);
     disconnect(ptr, &StructureElement::elementChanged, this, &Structure::structureChanged);
     disconnect(ptr, &StructureElement::aboutToDelete, this, &Structure::removeElement);
     disconnect(ptr, &StructureElement::sceneLocationChanged, this,
@@ -3033,6 +3039,8 @@ void Structure::insertElement(StructureElement *ptr, int index)
             &QObjectListModel<StructureElement *>::objectDestroyed);
     connect(ptr, &StructureElement::stackIdChanged, &m_elementStacks,
             &StructureElementStacks::evaluateStacksLater);
+    connect(ptr, &StructureElement::sceneChanged, this,
+            [=]() { this->onStructureElementSceneChanged(ptr); });
     this->updateLocationHeadingMapLater();
 
     this->onStructureElementSceneChanged(ptr);
@@ -3084,6 +3092,8 @@ void Structure::setElements(const QList<StructureElement *> &list)
                 &QObjectListModel<StructureElement *>::objectDestroyed);
         connect(element, &StructureElement::stackIdChanged, &m_elementStacks,
                 &StructureElementStacks::evaluateStacksLater);
+        connect(element, &StructureElement::sceneChanged, this,
+                [=]() { this->onStructureElementSceneChanged(element); });
         this->onStructureElementSceneChanged(element);
     }
 
@@ -3415,6 +3425,10 @@ QJsonObject Structure::evaluateEpisodeAndGroupBoxes(Screenplay *screenplay,
     const QList<QPair<QString, QList<StructureElement *>>> groups =
             this->evaluateGroupsImpl(screenplay, category);
 
+    QHash<StructureElement *, int> elementIndexMap;
+    for (int i = 0; i < m_elements.size(); i++)
+        elementIndexMap.insert(m_elements.at(i), i);
+
     QJsonObject ret;
     QJsonArray groupBoxes;
 
@@ -3427,7 +3441,7 @@ QJsonObject Structure::evaluateEpisodeAndGroupBoxes(Screenplay *screenplay,
         QRectF groupBox;
         for (StructureElement *element : qAsConst(group.second)) {
             groupBox |= QRectF(element->x(), element->y(), element->width(), element->height());
-            sceneIndexes.append(this->indexOfElement(element));
+            sceneIndexes.append(elementIndexMap.value(element, -1));
         }
 
         QJsonObject groupJson;
@@ -3446,38 +3460,25 @@ QJsonObject Structure::evaluateEpisodeAndGroupBoxes(Screenplay *screenplay,
     }
 
     QJsonArray episodeBoxes;
-    if (screenplay->episodeCount() > 0) {
-        QMap<QString, QPair<int, QRectF>> episodeElementsMap;
-        for (StructureElement *element : m_elements.list()) {
-            const QString episodeName = element->scene()->episode();
-            if (episodeName.isEmpty())
-                continue;
+    const QList<QPair<QString, QList<StructureElement *>>> episodes =
+            this->evaluateEpisodesImpl(screenplay);
+    for (const QPair<QString, QList<StructureElement *>> &episode : episodes) {
+        QRectF episodeBox;
+        for (StructureElement *element : qAsConst(episode.second))
+            episodeBox |= QRectF(element->x(), element->y(), element->width(), element->height());
 
-            episodeElementsMap[episodeName].first++;
-            episodeElementsMap[episodeName].second |=
-                    QRectF(element->x(), element->y(), element->width(), element->height());
-        }
-
-        QMap<QString, QPair<int, QRectF>>::const_iterator it = episodeElementsMap.constBegin();
-        QMap<QString, QPair<int, QRectF>>::const_iterator end = episodeElementsMap.constEnd();
-        while (it != end) {
-            QJsonObject episodeJson;
-            episodeJson.insert(QStringLiteral("name"), it.key());
-            episodeJson.insert(QStringLiteral("sceneCount"), it.value().first);
+        QJsonObject episodeJson;
+        episodeJson.insert(QStringLiteral("name"), episode.first);
+        episodeJson.insert(QStringLiteral("sceneCount"), episode.second.size());
 
-            const QRectF episodeBox = it.value().second;
-
-            QJsonObject geometryJson;
-            geometryJson.insert(QStringLiteral("x"), episodeBox.x());
-            geometryJson.insert(QStringLiteral("y"), episodeBox.y());
-            geometryJson.insert(QStringLiteral("width"), episodeBox.width());
-            geometryJson.insert(QStringLiteral("height"), episodeBox.height());
-            episodeJson.insert(QStringLiteral("geometry"), geometryJson);
-
-            episodeBoxes.append(episodeJson);
+        QJsonObject geometryJson;
+        geometryJson.insert(QStringLiteral("x"), episodeBox.x());
+        geometryJson.insert(QStringLiteral("y"), episodeBox.y());
+        geometryJson.insert(QStringLiteral("width"), episodeBox.width());
+        geometryJson.insert(QStringLiteral("height"), episodeBox.height());
+        episodeJson.insert(QStringLiteral("geometry"), geometryJson);
 
-            ++it;
-        }
+        episodeBoxes.append(episodeJson);
     }
 
     ret.insert(QStringLiteral("groupBoxes"), groupBoxes);
@@ -3556,8 +3557,17 @@ Structure::evaluateGroupsImpl(Screenplay *screenplay, const QString &category) c
 
     bool hasEpisodeBreaks = false;
 
+    // Looking up elements of scenes one at a time, using indexOfScene(), makes this
+    // function quadratic in the number of scenes.
+    QHash<Scene *, StructureElement *> sceneElementMap;
+    for (int i = m_elements.size() - 1; i >= 0; i--) {
+        StructureElement *element = m_elements.at(i);
+        if (element->scene() != nullptr)
+            sceneElementMap.insert(element->scene(), element);
+    }
+
     if (category.isEmpty()) {
-        QList<StructureElement *> unusedElements = m_elements.list();
+        QSet<StructureElement *> usedElements;
 
         ret.append(qMakePair(QString(), QList<StructureElement *>()));
 
@@ -3570,11 +3580,9 @@ Structure::evaluateGroupsImpl(Screenplay *screenplay, const QString &category) c
                         element->breakType() == Screenplay::Act ? element->breakTitle() : QString();
                 ret.append(qMakePair(beatName, QList<StructureElement *>()));
             } else {
-                Scene *scene = element->scene();
-                int index = this->indexOfScene(scene);
-                StructureElement *selement = this->elementAt(index);
+                StructureElement *selement = sceneElementMap.value(element->scene());
                 if (selement != nullptr) {
-                    unusedElements.removeOne(selement);
+                    usedElements.insert(selement);
                     ret.last().second.append(selement);
 
                     if (ret.last().first.isEmpty())
@@ -3584,6 +3592,12 @@ Structure::evaluateGroupsImpl(Screenplay *screenplay, const QString &category) c
             }
         }
 
+        QList<StructureElement *> unusedElements;
+        for (StructureElement *element : m_elements.list()) {
+            if (!usedElements.contains(element))
+                unusedElements.append(element);
+        }
+
         if (!unusedElements.isEmpty())
             ret.append(qMakePair(QStringLiteral("Unused Scenes"), unusedElements));
     } else {
@@ -3618,8 +3632,7 @@ Structure::evaluateGroupsImpl(Screenplay *screenplay, const QString &category) c
 
             sceneIndexMap[scene] = element->elementIndex();
             actIndexMap[scene] = element->actIndex();
-            const int index = this->indexOfScene(scene);
-            StructureElement *selement = this->elementAt(index);
+            StructureElement *selement = sceneElementMap.value(scene);
             if (selement != nullptr) {
                 for (const QString &group : sceneGroups)
                     map[group].append(selement);
@@ -3693,6 +3706,30 @@ Structure::evaluateGroupsImpl(Screenplay *screenplay, const QString &category) c
     return ret;
 }
 
+QList<QPair<QString, QList<StructureElement *>>>
+Structure::evaluateEpisodesImpl(Screenplay *screenplay) const
+{
+    QList<QPair<QString, QList<StructureElement *>>> ret;
+    if (screenplay == nullptr || screenplay->episodeCount() == 0)
+        return ret;
+
+    QMap<QString, QList<StructureElement *>> episodeElementsMap;
+    for (StructureElement *element : m_elements.list()) {
+        const QString episodeName = element->scene() ? element->scene()->episode() : QString();
+        if (!episodeName.isEmpty())
+            episodeElementsMap[episodeName].append(element);
+    }
+
+    QMap<QString, QList<StructureElement *>>::const_iterator it = episodeElementsMap.constBegin();
+    QMap<QString, QList<StructureElement *>>::const_iterator end = episodeElementsMap.constEnd();
+    while (it != end) {
+        ret.append(qMakePair(it.key(), it.value()));
+        ++it;
+    }
+
+    return ret;
+}
+
 bool Structure::renameCharacter(const QString &from, const QString &to, QString *errMsg)
 {
     auto setError = [=](const QString &msg) {
@@ -4869,23 +4906,6 @@ bool Structure::event(QEvent *event)
     return QObject::event(event);
 }
 
-void Structure::timerEvent(QTimerEvent *event)
-{
-    if (m_locationHeadingsMapTimer.timerId() == event->timerId()) {
-        m_locationHeadingsMapTimer.stop();
-        this->updateLocationHeadingMap();
-        return;
-    }
-
-    if (m_updateCharacterNamesShotsTransitionsAndTagsTimer.timerId() == event->timerId()) {
-        m_updateCharacterNamesShotsTransitionsAndTagsTimer.stop();
-        this->updateCharacterNamesShotsTransitionsAndTags();
-        return;
-    }
-
-    QObject::timerEvent(event);
-}
-
 void Structure::resetCurentElementIndex()
 {
     int val = m_currentElementIndex;
@@ -4999,7 +5019,9 @@ void Structure::updateLocationHeadingMap()
 
 void Structure::updateLocationHeadingMapLater()
 {
-    m_locationHeadingsMapTimer.start(0, this);
+    DeferredWorkScheduler::instance()->schedule(this, "Structure.updateLocationHeadingMap",
+                                                DeferredWorkScheduler::NormalPriority, 0,
+                                                [=]() { this->updateLocationHeadingMap(); });
 }
 
 void Structure::onStructureElementSceneChanged(StructureElement *element)
@@ -5010,9 +5032,10 @@ void Structure::onStructureElementSceneChanged(StructureElement *element)
     if (element == nullptr || element->scene() == nullptr)
         return;
 
-    connect(element->scene(), &Scene::sceneElementChanged, this, &Structure::onSceneElementChanged);
+    connect(element->scene(), &Scene::sceneElementChanged, this, &Structure::onSceneElementChanged,
+            Qt::UniqueConnection);
     connect(element->scene(), &Scene::aboutToRemoveSceneElement, this,
-            &Structure::onAboutToRemoveSceneElement);
+            &Structure::onAboutToRemoveSceneElement, Qt::UniqueConnection);
 
     Scene *scene = element->scene();
     for (int i = 0; i < scene->elementCount(); i++) {
@@ -5022,12 +5045,17 @@ void Structure::onStructureElementSceneChanged(StructureElement *element)
                 m_shotElementMap.include(element);
     }
 
+    m_incidenceIndex.trackScene(scene);
+    m_incidenceIndex.markSceneDirty(scene);
+
     this->updateLocationHeadingMapLater();
     this->updateCharacterNamesShotsTransitionsAndTagsLater();
 }
 
 void Structure::onSceneElementChanged(SceneElement *element, Scene::SceneElementChangeType)
 {
+    m_incidenceIndex.markSceneDirty(element->scene());
+
     if (m_characterElementMap.include(element) || m_transitionElementMap.include(element)
         || m_shotElementMap.include(element))
         updateCharacterNamesShotsTransitionsAndTagsLater();
@@ -5035,6 +5063,8 @@ void Structure::onSceneElementChanged(SceneElement *element, Scene::SceneElement
 
 void Structure::onAboutToRemoveSceneElement(SceneElement *element)
 {
+    m_incidenceIndex.markSceneDirty(element->scene());
+
     if (m_characterElementMap.remove(element) || m_transitionElementMap.remove(element)
         || m_shotElementMap.remove(element))
         updateCharacterNamesShotsTransitionsAndTagsLater();
@@ -5094,7 +5124,10 @@ void Structure::updateCharacterNamesShotsTransitionsAndTags()
 
 void Structure::updateCharacterNamesShotsTransitionsAndTagsLater()
 {
-    m_updateCharacterNamesShotsTransitionsAndTagsTimer.start(0, this);
+    DeferredWorkScheduler::instance()->schedule(
+            this, "Structure.updateCharacterNamesShotsTransitionsAndTags",
+            DeferredWorkScheduler::NormalPriority, 0,
+            [=]() { this->updateCharacterNamesShotsTransitionsAndTags(); });
 }
 
 void Structure::staticAppendAnnotation(QQmlListProperty<Annotation> *list, Annotation *ptr)
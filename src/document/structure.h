@@ -22,6 +22,8 @@
 #include "qobjectproperty.h"
 #include "abstractshapeitem.h"
 #include "qobjectlistmodel.h"
+#include "structureboxmodel.h"
+#include "sceneincidenceindex.h"
 
 #include <QColor>
 #include <QPointer>
@@ -857,6 +859,25 @@ public:
         return &((const_cast<Structure *>(this))->m_elementStacks);
     }
 
+    Q_PROPERTY(SceneIncidenceIndex *incidenceIndex READ incidenceIndex CONSTANT STORED false)
+    SceneIncidenceIndex *incidenceIndex() const
+    {
+        return &((const_cast<Structure *>(this))->m_incidenceIndex);
+    }
+
+    Q_PROPERTY(StructureBoxModel *episodeBoxes READ episodeBoxes CONSTANT STORED false)
+    StructureBoxModel *episodeBoxes() const
+    {
+        return &((const_cast<Structure *>(this))->m_episodeBoxes);
+    }
+
+    // Group boxes are for groups in the preferredGroupCategory, or acts if none is set.
+    Q_PROPERTY(StructureBoxModel *groupBoxes READ groupBoxes CONSTANT STORED false)
+    StructureBoxModel *groupBoxes() const
+    {
+        return &((const_cast<Structure *>(this))->m_groupBoxes);
+    }
+
     Q_PROPERTY(QQmlListProperty<StructureElement> elements READ elements NOTIFY elementsChanged)
     QQmlListProperty<StructureElement> elements();
     Q_INVOKABLE void addElement(StructureElement *ptr);
@@ -1048,7 +1069,6 @@ public:
 
 protected:
     bool event(QEvent *event);
-    void timerEvent(QTimerEvent *event);
     void resetCurentElementIndex();
     void setCanPaste(bool val);
     void onClipboardDataChanged();
@@ -1057,9 +1077,12 @@ private:
     friend class Character;
     friend class Screenplay;
     friend class ScriteDocument;
+    friend class StructureBoxModel;
     StructureElement *splitElement(StructureElement *ptr, SceneElement *element, int textPosition);
     QList<QPair<QString, QList<StructureElement *>>>
     evaluateGroupsImpl(Screenplay *screenplay, const QString &category = QString()) const;
+    QList<QPair<QString, QList<StructureElement *>>>
+    evaluateEpisodesImpl(Screenplay *screenplay) const;
 
     bool renameCharacter(const QString &from, const QString &to, QString *errMsg);
 
@@ -1088,12 +1111,14 @@ private:
     QObjectListModel<StructureElement *> m_elements;
     ModelAggregator m_elementsBoundingBoxAggregator;
     StructureElementStacks m_elementStacks;
+    SceneIncidenceIndex m_incidenceIndex;
+    StructureBoxModel m_episodeBoxes;
+    StructureBoxModel m_groupBoxes;
     int m_currentElementIndex = -1;
     qreal m_zoomLevel = 1.0;
 
     void updateLocationHeadingMap();
     void updateLocationHeadingMapLater();
-    ExecLaterTimer m_locationHeadingsMapTimer;
     QMap<QString, QList<SceneHeading *>> m_locationHeadingsMap;
 
     void onStructureElementSceneChanged(StructureElement *element = nullptr);
@@ -1101,7 +1126,6 @@ private:
     void onAboutToRemoveSceneElement(SceneElement *element);
     void updateCharacterNamesShotsTransitionsAndTags();
     void updateCharacterNamesShotsTransitionsAndTagsLater();
-    ExecLaterTimer m_updateCharacterNamesShotsTransitionsAndTagsTimer;
     CharacterElementMap m_characterElementMap;
     TransitionElementMap m_transitionElementMap;
     ShotElementMap m_shotElementMap;
@@ -0,0 +1,275 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "structureboxmodel.h"
+#include "structure.h"
+#include "screenplay.h"
+#include "scritedocument.h"
+#include "deferredworkscheduler.h"
+
+StructureBoxModel::StructureBoxModel(QObject *parent) : QAbstractListModel(parent) { }
+
+StructureBoxModel::~StructureBoxModel()
+{
+    DeferredWorkScheduler::instance()->cancel(this, "StructureBoxModel.refresh");
+    DeferredWorkScheduler::instance()->cancel(this, "StructureBoxModel.updateGeometries");
+}
+
+void StructureBoxModel::refreshNow()
+{
+    if (DeferredWorkScheduler::instance()->isScheduled(this, "StructureBoxModel.refresh"))
+        this->refresh();
+    else
+        DeferredWorkScheduler::instance()->runNow(this, "StructureBoxModel.updateGeometries");
+}
+
+int StructureBoxModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_boxes.size();
+}
+
+QVariant StructureBoxModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_boxes.size())
+        return QVariant();
+
+    const Box &box = m_boxes.at(index.row());
+    switch (role) {
+    case NameRole:
+        return box.name;
+    case SceneCountRole:
+        return box.sceneIndexes.size();
+    case SceneIndexesRole: {
+        QVariantList ret;
+        ret.reserve(box.sceneIndexes.size());
+        for (int sceneIndex : box.sceneIndexes)
+            ret << sceneIndex;
+        return ret;
+    }
+    case GeometryRole:
+        return box.geometry;
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> StructureBoxModel::roleNames() const
+{
+    return { { NameRole, QByteArrayLiteral("name") },
+             { SceneCountRole, QByteArrayLiteral("sceneCount") },
+             { SceneIndexesRole, QByteArrayLiteral("sceneIndexes") },
+             { GeometryRole, QByteArrayLiteral("geometry") } };
+}
+
+void StructureBoxModel::setup(Structure *structure, BoxType boxType)
+{
+    m_structure = structure;
+    m_boxType = boxType;
+
+    connect(m_structure, &Structure::elementsChanged, this, &StructureBoxModel::refreshLater);
+    if (m_boxType == GroupBoxes)
+        connect(m_structure, &Structure::preferredGroupCategoryChanged, this,
+                &StructureBoxModel::refreshLater);
+
+    ScriteDocument *document = m_structure->scriteDocument();
+    if (document != nullptr) {
+        connect(document, &ScriteDocument::loadingChanged, this,
+                &StructureBoxModel::refreshLater);
+
+        Screenplay *screenplay = document->screenplay();
+        if (screenplay != nullptr) {
+            connect(screenplay, &Screenplay::elementsChanged, this,
+                    &StructureBoxModel::refreshLater);
+            connect(screenplay, &Screenplay::breakTitleChanged, this,
+                    &StructureBoxModel::refreshLater);
+            connect(screenplay, &Screenplay::elementSceneGroupsChanged, this,
+                    &StructureBoxModel::refreshLater);
+            connect(screenplay, &Screenplay::episodeCountChanged, this,
+                    &StructureBoxModel::refreshLater);
+        }
+    }
+
+    this->refreshLater();
+}
+
+void StructureBoxModel::refreshLater()
+{
+    // Screenplay evaluates episode and act indexes of its elements lazily, box
+    // membership must be evaluated only after that.
+    DeferredWorkScheduler::instance()->schedule(this, "StructureBoxModel.refresh",
+                                                DeferredWorkScheduler::NormalPriority, 250,
+                                                [=]() { this->refresh(); });
+}
+
+void StructureBoxModel::refresh()
+{
+    DeferredWorkScheduler::instance()->cancel(this, "StructureBoxModel.refresh");
+    DeferredWorkScheduler::instance()->cancel(this, "StructureBoxModel.updateGeometries");
+    m_dirtyRows.clear();
+
+    ScriteDocument *document = m_structure ? m_structure->scriteDocument() : nullptr;
+    Screenplay *screenplay = document ? document->screenplay() : nullptr;
+
+    QList<QPair<QString, QList<StructureElement *>>> items;
+    if (screenplay != nullptr && !document->isLoading())
+        items = m_boxType == EpisodeBoxes
+                ? m_structure->evaluateEpisodesImpl(screenplay)
+                : m_structure->evaluateGroupsImpl(screenplay,
+                                                  m_structure->preferredGroupCategory());
+
+    QHash<StructureElement *, int> elementIndexMap;
+    if (!items.isEmpty()) {
+        for (int i = 0; i < m_structure->elementCount(); i++)
+            elementIndexMap.insert(m_structure->elementAt(i), i);
+    }
+
+    QList<Box> boxes;
+    boxes.reserve(items.size());
+    for (const QPair<QString, QList<StructureElement *>> &item : qAsConst(items)) {
+        if (item.second.isEmpty())
+            continue;
+
+        Box box;
+        box.name = item.first;
+        box.elements = item.second;
+        box.geometry = evaluateGeometry(box.elements);
+        for (StructureElement *element : qAsConst(box.elements))
+            box.sceneIndexes << elementIndexMap.value(element, -1);
+        boxes << box;
+    }
+
+    // Rows common to both lists are updated in place, so that only rows whose data
+    // actually changed are reported.
+    const int oldCount = m_boxes.size();
+    const int newCount = boxes.size();
+
+    if (newCount < oldCount) {
+        this->beginRemoveRows(QModelIndex(), newCount, oldCount - 1);
+        m_boxes.erase(m_boxes.begin() + newCount, m_boxes.end());
+        this->endRemoveRows();
+    }
+
+    for (int i = 0; i < qMin(oldCount, newCount); i++) {
+        Box &box = m_boxes[i];
+        const Box &newBox = boxes.at(i);
+
+        QVector<int> roles;
+        if (box.name != newBox.name)
+            roles << NameRole;
+        if (box.sceneIndexes != newBox.sceneIndexes)
+            roles << SceneCountRole << SceneIndexesRole;
+        if (box.geometry != newBox.geometry)
+            roles << GeometryRole;
+
+        box = newBox;
+
+        if (!roles.isEmpty()) {
+            const QModelIndex index = this->index(i);
+            emit dataChanged(index, index, roles);
+        }
+    }
+
+    if (newCount > oldCount) {
+        this->beginInsertRows(QModelIndex(), oldCount, newCount - 1);
+        for (int i = oldCount; i < newCount; i++)
+            m_boxes << boxes.at(i);
+        this->endInsertRows();
+    }
+
+    QHash<StructureElement *, QList<int>> elementRows;
+    for (int i = 0; i < m_boxes.size(); i++) {
+        for (StructureElement *element : qAsConst(m_boxes.at(i).elements)) {
+            QList<int> &rows = elementRows[element];
+            if (rows.isEmpty() || rows.last() != i)
+                rows << i;
+        }
+    }
+
+    for (auto it = m_elementRows.constBegin(); it != m_elementRows.constEnd(); ++it) {
+        if (!elementRows.contains(it.key()))
+            disconnect(it.key(), nullptr, this, nullptr);
+    }
+
+    for (auto it = elementRows.constBegin(); it != elementRows.constEnd(); ++it) {
+        if (m_elementRows.contains(it.key()))
+            continue;
+
+        connect(it.key(), &StructureElement::geometryChanged, this,
+                &StructureBoxModel::onElementGeometryChanged);
+        connect(it.key(), &StructureElement::aboutToDelete, this,
+                &StructureBoxModel::onElementAboutToDelete);
+    }
+
+    m_elementRows = elementRows;
+
+    if (oldCount != newCount)
+        emit countChanged();
+}
+
+void StructureBoxModel::onElementGeometryChanged()
+{
+    StructureElement *element = qobject_cast<StructureElement *>(this->sender());
+    const QList<int> rows = m_elementRows.value(element);
+    if (rows.isEmpty())
+        return;
+
+    for (int row : rows) {
+        if (!m_dirtyRows.contains(row))
+            m_dirtyRows << row;
+    }
+
+    DeferredWorkScheduler::instance()->schedule(this, "StructureBoxModel.updateGeometries",
+                                                DeferredWorkScheduler::NormalPriority, 0,
+                                                [=]() { this->updateGeometries(); });
+}
+
+void StructureBoxModel::onElementAboutToDelete(StructureElement *element)
+{
+    const QList<int> rows = m_elementRows.take(element);
+    for (int row : rows) {
+        m_boxes[row].elements.removeAll(element);
+        if (!m_dirtyRows.contains(row))
+            m_dirtyRows << row;
+    }
+
+    this->refreshLater();
+}
+
+void StructureBoxModel::updateGeometries()
+{
+    const QList<int> rows = m_dirtyRows;
+    m_dirtyRows.clear();
+
+    for (int row : rows) {
+        if (row < 0 || row >= m_boxes.size())
+            continue;
+
+        Box &box = m_boxes[row];
+        const QRectF geometry = evaluateGeometry(box.elements);
+        if (geometry == box.geometry)
+            continue;
+
+        box.geometry = geometry;
+
+        const QModelIndex index = this->index(row);
+        emit dataChanged(index, index, { GeometryRole });
+    }
+}
+
+QRectF StructureBoxModel::evaluateGeometry(const QList<StructureElement *> &elements)
+{
+    QRectF ret;
+    for (StructureElement *element : elements)
+        ret |= element->geometry();
+    return ret;
+}
@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef STRUCTUREBOXMODEL_H
+#define STRUCTUREBOXMODEL_H
+
+#include <QHash>
+#include <QRectF>
+#include <QQmlEngine>
+#include <QAbstractListModel>
+
+class Structure;
+class StructureElement;
+
+/**
+ * Bounding boxes of episodes, or of groups (acts or beats of the preferred group category),
+ * drawn behind index cards on the structure canvas. Which cards belong to which box is
+ * re-evaluated once after a batch of screenplay or structure changes. When a card is
+ * moved or resized, only the geometry of boxes containing that card is updated. Changes
+ * are reported per row, so delegates are not re-created.
+ */
+class StructureBoxModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Instantiation from QML not allowed.")
+
+public:
+    explicit StructureBoxModel(QObject *parent = nullptr);
+    ~StructureBoxModel();
+
+    enum BoxType { EpisodeBoxes, GroupBoxes };
+    Q_ENUM(BoxType)
+
+    Q_PROPERTY(BoxType boxType READ boxType CONSTANT)
+    BoxType boxType() const { return m_boxType; }
+
+    Q_PROPERTY(Structure *structure READ structure CONSTANT)
+    Structure *structure() const { return m_structure; }
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    int count() const { return m_boxes.size(); }
+    Q_SIGNAL void countChanged();
+
+    // Carries out pending updates, if any, right away.
+    Q_INVOKABLE void refreshNow();
+
+    // QAbstractItemModel interface
+    enum Roles { NameRole = Qt::UserRole, SceneCountRole, SceneIndexesRole, GeometryRole };
+    int rowCount(const QModelIndex &parent) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QHash<int, QByteArray> roleNames() const;
+
+private:
+    friend class Structure;
+    void setup(Structure *structure, BoxType boxType);
+    void refreshLater();
+    void refresh();
+    void onElementGeometryChanged();
+    void onElementAboutToDelete(StructureElement *element);
+    void updateGeometries();
+
+    struct Box
+    {
+        QString name;
+        QList<StructureElement *> elements;
+        QList<int> sceneIndexes; // of elements, in the structure
+        QRectF geometry;
+    };
+    static QRectF evaluateGeometry(const QList<StructureElement *> &elements);
+
+private:
+    BoxType m_boxType = GroupBoxes;
+    Structure *m_structure = nullptr;
+    QList<Box> m_boxes;
+    QHash<StructureElement *, QList<int>> m_elementRows;
+    QList<int> m_dirtyRows;
+};
+
+#endif // STRUCTUREBOXMODEL_H
@@ -14,10 +14,8 @@
 #include "finaldraftexporter.h"
 #include "application.h"
 
-#include <QDomDocument>
-#include <QDomElement>
-#include <QDomAttr>
 #include <QFileInfo>
+#include <QXmlStreamWriter>
 
 FinalDraftExporter::FinalDraftExporter(QObject *parent) : AbstractExporter(parent) { }
 
@@ -67,40 +65,48 @@ bool FinalDraftExporter::doExport(QIODevice *device)
 
     this->progress()->setProgressStep(1.0 / qreal(nrElements + 1));
 
-    QDomDocument doc;
-
-    QDomElement rootE = doc.createElement(QStringLiteral("FinalDraft"));
-    rootE.setAttribute(QStringLiteral("DocumentType"), QStringLiteral("Script"));
-    rootE.setAttribute(QStringLiteral("Template"), QStringLiteral("No"));
-    rootE.setAttribute(QStringLiteral("Version"), QStringLiteral("2"));
-    doc.appendChild(rootE);
-
-    QDomElement contentE = doc.createElement(QStringLiteral("Content"));
-    rootE.appendChild(contentE);
-
-    auto addTextToParagraph = [&doc, this](QDomElement &paraE, const QString &text,
-                                           Qt::Alignment overrideAlignment = Qt::Alignment(),
-                                           const QVector<QTextLayout::FormatRange> &textFormats =
-                                                   QVector<QTextLayout::FormatRange>()) {
-        if (overrideAlignment != 0) {
-            const QString alignmentAttr = QStringLiteral("Alignment");
-            switch (overrideAlignment) {
-            default:
-            case Qt::AlignLeft:
-                paraE.setAttribute(alignmentAttr, QStringLiteral("Left"));
-                break;
-            case Qt::AlignRight:
-                paraE.setAttribute(alignmentAttr, QStringLiteral("Right"));
-                break;
-            case Qt::AlignHCenter:
-                paraE.setAttribute(alignmentAttr, QStringLiteral("Center"));
-                break;
-            case Qt::AlignJustify:
-                paraE.setAttribute(alignmentAttr, QStringLiteral("Justify"));
-                break;
-            }
+    /**
+     * Paragraphs are written out as scenes are visited, so the whole document is never
+     * held in memory, no matter how large the screenplay is.
+     */
+    QXmlStreamWriter writer(device);
+    writer.setCodec("utf-8");
+    writer.setAutoFormatting(true);
+    writer.setAutoFormattingIndent(2);
+    writer.writeStartDocument(QStringLiteral("1.0"), false);
+
+    writer.writeStartElement(QStringLiteral("FinalDraft"));
+    writer.writeAttribute(QStringLiteral("DocumentType"), QStringLiteral("Script"));
+    writer.writeAttribute(QStringLiteral("Template"), QStringLiteral("No"));
+    writer.writeAttribute(QStringLiteral("Version"), QStringLiteral("2"));
+
+    writer.writeStartElement(QStringLiteral("Content"));
+
+    auto writeAlignment = [&writer](Qt::Alignment alignment) {
+        if (alignment == 0)
+            return;
+
+        const QString alignmentAttr = QStringLiteral("Alignment");
+        switch (alignment) {
+        default:
+        case Qt::AlignLeft:
+            writer.writeAttribute(alignmentAttr, QStringLiteral("Left"));
+            break;
+        case Qt::AlignRight:
+            writer.writeAttribute(alignmentAttr, QStringLiteral("Right"));
+            break;
+        case Qt::AlignHCenter:
+            writer.writeAttribute(alignmentAttr, QStringLiteral("Center"));
+            break;
+        case Qt::AlignJustify:
+            writer.writeAttribute(alignmentAttr, QStringLiteral("Justify"));
+            break;
         }
+    };
 
+    auto writeTexts = [&writer, this](const QString &text,
+                                      const QVector<QTextLayout::FormatRange> &textFormats =
+                                              QVector<QTextLayout::FormatRange>()) {
         QVector<QTextLayout::FormatRange> mergedTextFormats = textFormats;
         if (m_markLanguagesExplicitly) {
             const QList<TransliterationEngine::Boundary> breakup =
@@ -108,97 +114,93 @@ bool FinalDraftExporter::doExport(QIODevice *device)
             mergedTextFormats = TransliterationEngine::mergeTextFormats(breakup, textFormats);
         }
 
-        auto createTextElement = [&]() {
-            QDomElement textE = doc.createElement(QStringLiteral("Text"));
-            textE.setAttribute(QStringLiteral("Font"), QStringLiteral("Courier Final Draft"));
-            textE.setAttribute(QStringLiteral("Language"), QStringLiteral("English"));
-            paraE.appendChild(textE);
-            return textE;
+        auto writeTextElementStart = [&writer](const QString &font, const QString &language) {
+            writer.writeStartElement(QStringLiteral("Text"));
+            writer.writeAttribute(QStringLiteral("Font"), font);
+            writer.writeAttribute(QStringLiteral("Language"), language);
         };
 
+        const QString defaultFont = QStringLiteral("Courier Final Draft");
+        const QString defaultLanguage = QStringLiteral("English");
+
         if (mergedTextFormats.isEmpty()) {
-            QDomElement textE = createTextElement();
-            textE.appendChild(doc.createTextNode(text));
-        } else {
-            for (const QTextLayout::FormatRange &format : qAsConst(mergedTextFormats)) {
-                const QString snippet = text.mid(format.start, format.length);
-                if (snippet.isEmpty())
-                    continue;
-
-                QDomElement textE = createTextElement();
-
-                QStringList styles;
-                if (format.format.hasProperty(QTextFormat::FontWeight)) {
-                    if (format.format.fontWeight() == QFont::Bold)
-                        styles << QStringLiteral("Bold");
-                }
+            writeTextElementStart(defaultFont, defaultLanguage);
+            writer.writeCharacters(text);
+            writer.writeEndElement();
+            return;
+        }
 
-                if (format.format.hasProperty(QTextFormat::FontItalic)) {
-                    if (format.format.fontItalic())
-                        styles << QStringLiteral("Italic");
+        for (const QTextLayout::FormatRange &format : qAsConst(mergedTextFormats)) {
+            const QString snippet = text.mid(format.start, format.length);
+            if (snippet.isEmpty())
+                continue;
+
+            QString font = defaultFont;
+            QString language = defaultLanguage;
+            if (m_markLanguagesExplicitly) {
+                TransliterationEngine::Language lang =
+                        (TransliterationEngine::Language)format.format
+                                .property(QTextFormat::UserProperty)
+                                .toInt();
+                if (lang != TransliterationEngine::English) {
+                    font = TransliterationEngine::instance()
+                                   ->languageFont(lang, m_useScriteFonts)
+                                   .family();
+                    language = TransliterationEngine::instance()->languageAsString(lang);
                 }
+            }
 
-                if (format.format.hasProperty(QTextFormat::TextUnderlineStyle)) {
-                    if (format.format.fontUnderline())
-                        styles << QStringLiteral("Underline");
-                }
+            writeTextElementStart(font, language);
+
+            QStringList styles;
+            if (format.format.hasProperty(QTextFormat::FontWeight)) {
+                if (format.format.fontWeight() == QFont::Bold)
+                    styles << QStringLiteral("Bold");
+            }
 
-                if (!styles.isEmpty())
-                    textE.setAttribute(QStringLiteral("Style"), styles.join('+'));
+            if (format.format.hasProperty(QTextFormat::FontItalic)) {
+                if (format.format.fontItalic())
+                    styles << QStringLiteral("Italic");
+            }
 
-                if (format.format.hasProperty(QTextFormat::BackgroundBrush)) {
-                    const QColor color = format.format.background().color();
-                    textE.setAttribute(QStringLiteral("Background"), fdxColorCode(color));
-                }
+            if (format.format.hasProperty(QTextFormat::TextUnderlineStyle)) {
+                if (format.format.fontUnderline())
+                    styles << QStringLiteral("Underline");
+            }
 
-                if (format.format.hasProperty(QTextFormat::ForegroundBrush)) {
-                    const QColor color = format.format.foreground().color();
-                    textE.setAttribute(QStringLiteral("Color"), fdxColorCode(color));
-                }
+            if (!styles.isEmpty())
+                writer.writeAttribute(QStringLiteral("Style"), styles.join('+'));
 
-                if (m_markLanguagesExplicitly) {
-                    TransliterationEngine::Language lang =
-                            (TransliterationEngine::Language)format.format
-                                    .property(QTextFormat::UserProperty)
-                                    .toInt();
-                    if (lang != TransliterationEngine::English) {
-                        const QFont font = TransliterationEngine::instance()->languageFont(
-                                lang, m_useScriteFonts);
-                        textE.setAttribute(QStringLiteral("Font"), font.family());
-                        textE.setAttribute(
-                                QStringLiteral("Language"),
-                                TransliterationEngine::instance()->languageAsString(lang));
-                    }
-                }
+            if (format.format.hasProperty(QTextFormat::BackgroundBrush)) {
+                const QColor color = format.format.background().color();
+                writer.writeAttribute(QStringLiteral("Background"), fdxColorCode(color));
+            }
 
-                textE.appendChild(doc.createTextNode(snippet));
+            if (format.format.hasProperty(QTextFormat::ForegroundBrush)) {
+                const QColor color = format.format.foreground().color();
+                writer.writeAttribute(QStringLiteral("Color"), fdxColorCode(color));
             }
+
+            writer.writeCharacters(snippet);
+            writer.writeEndElement();
         }
     };
 
-    QStringList locations;
     for (int i = 0; i < nrElements; i++) {
         const ScreenplayElement *element = screenplay->elementAt(i);
         if (element->elementType() != ScreenplayElement::SceneElementType)
             continue;
 
-        QDomElement paragraphContainerE = contentE;
         if (element->isOmitted()) {
-            QDomElement paragraphE = doc.createElement(QStringLiteral("Paragraph"));
-            contentE.appendChild(paragraphE);
-
-            paragraphE.setAttribute(QStringLiteral("Type"), QStringLiteral("Scene Heading"));
+            writer.writeStartElement(QStringLiteral("Paragraph"));
+            writer.writeAttribute(QStringLiteral("Type"), QStringLiteral("Scene Heading"));
             if (element->hasUserSceneNumber())
-                paragraphE.setAttribute(QStringLiteral("Number"), element->userSceneNumber());
-
-            QDomElement textE = doc.createElement(QStringLiteral("Text"));
-            textE.appendChild(doc.createTextNode(QStringLiteral("OMITTED")));
-            paragraphE.appendChild(textE);
+                writer.writeAttribute(QStringLiteral("Number"), element->userSceneNumber());
 
-            QDomElement omittedSceneE = doc.createElement(QStringLiteral("OmittedScene"));
-            paragraphE.appendChild(omittedSceneE);
+            writer.writeTextElement(QStringLiteral("Text"), QStringLiteral("OMITTED"));
 
-            paragraphContainerE = omittedSceneE;
+            // Paragraphs of the scene go inside, closed after the scene is written
+            writer.writeStartElement(QStringLiteral("OmittedScene"));
         }
 
         const Scene *scene = element->scene();
@@ -207,16 +209,13 @@ bool FinalDraftExporter::doExport(QIODevice *device)
 
         if (heading->isEnabled() || scene->hasSynopsis()
             || (selement && selement->hasNativeTitle())) {
-            QDomElement paragraphE = doc.createElement(QStringLiteral("Paragraph"));
-            paragraphContainerE.appendChild(paragraphE);
-
-            paragraphE.setAttribute(QStringLiteral("Type"), QStringLiteral("Scene Heading"));
+            writer.writeStartElement(QStringLiteral("Paragraph"));
+            writer.writeAttribute(QStringLiteral("Type"), QStringLiteral("Scene Heading"));
             if (element->hasUserSceneNumber())
-                paragraphE.setAttribute(QStringLiteral("Number"), element->userSceneNumber());
+                writer.writeAttribute(QStringLiteral("Number"), element->userSceneNumber());
 
             if (heading->isEnabled()) {
-                addTextToParagraph(paragraphE, heading->text());
-                locations.append(heading->location());
+                writeTexts(heading->text());
 
                 if (!locationTypes.contains(heading->locationType()))
                     locationTypes.append(heading->locationType());
@@ -226,10 +225,9 @@ bool FinalDraftExporter::doExport(QIODevice *device)
             }
 
             if (scene->hasSynopsis() || (selement && selement->hasNativeTitle())) {
-                QDomElement scenePropsE = doc.createElement(QStringLiteral("SceneProperties"));
-                paragraphE.appendChild(scenePropsE);
+                writer.writeStartElement(QStringLiteral("SceneProperties"));
                 if (selement && selement->hasNativeTitle())
-                    scenePropsE.setAttribute(QStringLiteral("Title"), selement->nativeTitle());
+                    writer.writeAttribute(QStringLiteral("Title"), selement->nativeTitle());
 
                 const QColor sceneColor = scene->color();
                 const QColor tintColor(QStringLiteral("#E7FFFFFF"));
@@ -239,95 +237,74 @@ bool FinalDraftExporter::doExport(QIODevice *device)
                                          (sceneColor.blueF() + tintColor.blueF()) / 2,
                                          (sceneColor.alphaF() + tintColor.alphaF()) / 2);
 
-                scenePropsE.setAttribute(QStringLiteral("Color"), fdxColorCode(exportSceneColor));
+                writer.writeAttribute(QStringLiteral("Color"), fdxColorCode(exportSceneColor));
 
                 if (scene->hasSynopsis()) {
-                    QDomElement summaryE = doc.createElement(QStringLiteral("Summary"));
-                    scenePropsE.appendChild(summaryE);
-
-                    QDomElement summaryParagraphE = doc.createElement(QStringLiteral("Paragraph"));
-                    summaryE.appendChild(summaryParagraphE);
+                    writer.writeStartElement(QStringLiteral("Summary"));
+                    writer.writeStartElement(QStringLiteral("Paragraph"));
 
-                    const QString synopsis = scene->synopsis();
-                    QVector<QTextLayout::FormatRange> formats;
-
-#if 0
                     // We don't need to apply scene color to synopsis text also.
+                    writeTexts(scene->synopsis());
 
-                    QTextLayout::FormatRange format;
-                    format.start = 0;
-                    format.length = synopsis.length();
-                    format.format.setBackground(exportSceneColor);
-                    format.format.setForeground(Application::textColorFor(exportSceneColor));
-                    formats.append(format);
-#endif
-                    addTextToParagraph(summaryParagraphE, synopsis, Qt::Alignment(), formats);
+                    writer.writeEndElement(); // Paragraph
+                    writer.writeEndElement(); // Summary
                 }
+
+                writer.writeEndElement(); // SceneProperties
             }
+
+            writer.writeEndElement(); // Paragraph
         }
 
         const int nrSceneElements = scene->elementCount();
         for (int j = 0; j < nrSceneElements; j++) {
             const SceneElement *sceneElement = scene->elementAt(j);
-            QDomElement paragraphE = doc.createElement(QStringLiteral("Paragraph"));
-            paragraphContainerE.appendChild(paragraphE);
+            writer.writeStartElement(QStringLiteral("Paragraph"));
+            writer.writeAttribute(QStringLiteral("Type"), sceneElement->typeAsString());
+            writeAlignment(sceneElement->alignment());
+            writeTexts(sceneElement->formattedText(), sceneElement->textFormats());
+            writer.writeEndElement();
+        }
 
-            paragraphE.setAttribute(QStringLiteral("Type"), sceneElement->typeAsString());
-            addTextToParagraph(paragraphE, sceneElement->formattedText(), sceneElement->alignment(),
-                               sceneElement->textFormats());
+        if (element->isOmitted()) {
+            writer.writeEndElement(); // OmittedScene
+            writer.writeEndElement(); // Paragraph
         }
 
         this->progress()->tick();
     }
 
-    QDomElement watermarkingE = doc.createElement(QStringLiteral("Watermarking"));
-    rootE.appendChild(watermarkingE);
-    watermarkingE.setAttribute(QStringLiteral("Text"), qApp->applicationName());
+    writer.writeEndElement(); // Content
 
-    QDomElement smartTypeE = doc.createElement("SmartType");
-    rootE.appendChild(smartTypeE);
+    writer.writeStartElement(QStringLiteral("Watermarking"));
+    writer.writeAttribute(QStringLiteral("Text"), qApp->applicationName());
+    writer.writeEndElement();
 
-    const QStringList characters = structure->allCharacterNames();
-    QDomElement charactersE = doc.createElement(QStringLiteral("Characters"));
-    smartTypeE.appendChild(charactersE);
-    for (const QString &name : qAsConst(characters)) {
-        QDomElement characterE = doc.createElement(QStringLiteral("Character"));
-        charactersE.appendChild(characterE);
-        characterE.appendChild(doc.createTextNode(name));
-    }
+    writer.writeStartElement(QStringLiteral("SmartType"));
 
-    locations.removeDuplicates();
-    std::sort(locations.begin(), locations.end());
+    const QStringList characters = structure->allCharacterNames();
+    writer.writeStartElement(QStringLiteral("Characters"));
+    for (const QString &name : qAsConst(characters))
+        writer.writeTextElement(QStringLiteral("Character"), name);
+    writer.writeEndElement();
 
-    QDomElement timesOfDayE = doc.createElement(QStringLiteral("TimesOfDay"));
-    smartTypeE.appendChild(timesOfDayE);
-    timesOfDayE.setAttribute(QStringLiteral("Separator"), QStringLiteral(" - "));
+    writer.writeStartElement(QStringLiteral("TimesOfDay"));
+    writer.writeAttribute(QStringLiteral("Separator"), QStringLiteral(" - "));
     std::sort(moments.begin(), moments.end());
-    for (const QString &moment : qAsConst(moments)) {
-        QDomElement timeOfDayE = doc.createElement(QStringLiteral("TimeOfDay"));
-        timesOfDayE.appendChild(timeOfDayE);
-        timeOfDayE.appendChild(doc.createTextNode(moment));
-    }
+    for (const QString &moment : qAsConst(moments))
+        writer.writeTextElement(QStringLiteral("TimeOfDay"), moment);
+    writer.writeEndElement();
 
     std::sort(locationTypes.begin(), locationTypes.end());
-    QDomElement sceneIntrosE = doc.createElement(QStringLiteral("SceneIntros"));
-    smartTypeE.appendChild(sceneIntrosE);
-    sceneIntrosE.setAttribute(QStringLiteral("Separator"), QStringLiteral(". "));
-    for (const QString &locationType : qAsConst(locationTypes)) {
-        QDomElement sceneIntroE = doc.createElement(QStringLiteral("SceneIntro"));
-        sceneIntrosE.appendChild(sceneIntroE);
-        sceneIntroE.appendChild(doc.createTextNode(locationType));
-    }
-
-    const QString xml = doc.toString(2);
-
-    QTextStream ts(device);
-    ts.setCodec("utf-8");
-    ts.setAutoDetectUnicode(true);
+    writer.writeStartElement(QStringLiteral("SceneIntros"));
+    writer.writeAttribute(QStringLiteral("Separator"), QStringLiteral(". "));
+    for (const QString &locationType : qAsConst(locationTypes))
+        writer.writeTextElement(QStringLiteral("SceneIntro"), locationType);
+    writer.writeEndElement();
 
-    ts << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
-    ts << xml;
-    ts.flush();
+    writer.writeEndElement(); // SmartType
+    writer.writeEndElement(); // FinalDraft
+    writer.writeEndDocument();
 
-    return true;
+    return !writer.hasError();
 }
@@ -202,6 +202,7 @@ bool PdfExporter::doExport(QIODevice *device)
 
     QTextDocumentPagedPrinter printer;
     printer.setSideBar(&sideBar);
+    printer.setPipelined(true);
     printer.header()->setVisibleFromPageOne(!m_generateTitlePage);
     printer.footer()->setVisibleFromPageOne(!m_generateTitlePage);
     printer.watermark()->setVisibleFromPageOne(!m_generateTitlePage);
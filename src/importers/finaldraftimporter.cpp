@@ -11,12 +11,11 @@
 **
 ****************************************************************************/
 
+
 #include "finaldraftimporter.h"
 #include "application.h"
 
-#include <QXmlSimpleReader>
-
-static void fixOmittedScenes(QDomElement &contentE);
+#include <QXmlStreamReader>
 
 FinalDraftImporter::FinalDraftImporter(QObject *parent) : AbstractImporter(parent) { }
 
@@ -37,284 +36,288 @@ static QColor fromFdxColorCode(const QString &code)
     return QColor(code.mid(0, 1) + red + green + blue);
 }
 
-bool FinalDraftImporter::doImport(QIODevice *device)
+static void readTextElement(QXmlStreamReader &reader, QString &text,
+                            QVector<QTextLayout::FormatRange> &formats)
 {
-    QString errMsg;
-    int errLine = -1;
-    int errCol = -1;
+    const QXmlStreamAttributes attributes = reader.attributes();
+
+    QTextLayout::FormatRange format;
+    format.start = text.length();
+
+    // Unlike QDomDocument, QXmlStreamReader retains text made up of only spaces, which
+    // is what we want.
+    text += reader.readElementText(QXmlStreamReader::IncludeChildElements);
+
+    format.length = text.length() - format.start;
+
+    const QStringList styles =
+            attributes.value(QStringLiteral("Style")).toString().split(QChar('+'));
+    if (styles.contains(QStringLiteral("Bold")))
+        format.format.setFontWeight(QFont::Bold);
+    if (styles.contains(QStringLiteral("Italic")))
+        format.format.setFontItalic(true);
+    if (styles.contains(QStringLiteral("Underline")))
+        format.format.setFontUnderline(true);
+
+    const QString colorAttr = QStringLiteral("Color");
+    const QString backgroundAttr = QStringLiteral("Background");
+    if (attributes.hasAttribute(colorAttr))
+        format.format.setForeground(
+                QBrush(fromFdxColorCode(attributes.value(colorAttr).toString())));
+    if (attributes.hasAttribute(backgroundAttr))
+        format.format.setBackground(
+                QBrush(fromFdxColorCode(attributes.value(backgroundAttr).toString())));
+
+    if (!format.format.isEmpty())
+        formats.append(format);
+}
 
+static QString readParagraphText(QXmlStreamReader &reader)
+{
+    QString text;
+    QVector<QTextLayout::FormatRange> formats;
+    while (reader.readNextStartElement()) {
+        if (reader.name() == QLatin1String("Text"))
+            readTextElement(reader, text, formats);
+        else
+            reader.skipCurrentElement();
+    }
+
+    return text;
+}
+
+bool FinalDraftImporter::doImport(QIODevice *device)
+{
     /**
-     * We cannot use QDomDocument::setContent(QIODevice*, QString*, int*, int*)
-     * because DOM Elements with spaces will be read as empty strings, instead of
-     * actual number of spaces. This is obviously a problem for us.
-     *
-     * The only way to address that is to actually use a QXmlInputSource over the
-     * QIODevice, and then parse that using QXmlSimpleReader instance.
-     *
-     * In Qt 5.15, QXmlInputSource and QXmlSimpleReader classes are depricated.
-     * But until we can find a replacement that also parses spaces properly,
-     * we will have to simply use these deprecated classes.
+     * The file is read as a stream, and scenes are created as their paragraphs are read.
+     * So the whole document is never held in memory, no matter how large the script is.
      */
+    QXmlStreamReader reader(device);
+
+    // A parse error can show up after several scenes have been created from paragraphs
+    // read so far. Those scenes are removed, so that a broken file imports nothing.
+    Screenplay *screenplay = this->document()->screenplay();
+    Structure *structure = this->document()->structure();
+    const int screenplayElementCount = screenplay->elementCount();
+    const int structureElementCount = structure->elementCount();
+
+    auto reportParseError = [&reader, screenplay, structure, screenplayElementCount,
+                             structureElementCount, this]() {
+        while (screenplay->elementCount() > screenplayElementCount)
+            screenplay->removeElement(screenplay->elementAt(screenplay->elementCount() - 1));
+        while (structure->elementCount() > structureElementCount)
+            structure->removeElement(structure->elementAt(structure->elementCount() - 1));
 
-    QXmlInputSource xmlInputSource(device);
-    QXmlSimpleReader xmlParser;
-
-    QDomDocument doc;
-    if (!doc.setContent(&xmlInputSource, &xmlParser, &errMsg, &errLine, &errCol)) {
         const QString msg = QStringLiteral("Parse Error: %1 at Line %2, Column %3")
-                                    .arg(errMsg)
-                                    .arg(errLine)
-                                    .arg(errCol);
+                                    .arg(reader.errorString())
+                                    .arg(reader.lineNumber())
+                                    .arg(reader.columnNumber());
         this->error()->setErrorMessage(msg);
         return false;
-    }
+    };
+
+    if (!reader.readNextStartElement()) {
+        if (reader.hasError())
+            return reportParseError();
 
-    QDomElement rootE = doc.documentElement();
-    if (rootE.tagName() != QStringLiteral("FinalDraft")) {
         this->error()->setErrorMessage("Not a Final-Draft file.");
         return false;
     }
 
-    const int fdxVersion = rootE.attribute("Version").toInt();
-    if (rootE.attribute("DocumentType") != QStringLiteral("Script") || fdxVersion < 1
-        || fdxVersion > 5) {
-        this->error()->setErrorMessage("Unrecognised Final Draft file version.");
+    if (reader.name() != QLatin1String("FinalDraft")) {
+        this->error()->setErrorMessage("Not a Final-Draft file.");
         return false;
     }
 
-    QDomElement contentE = rootE.firstChildElement(QStringLiteral("Content"));
-    QDomNodeList paragraphs = contentE.elementsByTagName(QStringLiteral("Paragraph"));
-    if (paragraphs.isEmpty()) {
-        this->error()->setErrorMessage(QStringLiteral("No paragraphs to import."));
+    const QXmlStreamAttributes rootAttributes = reader.attributes();
+    const int fdxVersion = rootAttributes.value(QStringLiteral("Version")).toInt();
+    if (rootAttributes.value(QStringLiteral("DocumentType")) != QLatin1String("Script")
+        || fdxVersion < 1 || fdxVersion > 5) {
+        this->error()->setErrorMessage("Unrecognised Final Draft file version.");
         return false;
     }
 
-    ::fixOmittedScenes(contentE);
+    // The number of paragraphs is not known up front, so progress is reported in terms
+    // of how much of the file has been read.
+    const qint64 deviceSize = device->size();
+    const qint64 progressInterval = qMax(deviceSize / 100, qint64(1));
+    qint64 nextProgressPos = progressInterval;
+    this->progress()->setProgressStep(0.01);
 
     Scene *scene = nullptr;
-    this->progress()->setProgressStep(1.0 / qreal(paragraphs.size() + 1));
-    this->configureCanvas(paragraphs.size());
-
-    auto parseParagraphTexts =
-            [](const QDomElement &paragraphE) -> QPair<QString, QVector<QTextLayout::FormatRange>> {
-        QVector<QTextLayout::FormatRange> formats;
-        QString text;
-        if (paragraphE.isNull())
-            return qMakePair(text, formats);
-
-        const QString textN = QStringLiteral("Text");
-        QDomElement textE = paragraphE.firstChildElement(textN);
-        while (!textE.isNull()) {
-            QTextLayout::FormatRange format;
-            format.start = text.length();
-
-            const QString textEText = textE.text();
-            text += textEText;
-
-            format.length = text.length() - format.start;
-
-            const QStringList styles = textE.attribute(QStringLiteral("Style")).split(QChar('+'));
-            if (styles.contains(QStringLiteral("Bold")))
-                format.format.setFontWeight(QFont::Bold);
-            if (styles.contains(QStringLiteral("Italic")))
-                format.format.setFontItalic(true);
-            if (styles.contains(QStringLiteral("Underline")))
-                format.format.setFontUnderline(true);
-
-            const QString colorAttr = QStringLiteral("Color");
-            const QString backgroundAttr = QStringLiteral("Background");
-            if (textE.hasAttribute(colorAttr))
-                format.format.setForeground(QBrush(fromFdxColorCode(textE.attribute(colorAttr))));
-            if (textE.hasAttribute(backgroundAttr))
-                format.format.setBackground(
-                        QBrush(fromFdxColorCode(textE.attribute(backgroundAttr))));
-
-            if (!format.format.isEmpty())
-                formats.append(format);
-
-            textE = textE.nextSiblingElement(textN);
-        }
-
-        return qMakePair(text, formats);
-    };
+    int nrParagraphs = 0;
 
-    const QStringList types({ QStringLiteral("Scene Heading"), QStringLiteral("Action"),
-                              QStringLiteral("Character"), QStringLiteral("Dialogue"),
-                              QStringLiteral("Parenthetical"), QStringLiteral("Shot"),
-                              QStringLiteral("Transition") });
     const QString paragraphName = QStringLiteral("Paragraph");
-    QDomElement paragraphE = contentE.firstChildElement(paragraphName);
-    while (!paragraphE.isNull()) {
-        TraverseDomElement tde(paragraphE, this->progress());
-
-        const QString flags = paragraphE.attribute(QStringLiteral("Flags"));
-        if (flags == "Ignore")
+    while (reader.readNextStartElement()) {
+        if (reader.name() != QLatin1String("Content")) {
+            reader.skipCurrentElement();
             continue;
+        }
 
-        const QString type = paragraphE.attribute(QStringLiteral("Type"));
-        const int typeIndex = types.indexOf(type);
-        if (typeIndex < 0)
-            continue;
+        while (reader.readNextStartElement()) {
+            if (reader.name() != paragraphName) {
+                reader.skipCurrentElement();
+                continue;
+            }
+
+            this->importParagraph(reader, QString(), scene);
+            ++nrParagraphs;
 
-        const QString alignmentHint = paragraphE.attribute(QStringLiteral("Alignment"));
-        const Qt::Alignment alignment = [alignmentHint]() {
-            return QHash<QString, Qt::Alignment>({ { QStringLiteral("Left"), Qt::AlignLeft },
-                                                   { QStringLiteral("Right"), Qt::AlignRight },
-                                                   { QStringLiteral("Center"), Qt::AlignCenter } })
-                    .value(alignmentHint, Qt::Alignment());
-        }();
-
-        const QPair<QString, QVector<QTextLayout::FormatRange>> paragraphText =
-                parseParagraphTexts(paragraphE);
-
-        const QString text = paragraphText.first;
-        const QVector<QTextLayout::FormatRange> formats = paragraphText.second;
-
-        SceneElement *sceneElement = nullptr;
-        switch (typeIndex) {
-        case 0: {
-            scene = this->createScene(text);
-
-            ScreenplayElement *element = this->document()->screenplay()->elementAt(
-                    this->document()->screenplay()->elementCount() - 1);
-            element->setOmitted(flags == "Omitted");
-
-            const QString number = paragraphE.attribute(QStringLiteral("Number"));
-            if (!number.isEmpty())
-                element->setUserSceneNumber(number);
-
-            const QDomElement sceneProperiesE =
-                    paragraphE.firstChildElement(QStringLiteral("SceneProperties"));
-            if (!sceneProperiesE.isNull()) {
-                const QString title = sceneProperiesE.attribute(QStringLiteral("Title"));
-                const QColor color =
-                        fromFdxColorCode(sceneProperiesE.attribute(QStringLiteral("Color")));
-                scene->setColor(color);
-                scene->structureElement()->setTitle(title);
-
-                const QDomElement summaryE =
-                        sceneProperiesE.firstChildElement(QStringLiteral("Summary"));
-                const QDomElement summaryParagraphE = summaryE.isNull()
-                        ? QDomElement()
-                        : summaryE.firstChildElement(paragraphName);
-                const QPair<QString, QVector<QTextLayout::FormatRange>> summaryParagraphText =
-                        parseParagraphTexts(summaryParagraphE);
-
-                // Ignore formatting, just retain the text.
-                scene->setSynopsis(summaryParagraphText.first);
+            while (device->pos() >= nextProgressPos && nextProgressPos <= deviceSize) {
+                this->progress()->tick();
+                nextProgressPos += progressInterval;
             }
-        } break;
-        case 1:
-            sceneElement = this->addSceneElement(scene, SceneElement::Action, text);
-            break;
-        case 2:
-            sceneElement = this->addSceneElement(scene, SceneElement::Character, text);
-            break;
-        case 3:
-            sceneElement = this->addSceneElement(scene, SceneElement::Dialogue, text);
-            break;
-        case 4:
-            sceneElement = this->addSceneElement(scene, SceneElement::Parenthetical, text);
-            break;
-        case 5:
-            sceneElement = this->addSceneElement(scene, SceneElement::Shot, text);
-            break;
-        case 6:
-            sceneElement = this->addSceneElement(scene, SceneElement::Transition, text);
-            break;
         }
 
-        if (sceneElement != nullptr) {
-            sceneElement->setAlignment(alignment);
-            sceneElement->setTextFormats(formats);
-        }
+        // Nothing after the content is imported
+        break;
+    }
+
+    if (reader.hasError())
+        return reportParseError();
+
+    if (nrParagraphs == 0) {
+        this->error()->setErrorMessage(QStringLiteral("No paragraphs to import."));
+        return false;
     }
 
+    this->configureCanvas(nrParagraphs);
+
     return true;
 }
 
-void fixOmittedScenes(QDomElement &contentE)
+void FinalDraftImporter::importParagraph(QXmlStreamReader &reader, const QString &overrideFlags,
+                                         Scene *&scene)
 {
-    /**
-     * The final-draft importer is built to process a flat <Paragraph> hierarchy like this.
-     *
-     * <FinalDraft ...>
-     * <Content>
-     *   <Paragraph ...>
-     *
-     *   </Paragraph>
-     *
-     *   <Paragraph ....>
-     *
-     *   </Paragraph>
-     *
-     *   ....
-     * </Content>
-     * </FinalDraft>
-     *
-     * However, if there are omitted scenes, then they show up like this in the FDX file.
-     *
-     * <FinalDraft ...>
-     *  <Content>
-     *      <Paragraph Type="Scene Heading" ...>
-     *          <Text>Omitted</Text>
-     *          <OmittedScene>
-     *              <Paragraph Type="Scene Heading" ...>...</Paragraph>
-     *              <Paragraph Type="Action" ...>...</Paragraph>
-     *              <Paragraph Type="Character" ...>...</Paragraph>
-     *              <Paragraph Type="Dialog" ...>...</Paragraph>
-     *              <Paragraph Type="Shot" ...>...</Paragraph>
-     *              .....
-     *          </OmittedScene>
-     *      </Paragraph>
-     *      <Paragraph Type="Scene Heading">...</Paragraph>
-     *      ....
-     *  </Content>
-     * </FinalDraft>
-     *
-     * We need to transform this into ...
-     *
-     * <FinalDraft ...>
-     *  <Content>
-     *     <Paragraph Flags="Omitted" Type="Scene Heading" ...>...</Paragraph>
-     *     <Paragraph Flags="Omitted" Type="Action" ...>...</Paragraph>
-     *     <Paragraph Flags="Omitted" Type="Character" ...>...</Paragraph>
-     *     <Paragraph Flags="Omitted" Type="Dialog" ...>...</Paragraph>
-     *     <Paragraph Flags="Omitted" Type="Shot" ...>...</Paragraph>
-     *     .....
-     *     <Paragraph Flags="Ignore" Type="Scene Heading" ...>
-     *          <Text>Omitted</Text>
-     *          <OmittedScene>
-     *     </Paragraph>
-     *     <Paragraph Type="Scene Heading">...</Paragraph>
-     *     ....
-     *  </Content>
-     * </FinalDraft>
-     *
-     * So, that the existing parser can continue to import this FDX file without
-     * having to make too many adjustments.
-     *
-     * So, that's what this function does!
-     */
+    const QXmlStreamAttributes attributes = reader.attributes();
+
+    QString flags = overrideFlags.isEmpty() ? attributes.value(QStringLiteral("Flags")).toString()
+                                            : overrideFlags;
+    const QString type = attributes.value(QStringLiteral("Type")).toString();
+    const QString number = attributes.value(QStringLiteral("Number")).toString();
+    const QString alignmentHint = attributes.value(QStringLiteral("Alignment")).toString();
+
+    QString text;
+    QVector<QTextLayout::FormatRange> formats;
+
+    bool hasSceneProperties = false;
+    QString sceneTitle;
+    QColor sceneColor;
+    QString sceneSummary;
 
     const QString paragraphName = QStringLiteral("Paragraph");
-    const QString omittedSceneName = QStringLiteral("OmittedScene");
-    const QString flagsAttr = QStringLiteral("Flags");
-
-    QDomElement paragraphE = contentE.firstChildElement(paragraphName);
-    while (!paragraphE.isNull()) {
-
-        QDomElement omittedSceneE = paragraphE.firstChildElement(omittedSceneName);
-        if (!omittedSceneE.isNull()) {
-            paragraphE.setAttribute(flagsAttr, QStringLiteral("Ignore"));
-            const QDomNodeList childParagraphs = omittedSceneE.elementsByTagName(paragraphName);
-            for (int i = childParagraphs.size() - 1; i >= 0; i--) {
-                QDomElement childParagraphE = childParagraphs.at(i).toElement();
-                childParagraphE.setAttribute(flagsAttr, QStringLiteral("Omitted"));
-                contentE.insertAfter(childParagraphE, paragraphE);
+    while (reader.readNextStartElement()) {
+        const QStringRef name = reader.name();
+        if (name == QLatin1String("Text")) {
+            readTextElement(reader, text, formats);
+        } else if (name == QLatin1String("SceneProperties")) {
+            const QXmlStreamAttributes scenePropertiesAttributes = reader.attributes();
+            hasSceneProperties = true;
+            sceneTitle = scenePropertiesAttributes.value(QStringLiteral("Title")).toString();
+            sceneColor = fromFdxColorCode(
+                    scenePropertiesAttributes.value(QStringLiteral("Color")).toString());
+
+            while (reader.readNextStartElement()) {
+                if (reader.name() != QLatin1String("Summary")) {
+                    reader.skipCurrentElement();
+                    continue;
+                }
+
+                // Ignore formatting, just retain the text of the first paragraph.
+                bool summaryRead = false;
+                while (reader.readNextStartElement()) {
+                    if (!summaryRead && reader.name() == paragraphName) {
+                        sceneSummary = readParagraphText(reader);
+                        summaryRead = true;
+                    } else
+                        reader.skipCurrentElement();
+                }
+            }
+        } else if (name == QLatin1String("OmittedScene")) {
+            /**
+             * Paragraphs of omitted scenes show up nested in a placeholder scene heading,
+             * like this.
+             *
+             * <Paragraph Type="Scene Heading" ...>
+             *     <Text>Omitted</Text>
+             *     <OmittedScene>
+             *         <Paragraph Type="Scene Heading" ...>...</Paragraph>
+             *         <Paragraph Type="Action" ...>...</Paragraph>
+             *         .....
+             *     </OmittedScene>
+             * </Paragraph>
+             *
+             * Nested paragraphs are imported as omitted, and the placeholder is ignored.
+             */
+            flags = QStringLiteral("Ignore");
+            while (reader.readNextStartElement()) {
+                if (reader.name() == paragraphName)
+                    this->importParagraph(reader, QStringLiteral("Omitted"), scene);
+                else
+                    reader.skipCurrentElement();
             }
+        } else
+            reader.skipCurrentElement();
+    }
+
+    if (flags == QStringLiteral("Ignore"))
+        return;
+
+    static const QStringList types({ QStringLiteral("Scene Heading"), QStringLiteral("Action"),
+                                     QStringLiteral("Character"), QStringLiteral("Dialogue"),
+                                     QStringLiteral("Parenthetical"), QStringLiteral("Shot"),
+                                     QStringLiteral("Transition") });
+    const int typeIndex = types.indexOf(type);
+    if (typeIndex < 0)
+        return;
+
+    const Qt::Alignment alignment = [alignmentHint]() {
+        return QHash<QString, Qt::Alignment>({ { QStringLiteral("Left"), Qt::AlignLeft },
+                                               { QStringLiteral("Right"), Qt::AlignRight },
+                                               { QStringLiteral("Center"), Qt::AlignCenter } })
+                .value(alignmentHint, Qt::Alignment());
+    }();
+
+    SceneElement *sceneElement = nullptr;
+    switch (typeIndex) {
+    case 0: {
+        scene = this->createScene(text);
+
+        ScreenplayElement *element = this->document()->screenplay()->elementAt(
+                this->document()->screenplay()->elementCount() - 1);
+        element->setOmitted(flags == QStringLiteral("Omitted"));
+
+        if (!number.isEmpty())
+            element->setUserSceneNumber(number);
+
+        if (hasSceneProperties) {
+            scene->setColor(sceneColor);
+            scene->structureElement()->setTitle(sceneTitle);
+            scene->setSynopsis(sceneSummary);
         }
+    } break;
+    case 1:
+        sceneElement = this->addSceneElement(scene, SceneElement::Action, text);
+        break;
+    case 2:
+        sceneElement = this->addSceneElement(scene, SceneElement::Character, text);
+        break;
+    case 3:
+        sceneElement = this->addSceneElement(scene, SceneElement::Dialogue, text);
+        break;
+    case 4:
+        sceneElement = this->addSceneElement(scene, SceneElement::Parenthetical, text);
+        break;
+    case 5:
+        sceneElement = this->addSceneElement(scene, SceneElement::Shot, text);
+        break;
+    case 6:
+        sceneElement = this->addSceneElement(scene, SceneElement::Transition, text);
+        break;
+    }
 
-        paragraphE = paragraphE.nextSiblingElement(paragraphName);
+    if (sceneElement != nullptr) {
+        sceneElement->setAlignment(alignment);
+        sceneElement->setTextFormats(formats);
     }
 }
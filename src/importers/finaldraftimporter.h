@@ -14,9 +14,10 @@
 #ifndef FINALDRAFTIMPORTER_H
 #define FINALDRAFTIMPORTER_H
 
-#include <QDomDocument>
 #include "abstractimporter.h"
 
+class QXmlStreamReader;
+
 class FinalDraftImporter : public AbstractImporter
 {
     Q_OBJECT
@@ -31,6 +32,9 @@ public:
 
 protected:
     bool doImport(QIODevice *device); // AbstractImporter interface
+
+private:
+    void importParagraph(QXmlStreamReader &reader, const QString &overrideFlags, Scene *&scene);
 };
 
 #endif // FINALDRAFTIMPORTER_H
@@ -14,6 +14,7 @@
 #include "abstractscreenplaysubsetreport.h"
 #include "qtextdocumentpagedprinter.h"
 #include "screenplaytextdocument.h"
+#include "timeprofiler.h"
 #include "application.h"
 #include "scene.h"
 
@@ -170,6 +171,8 @@ void AbstractScreenplaySubsetReport::setTags(const QStringList &val)
 
 bool AbstractScreenplaySubsetReport::doGenerate(QTextDocument *textDocument)
 {
+    PROFILE_THIS_FUNCTION;
+
     ScriteDocument *document = this->document();
     Screenplay *screenplay = document->screenplay();
 
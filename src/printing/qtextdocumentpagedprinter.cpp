@@ -15,17 +15,24 @@
 #include "scrite.h"
 #include "ruleritem.h"
 #include "application.h"
+#include "timeprofiler.h"
 #include "scritedocument.h"
 #include "qtextdocumentpagedprinter.h"
 
 #include <QDate>
 #include <QTime>
+#include <QMutex>
+#include <QQueue>
 #include <QtDebug>
+#include <QPicture>
+#include <QPrinter>
 #include <QPainter>
 #include <QDateTime>
 #include <QSettings>
 #include <QTextBlock>
 #include <QPaintEngine>
+#include <QWaitCondition>
+#include <QtConcurrentRun>
 #include <QAbstractTextDocumentLayout>
 
 HeaderFooter::HeaderFooter(Type type, QObject *parent) : QObject(parent), m_type(type)
@@ -350,6 +357,161 @@ QTextDocumentPagedPrinter::QTextDocumentPagedPrinter(QObject *parent) : QObject(
 
 QTextDocumentPagedPrinter::~QTextDocumentPagedPrinter() { }
 
+void QTextDocumentPagedPrinter::setFromPage(int val)
+{
+    val = qMax(val, 0);
+    if (m_fromPage == val)
+        return;
+
+    m_fromPage = val;
+    emit fromPageChanged();
+}
+
+void QTextDocumentPagedPrinter::setToPage(int val)
+{
+    val = qMax(val, 0);
+    if (m_toPage == val)
+        return;
+
+    m_toPage = val;
+    emit toPageChanged();
+}
+
+void QTextDocumentPagedPrinter::setPipelined(bool val)
+{
+    if (m_pipelined == val)
+        return;
+
+    m_pipelined = val;
+    emit pipelinedChanged();
+}
+
+/**
+ * A picture that reports the metrics of the device it will be played on. Fonts and
+ * font metrics are resolved just as they would be on that device, so a recorded page
+ * plays back exactly like a page painted straight onto it.
+ */
+class PageRecording : public QPicture
+{
+public:
+    explicit PageRecording(const QPaintDevice *device)
+    {
+        m_metrics[PdmWidth] = device->width();
+        m_metrics[PdmHeight] = device->height();
+        m_metrics[PdmWidthMM] = device->widthMM();
+        m_metrics[PdmHeightMM] = device->heightMM();
+        m_metrics[PdmNumColors] = device->colorCount();
+        m_metrics[PdmDepth] = device->depth();
+        m_metrics[PdmDpiX] = device->logicalDpiX();
+        m_metrics[PdmDpiY] = device->logicalDpiY();
+        m_metrics[PdmPhysicalDpiX] = device->physicalDpiX();
+        m_metrics[PdmPhysicalDpiY] = device->physicalDpiY();
+        m_metrics[PdmDevicePixelRatio] = device->devicePixelRatio();
+        m_metrics[PdmDevicePixelRatioScaled] =
+                qRound(device->devicePixelRatioF() * QPaintDevice::devicePixelRatioFScale());
+    }
+
+protected:
+    int metric(PaintDeviceMetric metric) const
+    {
+        return metric >= PdmWidth && metric <= PdmDevicePixelRatioScaled
+                ? m_metrics[metric]
+                : QPicture::metric(metric);
+    }
+
+private:
+    int m_metrics[PdmDevicePixelRatioScaled + 1] = {};
+};
+
+/**
+ * Plays recorded pages onto a painter in a worker thread, one after the other. Pages
+ * are queued by the thread recording them, which waits if too many are pending.
+ */
+class PagePlayer
+{
+public:
+    PagePlayer(QPainter *painter, QPagedPaintDevice *device) : m_painter(painter), m_device(device)
+    {
+        m_future = QtConcurrent::run([=]() { this->run(); });
+    }
+    ~PagePlayer() { this->finish(); }
+
+    bool add(PageRecording *page)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_pages.size() >= MaxPendingPages && !m_failed)
+            m_pageTaken.wait(&m_mutex);
+
+        if (m_failed) {
+            delete page;
+            return false;
+        }
+
+        m_pages.enqueue(page);
+        m_pageAdded.wakeOne();
+        return true;
+    }
+
+    bool finish()
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_finished = true;
+            m_pageAdded.wakeOne();
+        }
+
+        m_future.waitForFinished();
+        return !m_failed;
+    }
+
+private:
+    void run()
+    {
+        TimeProfiler profiler("QTextDocumentPagedPrinter::print [play pages]");
+
+        bool firstPage = true;
+        while (1) {
+            PageRecording *page = nullptr;
+            {
+                QMutexLocker locker(&m_mutex);
+                while (m_pages.isEmpty() && !m_finished)
+                    m_pageAdded.wait(&m_mutex);
+                if (m_pages.isEmpty())
+                    return;
+                page = m_pages.dequeue();
+                m_pageTaken.wakeOne();
+            }
+
+            const bool newPage = firstPage || m_device->newPage();
+            if (newPage)
+                m_painter->drawPicture(0, 0, *page);
+            delete page;
+            firstPage = false;
+
+            if (!newPage) {
+                QMutexLocker locker(&m_mutex);
+                m_failed = true;
+                qDeleteAll(m_pages);
+                m_pages.clear();
+                m_pageTaken.wakeOne();
+                return;
+            }
+        }
+    }
+
+private:
+    enum { MaxPendingPages = 4 };
+    QPainter *m_painter = nullptr;
+    QPagedPaintDevice *m_device = nullptr;
+    QMutex m_mutex;
+    QWaitCondition m_pageAdded;
+    QWaitCondition m_pageTaken;
+    QQueue<PageRecording *> m_pages;
+    bool m_finished = false;
+    bool m_failed = false;
+    QFuture<void> m_future;
+};
+
 // Much of the code in the print() function is inspired from the implementation
 // of QTextDocument::print() method implementation. Because I tried writing
 // my own print() implementation and it always sucked in stellar proportions.
@@ -532,36 +694,79 @@ bool QTextDocumentPagedPrinter::print(QTextDocument *document, QPagedPaintDevice
         m_watermark->setText(watermarkText);
 
     // We are now ready to print.
-    const int fromPageNr = 1;
-    const int toPageNr = doc->pageCount();
+    const int pageCount = doc->pageCount();
+
+    int fromPageNr = m_fromPage;
+    int toPageNr = m_toPage;
+    if (fromPageNr == 0 && toPageNr == 0) {
+        const QPrinter *qprinter = dynamic_cast<const QPrinter *>(printer);
+        if (qprinter != nullptr && qprinter->printRange() == QPrinter::PageRange) {
+            fromPageNr = qprinter->fromPage();
+            toPageNr = qprinter->toPage();
+        }
+    }
+    fromPageNr = fromPageNr > 0 ? qMin(fromPageNr, pageCount) : 1;
+    toPageNr = toPageNr > 0 ? qBound(fromPageNr, toPageNr, pageCount) : pageCount;
 
     m_progressReport->start();
-    m_progressReport->setProgressStep(1 / qreal(doc->pageCount() + 1));
+    m_progressReport->setProgressStep(1 / qreal(toPageNr - fromPageNr + 2));
     int pageNr = fromPageNr;
     QRectF pageRect;
 
     const bool isPdfDevice = printer->paintEngine()->type() == QPaintEngine::Pdf;
 
-    // Print away!
-    while (pageNr <= toPageNr) {
-        painter.save();
-        painter.scale(contentScale.first, contentScale.second);
-        this->printPageContents(pageNr, toPageNr, &painter, doc, body, pageRect);
+    auto printPage = [&](QPainter *painter) {
+        painter->save();
+        painter->scale(contentScale.first, contentScale.second);
+        this->printPageContents(pageNr, pageCount, painter, doc, body, pageRect);
         if (!isPdfDevice)
-            this->printHeaderFooterWatermark(pageNr, toPageNr, &painter, doc, body, pageRect);
-        painter.restore();
+            this->printHeaderFooterWatermark(pageNr, pageCount, painter, doc, body, pageRect);
+        painter->restore();
 
         if (isPdfDevice)
-            this->printHeaderFooterWatermark(pageNr, toPageNr, &painter, doc, body, pageRect);
+            this->printHeaderFooterWatermark(pageNr, pageCount, painter, doc, body, pageRect);
+    };
+
+    // Painting onto PDF devices from another thread is supported on all platforms, unlike
+    // painting onto native printers. The document and its layout stay on this thread.
+    const bool pipelined = m_pipelined && isPdfDevice
+            && (!qEnvironmentVariableIsSet("SCRITE_PRINT_PIPELINE")
+                || qEnvironmentVariableIntValue("SCRITE_PRINT_PIPELINE") != 0);
+
+    // Print away!
+    if (pipelined) {
+        TimeProfiler profiler("QTextDocumentPagedPrinter::print [pipelined]");
 
-        m_progressReport->tick();
+        PagePlayer pagePlayer(&painter, printer);
+        while (pageNr <= toPageNr) {
+            PageRecording *page = new PageRecording(printer);
+            QPainter pagePainter(page);
+            printPage(&pagePainter);
+            pagePainter.end();
 
-        if (pageNr < toPageNr) {
-            if (!m_printer->newPage())
+            if (!pagePlayer.add(page))
                 break;
+
+            m_progressReport->tick();
+            ++pageNr;
         }
 
-        ++pageNr;
+        pagePlayer.finish();
+    } else {
+        TimeProfiler profiler("QTextDocumentPagedPrinter::print [serial]");
+
+        while (pageNr <= toPageNr) {
+            printPage(&painter);
+
+            m_progressReport->tick();
+
+            if (pageNr < toPageNr) {
+                if (!m_printer->newPage())
+                    break;
+            }
+
+            ++pageNr;
+        }
     }
 
     // All done!
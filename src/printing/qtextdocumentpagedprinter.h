@@ -228,6 +228,28 @@ public:
     void setSideBar(QTextDocumentPageSideBarInterface *val) { m_sideBar = val; }
     QTextDocumentPageSideBarInterface *sideBar() const { return m_sideBar; }
 
+    // Page numbers are 1 based. When zero, printing starts from the first page or ends
+    // at the last page. If neither is set and the device is a QPrinter whose print range
+    // is a page range, then that is used instead.
+    Q_PROPERTY(int fromPage READ fromPage WRITE setFromPage NOTIFY fromPageChanged)
+    void setFromPage(int val);
+    int fromPage() const { return m_fromPage; }
+    Q_SIGNAL void fromPageChanged();
+
+    Q_PROPERTY(int toPage READ toPage WRITE setToPage NOTIFY toPageChanged)
+    void setToPage(int val);
+    int toPage() const { return m_toPage; }
+    Q_SIGNAL void toPageChanged();
+
+    // When set, and the device is a PDF device, pages are recorded into pictures on the
+    // calling thread, and played into the PDF on a worker thread. So laying out and
+    // drawing page N+1 overlaps with encoding page N. Set SCRITE_PRINT_PIPELINE=0 to
+    // always print serially, for instance to compare the two.
+    Q_PROPERTY(bool pipelined READ isPipelined WRITE setPipelined NOTIFY pipelinedChanged)
+    void setPipelined(bool val);
+    bool isPipelined() const { return m_pipelined; }
+    Q_SIGNAL void pipelinedChanged();
+
     Q_INVOKABLE bool print(QTextDocument *document, QPagedPaintDevice *device);
 
     static void loadSettings(HeaderFooter *header, HeaderFooter *footer, Watermark *watermark);
@@ -250,6 +272,9 @@ private:
     QTextDocumentPageSideBarInterface *m_sideBar = nullptr;
     QRectF m_headerRect;
     QRectF m_footerRect;
+    int m_fromPage = 0;
+    int m_toPage = 0;
+    bool m_pipelined = false;
 };
 
 #endif // QTEXTDOCUMENTPAGEDPRINTER_H
@@ -15,6 +15,7 @@
 #include "timeprofiler.h"
 #include "application.h"
 
+#include <QSet>
 #include <QKeyEvent>
 #include <QtConcurrentRun>
 #include <QGuiApplication>
@@ -29,6 +30,51 @@ static bool isEnglishString(const QString &item)
     return true;
 }
 
+// Optimal string alignment distance, which is the Levenshtein distance that also
+// counts swapping two adjacent characters as one edit.
+static int editDistance(const QString &a, const QString &b)
+{
+    const int m = a.length();
+    const int n = b.length();
+
+    QVector<int> prev2(n + 1), prev(n + 1), curr(n + 1);
+    for (int j = 0; j <= n; j++)
+        prev[j] = j;
+
+    for (int i = 1; i <= m; i++) {
+        curr[0] = i;
+        for (int j = 1; j <= n; j++) {
+            const int cost = a.at(i - 1) == b.at(j - 1) ? 0 : 1;
+            curr[j] = qMin(qMin(prev[j] + 1, curr[j - 1] + 1), prev[j - 1] + cost);
+            if (i > 1 && j > 1 && a.at(i - 1) == b.at(j - 2) && a.at(i - 2) == b.at(j - 1))
+                curr[j] = qMin(curr[j], prev2[j - 2] + 1);
+        }
+        std::swap(prev2, prev);
+        std::swap(prev, curr);
+    }
+
+    return prev[n];
+}
+
+static bool isSubsequence(const QString &needle, const QString &haystack)
+{
+    int n = 0;
+    for (int h = 0; h < haystack.length() && n < needle.length(); h++) {
+        if (haystack.at(h) == needle.at(n))
+            ++n;
+    }
+    return n == needle.length();
+}
+
+static bool hasWordStartingWith(const QString &string, const QString &prefix)
+{
+    for (int i = string.indexOf(prefix, 1); i > 0; i = string.indexOf(prefix, i + 1)) {
+        if (!string.at(i - 1).isLetterOrNumber())
+            return true;
+    }
+    return false;
+}
+
 CompletionModel::CompletionModel(QObject *parent) : QAbstractListModel(parent)
 {
     connect(this, &QAbstractListModel::rowsInserted, this, &CompletionModel::countChanged);
@@ -43,6 +89,8 @@ CompletionModel::CompletionModel(QObject *parent) : QAbstractListModel(parent)
             &CompletionModel::currentCompletionChanged);
     connect(this, &QAbstractListModel::modelReset, this,
             &CompletionModel::currentCompletionChanged);
+    connect(this, &QAbstractListModel::dataChanged, this,
+            &CompletionModel::currentCompletionChanged);
 }
 
 CompletionModel::~CompletionModel() { }
@@ -100,6 +148,17 @@ void CompletionModel::setSortMode(SortMode val)
     emit sortModeChanged();
 }
 
+void CompletionModel::setMatchMode(MatchMode val)
+{
+    if (m_matchMode == val)
+        return;
+
+    m_matchMode = val;
+    emit matchModeChanged();
+
+    this->filterStrings();
+}
+
 void CompletionModel::setMaxVisibleItems(int val)
 {
     if (m_maxVisibleItems == val)
@@ -246,32 +305,24 @@ void CompletionModel::filterStrings()
         return;
     }
 
-    bool someFilteringHappened = false;
+    int nrMatches = 0;
     QStringList fstrings;
-    if (m_completionPrefix.isEmpty())
-        fstrings = m_strings2;
-    else {
-        if (m_completionPrefix.isEmpty())
-            fstrings = m_strings2;
+    if (m_completionPrefix.isEmpty()) {
+        nrMatches = m_strings2.size();
+        fstrings = m_maxVisibleItems > 0 ? m_strings2.mid(0, m_maxVisibleItems) : m_strings2;
+    } else {
+        const QString foldedPrefix = m_completionPrefix.toCaseFolded();
+
         // if an exact match was found, then clear the completion model
         // even if there is another potential match possible.
-        else if (m_strings2.contains(m_completionPrefix, Qt::CaseInsensitive))
-            fstrings.clear();
-        else
-            std::copy_if(m_strings2.begin(), m_strings2.end(), std::back_inserter(fstrings),
-                         [&](const QString &item) {
-                             const bool ret =
-                                     item.startsWith(m_completionPrefix, Qt::CaseInsensitive);
-                             someFilteringHappened |= !ret;
-                             return ret;
-                         });
+        if (!this->indexContains(foldedPrefix))
+            fstrings = m_matchMode == FuzzyMatch ? this->fuzzyMatches(foldedPrefix, &nrMatches)
+                                                 : this->prefixMatches(foldedPrefix, &nrMatches);
     }
 
-    this->beginResetModel();
-    m_filteredStrings = fstrings.isEmpty() ? fstrings
-            : m_maxVisibleItems > 0        ? fstrings.mid(0, m_maxVisibleItems)
-                                           : fstrings;
-    this->endResetModel();
+    const bool someFilteringHappened = nrMatches < m_strings2.size();
+
+    this->setFilteredStrings(fstrings);
 
     if (m_filteredStrings.isEmpty() || !someFilteringHappened)
         this->setCurrentRow(-1);
@@ -291,31 +342,194 @@ void CompletionModel::prepareStrings()
         m_strings2 = m_strings;
     m_strings2.removeDuplicates();
 
+    QSet<QString> foldedStrings;
+    foldedStrings.reserve(m_strings2.size());
+    for (const QString &item : qAsConst(m_strings2))
+        foldedStrings.insert(item.toCaseFolded());
+
     std::copy_if(m_priorityStrings.begin(), m_priorityStrings.end(),
-                 std::back_inserter(m_priorityStrings2), [=](const QString &item) {
-                     return m_strings2.contains(item, Qt::CaseInsensitive);
+                 std::back_inserter(m_priorityStrings2), [&](const QString &item) {
+                     return foldedStrings.contains(item.toCaseFolded());
                  });
     m_priorityStrings2.removeDuplicates();
 
     if (m_sortStrings)
         std::sort(m_strings2.begin(), m_strings2.end());
 
-    for (int i = m_priorityStrings2.size() - 1; i >= 0; i--) {
-        const QString priorityString2 = m_priorityStrings2.at(i);
-        m_strings2.removeOne(priorityString2);
-        m_strings2.prepend(priorityString2);
+    // Priority strings go first, in their own order. Everything else follows.
+    if (!m_priorityStrings2.isEmpty()) {
+        const QSet<QString> priorityStrings(m_priorityStrings2.begin(), m_priorityStrings2.end());
+        QStringList strings = m_priorityStrings2;
+        strings.reserve(m_strings2.size() + m_priorityStrings2.size());
+        std::copy_if(m_strings2.begin(), m_strings2.end(), std::back_inserter(strings),
+                     [&](const QString &item) { return !priorityStrings.contains(item); });
+        m_strings2 = strings;
     }
 
+    // Strings change far less often than the completion prefix, which changes with
+    // every key stroke. So the index is rebuilt here, and only looked up while filtering.
+    m_prefixIndex.clear();
+    m_prefixIndex.reserve(m_strings2.size());
+    for (int i = 0; i < m_strings2.size(); i++) {
+        IndexEntry entry;
+        entry.key = m_strings2.at(i).toCaseFolded();
+        entry.order = i;
+        m_prefixIndex.append(entry);
+    }
+    std::sort(m_prefixIndex.begin(), m_prefixIndex.end());
+
     this->filterStrings();
 }
 
 void CompletionModel::clearFilterStrings()
 {
-    if (!m_filteredStrings.isEmpty()) {
-        this->beginResetModel();
-        m_filteredStrings.clear();
-        this->endResetModel();
+    this->setFilteredStrings(QStringList());
+    this->setCurrentRow(-1);
+}
+
+void CompletionModel::setFilteredStrings(const QStringList &strings)
+{
+    if (m_filteredStrings == strings)
+        return;
+
+    // Emit only the row changes needed, so that views don't have to recreate delegates
+    // for completions that remain on every key stroke.
+    const int oldCount = m_filteredStrings.size();
+    const int newCount = strings.size();
+
+    if (newCount < oldCount) {
+        this->beginRemoveRows(QModelIndex(), newCount, oldCount - 1);
+        m_filteredStrings.erase(m_filteredStrings.begin() + newCount, m_filteredStrings.end());
+        this->endRemoveRows();
     }
 
-    this->setCurrentRow(-1);
+    int firstChangedRow = -1;
+    int lastChangedRow = -1;
+    for (int i = 0; i < m_filteredStrings.size(); i++) {
+        if (m_filteredStrings.at(i) == strings.at(i))
+            continue;
+
+        m_filteredStrings[i] = strings.at(i);
+        if (firstChangedRow < 0)
+            firstChangedRow = i;
+        lastChangedRow = i;
+    }
+
+    if (firstChangedRow >= 0)
+        emit dataChanged(this->index(firstChangedRow), this->index(lastChangedRow));
+
+    if (newCount > oldCount) {
+        this->beginInsertRows(QModelIndex(), oldCount, newCount - 1);
+        m_filteredStrings += strings.mid(oldCount);
+        this->endInsertRows();
+    }
+}
+
+bool CompletionModel::indexContains(const QString &foldedString) const
+{
+    IndexEntry probe;
+    probe.key = foldedString;
+
+    const auto it = std::lower_bound(m_prefixIndex.begin(), m_prefixIndex.end(), probe);
+    return it != m_prefixIndex.end() && it->key == foldedString;
+}
+
+QStringList CompletionModel::prefixMatches(const QString &foldedPrefix, int *nrMatches) const
+{
+    IndexEntry probe;
+    probe.key = foldedPrefix;
+
+    // Keys starting with the prefix are contiguous in the sorted index
+    const auto begin = std::lower_bound(m_prefixIndex.begin(), m_prefixIndex.end(), probe);
+    const auto end = std::partition_point(begin, m_prefixIndex.end(), [&](const IndexEntry &e) {
+        return e.key.startsWith(foldedPrefix);
+    });
+
+    QVector<int> orders;
+    orders.reserve(int(std::distance(begin, end)));
+    for (auto it = begin; it != end; ++it)
+        orders.append(it->order);
+
+    *nrMatches = orders.size();
+
+    if (m_maxVisibleItems > 0 && orders.size() > m_maxVisibleItems) {
+        std::partial_sort(orders.begin(), orders.begin() + m_maxVisibleItems, orders.end());
+        orders.resize(m_maxVisibleItems);
+    } else
+        std::sort(orders.begin(), orders.end());
+
+    QStringList ret;
+    ret.reserve(orders.size());
+    for (int order : qAsConst(orders))
+        ret.append(m_strings2.at(order));
+
+    return ret;
+}
+
+QStringList CompletionModel::fuzzyMatches(const QString &foldedPrefix, int *nrMatches) const
+{
+    struct Candidate
+    {
+        int rank = 0;
+        int distance = 0;
+        int order = 0;
+        bool operator<(const Candidate &other) const
+        {
+            if (rank != other.rank)
+                return rank < other.rank;
+            if (distance != other.distance)
+                return distance < other.distance;
+            return order < other.order;
+        }
+    };
+
+    const int prefixLength = foldedPrefix.length();
+    const int maxTypos = prefixLength < 3 ? 0 : (prefixLength < 6 ? 1 : 2);
+
+    QVector<Candidate> candidates;
+    for (const IndexEntry &entry : m_prefixIndex) {
+        Candidate candidate;
+        candidate.order = entry.order;
+
+        if (entry.key.startsWith(foldedPrefix))
+            candidate.rank = 0;
+        else if (hasWordStartingWith(entry.key, foldedPrefix))
+            candidate.rank = 1;
+        else if (isSubsequence(foldedPrefix, entry.key))
+            candidate.rank = 2;
+        else if (maxTypos > 0) {
+            // Typos may have added or dropped a character, so the prefix is compared
+            // with starts of the key that are one character shorter or longer too.
+            int distance = maxTypos + 1;
+            for (int length = prefixLength - 1; length <= prefixLength + 1; length++) {
+                if (length <= 0 || length > entry.key.length())
+                    continue;
+                distance = qMin(distance, editDistance(foldedPrefix, entry.key.left(length)));
+            }
+            if (distance > maxTypos)
+                continue;
+
+            candidate.rank = 3;
+            candidate.distance = distance;
+        } else
+            continue;
+
+        candidates.append(candidate);
+    }
+
+    *nrMatches = candidates.size();
+
+    if (m_maxVisibleItems > 0 && candidates.size() > m_maxVisibleItems) {
+        std::partial_sort(candidates.begin(), candidates.begin() + m_maxVisibleItems,
+                          candidates.end());
+        candidates.resize(m_maxVisibleItems);
+    } else
+        std::sort(candidates.begin(), candidates.end());
+
+    QStringList ret;
+    ret.reserve(candidates.size());
+    for (const Candidate &candidate : qAsConst(candidates))
+        ret.append(m_strings2.at(candidate.order));
+
+    return ret;
 }
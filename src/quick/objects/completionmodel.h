@@ -54,6 +54,18 @@ public:
     SortMode sortMode() const { return m_sortMode; }
     Q_SIGNAL void sortModeChanged();
 
+    // PrefixMatch lists strings that start with the completion prefix. FuzzyMatch also
+    // lists strings having a word that starts with the prefix, strings that contain the
+    // prefix's letters in order, and strings whose start is within a typo or two of the
+    // prefix; ranked in that order.
+    enum MatchMode { PrefixMatch, FuzzyMatch };
+    Q_ENUM(MatchMode)
+
+    Q_PROPERTY(MatchMode matchMode READ matchMode WRITE setMatchMode NOTIFY matchModeChanged)
+    void setMatchMode(MatchMode val);
+    MatchMode matchMode() const { return m_matchMode; }
+    Q_SIGNAL void matchModeChanged();
+
     Q_PROPERTY(int maxVisibleItems READ maxVisibleItems WRITE setMaxVisibleItems NOTIFY maxVisibleItemsChanged)
     void setMaxVisibleItems(int val);
     int maxVisibleItems() const { return m_maxVisibleItems; }
@@ -106,6 +118,10 @@ private:
     void filterStrings();
     void prepareStrings();
     void clearFilterStrings();
+    void setFilteredStrings(const QStringList &strings);
+    bool indexContains(const QString &foldedString) const;
+    QStringList prefixMatches(const QString &foldedPrefix, int *nrMatches) const;
+    QStringList fuzzyMatches(const QString &foldedPrefix, int *nrMatches) const;
 
 private:
     int m_currentRow = -1;
@@ -119,6 +135,17 @@ private:
     QStringList m_strings2;
     QStringList m_priorityStrings2;
     QStringList m_filteredStrings;
+    MatchMode m_matchMode = PrefixMatch;
+
+    // Case folded m_strings2, sorted for binary searching prefixes. Each entry also
+    // has the index of the string in m_strings2, which is the order to list them in.
+    struct IndexEntry
+    {
+        QString key;
+        int order = -1;
+        bool operator<(const IndexEntry &other) const { return key < other.key; }
+    };
+    QVector<IndexEntry> m_prefixIndex;
     bool m_filterKeyStrokes = false;
     bool m_acceptEnglishStringsOnly = true;
     int m_minimumCompletionPrefixLength = 0;
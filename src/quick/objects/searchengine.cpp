@@ -13,12 +13,116 @@
 
 #include "hourglass.h"
 #include "searchengine.h"
+#include "timeprofiler.h"
+#include "deferredworkscheduler.h"
 
 #include <QSet>
-#include <QJsonObject>
+#include <QTextBlock>
 #include <QTextCursor>
 #include <QTimerEvent>
 
+SearchResultModel::SearchResultModel(QObject *parent) : QAbstractListModel(parent) { }
+
+SearchResultModel::~SearchResultModel() { }
+
+SearchAgent *SearchResultModel::agentAt(int row) const
+{
+    if (row < 0 || row >= m_records.size())
+        return nullptr;
+
+    return m_agents.value(m_records.at(row).agent);
+}
+
+int SearchResultModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_records.size();
+}
+
+QVariant SearchResultModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_records.size())
+        return QVariant();
+
+    const Record &record = m_records.at(index.row());
+    switch (role) {
+    case AgentRole:
+        return QVariant::fromValue<QObject *>(m_agents.value(record.agent));
+    case BlockRole:
+        return record.block;
+    case StartRole:
+        return record.start;
+    case LengthRole:
+        return record.length;
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> SearchResultModel::roleNames() const
+{
+    return { { AgentRole, QByteArrayLiteral("agent") },
+             { BlockRole, QByteArrayLiteral("block") },
+             { StartRole, QByteArrayLiteral("start") },
+             { LengthRole, QByteArrayLiteral("length") } };
+}
+
+int SearchResultModel::append(SearchAgent *agent, QVector<Record> &records)
+{
+    if (agent == nullptr || records.isEmpty())
+        return -1;
+
+    int agentIndex = m_agents.indexOf(agent);
+    if (agentIndex < 0) {
+        agentIndex = m_agents.size();
+        m_agents.append(agent);
+    }
+
+    for (Record &record : records)
+        record.agent = quint16(agentIndex);
+
+    const int firstRow = m_records.size();
+    this->beginInsertRows(QModelIndex(), firstRow, firstRow + records.size() - 1);
+    m_records += records;
+    this->endInsertRows();
+
+    emit countChanged();
+
+    return firstRow;
+}
+
+void SearchResultModel::remove(SearchAgent *agent, int row, int count)
+{
+    // Slots in the agent table are not reused, so that records of other agents
+    // continue to point to the right agents.
+    const int agentIndex = m_agents.indexOf(agent);
+    if (agentIndex >= 0)
+        m_agents[agentIndex] = nullptr;
+
+    if (row < 0 || count <= 0 || row + count > m_records.size())
+        return;
+
+    this->beginRemoveRows(QModelIndex(), row, row + count - 1);
+    m_records.remove(row, count);
+    this->endRemoveRows();
+
+    emit countChanged();
+}
+
+void SearchResultModel::clear()
+{
+    if (m_records.isEmpty() && m_agents.isEmpty())
+        return;
+
+    this->beginResetModel();
+    m_records.clear();
+    m_agents.clear();
+    this->endResetModel();
+
+    emit countChanged();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 SearchAgent::SearchAgent(QObject *parent)
     : QObject(parent), m_engine(this, "engine"), m_textDocument(this, "textDocument")
 {
@@ -57,6 +161,8 @@ void SearchAgent::setEngine(SearchEngine *val)
 void SearchAgent::resetEngine()
 {
     m_engine = nullptr;
+    m_firstSearchResultRow = -1;
+    m_pendingSearchResults.clear();
 
     this->setSearchResultCount(0);
     this->setCurrentSearchResultIndex(-1);
@@ -106,11 +212,18 @@ void SearchAgent::setCurrentSearchResultIndex(int val)
     m_currentSearchResultIndex = val;
     emit currentSearchResultIndexChanged();
 
-    if (val < 0 || val >= m_textDocumentSearchResults.size())
+    if (val < 0 || m_textDocument == nullptr)
         return;
 
-    const QPair<int, int> result = m_textDocumentSearchResults.at(val);
-    emit highlightText(result.first, result.second);
+    SearchResultModel::Record record;
+    if (!this->searchResult(val, record))
+        return;
+
+    const QTextBlock block = m_textDocument->textDocument()->findBlockByNumber(record.block);
+    if (block.isValid()) {
+        const int start = block.position() + record.start;
+        emit highlightText(start, start + record.length);
+    }
 }
 
 void SearchAgent::setTextDocument(QQuickTextDocument *val)
@@ -137,6 +250,54 @@ void SearchAgent::resetTextDocument()
     this->setTextDocument(nullptr);
 }
 
+void SearchAgent::addSearchResult(int block, int start, int length)
+{
+    SearchResultModel::Record record;
+    record.block = block;
+    record.start = start;
+    record.length = quint16(qBound(0, length, 0xFFFF));
+    m_pendingSearchResults.append(record);
+}
+
+int SearchAgent::addSearchResultsIn(const QString &text, int block)
+{
+    if (m_engine == nullptr)
+        return 0;
+
+    const QVector<QPair<int, int>> ranges =
+            SearchEngine::rangesOf(m_engine->searchString(), text, int(m_engine->searchFlags()));
+    for (const QPair<int, int> &range : ranges)
+        this->addSearchResult(block, range.first, range.second);
+
+    return ranges.size();
+}
+
+QJsonObject SearchAgent::searchResultAt(int index) const
+{
+    SearchResultModel::Record record;
+    if (!this->searchResult(index, record))
+        return QJsonObject();
+
+    // Results of an agent are stored in the order in which they were reported, so
+    // results in the same block are next to each other.
+    int blockResultIndex = 0;
+    const SearchResultModel *results = m_engine->searchResults();
+    for (int row = m_firstSearchResultRow + index - 1; row >= m_firstSearchResultRow; row--) {
+        if (results->at(row).block != record.block)
+            break;
+        ++blockResultIndex;
+    }
+
+    QJsonObject ret;
+    ret.insert(QStringLiteral("block"), record.block);
+    ret.insert(QStringLiteral("start"), record.start);
+    ret.insert(QStringLiteral("length"), record.length);
+    ret.insert(QStringLiteral("from"), record.start);
+    ret.insert(QStringLiteral("to"), record.start + record.length - 1);
+    ret.insert(QStringLiteral("blockResultIndex"), blockResultIndex);
+    return ret;
+}
+
 QJsonArray SearchAgent::indexesOf(const QString &of, const QString &in) const
 {
     SearchEngine::SearchFlags flags;
@@ -156,7 +317,6 @@ void SearchAgent::onSearchRequest(const QString &string)
     if (m_textDocument == nullptr)
         return;
 
-    m_textDocumentSearchResults.clear();
     this->setSearchResultCount(0);
     this->setCurrentSearchResultIndex(-1);
 
@@ -174,25 +334,37 @@ void SearchAgent::onSearchRequest(const QString &string)
         if (cursor.isNull())
             break;
 
-        m_textDocumentSearchResults
-                << qMakePair<int, int>(cursor.selectionStart(), cursor.selectionEnd());
+        const QTextBlock block = document->findBlock(cursor.selectionStart());
+        this->addSearchResult(block.blockNumber(), cursor.selectionStart() - block.position(),
+                              cursor.selectionEnd() - cursor.selectionStart());
         cursor.setPosition(cursor.selectionEnd());
     }
-
-    this->setSearchResultCount(m_textDocumentSearchResults.size());
 }
 
 void SearchAgent::onClearSearchRequest()
 {
-    m_textDocumentSearchResults.clear();
+    m_pendingSearchResults.clear();
+}
+
+bool SearchAgent::searchResult(int index, SearchResultModel::Record &record) const
+{
+    if (m_engine == nullptr || m_firstSearchResultRow < 0 || index < 0
+        || index >= m_searchResultCount)
+        return false;
+
+    const int row = m_firstSearchResultRow + index;
+    if (row >= m_engine->searchResults()->count())
+        return false;
+
+    record = m_engine->searchResults()->at(row);
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 SearchEngine::SearchEngine(QObject *parent)
     : QObject(parent),
-      m_searchTimer("SearchEngine.m_searchTimer"),
-      m_searchAgentSortTimer("SearchEngine.m_searchAgentSortTimer")
+      m_searchTimer("SearchEngine.m_searchTimer")
 {
 }
 
@@ -228,7 +400,7 @@ void SearchEngine::setSearchFlags(SearchFlags val)
 void SearchEngine::setSearchString(const QString &val)
 {
     if (m_searchString == val) {
-        if (m_searchResults.isEmpty())
+        if (m_searchResults->count() == 0)
             this->doSearchLater();
         return;
     }
@@ -243,35 +415,34 @@ void SearchEngine::replace(const QString &string)
 {
     HourGlass hourGlass;
 
-    if (m_currentSearchResultIndex >= 0 && m_currentSearchResultIndex < m_searchResults.size()) {
-        const QPair<SearchAgent *, int> result = m_searchResults.at(m_currentSearchResultIndex);
-        if (result.first != nullptr)
-            result.first->replaceCurrent(string);
-    }
+    SearchAgent *agent = m_searchResults->agentAt(m_currentSearchResultIndex);
+    if (agent != nullptr)
+        agent->replaceCurrent(string);
 }
 
 void SearchEngine::replaceAll(const QString &string)
 {
     HourGlass hourGlass;
 
-    if (m_searchResults.isEmpty())
+    if (m_searchResults->count() == 0)
         return;
 
-    this->setCurrentSearchResultIndex(-1);
+    const QList<SearchAgent *> agents = m_searchResults->m_agents;
+    for (SearchAgent *agent : agents) {
+        if (agent == nullptr)
+            continue;
 
-    SearchAgent *agent = nullptr;
-    while (!m_searchResults.isEmpty()) {
-        const QPair<SearchAgent *, int> result = m_searchResults.takeFirst();
-        if (result.first != agent) {
-            agent = result.first;
-            agent->replaceAll(string);
-            agent->clearHighlight();
-            agent->clearSearchRequest();
-            agent->setSearchResultCount(0);
-            agent->setCurrentSearchResultIndex(-1);
-        }
+        agent->replaceAll(string);
+        agent->clearHighlight();
+        agent->clearSearchRequest();
+        agent->setSearchResultCount(0);
+        agent->setCurrentSearchResultIndex(-1);
+        agent->m_firstSearchResultRow = -1;
     }
 
+    m_searchResults->clear();
+    this->setCurrentSearchResultIndex(-1);
+
     emit searchResultCountChanged();
 }
 
@@ -292,30 +463,27 @@ void SearchEngine::previousSearchResult()
 
 void SearchEngine::cycleSearchResult()
 {
-    if (m_searchResults.isEmpty())
+    if (m_searchResults->count() == 0)
         this->setCurrentSearchResultIndex(-1);
     else {
-        const int newIndex = (m_currentSearchResultIndex + 1) % m_searchResults.size();
+        const int newIndex = (m_currentSearchResultIndex + 1) % m_searchResults->count();
         this->setCurrentSearchResultIndex(newIndex);
     }
 }
 
-QJsonArray SearchEngine::indexesOf(const QString &of, const QString &in, int givenFlags)
+QVector<QPair<int, int>> SearchEngine::rangesOf(const QString &of, const QString &in,
+                                                int givenFlags)
 {
+    QVector<QPair<int, int>> ret;
+    if (of.isEmpty())
+        return ret;
+
     SearchEngine::SearchFlags flags(givenFlags);
     Qt::CaseSensitivity cs = Qt::CaseInsensitive;
 
     if (flags.testFlag(SearchEngine::SearchCaseSensitively))
         cs = Qt::CaseSensitive;
 
-    auto createResultItem = [](int from, int to) {
-        QJsonObject item;
-        item.insert("from", from);
-        item.insert("to", to);
-        return item;
-    };
-
-    QJsonArray ret;
     int from = 0;
     while (1) {
         int pos = in.indexOf(of, from, cs);
@@ -324,9 +492,9 @@ QJsonArray SearchEngine::indexesOf(const QString &of, const QString &in, int giv
 
         if (flags.testFlag(SearchEngine::SearchWholeWords)) {
             if (pos + of.length() >= in.length() || in.at(pos + of.length()).isSpace())
-                ret.append(createResultItem(pos, pos + of.length() - 1));
+                ret.append(qMakePair(pos, of.length()));
         } else
-            ret.append(createResultItem(pos, pos + of.length() - 1));
+            ret.append(qMakePair(pos, of.length()));
 
         from = pos + of.length();
     }
@@ -334,6 +502,21 @@ QJsonArray SearchEngine::indexesOf(const QString &of, const QString &in, int giv
     return ret;
 }
 
+QJsonArray SearchEngine::indexesOf(const QString &of, const QString &in, int flags)
+{
+    const QVector<QPair<int, int>> ranges = SearchEngine::rangesOf(of, in, flags);
+
+    QJsonArray ret;
+    for (const QPair<int, int> &range : ranges) {
+        QJsonObject item;
+        item.insert("from", range.first);
+        item.insert("to", range.first + range.second - 1);
+        ret.append(item);
+    }
+
+    return ret;
+}
+
 QString SearchEngine::createMarkupText(const QString &text, int from, int to, const QBrush &bg,
                                        const QBrush &fg)
 {
@@ -348,11 +531,6 @@ QString SearchEngine::createMarkupText(const QString &text, int from, int to, co
 
 void SearchEngine::timerEvent(QTimerEvent *event)
 {
-    if (event->timerId() == m_searchAgentSortTimer.timerId()) {
-        m_searchAgentSortTimer.stop();
-        this->sortSearchAgents();
-    }
-
     if (event->timerId() == m_searchTimer.timerId()) {
         m_searchTimer.stop();
         this->doSearch();
@@ -382,20 +560,32 @@ void SearchEngine::removeSearchAgent(SearchAgent *ptr)
 
     m_searchAgents.removeAt(index);
 
-    const int oldSearchResultCount = m_searchResults.size();
-    for (int i = m_searchResults.size() - 1; i >= 0; i--) {
-        const QPair<SearchAgent *, int> result = m_searchResults.at(i);
-        if (result.first == ptr)
-            m_searchResults.removeAt(i);
+    const int firstRow = ptr->m_firstSearchResultRow;
+    const int nrResults = firstRow < 0 ? 0 : ptr->searchResultCount();
+    SearchAgent *currentAgent = m_searchResults->agentAt(m_currentSearchResultIndex);
+
+    m_searchResults->remove(ptr, firstRow, nrResults);
+    ptr->m_firstSearchResultRow = -1;
+
+    if (nrResults > 0) {
+        for (SearchAgent *agent : qAsConst(m_searchAgents)) {
+            if (agent->m_firstSearchResultRow > firstRow)
+                agent->m_firstSearchResultRow -= nrResults;
+        }
     }
-    const int newSearchResultCount = m_searchResults.size();
 
     emit searchAgentCountChanged();
     emit searchAgentsChanged();
 
-    if (newSearchResultCount != oldSearchResultCount) {
+    if (nrResults > 0) {
+        if (currentAgent != nullptr && currentAgent != ptr)
+            currentAgent->setCurrentSearchResultIndex(-1);
+        m_currentSearchResultIndex = -1;
+
         emit searchResultCountChanged();
         this->setCurrentSearchResultIndex(0);
+        if (m_currentSearchResultIndex < 0)
+            emit currentSearchResultIndexChanged();
     }
 }
 
@@ -412,7 +602,9 @@ void SearchEngine::sortSearchAgents()
 
 void SearchEngine::sortSearchAgentsLater()
 {
-    m_searchAgentSortTimer.start(0, this);
+    DeferredWorkScheduler::instance()->schedule(this, "SearchEngine.sortSearchAgents",
+                                                DeferredWorkScheduler::NormalPriority, 0,
+                                                [=]() { this->sortSearchAgents(); });
 }
 
 SearchAgent *SearchEngine::staticSearchAgentAt(QQmlListProperty<SearchAgent> *list, int index)
@@ -427,52 +619,55 @@ int SearchEngine::staticSearchAgentCount(QQmlListProperty<SearchAgent> *list)
 
 void SearchEngine::doSearch()
 {
+    PROFILE_THIS_FUNCTION;
+
     HourGlass hourGlass;
 
-    if (!m_searchResults.isEmpty()) {
-        SearchAgent *agent = nullptr;
-        for (const QPair<SearchAgent *, int> &result : qAsConst(m_searchResults)) {
-            if (agent == result.first)
+    if (m_searchResults->count() > 0) {
+        const QList<SearchAgent *> agents = m_searchResults->m_agents;
+        for (SearchAgent *agent : agents) {
+            if (agent == nullptr)
                 continue;
 
-            agent = result.first;
             agent->clearHighlight();
             agent->clearSearchRequest();
             agent->setSearchResultCount(0);
             agent->setCurrentSearchResultIndex(-1);
+            agent->m_firstSearchResultRow = -1;
         }
 
-        m_searchResults.clear();
+        m_searchResults->clear();
         emit searchResultCountChanged();
     }
 
     this->setCurrentSearchResultIndex(-1);
 
-    if (m_searchAgentSortTimer.isActive()) {
-        this->sortSearchAgents();
-        m_searchAgentSortTimer.stop();
-    }
+    DeferredWorkScheduler::instance()->runNow(this, "SearchEngine.sortSearchAgents");
 
     if (m_searchString.isEmpty())
         return;
 
     for (SearchAgent *agent : qAsConst(m_searchAgents)) {
         // Ask the agent to perform search
+        agent->m_pendingSearchResults.clear();
         agent->searchRequest(m_searchString);
 
-        // Collect search results
-        const int nrResults = agent->searchResultCount();
-        for (int i = 0; i < nrResults; i++) {
-            QPair<SearchAgent *, int> result(agent, i);
-            m_searchResults << result;
-        }
+        // Collect search results. Agents that don't report matches only tell us how
+        // many they found, their rows carry no block and offset.
+        QVector<SearchResultModel::Record> records;
+        records.swap(agent->m_pendingSearchResults);
+        if (records.isEmpty())
+            records.resize(agent->searchResultCount());
+        else
+            agent->setSearchResultCount(records.size());
 
+        agent->m_firstSearchResultRow = m_searchResults->append(agent, records);
         agent->setCurrentSearchResultIndex(-1);
     }
 
     emit searchResultCountChanged();
 
-    if (!m_searchResults.isEmpty())
+    if (m_searchResults->count() > 0)
         this->setCurrentSearchResultIndex(0);
 }
 
@@ -483,7 +678,7 @@ void SearchEngine::doSearchLater()
 
 void SearchEngine::setCurrentSearchResultIndex(int val)
 {
-    if (m_searchResults.isEmpty()) {
+    if (m_searchResults->count() == 0) {
         if (m_currentSearchResultIndex != -1) {
             m_currentSearchResultIndex = -1;
             emit currentSearchResultIndexChanged();
@@ -492,20 +687,18 @@ void SearchEngine::setCurrentSearchResultIndex(int val)
         return;
     }
 
-    val = qBound(0, val, m_searchResults.size() - 1);
+    val = qBound(0, val, m_searchResults->count() - 1);
     if (m_currentSearchResultIndex == val)
         return;
 
-    const QPair<SearchAgent *, int> oldResult =
-            (m_currentSearchResultIndex >= 0 && m_currentSearchResultIndex < m_searchResults.size())
-            ? m_searchResults.at(m_currentSearchResultIndex)
-            : qMakePair<SearchAgent *, int>(nullptr, -1);
+    SearchAgent *oldAgent = m_searchResults->agentAt(m_currentSearchResultIndex);
     m_currentSearchResultIndex = val;
-    const QPair<SearchAgent *, int> newResult = m_searchResults.at(m_currentSearchResultIndex);
+    SearchAgent *newAgent = m_searchResults->agentAt(m_currentSearchResultIndex);
 
-    if (oldResult.first != nullptr && oldResult.first != newResult.first)
-        oldResult.first->setCurrentSearchResultIndex(-1);
-    newResult.first->setCurrentSearchResultIndex(newResult.second);
+    if (oldAgent != nullptr && oldAgent != newAgent)
+        oldAgent->setCurrentSearchResultIndex(-1);
+    if (newAgent != nullptr)
+        newAgent->setCurrentSearchResultIndex(val - newAgent->m_firstSearchResultRow);
 
     emit currentSearchResultIndexChanged();
 }
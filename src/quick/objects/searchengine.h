@@ -15,17 +15,69 @@
 #define SEARCHENGINE_H
 
 #include <QObject>
+#include <QVector>
 #include <QJsonArray>
+#include <QJsonObject>
 #include <QQmlEngine>
 #include <QQuickTextDocument>
+#include <QAbstractListModel>
 
 #include "execlatertimer.h"
 #include "errorreport.h"
 #include "progressreport.h"
 #include "qobjectproperty.h"
 
+class SearchAgent;
 class SearchEngine;
 
+/**
+ * Matches reported by search agents of a SearchEngine, in the order of agents. Each match
+ * is stored as a packed 12 byte record, so that even tens of thousands of matches of a
+ * common word take up little memory. Rows are inserted one agent at a time, as agents
+ * report their matches.
+ */
+class SearchResultModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Instantiation from QML not allowed.")
+
+public:
+    ~SearchResultModel();
+
+    struct Record
+    {
+        qint32 block = -1; // paragraph, scene or text block, as the agent defines it
+        qint32 start = -1; // offset of the match within the block
+        quint16 agent = 0; // index into the agent table of the model
+        quint16 length = 0;
+    };
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    int count() const { return m_records.size(); }
+    Q_SIGNAL void countChanged();
+
+    const Record &at(int row) const { return m_records.at(row); }
+    SearchAgent *agentAt(int row) const;
+
+    // QAbstractItemModel interface
+    enum Roles { AgentRole = Qt::UserRole, BlockRole, StartRole, LengthRole };
+    int rowCount(const QModelIndex &parent) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QHash<int, QByteArray> roleNames() const;
+
+private:
+    friend class SearchEngine;
+    SearchResultModel(QObject *parent = nullptr);
+    int append(SearchAgent *agent, QVector<Record> &records); // returns the first row
+    void remove(SearchAgent *agent, int row, int count);
+    void clear();
+
+private:
+    QVector<Record> m_records;
+    QList<SearchAgent *> m_agents;
+};
+
 class SearchAgent : public QObject
 {
     Q_OBJECT
@@ -75,6 +127,15 @@ public:
 
     Q_SIGNAL void clearSearchRequest();
 
+    // While handling searchRequest(), agents report their matches with these functions.
+    // Reported matches make up searchResultCount, agents that report nothing can set
+    // searchResultCount on their own instead.
+    Q_INVOKABLE void addSearchResult(int block, int start, int length);
+    Q_INVOKABLE int addSearchResultsIn(const QString &text, int block = 0);
+
+    // Returns block, start, length, from, to (inclusive) and blockResultIndex of a result
+    Q_INVOKABLE QJsonObject searchResultAt(int index) const;
+
     // Helper function
     Q_INVOKABLE QJsonArray indexesOf(const QString &of, const QString &in) const;
     Q_INVOKABLE QString createMarkupText(const QString &text, int from, int to, const QColor &bg,
@@ -87,13 +148,18 @@ protected:
     void onSearchRequest(const QString &string);
     void onClearSearchRequest();
 
+private:
+    friend class SearchEngine;
+    bool searchResult(int index, SearchResultModel::Record &record) const;
+
 private:
     int m_sequenceNumber = -1;
     int m_searchResultCount = 0;
+    int m_firstSearchResultRow = -1;
     int m_currentSearchResultIndex = -1;
     QObjectProperty<SearchEngine> m_engine;
     QObjectProperty<QQuickTextDocument> m_textDocument;
-    QList<QPair<int, int>> m_textDocumentSearchResults;
+    QVector<SearchResultModel::Record> m_pendingSearchResults;
 };
 
 class SearchEngine : public QObject
@@ -138,8 +204,11 @@ public:
     QString searchString() const { return m_searchString; }
     Q_SIGNAL void searchStringChanged();
 
+    Q_PROPERTY(SearchResultModel* searchResults READ searchResults CONSTANT)
+    SearchResultModel *searchResults() const { return m_searchResults; }
+
     Q_PROPERTY(int searchResultCount READ searchResultCount NOTIFY searchResultCountChanged)
-    int searchResultCount() const { return m_searchResults.size(); }
+    int searchResultCount() const { return m_searchResults->count(); }
     Q_SIGNAL void searchResultCountChanged();
 
     Q_PROPERTY(int currentSearchResultIndex READ currentSearchResultIndex NOTIFY currentSearchResultIndexChanged)
@@ -154,6 +223,8 @@ public:
     Q_INVOKABLE void previousSearchResult();
     Q_INVOKABLE void cycleSearchResult();
 
+    // Start and length of every match of "of" in "in"
+    static QVector<QPair<int, int>> rangesOf(const QString &of, const QString &in, int flags);
     static QJsonArray indexesOf(const QString &of, const QString &in, int flags);
     static QString createMarkupText(const QString &text, int from, int to, const QBrush &bg,
                                     const QBrush &fg);
@@ -181,9 +252,8 @@ private:
     ErrorReport *m_errorReport = new ErrorReport(this);
     int m_currentSearchResultIndex = -1;
     ProgressReport *m_progressReport = new ProgressReport(this);
-    ExecLaterTimer m_searchAgentSortTimer;
     QList<SearchAgent *> m_searchAgents;
-    QList<QPair<SearchAgent *, int>> m_searchResults;
+    SearchResultModel *m_searchResults = new SearchResultModel(this);
 };
 
 class TextDocumentSearch : public QObject
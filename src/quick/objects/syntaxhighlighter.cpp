@@ -18,6 +18,10 @@
 #include "spellcheckservice.h"
 #include "syntaxhighlighter.h"
 
+#include <QTextLayout>
+#include <QAtomicInteger>
+#include <QScopedValueRollback>
+
 AbstractSyntaxHighlighterDelegate::AbstractSyntaxHighlighterDelegate(QObject *parent)
     : QObject(parent)
 {
@@ -45,14 +49,18 @@ void AbstractSyntaxHighlighterDelegate::setEnabled(bool val)
 
 void AbstractSyntaxHighlighterDelegate::rehighlight()
 {
-    if (m_highlighter != nullptr)
+    if (m_highlighter != nullptr) {
+        m_highlighter->invalidateFormatCache();
         m_highlighter->rehighlight();
+    }
 }
 
 void AbstractSyntaxHighlighterDelegate::rehighlightBlock(const QTextBlock &block)
 {
-    if (m_highlighter != nullptr)
+    if (m_highlighter != nullptr) {
+        m_highlighter->invalidateFormatCache(block);
         m_highlighter->rehighlightBlock(block);
+    }
 }
 
 void AbstractSyntaxHighlighterDelegate::documentsContentsChange(int from, int charsRemoved,
@@ -68,6 +76,11 @@ void AbstractSyntaxHighlighterDelegate::documentContentsChanged() { }
 void AbstractSyntaxHighlighterDelegate::mergeFormat(int start, int count,
                                                     const QTextCharFormat &format)
 {
+    if (m_highlighter != nullptr && m_highlighter->m_highlightingBlock) {
+        m_highlighter->mergeDelegateFormat(start, count, format);
+        return;
+    }
+
     for (int i = start; i < start + count; i++) {
         QTextCharFormat mergedFormat = this->format(i);
         mergedFormat.merge(format);
@@ -79,25 +92,27 @@ void AbstractSyntaxHighlighterDelegate::setFormat(int start, int count,
                                                   const QTextCharFormat &format)
 {
     if (m_highlighter != nullptr)
-        m_highlighter->setFormat(start, count, format);
+        m_highlighter->setDelegateFormat(start, count, format);
 }
 
 void AbstractSyntaxHighlighterDelegate::setFormat(int start, int count, const QColor &color)
 {
-    if (m_highlighter != nullptr)
-        m_highlighter->setFormat(start, count, color);
+    QTextCharFormat format;
+    format.setForeground(color);
+    this->setFormat(start, count, format);
 }
 
 void AbstractSyntaxHighlighterDelegate::setFormat(int start, int count, const QFont &font)
 {
-    if (m_highlighter != nullptr)
-        m_highlighter->setFormat(start, count, font);
+    QTextCharFormat format;
+    format.setFont(font);
+    this->setFormat(start, count, format);
 }
 
 QTextCharFormat AbstractSyntaxHighlighterDelegate::format(int pos) const
 {
     if (m_highlighter != nullptr)
-        return m_highlighter->format(pos);
+        return m_highlighter->delegateFormat(pos);
 
     return QTextCharFormat();
 }
@@ -179,12 +194,43 @@ public:
         return m_userDataMap.value(delegate, (QTextBlockUserData *)nullptr);
     }
 
+    // Formats applied to the block, after all delegates ran on it.
+    bool isFormatCacheValid(uint inputHash) const
+    {
+        return m_hasFormatCache && m_formatCacheInputHash == inputHash;
+    }
+    const QVector<QTextLayout::FormatRange> &cachedFormats() const { return m_cachedFormats; }
+    void setFormatCache(uint inputHash, const QVector<QTextLayout::FormatRange> &formats)
+    {
+        m_hasFormatCache = true;
+        m_formatCacheInputHash = inputHash;
+        m_cachedFormats = formats;
+    }
+    void clearFormatCache()
+    {
+        m_hasFormatCache = false;
+        m_cachedFormats.clear();
+    }
+
 private:
     QHash<const AbstractSyntaxHighlighterDelegate *, QTextBlockUserData *> m_userDataMap;
+    bool m_hasFormatCache = false;
+    uint m_formatCacheInputHash = 0;
+    QVector<QTextLayout::FormatRange> m_cachedFormats;
 };
 
+// Handed out to each highlighter, and every time it invalidates its format cache, so
+// that formats cached by one highlighter are never mistaken for another's.
+static uint nextFormatCacheGeneration()
+{
+    static QAtomicInteger<uint> generation(0);
+    return ++generation;
+}
+
 SyntaxHighlighter::SyntaxHighlighter(QObject *parent) : QSyntaxHighlighter(parent)
 {
+    m_formatCacheGeneration = nextFormatCacheGeneration();
+
     connect(this, &SyntaxHighlighter::delegateCountChanged, this,
             &SyntaxHighlighter::sortDelegates);
 
@@ -198,6 +244,7 @@ SyntaxHighlighter::SyntaxHighlighter(QObject *parent) : QSyntaxHighlighter(paren
             this->setTextDocument(qobject_cast<QQuickTextDocument *>(docObj));
         }
 
+        connect(parent, SIGNAL(fontChanged(QFont)), this, SLOT(invalidateFormatCache()));
         connect(parent, SIGNAL(fontChanged(QFont)), this, SLOT(rehighlight()));
     } else if (parent->inherits("QTextDocument"))
         this->setDocument(qobject_cast<QTextDocument *>(parent));
@@ -246,12 +293,84 @@ void SyntaxHighlighter::setTextDocument(QQuickTextDocument *val)
     this->documentContentsChanged();
 }
 
+void SyntaxHighlighter::setFused(bool val)
+{
+    if (m_fused == val)
+        return;
+
+    m_fused = val;
+    emit fusedChanged();
+
+    this->invalidateFormatCache();
+}
+
+void SyntaxHighlighter::invalidateFormatCache()
+{
+    m_formatCacheGeneration = nextFormatCacheGeneration();
+}
+
+void SyntaxHighlighter::invalidateFormatCache(const QTextBlock &block)
+{
+    SyntaxHighlighterUserData *userData =
+            static_cast<SyntaxHighlighterUserData *>(block.userData());
+    if (userData != nullptr)
+        userData->clearFormatCache();
+}
+
 void SyntaxHighlighter::highlightBlock(const QString &text)
 {
-    for (AbstractSyntaxHighlighterDelegate *delegate : qAsConst(m_sortedDelegates)) {
-        if (delegate->isEnabled())
-            delegate->highlightBlock(text);
+    if (!m_fused) {
+        for (AbstractSyntaxHighlighterDelegate *delegate : qAsConst(m_sortedDelegates)) {
+            if (delegate->isEnabled())
+                delegate->highlightBlock(text);
+        }
+        return;
     }
+
+    const QTextBlock block = this->currentBlock();
+    SyntaxHighlighterUserData *userData = static_cast<SyntaxHighlighterUserData *>(
+            this->QSyntaxHighlighter::currentBlockUserData());
+    if (userData == nullptr) {
+        userData = new SyntaxHighlighterUserData;
+        this->QSyntaxHighlighter::setCurrentBlockUserData(userData);
+    }
+
+    const uint inputHash = this->evaluateBlockInputHash(text, block);
+    if (!userData->isFormatCacheValid(inputHash)) {
+        m_blockFormats.fill(QTextCharFormat(), text.length());
+
+        {
+            QScopedValueRollback<bool> rollback(m_highlightingBlock, true);
+            for (AbstractSyntaxHighlighterDelegate *delegate : qAsConst(m_sortedDelegates)) {
+                if (delegate->isEnabled())
+                    delegate->highlightBlock(text);
+            }
+        }
+
+        // Adjacent characters with the same format are applied as one range.
+        QVector<QTextLayout::FormatRange> formats;
+        for (int i = 0; i < m_blockFormats.size();) {
+            int j = i + 1;
+            while (j < m_blockFormats.size() && m_blockFormats.at(j) == m_blockFormats.at(i))
+                ++j;
+
+            if (m_blockFormats.at(i).propertyCount() > 0) {
+                QTextLayout::FormatRange range;
+                range.start = i;
+                range.length = j - i;
+                range.format = m_blockFormats.at(i);
+                formats.append(range);
+            }
+
+            i = j;
+        }
+
+        m_blockFormats.clear();
+        userData->setFormatCache(inputHash, formats);
+    }
+
+    for (const QTextLayout::FormatRange &range : userData->cachedFormats())
+        this->QSyntaxHighlighter::setFormat(range.start, range.length, range.format);
 }
 
 QQmlListProperty<AbstractSyntaxHighlighterDelegate> SyntaxHighlighter::delegates()
@@ -351,6 +470,8 @@ int SyntaxHighlighter::staticDelegateCount(
 
 void SyntaxHighlighter::sortDelegates()
 {
+    this->invalidateFormatCache();
+
     m_sortedDelegates = m_delegates;
     std::sort(m_sortedDelegates.begin(), m_sortedDelegates.end(),
               [](AbstractSyntaxHighlighterDelegate *a, AbstractSyntaxHighlighterDelegate *b) {
@@ -425,11 +546,73 @@ void SyntaxHighlighter::documentContentsChanged()
         delegate->documentContentsChanged();
 }
 
+void SyntaxHighlighter::setDelegateFormat(int start, int count, const QTextCharFormat &format)
+{
+    if (!m_highlightingBlock) {
+        this->setFormat(start, count, format);
+        return;
+    }
+
+    const int end = qMin(start + count, m_blockFormats.size());
+    for (int i = qMax(start, 0); i < end; i++)
+        m_blockFormats[i] = format;
+}
+
+void SyntaxHighlighter::mergeDelegateFormat(int start, int count, const QTextCharFormat &format)
+{
+    const int end = qMin(start + count, m_blockFormats.size());
+    for (int i = qMax(start, 0); i < end; i++)
+        m_blockFormats[i].merge(format);
+}
+
+QTextCharFormat SyntaxHighlighter::delegateFormat(int pos) const
+{
+    if (!m_highlightingBlock)
+        return this->format(pos);
+
+    return pos >= 0 && pos < m_blockFormats.size() ? m_blockFormats.at(pos) : QTextCharFormat();
+}
+
+uint SyntaxHighlighter::evaluateBlockInputHash(const QString &text, const QTextBlock &block) const
+{
+    // Everything delegates look at, other than their own properties and fonts preferred for
+    // languages. Changes to those invalidate the cache through
+    // AbstractSyntaxHighlighterDelegate::rehighlight().
+    uint ret = qHash(text, m_formatCacheGeneration);
+    const auto combine = [&ret](uint val) { ret ^= val + 0x9e3779b9 + (ret << 6) + (ret >> 2); };
+    combine(qHash(block.position()));
+    combine(qHash(block.blockFormat().headingLevel()));
+    combine(qHash(this->previousBlockState()));
+
+    // QTextDocument doesn't notify changes to its default font, so it is hashed instead.
+    if (const QTextDocument *doc = this->document()) {
+        const QFont defaultFont = doc->defaultFont();
+        combine(qHash(defaultFont.family()));
+        combine(qHash(defaultFont.pointSizeF()));
+        combine(qHash(defaultFont.pixelSize()));
+        combine(qHash(defaultFont.weight()));
+        combine(qHash(defaultFont.italic()));
+    }
+
+    uint enabledDelegates = 0;
+    for (int i = 0; i < m_sortedDelegates.size() && i < 32; i++) {
+        if (m_sortedDelegates.at(i)->isEnabled())
+            enabledDelegates |= 1u << i;
+    }
+    combine(qHash(enabledDelegates));
+
+    return ret;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 LanguageFontSyntaxHighlighterDelegate::LanguageFontSyntaxHighlighterDelegate(QObject *parent)
     : AbstractSyntaxHighlighterDelegate(parent)
 {
+    // Fonts picked for languages are not part of the format cache's input hash.
+    connect(TransliterationEngine::instance(),
+            &TransliterationEngine::preferredFontFamilyForLanguageChanged, this,
+            &LanguageFontSyntaxHighlighterDelegate::rehighlight);
 }
 
 LanguageFontSyntaxHighlighterDelegate::~LanguageFontSyntaxHighlighterDelegate() { }
@@ -468,7 +651,6 @@ void LanguageFontSyntaxHighlighterDelegate::highlightBlock(const QString &text)
                 ? m_defaultFont.value<QFont>()
                 : doc->defaultFont();
         const QTextBlock block = this->currentBlock();
-        qDebug() << "PAF: " << defaultFont;
 
         QTextCharFormat defaultFormat;
         defaultFormat.setFont(defaultFont);
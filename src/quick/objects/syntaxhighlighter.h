@@ -116,6 +116,20 @@ public:
     QQuickTextDocument *textDocument() const { return m_textDocument; }
     Q_SIGNAL void textDocumentChanged();
 
+    // When fused, delegates write into a format buffer for the block, which is applied
+    // to the block in one go after all delegates have run. Formats applied to a block
+    // are cached along with a hash of its inputs. Blocks whose inputs haven't changed
+    // since get the cached formats, without running any delegates.
+    Q_PROPERTY(bool fused READ isFused WRITE setFused NOTIFY fusedChanged)
+    void setFused(bool val);
+    bool isFused() const { return m_fused; }
+    Q_SIGNAL void fusedChanged();
+
+    // Causes delegates to be run for all blocks on the next rehighlight, even if
+    // their inputs haven't changed.
+    Q_SLOT void invalidateFormatCache();
+    void invalidateFormatCache(const QTextBlock &block);
+
 protected:
     // QSyntaxHighlighter interface
     void highlightBlock(const QString &text);
@@ -188,10 +202,22 @@ private:
     void documentContentsChange(int from, int charsRemoved, int charsAdded);
     void documentContentsChanged();
 
+    // Used by delegates, these write into m_blockFormats while a block is being
+    // highlighted in fused mode.
+    void setDelegateFormat(int start, int count, const QTextCharFormat &format);
+    void mergeDelegateFormat(int start, int count, const QTextCharFormat &format);
+    QTextCharFormat delegateFormat(int pos) const;
+
+    uint evaluateBlockInputHash(const QString &text, const QTextBlock &block) const;
+
 private:
     friend class AbstractSyntaxHighlighterDelegate;
     QQuickTextDocument *m_textDocument = nullptr;
     QList<AbstractSyntaxHighlighterDelegate *> m_delegates, m_sortedDelegates;
+    bool m_fused = true;
+    bool m_highlightingBlock = false;
+    uint m_formatCacheGeneration = 0;
+    QVector<QTextCharFormat> m_blockFormats;
 };
 
 class LanguageFontSyntaxHighlighterDelegate : public AbstractSyntaxHighlighterDelegate
@@ -14,6 +14,7 @@
 #include "form.h"
 #include "deltadocument.h"
 #include "characterreport.h"
+#include "timeprofiler.h"
 #include "transliteration.h"
 
 #include <QTextTable>
@@ -64,6 +65,8 @@ void CharacterReport::setIncludeNotes(bool val)
 
 bool CharacterReport::doGenerate(QTextDocument *textDocument)
 {
+    PROFILE_THIS_FUNCTION;
+
     if (m_characterNames.isEmpty()) {
         this->error()->setErrorMessage("No character was selected for report generation.");
         return false;
@@ -393,6 +396,8 @@ bool CharacterReport::doGenerate(QTextDocument *textDocument)
         cursor.insertBlock(blockFormat, charFormat);
         cursor.insertText("DETAIL:");
 
+        const SceneIncidenceIndex *incidenceIndex =
+                this->document()->structure()->incidenceIndex();
         const int nrScenes = screenplay->elementCount();
         for (int i = 0; i < nrScenes; i++) {
             QTextTable *dialogueTable = nullptr;
@@ -407,7 +412,7 @@ bool CharacterReport::doGenerate(QTextDocument *textDocument)
 
             bool sceneHasSaidCharacters = false;
             for (const QString &characterName : qAsConst(m_characterNames)) {
-                if (scene->characterNames().contains(characterName)) {
+                if (incidenceIndex->hasCharacter(scene, characterName)) {
                     sceneCount[characterName] = sceneCount.value(characterName, 0) + 1;
 
                     if (sceneInfoWritten == false && m_includeSceneHeadings) {
@@ -522,7 +527,7 @@ bool CharacterReport::doGenerate(QTextDocument *textDocument)
             QStringList muteCharacters;
             for (const QString &characterName : qAsConst(m_characterNames)) {
                 if (characterHasDialogue.value(characterName, false) == false
-                    && scene->characterNames().contains(characterName)) {
+                    && incidenceIndex->hasCharacter(scene, characterName)) {
                     muteCharacters << characterName;
                 }
             }
@@ -12,6 +12,7 @@
 ****************************************************************************/
 
 #include "locationreport.h"
+#include "timeprofiler.h"
 #include "transliteration.h"
 
 LocationReport::LocationReport(QObject *parent) : AbstractReportGenerator(parent) { }
@@ -20,6 +21,8 @@ LocationReport::~LocationReport() { }
 
 bool LocationReport::doGenerate(QTextDocument *textDocument)
 {
+    PROFILE_THIS_FUNCTION;
+
     static const int snippetLength = 40;
     const Structure *structure = this->document()->structure();
     const Screenplay *screenplay = this->document()->screenplay();
@@ -16,6 +16,7 @@
 #include "notes.h"
 #include "scene.h"
 #include "structure.h"
+#include "timeprofiler.h"
 #include "screenplay.h"
 #include "application.h"
 #include "screenplaytextdocument.h"
@@ -109,6 +110,8 @@ QString NotebookReport::polishFileName(const QString &fileName) const
 
 bool NotebookReport::doGenerate(QTextDocument *doc)
 {
+    PROFILE_THIS_FUNCTION;
+
     ScriteDocument *scriteDocument = this->document();
     Screenplay *screenplay = scriteDocument->screenplay();
     Structure *structure = scriteDocument->structure();
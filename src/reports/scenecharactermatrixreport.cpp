@@ -12,6 +12,7 @@
 ****************************************************************************/
 
 #include "scenecharactermatrixreport.h"
+#include "timeprofiler.h"
 #include "transliteration.h"
 
 #include <QPrinter>
@@ -117,6 +118,8 @@ struct CreateColumnHeadingImageFunctor
 
 bool SceneCharacterMatrixReport::doGenerate(QTextDocument *document)
 {
+    PROFILE_THIS_FUNCTION;
+
     const Screenplay *screenplay = this->document()->screenplay();
     QList<ScreenplayElement *> allScreenplayElements = this->getScreenplayElements();
     QList<ScreenplayElement *> screenplayElements; // ones that are not emotted
@@ -269,26 +272,27 @@ bool SceneCharacterMatrixReport::doGenerate(QTextDocument *document)
     }
 
     // Mark cells
-    int sceneNumber = 0;
+    QList<Scene *> scenes;
     for (const ScreenplayElement *element : qAsConst(screenplayElements)) {
-        const Scene *scene = element->scene();
-        if (scene) {
-            const QStringList characters = scene->characterNames();
-            for (const QString &character : characters) {
-                const int row =
-                        m_type == SceneVsCharacter ? sceneNumber : rowHeadings.indexOf(character);
-                const int column = m_type == SceneVsCharacter ? columnHeadings.indexOf(character)
-                                                              : sceneNumber;
-                if (row < 0 || column < 0)
-                    continue;
-
-                QTextTableCell cell = table->cellAt(row + 1, column + 1);
-                QTextBlockFormat cellFormat;
-                cellFormat.setBackground(Qt::black);
-                cell.firstCursorPosition().setBlockFormat(cellFormat);
-            }
+        if (element->scene())
+            scenes.append(element->scene());
+    }
+
+    const SceneIncidenceIndex *index = this->document()->structure()->incidenceIndex();
+    const QVector<QVector<int>> presence = index->characterPresenceMatrix(scenes, m_characterNames);
+    for (int characterIndex = 0; characterIndex < presence.size(); characterIndex++) {
+        const QVector<int> &characterPresence = presence.at(characterIndex);
+        for (int sceneNumber = 0; sceneNumber < characterPresence.size(); sceneNumber++) {
+            if (characterPresence.at(sceneNumber) == 0)
+                continue;
+
+            const int row = m_type == SceneVsCharacter ? sceneNumber : characterIndex;
+            const int column = m_type == SceneVsCharacter ? characterIndex : sceneNumber;
 
-            ++sceneNumber;
+            QTextTableCell cell = table->cellAt(row + 1, column + 1);
+            QTextBlockFormat cellFormat;
+            cellFormat.setBackground(Qt::black);
+            cell.firstCursorPosition().setBlockFormat(cellFormat);
         }
     }
 
@@ -344,6 +348,14 @@ bool SceneCharacterMatrixReport::directExportToOdf(QIODevice *device)
     }
     ts << "\n";
 
+    QList<Scene *> scenes;
+    scenes.reserve(screenplayElements.size());
+    for (const ScreenplayElement *element : qAsConst(screenplayElements))
+        scenes.append(element->scene());
+
+    const SceneIncidenceIndex *index = this->document()->structure()->incidenceIndex();
+    const QVector<QVector<int>> presence = index->characterPresenceMatrix(scenes, m_characterNames);
+
     // Row contents
     const QString checkMark = m_marker.isEmpty() ? QStringLiteral("✓") : escapeComma(m_marker);
     for (int i = 0; i < nrRows; i++) {
@@ -362,18 +374,9 @@ bool SceneCharacterMatrixReport::directExportToOdf(QIODevice *device)
         for (int j = 0; j < nrCols; j++) {
             ts << ",";
 
-            Scene *scene = nullptr;
-            QString characterName;
-
-            if (m_type == SceneVsCharacter) {
-                scene = screenplayElements.at(i)->scene();
-                characterName = m_characterNames.at(j);
-            } else {
-                scene = screenplayElements.at(j)->scene();
-                characterName = m_characterNames.at(i);
-            }
-
-            if (scene->characterNames().contains(characterName))
+            const int sceneIndex = m_type == SceneVsCharacter ? i : j;
+            const int characterIndex = m_type == SceneVsCharacter ? j : i;
+            if (presence.at(characterIndex).at(sceneIndex) > 0)
                 ts << checkMark;
         }
 
@@ -20,6 +20,7 @@
 #include "screenplay.h"
 #include "application.h"
 #include "scritedocument.h"
+#include "timeprofiler.h"
 
 #include <QTextTable>
 #include <QScopeGuard>
@@ -408,6 +409,8 @@ QList<StatisticsReport::Distribution> StatisticsReport::episodeDistribution() co
 
 bool StatisticsReport::doGenerate(QTextDocument *textDocument)
 {
+    PROFILE_THIS_FUNCTION;
+
     auto guard = qScopeGuard([=]() { this->cleanupTextDocument(); });
     this->prepareTextDocument();
 
@@ -924,11 +924,17 @@ StatisticsReportTimeline::evalCharacterPresence(const StatisticsReport *report)
     const QStringList characterNames =
             specificCharacterNames.isEmpty() ? allCharacterNames : specificCharacterNames;
 
+    const SceneIncidenceIndex *index = structure->incidenceIndex();
     QList<QPair<QString, QList<int>>> ret = this->evalPresence(
-            report, characterNames, [](const Scene *scene, const QString &characterName) -> int {
-                return scene->hasCharacter(characterName)
-                        ? scene->characterPresence(characterName) + 2
-                        : 0;
+            report, characterNames,
+            [index](const QList<Scene *> &scenes,
+                    const QStringList &names) -> QVector<QVector<int>> {
+                QVector<QVector<int>> matrix = index->characterPresenceMatrix(scenes, names);
+                for (QVector<int> &row : matrix) {
+                    for (int &presence : row)
+                        presence = presence > 0 ? presence + 2 : 0;
+                }
+                return matrix;
             });
     if (!specificCharacterNames.isEmpty())
         ret = ret.mid(0, specificCharacterNames.size());
@@ -946,14 +952,30 @@ StatisticsReportTimeline::evalLocationPresence(const StatisticsReport *report) c
     const QStringList specificLocations = report->locations();
     const QStringList locations = specificLocations.isEmpty() ? allLocations : specificLocations;
 
-    QString lastLocation;
+    const SceneIncidenceIndex *index = structure->incidenceIndex();
     QList<QPair<QString, QList<int>>> ret = this->evalPresence(
-            report, locations, [&lastLocation](const Scene *scene, const QString &location) -> int {
-                const QString sceneLocation =
-                        scene->heading()->isEnabled() ? scene->heading()->location() : lastLocation;
-                const int ret = sceneLocation == location ? 10 : 0;
-                lastLocation = sceneLocation;
-                return ret;
+            report, locations,
+            [index](const QList<Scene *> &scenes,
+                    const QStringList &names) -> QVector<QVector<int>> {
+                QHash<QString, int> rows;
+                for (int i = 0; i < names.size(); i++)
+                    rows.insert(names.at(i), i);
+
+                // Scenes without a heading continue in the location of the previous scene.
+                QVector<QVector<int>> matrix(names.size(), QVector<int>(scenes.size(), 0));
+                QString lastLocation;
+                for (int i = 0; i < scenes.size(); i++) {
+                    Scene *scene = scenes.at(i);
+                    const QString sceneLocation = scene->heading()->isEnabled()
+                            ? index->location(scene)
+                            : lastLocation;
+                    const int row = rows.value(sceneLocation, -1);
+                    if (row >= 0)
+                        matrix[row][i] = 10;
+                    lastLocation = sceneLocation;
+                }
+
+                return matrix;
             });
 
     if (!specificLocations.isEmpty())
@@ -966,28 +988,39 @@ StatisticsReportTimeline::evalLocationPresence(const StatisticsReport *report) c
 
 QList<QPair<QString, QList<int>>> StatisticsReportTimeline::evalPresence(
         const StatisticsReport *report, const QStringList &allNames,
-        std::function<int(const Scene *, const QString &)> determinePresenceFunc) const
+        std::function<QVector<QVector<int>>(const QList<Scene *> &, const QStringList &)>
+                evalPresenceMatrixFunc) const
 {
-    QList<QPair<QString, QList<int>>> ret;
-
     const Screenplay *screenplay = report->document()->screenplay();
     const QList<ScreenplayElement *> sceneElements = screenplay->getFilteredElements(
             [](ScreenplayElement *e) { return e->scene() != nullptr && !e->isOmitted(); });
 
-    for (const QString &name : allNames)
-        ret << qMakePair(name, QList<int>());
+    QList<Scene *> scenes;
+    scenes.reserve(sceneElements.size());
+    for (const auto sceneElement : sceneElements)
+        scenes.append(sceneElement->scene());
 
-    for (const auto sceneElement : sceneElements) {
-        auto scene = sceneElement->scene();
-        for (auto &pair : ret)
-            pair.second.append(determinePresenceFunc(scene, pair.first));
+    const QVector<QVector<int>> matrix = evalPresenceMatrixFunc(scenes, allNames);
+
+    // Totals are computed once up front, instead of within the sort comparator.
+    struct Presence
+    {
+        int row = -1;
+        int total = 0;
+    };
+    QVector<Presence> presences(matrix.size());
+    for (int i = 0; i < matrix.size(); i++) {
+        presences[i].row = i;
+        presences[i].total = std::accumulate(matrix[i].begin(), matrix[i].end(), 0);
     }
 
-    std::sort(ret.begin(), ret.end(),
-              [](const QPair<QString, QList<int>> &a, const QPair<QString, QList<int>> &b) {
-                  return std::accumulate(a.second.begin(), a.second.end(), 0)
-                          > std::accumulate(b.second.begin(), b.second.end(), 0);
-              });
+    std::stable_sort(presences.begin(), presences.end(),
+                     [](const Presence &a, const Presence &b) { return a.total > b.total; });
+
+    QList<QPair<QString, QList<int>>> ret;
+    ret.reserve(presences.size());
+    for (const Presence &presence : qAsConst(presences))
+        ret << qMakePair(allNames.at(presence.row), matrix.at(presence.row).toList());
 
     return ret;
 }
@@ -62,7 +62,8 @@ private:
     QList<QPair<QString, QList<int>>> evalLocationPresence(const StatisticsReport *report) const;
     QList<QPair<QString, QList<int>>>
     evalPresence(const StatisticsReport *report, const QStringList &allNames,
-                 std::function<int(const Scene *, const QString &)> determinePresenceFunc) const;
+                 std::function<QVector<QVector<int>>(const QList<Scene *> &, const QStringList &)>
+                         evalPresenceMatrixFunc) const;
 
     QGraphicsRectItem *
     createCharacterPresenceGraph(const StatisticsReport *report, QGraphicsItem *container,
@@ -0,0 +1,65 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "callgraph.h"
+
+#include <QHash>
+#include <QMutex>
+
+namespace {
+
+struct CallGraphRegistry
+{
+    QMutex mutex;
+    QHash<QByteArray, CallGraph::Capture> captures;
+};
+
+Q_GLOBAL_STATIC(CallGraphRegistry, callGraphRegistry)
+
+} // namespace
+
+void CallGraph::capture(const char *context)
+{
+    const QList<const char *> stack = TimeProfiler::currentStack();
+
+    QByteArray key = context;
+    for (const char *caller : stack)
+        key += '\n' + QByteArray(caller);
+
+    CallGraphRegistry *registry = callGraphRegistry;
+    QMutexLocker locker(&registry->mutex);
+
+    Capture &capture = registry->captures[key];
+    if (capture.count == 0) {
+        capture.context = QString::fromLatin1(context);
+        for (const char *caller : stack)
+            capture.callers << QString::fromLatin1(caller);
+        capture.firstCaptureNs = TimeProfiler::timestampNs();
+        capture.threadId = TimeProfiler::currentThreadId();
+    }
+    ++capture.count;
+}
+
+QList<CallGraph::Capture> CallGraph::captures()
+{
+    CallGraphRegistry *registry = callGraphRegistry;
+    QMutexLocker locker(&registry->mutex);
+    return registry->captures.values();
+}
+
+void CallGraph::reset()
+{
+    CallGraphRegistry *registry = callGraphRegistry;
+    QMutexLocker locker(&registry->mutex);
+    registry->captures.clear();
+}
@@ -14,7 +14,45 @@
 #ifndef CALLGRAPH_H
 #define CALLGRAPH_H
 
-#define CAPTURE_CALL_GRAPH
-#define CAPTURE_FIRST_CALL_GRAPH
+#include "timeprofiler.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Records the chain of profiled scopes (see PROFILE_THIS_FUNCTION) that lead up
+ * to a call. Identical chains are captured once and counted. Captures are recorded
+ * only while TimeProfiler is enabled, and are included in its Chrome trace output.
+ */
+class CallGraph
+{
+public:
+    struct Capture
+    {
+        QString context;
+        QStringList callers; // outermost first
+        quint64 count = 0;
+        qint64 firstCaptureNs = 0;
+        int threadId = 0;
+    };
+
+    static void capture(const char *context);
+    static QList<Capture> captures();
+    static void reset();
+};
+
+#define CAPTURE_CALL_GRAPH                                                                         \
+    do {                                                                                           \
+        if (TimeProfiler::isEnabled())                                                             \
+            CallGraph::capture(Q_FUNC_INFO);                                                       \
+    } while (0)
+
+#define CAPTURE_FIRST_CALL_GRAPH                                                                   \
+    do {                                                                                           \
+        static std::atomic<bool> _callGraphCaptured_(false);                                       \
+        if (TimeProfiler::isEnabled() && !_callGraphCaptured_.exchange(true))                      \
+            CallGraph::capture(Q_FUNC_INFO);                                                       \
+    } while (0)
 
 #endif // CALLGRAPH_H
@@ -0,0 +1,329 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "deferredworkscheduler.h"
+
+#include <QThread>
+#include <QTimerEvent>
+#include <QCoreApplication>
+
+static DeferredWorkScheduler *theInstance = nullptr;
+
+DeferredWorkScheduler *DeferredWorkScheduler::instance()
+{
+    // Objects destroyed after qApp's children may still cancel their work. They get a
+    // fresh (empty) scheduler rather than a dangling one.
+    if (theInstance == nullptr)
+        theInstance = new DeferredWorkScheduler(qApp);
+    return theInstance;
+}
+
+DeferredWorkScheduler::DeferredWorkScheduler(QObject *parent) : QObject(parent)
+{
+    m_clock.start();
+    m_lastUserInputNs = -qint64(m_idleDelay) * 1000000;
+}
+
+DeferredWorkScheduler::~DeferredWorkScheduler()
+{
+    m_timer.stop();
+
+    if (theInstance == this)
+        theInstance = nullptr;
+}
+
+void DeferredWorkScheduler::schedule(QObject *receiver, const char *key, Priority priority,
+                                     int delay, const std::function<void()> &func)
+{
+    if (receiver == nullptr || key == nullptr || !func)
+        return;
+
+    if (QThread::currentThread() != this->thread()) {
+        const QPointer<QObject> receiverPtr(receiver);
+        QMetaObject::invokeMethod(
+                this,
+                [=]() {
+                    if (!receiverPtr.isNull())
+                        this->schedule(receiverPtr, key, priority, delay, func);
+                },
+                Qt::QueuedConnection);
+        return;
+    }
+
+    const JobKey jobKey(receiver, QByteArray::fromRawData(key, int(qstrlen(key))));
+    const QueuePosition position(m_clock.nsecsElapsed() + qint64(qMax(delay, 0)) * 1000000,
+                                 m_nextSequence++);
+
+    auto it = m_jobs.find(jobKey);
+    if (it != m_jobs.end()) {
+        Job &job = it.value();
+        m_queues[job.priority].erase(job.position);
+        ++m_coalescedCount;
+    } else {
+        it = m_jobs.insert(jobKey, Job());
+        m_peakQueueDepth = qMax(m_peakQueueDepth, m_jobs.size());
+
+        // Keys hold raw pointers, which may be reused by objects created later.
+        connect(receiver, &QObject::destroyed, this, &DeferredWorkScheduler::onReceiverDestroyed,
+                Qt::UniqueConnection);
+    }
+
+    Job &job = it.value();
+    job.receiver = receiver;
+    job.priority = priority;
+    job.position = position;
+    job.func = func;
+    m_queues[priority].emplace(position, jobKey);
+
+    this->rearm();
+    this->emitMetricsChangedLater();
+}
+
+void DeferredWorkScheduler::cancel(QObject *receiver, const char *key)
+{
+    if (receiver == nullptr || key == nullptr)
+        return;
+
+    if (QThread::currentThread() != this->thread()) {
+        // Queued after any schedule() made from the same thread, so it cancels that too
+        const QPointer<QObject> receiverPtr(receiver);
+        QMetaObject::invokeMethod(
+                this,
+                [=]() {
+                    if (!receiverPtr.isNull())
+                        this->cancel(receiverPtr, key);
+                },
+                Qt::QueuedConnection);
+        return;
+    }
+
+    const JobKey jobKey(receiver, QByteArray::fromRawData(key, int(qstrlen(key))));
+    auto it = m_jobs.find(jobKey);
+    if (it == m_jobs.end())
+        return;
+
+    m_queues[it.value().priority].erase(it.value().position);
+    m_jobs.erase(it);
+}
+
+bool DeferredWorkScheduler::isScheduled(QObject *receiver, const char *key) const
+{
+    if (receiver == nullptr || key == nullptr)
+        return false;
+
+    const JobKey jobKey(receiver, QByteArray::fromRawData(key, int(qstrlen(key))));
+    return m_jobs.contains(jobKey);
+}
+
+bool DeferredWorkScheduler::runNow(QObject *receiver, const char *key)
+{
+    if (!this->isScheduled(receiver, key))
+        return false;
+
+    this->run(JobKey(receiver, QByteArray::fromRawData(key, int(qstrlen(key)))));
+    return true;
+}
+
+void DeferredWorkScheduler::setFrameBudget(int val)
+{
+    val = qMax(val, 1);
+    if (m_frameBudget == val)
+        return;
+
+    m_frameBudget = val;
+    emit frameBudgetChanged();
+}
+
+void DeferredWorkScheduler::setIdleDelay(int val)
+{
+    val = qMax(val, 0);
+    if (m_idleDelay == val)
+        return;
+
+    m_idleDelay = val;
+    emit idleDelayChanged();
+
+    this->rearm();
+}
+
+void DeferredWorkScheduler::setIdleDeadline(int val)
+{
+    val = qMax(val, 0);
+    if (m_idleDeadline == val)
+        return;
+
+    m_idleDeadline = val;
+    emit idleDeadlineChanged();
+
+    this->rearm();
+}
+
+qreal DeferredWorkScheduler::averageLatency() const
+{
+    return m_executedCount > 0 ? qreal(m_totalLatencyNs) / 1e6 / qreal(m_executedCount) : 0;
+}
+
+QJsonObject DeferredWorkScheduler::metrics() const
+{
+    QJsonObject ret;
+    ret.insert(QStringLiteral("queueDepth"), this->queueDepth());
+    ret.insert(QStringLiteral("highPriorityQueueDepth"), int(m_queues[HighPriority].size()));
+    ret.insert(QStringLiteral("normalPriorityQueueDepth"), int(m_queues[NormalPriority].size()));
+    ret.insert(QStringLiteral("idlePriorityQueueDepth"), int(m_queues[IdlePriority].size()));
+    ret.insert(QStringLiteral("peakQueueDepth"), m_peakQueueDepth);
+    ret.insert(QStringLiteral("executedCount"), m_executedCount);
+    ret.insert(QStringLiteral("coalescedCount"), m_coalescedCount);
+    ret.insert(QStringLiteral("averageLatency"), this->averageLatency());
+    ret.insert(QStringLiteral("maximumLatency"), this->maximumLatency());
+    return ret;
+}
+
+void DeferredWorkScheduler::resetMetrics()
+{
+    m_peakQueueDepth = m_jobs.size();
+    m_executedCount = 0;
+    m_coalescedCount = 0;
+    m_totalLatencyNs = 0;
+    m_maxLatencyNs = 0;
+    emit metricsChanged();
+}
+
+void DeferredWorkScheduler::timerEvent(QTimerEvent *te)
+{
+    if (te->timerId() != m_timer.timerId()) {
+        QObject::timerEvent(te);
+        return;
+    }
+
+    m_timer.stop();
+    m_timerDueNs = -1;
+
+    const qint64 startNs = m_clock.nsecsElapsed();
+    const qint64 budgetEndNs = startNs + qint64(m_frameBudget) * 1000000;
+
+    for (int priority = HighPriority; priority <= IdlePriority; priority++) {
+        std::map<QueuePosition, JobKey> &queue = m_queues[priority];
+        while (!queue.empty() && queue.begin()->first.first <= startNs) {
+            if (priority != HighPriority && m_clock.nsecsElapsed() >= budgetEndNs)
+                break;
+
+            if (priority == IdlePriority
+                && !this->isIdleWorkDue(queue.begin()->first.first, startNs))
+                break;
+
+            // Work may schedule or cancel other work, so the queue is looked
+            // up afresh every time.
+            const JobKey key = queue.begin()->second;
+            this->run(key);
+        }
+    }
+
+    this->rearm();
+
+    if (m_jobs.isEmpty())
+        emit metricsChanged();
+    else
+        this->emitMetricsChangedLater();
+}
+
+void DeferredWorkScheduler::run(const JobKey &key)
+{
+    auto it = m_jobs.find(key);
+    if (it == m_jobs.end())
+        return;
+
+    const Job job = it.value();
+    m_queues[job.priority].erase(job.position);
+    m_jobs.erase(it);
+
+    if (job.receiver.isNull())
+        return;
+
+    const qint64 latencyNs = qMax(m_clock.nsecsElapsed() - job.position.first, qint64(0));
+    m_totalLatencyNs += latencyNs;
+    m_maxLatencyNs = qMax(m_maxLatencyNs, latencyNs);
+    ++m_executedCount;
+
+    if (job.receiver->thread() != this->thread()) {
+        QMetaObject::invokeMethod(job.receiver.data(), job.func, Qt::QueuedConnection);
+        return;
+    }
+
+    job.func();
+}
+
+void DeferredWorkScheduler::onReceiverDestroyed(QObject *receiver)
+{
+    // Receivers in other threads report this through a queued connection. By then a
+    // new object may have taken the same address, its work has a live QPointer.
+    auto it = m_jobs.begin();
+    while (it != m_jobs.end()) {
+        if (it.key().first == receiver && it.value().receiver.isNull()) {
+            m_queues[it.value().priority].erase(it.value().position);
+            it = m_jobs.erase(it);
+        } else
+            ++it;
+    }
+
+    this->rearm();
+}
+
+bool DeferredWorkScheduler::isIdleWorkDue(qint64 dueNs, qint64 nowNs) const
+{
+    return nowNs - m_lastUserInputNs >= qint64(m_idleDelay) * 1000000
+            || nowNs - dueNs >= qint64(m_idleDeadline) * 1000000;
+}
+
+void DeferredWorkScheduler::rearm()
+{
+    qint64 dueNs = -1;
+    for (int priority = HighPriority; priority <= IdlePriority; priority++) {
+        const std::map<QueuePosition, JobKey> &queue = m_queues[priority];
+        if (queue.empty())
+            continue;
+
+        qint64 queueDueNs = queue.begin()->first.first;
+        if (priority == IdlePriority)
+            queueDueNs = qMax(queueDueNs,
+                              qMin(m_lastUserInputNs + qint64(m_idleDelay) * 1000000,
+                                   queueDueNs + qint64(m_idleDeadline) * 1000000));
+
+        dueNs = dueNs < 0 ? queueDueNs : qMin(dueNs, queueDueNs);
+    }
+
+    if (dueNs < 0) {
+        m_timer.stop();
+        m_timerDueNs = -1;
+        return;
+    }
+
+    if (m_timer.isActive() && m_timerDueNs >= 0 && m_timerDueNs <= dueNs)
+        return;
+
+    const qint64 nowNs = m_clock.nsecsElapsed();
+    const int delay = dueNs > nowNs ? int((dueNs - nowNs + 999999) / 1000000) : 0;
+    m_timer.start(delay, this);
+    m_timerDueNs = dueNs;
+}
+
+void DeferredWorkScheduler::emitMetricsChangedLater()
+{
+    // Metrics are for display, there is no need to update them more than a few times
+    // a second.
+    const qint64 nowNs = m_clock.nsecsElapsed();
+    if (nowNs - m_lastMetricsChangedNs < 250000000)
+        return;
+
+    m_lastMetricsChangedNs = nowNs;
+    emit metricsChanged();
+}
@@ -0,0 +1,151 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef DEFERREDWORKSCHEDULER_H
+#define DEFERREDWORKSCHEDULER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QQmlEngine>
+#include <QBasicTimer>
+#include <QJsonObject>
+#include <QElapsedTimer>
+
+#include <map>
+#include <functional>
+
+/**
+ * A single timer that runs all the ...Later() work that used to arm one timer per
+ * object. Work is keyed by (receiver, key): scheduling the same key again before it
+ * runs replaces the function and pushes its due time out, just like restarting an
+ * ExecLaterTimer would. Due work runs in slices; normal and idle work stop once the
+ * frame budget is used up, and idle work waits until there has been no user input for
+ * idleDelay milliseconds, or until it is idleDeadline milliseconds overdue.
+ *
+ * Work is queued on the GUI thread. It is run there, or posted to the receiver's thread
+ * if the receiver lives elsewhere. Work is dropped when its receiver is destroyed.
+ * Calls from other threads are queued to the GUI thread; isScheduled() and runNow()
+ * only know about work already queued. Keys must be string literals.
+ */
+class DeferredWorkScheduler : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Instantiation from QML not allowed.")
+
+public:
+    static DeferredWorkScheduler *instance();
+    ~DeferredWorkScheduler();
+
+    enum Priority {
+        HighPriority, // runs as soon as it is due, regardless of budget
+        NormalPriority, // runs as soon as it is due, within the frame budget
+        IdlePriority // runs only after user input has settled, within the frame budget
+    };
+    Q_ENUM(Priority)
+
+    void schedule(QObject *receiver, const char *key, Priority priority, int delay,
+                  const std::function<void()> &func);
+    void cancel(QObject *receiver, const char *key);
+    bool isScheduled(QObject *receiver, const char *key) const;
+
+    // Runs work scheduled against the receiver right away, if any
+    bool runNow(QObject *receiver, const char *key);
+
+    Q_PROPERTY(int frameBudget READ frameBudget WRITE setFrameBudget NOTIFY frameBudgetChanged)
+    void setFrameBudget(int val);
+    int frameBudget() const { return m_frameBudget; }
+    Q_SIGNAL void frameBudgetChanged();
+
+    Q_PROPERTY(int idleDelay READ idleDelay WRITE setIdleDelay NOTIFY idleDelayChanged)
+    void setIdleDelay(int val);
+    int idleDelay() const { return m_idleDelay; }
+    Q_SIGNAL void idleDelayChanged();
+
+    Q_PROPERTY(int idleDeadline READ idleDeadline WRITE setIdleDeadline NOTIFY
+                       idleDeadlineChanged)
+    void setIdleDeadline(int val);
+    int idleDeadline() const { return m_idleDeadline; }
+    Q_SIGNAL void idleDeadlineChanged();
+
+    Q_PROPERTY(int queueDepth READ queueDepth NOTIFY metricsChanged)
+    int queueDepth() const { return m_jobs.size(); }
+
+    Q_PROPERTY(int peakQueueDepth READ peakQueueDepth NOTIFY metricsChanged)
+    int peakQueueDepth() const { return m_peakQueueDepth; }
+
+    Q_PROPERTY(int executedCount READ executedCount NOTIFY metricsChanged)
+    int executedCount() const { return m_executedCount; }
+
+    Q_PROPERTY(int coalescedCount READ coalescedCount NOTIFY metricsChanged)
+    int coalescedCount() const { return m_coalescedCount; }
+
+    // How late work ran, compared to when it was due, in milliseconds
+    Q_PROPERTY(qreal averageLatency READ averageLatency NOTIFY metricsChanged)
+    qreal averageLatency() const;
+
+    Q_PROPERTY(qreal maximumLatency READ maximumLatency NOTIFY metricsChanged)
+    qreal maximumLatency() const { return qreal(m_maxLatencyNs) / 1e6; }
+
+    Q_SIGNAL void metricsChanged();
+
+    Q_INVOKABLE QJsonObject metrics() const;
+    Q_INVOKABLE void resetMetrics();
+
+    // Called by Application::notify() for keyboard, mouse and touch events
+    void noteUserInput() { m_lastUserInputNs = m_clock.nsecsElapsed(); }
+
+protected:
+    DeferredWorkScheduler(QObject *parent = nullptr);
+    void timerEvent(QTimerEvent *te);
+
+private:
+    typedef QPair<const QObject *, QByteArray> JobKey;
+    typedef std::pair<qint64, quint64> QueuePosition; // due time, sequence number
+
+    struct Job
+    {
+        QPointer<QObject> receiver;
+        Priority priority = NormalPriority;
+        QueuePosition position;
+        std::function<void()> func;
+    };
+
+    void run(const JobKey &key);
+    void onReceiverDestroyed(QObject *receiver);
+    bool isIdleWorkDue(qint64 dueNs, qint64 nowNs) const;
+    void rearm();
+    void emitMetricsChangedLater();
+
+private:
+    int m_frameBudget = 8; // msecs
+    int m_idleDelay = 250; // msecs
+    int m_idleDeadline = 2000; // msecs
+    QElapsedTimer m_clock;
+    qint64 m_lastUserInputNs = 0;
+    quint64 m_nextSequence = 0;
+    QHash<JobKey, Job> m_jobs;
+    std::map<QueuePosition, JobKey> m_queues[IdlePriority + 1];
+    QBasicTimer m_timer;
+    qint64 m_timerDueNs = -1;
+
+    int m_peakQueueDepth = 0;
+    int m_executedCount = 0;
+    int m_coalescedCount = 0;
+    qint64 m_totalLatencyNs = 0;
+    qint64 m_maxLatencyNs = 0;
+    qint64 m_lastMetricsChangedNs = 0;
+};
+
+#endif // DEFERREDWORKSCHEDULER_H
@@ -0,0 +1,99 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef DURATIONHISTOGRAM_H
+#define DURATIONHISTOGRAM_H
+
+#include <QtMath>
+#include <QtGlobal>
+
+/**
+ * Fixed size histogram of durations in nanoseconds. Values below 8ns get a bucket
+ * each, every power of two above that is split into four sub-buckets. That keeps the
+ * error in reported percentiles under 25%, without having to store samples.
+ */
+class DurationHistogram
+{
+public:
+    enum { NrBuckets = 256 };
+
+    void add(qint64 ns)
+    {
+        ns = qMax(ns, qint64(0));
+        minNs = count == 0 ? ns : qMin(minNs, ns);
+        maxNs = qMax(maxNs, ns);
+        totalNs += ns;
+        ++count;
+        ++buckets[bucketIndex(ns)];
+    }
+
+    void merge(const DurationHistogram &other)
+    {
+        if (other.count == 0)
+            return;
+
+        minNs = count == 0 ? other.minNs : qMin(minNs, other.minNs);
+        maxNs = qMax(maxNs, other.maxNs);
+        totalNs += other.totalNs;
+        count += other.count;
+        for (int i = 0; i < NrBuckets; i++)
+            buckets[i] += other.buckets[i];
+    }
+
+    qint64 percentile(qreal p) const
+    {
+        if (count == 0)
+            return 0;
+
+        const quint64 rank = qMax(quint64(1), quint64(qCeil(p * qreal(count))));
+        quint64 cumulative = 0;
+        for (int i = 0; i < NrBuckets; i++) {
+            cumulative += buckets[i];
+            if (cumulative >= rank)
+                return qBound(minNs, bucketUpperBound(i), maxNs);
+        }
+
+        return maxNs;
+    }
+
+    quint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 minNs = 0;
+    qint64 maxNs = 0;
+
+private:
+    static int bucketIndex(qint64 ns)
+    {
+        if (ns < 8)
+            return int(ns);
+
+        const int msb = 63 - qCountLeadingZeroBits(quint64(ns));
+        const int sub = int((quint64(ns) >> (msb - 2)) & 3);
+        return qMin(8 + (msb - 3) * 4 + sub, NrBuckets - 1);
+    }
+
+    static qint64 bucketUpperBound(int index)
+    {
+        if (index < 8)
+            return index;
+
+        const int msb = (index - 8) / 4 + 3;
+        const int sub = (index - 8) % 4;
+        const qint64 width = qint64(1) << (msb - 2);
+        return (qint64(4 + sub) * width) + width - 1;
+    }
+
+    quint64 buckets[NrBuckets] = {};
+};
+
+#endif // DURATIONHISTOGRAM_H
@@ -14,33 +14,10 @@
 #include "execlatertimer.h"
 #include "application.h"
 
-#include <QList>
 #include <QThread>
 
-#ifndef QT_NO_DEBUG_OUTPUT
-Q_GLOBAL_STATIC(QList<ExecLaterTimer *>, ExecLaterTimerList)
-#endif
-
-ExecLaterTimer *ExecLaterTimer::get(int timerId)
-{
-#ifndef QT_NO_DEBUG_OUTPUT
-    for (ExecLaterTimer *timer : qAsConst(*ExecLaterTimerList)) {
-        if (timer->timerId() == timerId)
-            return timer;
-    }
-#else
-    Q_UNUSED(timerId)
-#endif
-
-    return nullptr;
-}
-
 ExecLaterTimer::ExecLaterTimer(const QString &name, QObject *parent) : QObject(parent), m_name(name)
 {
-#ifndef QT_NO_DEBUG_OUTPUT
-    ExecLaterTimerList->append(this);
-#endif
-
     m_timer.setObjectName("ExecLaterTimer");
     m_timer.setSingleShot(!m_repeat);
     connect(&m_timer, &QTimer::timeout, this, &ExecLaterTimer::onTimeout);
@@ -50,10 +27,6 @@ ExecLaterTimer::~ExecLaterTimer()
 {
     m_destroyed = true;
     this->stop();
-
-#ifndef QT_NO_DEBUG_OUTPUT
-    ExecLaterTimerList->removeOne(this);
-#endif
 }
 
 void ExecLaterTimer::setName(const QString &val)
@@ -158,7 +131,7 @@ void ExecLaterTimer::onTimeout()
 #ifndef QT_NO_DEBUG_OUTPUT
         qDebug() << "Posting Timer [" << m_name << "]." << m_timerId << " to " << m_object;
 #endif
-        qApp->postEvent(m_object, new QTimerEvent(m_timerId));
+        qApp->postEvent(m_object, new ExecLaterTimerEvent(m_timerId, m_name));
     }
 }
 
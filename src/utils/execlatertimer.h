@@ -16,14 +16,29 @@
 
 #include <QTimer>
 #include <QString>
+#include <QTimerEvent>
+
+// Timer events posted by ExecLaterTimer carry the name of the timer, so that they can
+// be attributed to their deferred jobs without looking anything up.
+class ExecLaterTimerEvent : public QTimerEvent
+{
+public:
+    explicit ExecLaterTimerEvent(int timerId, const QString &timerName)
+        : QTimerEvent(timerId), m_timerName(timerName)
+    {
+    }
+
+    QString timerName() const { return m_timerName; }
+
+private:
+    QString m_timerName;
+};
 
 class ExecLaterTimer : public QObject
 {
     Q_OBJECT
 
 public:
-    static ExecLaterTimer *get(int timerId);
-
     explicit ExecLaterTimer(const QString &name = QStringLiteral("Scrite ExecLaterTimer"),
                             QObject *parent = nullptr);
     ~ExecLaterTimer();
@@ -55,6 +55,8 @@ bool ForceDirectedLayout::layout(const Graph &graph)
     // If we are here, then graph consists of only those nodes that are connected
     // to each other with edges. No zombie nodes and no edges that connect to nodes
     // outside the given graph.
+    if (m_warmStart)
+        return this->warmLayout(graph);
 
     // Place the nodes in a circle and figure out maximum size of nodes
     const qreal angleStep = 2 * M_PI / qreal(graph.nodes.size());
@@ -121,6 +123,189 @@ bool ForceDirectedLayout::layout(const Graph &graph)
     return true;
 }
 
+bool ForceDirectedLayout::warmLayout(const Graph &graph)
+{
+    const int nrNodes = graph.nodes.size();
+
+    // Edges are about unit length in layout space. Positions in pixels are mapped into it
+    // using the average length of edges between nodes that were positioned already.
+    qreal pxScale = 0;
+    int nrMeasuredEdges = 0;
+    for (AbstractEdge *edge : qAsConst(graph.edges)) {
+        if (edge->node1()->isPositioned() && edge->node2()->isPositioned()) {
+            pxScale += QLineF(edge->node1()->position(), edge->node2()->position()).length();
+            ++nrMeasuredEdges;
+        }
+    }
+
+    if (nrMeasuredEdges == 0 || qFuzzyIsNull(pxScale))
+        return false;
+
+    pxScale /= qreal(nrMeasuredEdges);
+
+    QHash<AbstractNode *, int> indexMap;
+    for (int i = 0; i < nrNodes; i++)
+        indexMap.insert(graph.nodes.at(i), i);
+
+    QVector<QPair<int, int>> edgeIndexes;
+    edgeIndexes.reserve(graph.edges.size());
+    for (AbstractEdge *edge : qAsConst(graph.edges))
+        edgeIndexes.append(qMakePair(indexMap.value(edge->node1()), indexMap.value(edge->node2())));
+
+    QVector<QPointF> positions(nrNodes);
+    QVector<bool> movable(nrNodes, false);
+    QVector<int> unpositioned;
+    QSizeF maxSize(0, 0);
+    QPointF centroid;
+    int nrPositioned = 0;
+    for (int i = 0; i < nrNodes; i++) {
+        AbstractNode *node = graph.nodes.at(i);
+        movable[i] = node->canBeMoved()
+                && (!node->isPositioned() || m_movableNodes.isEmpty()
+                    || m_movableNodes.contains(node));
+        if (node->isPositioned()) {
+            positions[i] = node->position() / pxScale;
+            centroid += positions[i];
+            ++nrPositioned;
+        } else
+            unpositioned.append(i);
+
+        maxSize = maxSize.expandedTo(node->size());
+    }
+    centroid /= qreal(nrPositioned);
+
+    // Nodes that were never positioned start around their positioned neighbours, or
+    // around the centroid if they have none.
+    for (int n = 0; n < unpositioned.size(); n++) {
+        const int i = unpositioned.at(n);
+
+        QPointF anchor;
+        int nrAnchors = 0;
+        for (const QPair<int, int> &edgeIndex : qAsConst(edgeIndexes)) {
+            const int other = edgeIndex.first == i
+                    ? edgeIndex.second
+                    : (edgeIndex.second == i ? edgeIndex.first : -1);
+            if (other >= 0 && graph.nodes.at(other)->isPositioned()) {
+                anchor += positions.at(other);
+                ++nrAnchors;
+            }
+        }
+        anchor = nrAnchors > 0 ? anchor / qreal(nrAnchors) : centroid;
+
+        const qreal angle = 2 * M_PI * qreal(n + 1) / qreal(unpositioned.size() + 1);
+        positions[i] = anchor + QPointF(qCos(angle), qSin(angle)) * 0.5;
+    }
+
+    // Perform force directed graph layout, computing forces only on nodes that can move.
+    // Others hold still, but continue to push and pull.
+    const qreal k = fdg_constant;
+    int nrIterations = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (timer.elapsed() < this->maxTime()) {
+        QVector<QPointF> forces(nrNodes, QPointF(0, 0));
+
+        for (int i = 0; i < nrNodes; i++) {
+            if (!movable.at(i))
+                continue;
+
+            for (int j = 0; j < nrNodes; j++) {
+                if (i == j)
+                    continue;
+
+                const QPointF dp = positions.at(j) - positions.at(i);
+                const qreal force =
+                        k / qMax(qSqrt(qPow(dp.x(), 2.0) + qPow(dp.y(), 2.0)), qreal(1e-3));
+                const qreal angle = qAtan2(dp.y(), dp.x());
+                forces[i] -= QPointF(force * qCos(angle), force * qSin(angle));
+            }
+        }
+
+        for (const QPair<int, int> &edgeIndex : qAsConst(edgeIndexes)) {
+            const int i = edgeIndex.first;
+            const int j = edgeIndex.second;
+            if (!movable.at(i) && !movable.at(j))
+                continue;
+
+            const QPointF dp = positions.at(j) - positions.at(i);
+            const qreal force = k * (qPow(dp.x(), 2.0) + qPow(dp.y(), 2.0));
+            const qreal angle = qAtan2(dp.y(), dp.x());
+            const QPointF delta(force * qCos(angle), force * qSin(angle));
+            if (movable.at(i))
+                forces[i] += delta;
+            if (movable.at(j))
+                forces[j] -= delta;
+        }
+
+        bool moved = false;
+        for (int i = 0; i < nrNodes; i++) {
+            const QPointF force = forces.at(i);
+            if (!movable.at(i) || (qFuzzyIsNull(force.x()) && qFuzzyIsNull(force.y())))
+                continue;
+
+            positions[i] += force;
+            moved = true;
+        }
+
+        ++nrIterations;
+        if (!moved || (maxIterations() > 0 && nrIterations >= maxIterations()))
+            break;
+    }
+
+    // Map back to pixels with the same scale, so that nodes which did not move stay
+    // exactly where they were. Moved nodes are then nudged away from nodes that are
+    // closer than the spacing a full layout would have left between them.
+    for (int i = 0; i < nrNodes; i++)
+        positions[i] *= pxScale;
+
+    const qreal minNodeSpacingPx = this->minimumEdgeLength()
+            + QLineF(QPointF(0, 0), QPointF(maxSize.width(), maxSize.height())).length();
+    for (int pass = 0; pass < 8; pass++) {
+        bool nudged = false;
+        for (int i = 0; i < nrNodes; i++) {
+            if (!movable.at(i))
+                continue;
+
+            for (int j = 0; j < nrNodes; j++) {
+                if (i == j)
+                    continue;
+
+                QPointF dp = positions.at(i) - positions.at(j);
+                qreal length = QLineF(QPointF(0, 0), dp).length();
+                if (length >= minNodeSpacingPx)
+                    continue;
+
+                if (qFuzzyIsNull(length)) {
+                    dp = QPointF(1, 0);
+                    length = 1;
+                }
+
+                positions[i] += dp / length * (minNodeSpacingPx - length);
+                nudged = true;
+            }
+        }
+
+        if (!nudged)
+            break;
+    }
+
+    for (int i = 0; i < nrNodes; i++) {
+        if (movable.at(i))
+            graph.nodes.at(i)->setPosition(positions.at(i));
+    }
+
+    // Get the edges to compute their paths
+    for (int e = 0; e < graph.edges.size(); e++) {
+        const QPair<int, int> &edgeIndex = edgeIndexes.at(e);
+        if (movable.at(edgeIndex.first) || movable.at(edgeIndex.second))
+            graph.edges.at(e)->evaluateEdge();
+    }
+
+    return true;
+}
+
 void ForceDirectedLayout::calculateRepulsion(QVector<QPointF> &forces, const Graph &graph)
 {
     const qreal k = fdg_constant;
@@ -26,12 +26,14 @@ class AbstractNode
 public:
     void setPosition(const QPointF &pos)
     {
+        m_positioned = true;
         if (m_position == pos)
             return;
         m_position = pos;
         this->move(m_position);
     }
     QPointF position() const { return m_position; }
+    bool isPositioned() const { return m_positioned; }
 
     virtual bool canBeMoved() const { return true; }
     virtual QSizeF size() const = 0;
@@ -44,6 +46,7 @@ protected:
 
 private:
     QPointF m_position;
+    bool m_positioned = false;
 };
 
 class AbstractEdge
@@ -90,13 +93,29 @@ public:
     explicit ForceDirectedLayout();
     ~ForceDirectedLayout();
 
+    // When set, layout starts from current positions of nodes instead of a circle, and
+    // only moves movable nodes. Nodes that were never positioned start next to their
+    // positioned neighbours. If no edge joins two positioned nodes, there is nothing to
+    // warm-start from and layout() returns false without moving anything.
+    void setWarmStart(bool val) { m_warmStart = val; }
+    bool isWarmStart() const { return m_warmStart; }
+
+    // Nodes that may be moved during a warm start; all nodes if empty.
+    void setMovableNodes(const QVector<AbstractNode *> &nodes) { m_movableNodes = nodes; }
+    QVector<AbstractNode *> movableNodes() const { return m_movableNodes; }
+
     // AbstractGraphLayout interface
     bool layout(const Graph &graph);
 
 private:
+    bool warmLayout(const Graph &graph);
     void calculateRepulsion(QVector<QPointF> &forces, const Graph &graph);
     void calculateAttraction(QVector<QPointF> &forces, const Graph &graph);
     bool placeNodes(const QVector<QPointF> &forces, const Graph &graph);
+
+private:
+    bool m_warmStart = false;
+    QVector<AbstractNode *> m_movableNodes;
 };
 
 }
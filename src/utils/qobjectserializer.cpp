@@ -14,8 +14,11 @@
 #include "qobjectserializer.h"
 #include "timeprofiler.h"
 
+#include <QHash>
 #include <QtDebug>
 #include <QStack>
+#include <QVector>
+#include <QtConcurrentMap>
 #include <QColor>
 #include <QMetaType>
 #include <QMetaEnum>
@@ -25,6 +28,8 @@
 #include <QJsonDocument>
 #include <QQmlListProperty>
 #include <QQmlListReference>
+#include <QReadWriteLock>
+#include <QSharedPointer>
 
 #ifdef QT_WIDGETS_LIB
 #include <QGraphicsObject>
@@ -138,58 +143,59 @@ const QObjectSerializer::Helper *ObjectSerializerHelperRegistry::findHelper(int
 
 Q_GLOBAL_STATIC(ObjectSerializerHelperRegistry, Helpers)
 
-void QObjectSerializer::registerHelper(QObjectSerializer::Helper *helper)
+/**
+ * Everything toJson() and fromJson() need to know about the properties of a class,
+ * worked out once per QMetaObject instead of once per object. Only the
+ * Interface::canSerialize() check depends on the object, so that alone is still
+ * evaluated for every object.
+ */
+struct SerializationPlan
 {
-    if (::Helpers()->contains(helper))
-        return;
-
-    ::Helpers()->append(helper);
-}
-
-QObjectSerializer::Helper::~Helper()
-{
-    ::Helpers()->removeOne(this);
-}
+    struct Property
+    {
+        enum Kind { ListKind, EnumKind, FlagKind, ObjectKind, ValueKind };
+        Kind kind = ValueKind;
+
+        const QMetaObject *metaObject = nullptr; // class declaring the property
+        QMetaProperty property;
+        int propertyIndex = -1;
+        int userType = QMetaType::UnknownType;
+        QString name;
+        bool isWritable = false;
+        bool isFlagType = false;
+        QMetaEnum enumerator;
+        const QObjectSerializer::Helper *helper = nullptr;
+
+        // Only for ObjectKind
+        const QMetaObject *objectMetaObject = nullptr;
+        QByteArray objectClassName;
+
+        // Only for ListKind, if the element type is registered with the meta-type system
+        const QMetaObject *listElementMetaObject = nullptr;
+
+        QVariant defaultValue;
+    };
 
-QObjectSerializer::Interface::~Interface() { }
+    QVector<Property> properties; // base class properties first
+    bool defaultValuesCached = false;
+    QVariantMap defaultValues;
+};
+typedef QSharedPointer<const SerializationPlan> SerializationPlanPtr;
 
-QJsonObject QObjectSerializer::toJson(const QObject *object)
+static SerializationPlanPtr buildSerializationPlan(const QMetaObject *metaObject)
 {
-    QJsonObject ret;
-    if (object == nullptr)
-        return ret;
-
-    QObjectSerializer::Interface *interface = qobject_cast<QObjectSerializer::Interface *>(object);
-    if (interface != nullptr)
-        interface->prepareForSerialization();
-
     QStack<const QMetaObject *> metaObjects;
-    QStringList classNames;
-    const QMetaObject *mo = object->metaObject();
-    while (mo) {
+    for (const QMetaObject *mo = metaObject; mo != nullptr; mo = mo->superClass())
         metaObjects.push(mo);
-        if (interface != nullptr && interface->canSerialize(mo, QMetaProperty()) == false) {
-            mo = mo->superClass();
-            continue;
-        }
-
-        classNames << QString::fromLatin1(mo->className());
-        mo = mo->superClass();
-    }
 
-    // ret.insert("_class", classNames.join(","));
-
-    const QVariantMap defaultProperties =
-            QObjectSerializer::cacheDefaultPropertyValues(object, true);
+    SerializationPlan *plan = new SerializationPlan;
 
     while (!metaObjects.isEmpty()) {
-        mo = metaObjects.pop();
+        const QMetaObject *mo = metaObjects.pop();
 
         const int nrProperties = mo->propertyCount();
         for (int i = mo->propertyOffset(); i < nrProperties; i++) {
             const QMetaProperty prop = mo->property(i);
-            if (interface != nullptr && interface->canSerialize(mo, prop) == false)
-                continue;
 
 #ifdef QT_WIDGETS_LIB
             // QGraphicsObject::parent property returns a parent QGraphicsObject.
@@ -200,8 +206,6 @@ QJsonObject QObjectSerializer::toJson(const QObject *object)
                 continue;
 #endif
 
-            const QMetaType propType(prop.userType());
-
             // The objectName property wont be stored. In all my experiments so far,
             // storing objectName has turned out to be pointless.
             static const char *objectName = "objectName";
@@ -219,56 +223,237 @@ QJsonObject QObjectSerializer::toJson(const QObject *object)
             // cant be unserialized, whats the point of storing them.
             // The only exception to this rule is if the property is returning a QObject
             // type. In which case, we have to serialize it.
+            const QMetaType propType(prop.userType());
             const bool isQObjectPointer = (propType.flags() & QMetaType::PointerToQObject);
             const bool isQQmlListProperty =
                     QByteArray(prop.typeName()).startsWith("QQmlListProperty");
             if (!prop.isWritable() && !isQObjectPointer && !isQQmlListProperty)
                 continue;
 
-            const QString propName = QString::fromLatin1(prop.name());
-            const QVariant defaultPropValue = defaultProperties.value(propName);
-            QVariant propValue = prop.read(object);
+            SerializationPlan::Property planProp;
+            planProp.metaObject = mo;
+            planProp.property = prop;
+            planProp.propertyIndex = i;
+            planProp.userType = prop.userType();
+            planProp.name = QString::fromLatin1(prop.name());
+            planProp.isWritable = prop.isWritable();
+            planProp.isFlagType = prop.isFlagType();
+
+            if (isQQmlListProperty)
+                planProp.kind = SerializationPlan::Property::ListKind;
+            else if (prop.isEnumType())
+                planProp.kind = SerializationPlan::Property::EnumKind;
+            else if (prop.isFlagType())
+                planProp.kind = SerializationPlan::Property::FlagKind;
+            else if (isQObjectPointer)
+                planProp.kind = SerializationPlan::Property::ObjectKind;
+            else
+                planProp.kind = SerializationPlan::Property::ValueKind;
+
+            switch (planProp.kind) {
+            case SerializationPlan::Property::EnumKind:
+            case SerializationPlan::Property::FlagKind:
+                planProp.enumerator = prop.enumerator();
+                break;
+            case SerializationPlan::Property::ObjectKind:
+                planProp.objectMetaObject = QMetaType::metaObjectForType(prop.userType());
+                planProp.objectClassName = QByteArray(prop.typeName()).replace('*', "");
+                break;
+            case SerializationPlan::Property::ValueKind:
+                planProp.helper = ::Helpers()->findHelper(prop.userType());
+                break;
+            case SerializationPlan::Property::ListKind: {
+                const QByteArray typeName(prop.typeName());
+                const int lt = typeName.indexOf('<');
+                const int gt = typeName.lastIndexOf('>');
+                if (lt > 0 && gt > lt) {
+                    const QByteArray elementTypeName =
+                            typeName.mid(lt + 1, gt - lt - 1).trimmed() + '*';
+                    planProp.listElementMetaObject = QMetaType::metaObjectForType(
+                            QMetaType::type(elementTypeName.constData()));
+                }
+            } break;
+            default:
+                break;
+            }
 
-            if (isQQmlListProperty) {
-                QJsonArray list;
+            plan->properties.append(planProp);
+        }
+    }
 
-                QQmlListReference listRef(const_cast<QObject *>(object), prop.name());
-                for (int i = 0; i < listRef.count(); i++) {
-                    const QObject *listItem = listRef.at(i);
-                    if (listItem == nullptr)
-                        continue;
+    return SerializationPlanPtr(plan);
+}
 
-                    QJsonObject item = QObjectSerializer::toJson(listItem);
-                    list.append(item);
-                }
+class SerializationPlanCache
+{
+public:
+    SerializationPlanPtr plan(const QMetaObject *metaObject)
+    {
+        {
+            QReadLocker locker(&m_lock);
+            const auto it = m_plans.constFind(metaObject);
+            if (it != m_plans.constEnd())
+                return it.value();
+        }
 
-                ret.insert(propName, list);
-            } else if (prop.isEnumType()) {
-                const QMetaEnum propEnum = prop.enumerator();
-                propValue = QString::fromLatin1(propEnum.valueToKey(propValue.toInt()));
-                if (defaultPropValue == propValue.toString())
-                    continue;
+        const SerializationPlanPtr plan = buildSerializationPlan(metaObject);
 
-                ret.insert(propName, propValue.toString());
-            } else if (prop.isFlagType()) {
-                const QMetaEnum propEnum = prop.enumerator();
-                propValue = QString::fromLatin1(propEnum.valueToKeys(propValue.toInt()));
-                if (defaultPropValue == propValue.toString())
+        QWriteLocker locker(&m_lock);
+        const auto it = m_plans.constFind(metaObject);
+        if (it != m_plans.constEnd())
+            return it.value();
+
+        m_plans.insert(metaObject, plan);
+        return plan;
+    }
+
+    void replace(const QMetaObject *metaObject, const SerializationPlanPtr &plan)
+    {
+        QWriteLocker locker(&m_lock);
+        m_plans.insert(metaObject, plan);
+    }
+
+    void clear()
+    {
+        QWriteLocker locker(&m_lock);
+        m_plans.clear();
+    }
+
+private:
+    QReadWriteLock m_lock;
+    QHash<const QMetaObject *, SerializationPlanPtr> m_plans;
+};
+
+Q_GLOBAL_STATIC(SerializationPlanCache, SerializationPlans)
+
+/**
+ * Result of the first phase of a two-phase load. It holds, for one object and
+ * recursively for its child objects, the values to be written into each property of
+ * the plan, already looked up in and converted from JSON. The second phase reads
+ * property values only from here, it never looks them up in JSON again.
+ */
+struct QObjectSerializer::DecodedObject
+{
+    struct Value
+    {
+        bool present = false; // whether the JSON has a value for the property
+        bool decoded = false; // whether value was converted, for ValueKind, EnumKind & FlagKind
+        QVariant value;
+        QJsonValue json; // raw value, if it is converted only in the second phase
+        DecodedObjectPtr object; // ObjectKind
+        QVector<DecodedObjectPtr> items; // ListKind
+    };
+
+    const QMetaObject *metaObject = nullptr;
+    SerializationPlanPtr plan;
+    QJsonObject json; // for Interface::deserializeFromJson() and dynamic properties
+    QVector<Value> values; // one for each entry in plan->properties
+};
+
+struct DecodeListItem
+{
+    typedef QObjectSerializer::DecodedObjectPtr result_type;
+
+    const QMetaObject *metaObject = nullptr;
+    result_type operator()(const QJsonValue &item) const
+    {
+        return QObjectSerializer::decode(item.toObject(), metaObject);
+    }
+};
+
+void QObjectSerializer::registerHelper(QObjectSerializer::Helper *helper)
+{
+    if (::Helpers()->contains(helper))
+        return;
+
+    ::Helpers()->append(helper);
+
+    // Plans resolve helpers up front, so they have to be worked out again.
+    ::SerializationPlans()->clear();
+}
+
+QObjectSerializer::Helper::~Helper()
+{
+    ::Helpers()->removeOne(this);
+
+    if (!::SerializationPlans.isDestroyed())
+        ::SerializationPlans()->clear();
+}
+
+QObjectSerializer::Interface::~Interface() { }
+
+QJsonObject QObjectSerializer::toJson(const QObject *object)
+{
+    QJsonObject ret;
+    if (object == nullptr)
+        return ret;
+
+    QObjectSerializer::Interface *interface = qobject_cast<QObjectSerializer::Interface *>(object);
+    if (interface != nullptr)
+        interface->prepareForSerialization();
+
+    const SerializationPlanPtr plan = ::SerializationPlans()->plan(object->metaObject());
+
+    for (const SerializationPlan::Property &planProp : plan->properties) {
+        const QMetaProperty &prop = planProp.property;
+        if (interface != nullptr && interface->canSerialize(planProp.metaObject, prop) == false)
+            continue;
+
+        const QString &propName = planProp.name;
+        const QVariant &defaultPropValue = planProp.defaultValue;
+
+        if (planProp.kind == SerializationPlan::Property::ListKind) {
+            // Read the list property directly, like QQmlListReference does internally,
+            // without having to look up the property by name for every object.
+            QQmlListProperty<QObject> listProperty;
+            void *args[] = { &listProperty, nullptr };
+            QMetaObject::metacall(const_cast<QObject *>(object), QMetaObject::ReadProperty,
+                                  planProp.propertyIndex, args);
+
+            QJsonArray list;
+
+            const int listCount = listProperty.count ? listProperty.count(&listProperty) : 0;
+            for (int i = 0; i < listCount; i++) {
+                const QObject *listItem = listProperty.at ? listProperty.at(&listProperty, i)
+                                                          : nullptr;
+                if (listItem == nullptr)
                     continue;
 
-                ret.insert(propName, propValue.toString());
-            } else if (propType.flags() & QMetaType::PointerToQObject) {
-                propValue.convert(QMetaType::QObjectStar);
+                QJsonObject item = QObjectSerializer::toJson(listItem);
+                list.append(item);
+            }
 
-                const QObject *propObject = propValue.value<QObject *>();
-                if (propObject != nullptr) {
-                    const QJsonObject propJson = QObjectSerializer::toJson(propObject);
-                    if (!propJson.isEmpty())
-                        ret.insert(propName, propJson);
-                }
-            } else if (propValue.userType() == QMetaType::QJsonValue) {
+            ret.insert(propName, list);
+        } else if (planProp.kind == SerializationPlan::Property::EnumKind) {
+            const QString propValue = QString::fromLatin1(
+                    planProp.enumerator.valueToKey(prop.read(object).toInt()));
+            if (defaultPropValue == propValue)
+                continue;
+
+            ret.insert(propName, propValue);
+        } else if (planProp.kind == SerializationPlan::Property::FlagKind) {
+            const QString propValue = QString::fromLatin1(
+                    planProp.enumerator.valueToKeys(prop.read(object).toInt()));
+            if (defaultPropValue == propValue)
+                continue;
+
+            ret.insert(propName, propValue);
+        } else if (planProp.kind == SerializationPlan::Property::ObjectKind) {
+            QVariant propValue = prop.read(object);
+            propValue.convert(QMetaType::QObjectStar);
+
+            const QObject *propObject = propValue.value<QObject *>();
+            if (propObject != nullptr) {
+                const QJsonObject propJson = QObjectSerializer::toJson(propObject);
+                if (!propJson.isEmpty())
+                    ret.insert(propName, propJson);
+            }
+        } else {
+            const QVariant propValue = prop.read(object);
+
+            if (propValue.userType() == QMetaType::QJsonValue) {
                 const QJsonValue propJsonValue = propValue.toJsonValue();
-                if (defaultPropValue.toJsonValue() == propValue.toJsonValue())
+                if (defaultPropValue.toJsonValue() == propJsonValue)
                     continue;
 
                 ret.insert(propName, propJsonValue);
@@ -285,7 +470,7 @@ QJsonObject QObjectSerializer::toJson(const QObject *object)
 
                 ret.insert(propName, propJsonArray);
             } else {
-                const QObjectSerializer::Helper *helper = ::Helpers()->findHelper(prop.userType());
+                const QObjectSerializer::Helper *helper = planProp.helper;
                 if (helper == nullptr) {
                     if (propValue == defaultPropValue)
                         continue;
@@ -318,7 +503,108 @@ QJsonObject QObjectSerializer::toJson(const QObject *object)
     return ret;
 }
 
-bool QObjectSerializer::fromJson(const QJsonObject &json, QObject *object, QObjectFactory *factory)
+QObjectSerializer::DecodedObjectPtr QObjectSerializer::decode(const QJsonObject &json,
+                                                               const QMetaObject *metaObject)
+{
+    if (metaObject == nullptr || json.isEmpty())
+        return DecodedObjectPtr();
+
+    DecodedObject *ret = new DecodedObject;
+    ret->metaObject = metaObject;
+    ret->plan = ::SerializationPlans()->plan(metaObject);
+    ret->json = json;
+    ret->values.resize(ret->plan->properties.size());
+
+    // Values for all properties in the plan are decoded, because which of them get
+    // written is decided by Interface::canSerialize() on the object in the second phase.
+    for (int i = 0; i < ret->plan->properties.size(); i++) {
+        const SerializationPlan::Property &planProp = ret->plan->properties.at(i);
+        DecodedObject::Value &value = ret->values[i];
+
+        const auto jsonIt = json.constFind(planProp.name);
+        if (jsonIt == json.constEnd())
+            continue;
+
+        const QJsonValue jsonPropValue = jsonIt.value();
+        value.present = true;
+
+        switch (planProp.kind) {
+        case SerializationPlan::Property::ListKind: {
+            if (planProp.listElementMetaObject == nullptr) {
+                value.json = jsonPropValue;
+                break;
+            }
+
+            const QJsonArray list = jsonPropValue.toArray();
+
+            // Long lists (scenes, screenplay elements, notes) are decoded in parallel,
+            // items are independent of each other.
+            const int minParallelListSize = 32;
+            DecodeListItem decodeListItem;
+            decodeListItem.metaObject = planProp.listElementMetaObject;
+            if (list.size() >= minParallelListSize) {
+                QVector<QJsonValue> items;
+                items.reserve(list.size());
+                for (const QJsonValue &item : list)
+                    items.append(item);
+                value.items = QtConcurrent::blockingMapped<QVector<DecodedObjectPtr>>(
+                        items, decodeListItem);
+            } else {
+                value.items.reserve(list.size());
+                for (const QJsonValue &item : list)
+                    value.items.append(decodeListItem(item));
+            }
+        } break;
+        case SerializationPlan::Property::EnumKind:
+        case SerializationPlan::Property::FlagKind: {
+            const QByteArray key = jsonPropValue.toString().toLatin1();
+            const QMetaEnum &enumerator = planProp.enumerator;
+            value.value = planProp.isFlagType ? (key.isEmpty() ? 0 : enumerator.keysToValue(key))
+                                              : enumerator.keyToValue(key);
+            value.decoded = true;
+        } break;
+        case SerializationPlan::Property::ObjectKind:
+            value.object = decode(jsonPropValue.toObject(), planProp.objectMetaObject);
+            break;
+        case SerializationPlan::Property::ValueKind:
+            switch (planProp.userType) {
+            case QMetaType::QJsonValue:
+                value.value = QVariant::fromValue<QJsonValue>(jsonPropValue);
+                value.decoded = true;
+                break;
+            case QMetaType::QJsonObject:
+                value.value = QVariant::fromValue<QJsonObject>(jsonPropValue.toObject());
+                value.decoded = true;
+                break;
+            case QMetaType::QJsonArray:
+                value.value = QVariant::fromValue<QJsonArray>(jsonPropValue.toArray());
+                value.decoded = true;
+                break;
+            case QMetaType::QString:
+            case QMetaType::QStringList:
+                // Text makes up most of a document. Converting it in the second phase,
+                // one property at a time, avoids holding a second copy of all of it.
+                value.json = jsonPropValue;
+                break;
+            default:
+                // Helpers may create GUI types like QFont, so they are left to the
+                // second phase, which runs in the GUI thread.
+                if (planProp.helper == nullptr) {
+                    value.value = jsonPropValue.toVariant();
+                    value.decoded = true;
+                } else
+                    value.json = jsonPropValue;
+                break;
+            }
+            break;
+        }
+    }
+
+    return DecodedObjectPtr(ret);
+}
+
+static bool applyJson(const QJsonObject &json, QObject *object, QObjectFactory *factory,
+                      const QObjectSerializer::DecodedObject *decoded)
 {
     if (object == nullptr)
         return false;
@@ -330,153 +616,158 @@ bool QObjectSerializer::fromJson(const QJsonObject &json, QObject *object, QObje
     if (interface != nullptr)
         interface->prepareForDeserialization();
 
-    QStack<const QMetaObject *> metaObjects;
-    QStringList classNames;
-    const QMetaObject *mo = object->metaObject();
-    while (mo) {
-        metaObjects.push(mo);
-        if (interface != nullptr && interface->canSerialize(mo, QMetaProperty()) == false) {
-            mo = mo->superClass();
-            continue;
-        }
-
-        classNames << QString::fromLatin1(mo->className());
-        mo = mo->superClass();
-    }
-
-    while (!metaObjects.isEmpty()) {
-        mo = metaObjects.pop();
-
-        const int nrProperties = mo->propertyCount();
-        for (int i = mo->propertyOffset(); i < nrProperties; i++) {
-            const QMetaProperty prop = mo->property(i);
-            if (interface != nullptr && interface->canSerialize(mo, prop) == false)
-                continue;
+    const SerializationPlanPtr plan = ::SerializationPlans()->plan(object->metaObject());
 
-            const QMetaType propType(prop.userType());
+    // Decoded values are used only if they were decoded for exactly this class.
+    if (decoded != nullptr
+        && (decoded->metaObject != object->metaObject()
+            || decoded->values.size() != plan->properties.size()))
+        decoded = nullptr;
 
-            static const char *objectName = "objectName";
-            if (!qstrcmp(prop.name(), objectName))
-                continue;
+    for (int p = 0; p < plan->properties.size(); p++) {
+        const SerializationPlan::Property &planProp = plan->properties.at(p);
+        const QMetaProperty &prop = planProp.property;
+        if (interface != nullptr && interface->canSerialize(planProp.metaObject, prop) == false)
+            continue;
 
-            if (!prop.isStored())
-                continue;
+        const QString &propName = planProp.name;
+        const QObjectSerializer::DecodedObject::Value *decodedValue =
+                decoded == nullptr ? nullptr : &decoded->values.at(p);
 
-            const bool isQObjectPointer = (propType.flags() & QMetaType::PointerToQObject);
-            const bool isQQmlListProperty =
-                    QByteArray(prop.typeName()).startsWith("QQmlListProperty");
-            if (!prop.isWritable() && !isQObjectPointer && !isQQmlListProperty)
+        QJsonValue jsonPropValue;
+        if (decodedValue != nullptr) {
+            if (!decodedValue->present)
                 continue;
-
-            const QString propName = QString::fromLatin1(prop.name());
-            if (!json.contains(propName))
+            jsonPropValue = decodedValue->json;
+        } else {
+            const auto jsonIt = json.constFind(propName);
+            if (jsonIt == json.constEnd())
                 continue;
+            jsonPropValue = jsonIt.value();
+        }
 
-            const QJsonValue jsonPropValue = json.value(propName);
-
-            if (isQQmlListProperty) {
-                const QJsonArray list = jsonPropValue.toArray();
-
-                QQmlListReference listRef(const_cast<QObject *>(object), prop.name());
-                const bool canAddObjects =
-                        interface && interface->canSetPropertyFromObjectList(propName)
-                        && listRef.canAppend();
-
-                QObjectFactory listItemFactory;
-                const QByteArray className(listRef.listElementType()->className());
-                listItemFactory.add(listRef.listElementType());
-
-                QList<QObject *> propertyObjects;
-                if (canAddObjects)
-                    propertyObjects.reserve(list.size());
-                else if (listRef.canAppend())
-                    listRef.clear();
-
-                for (int i = 0; i < list.size(); i++) {
-                    const QJsonObject listItem = list.at(i).toObject();
-
-                    if (listRef.canAppend()) {
-                        QObject *listItemObject =
-                                listItemFactory.create(className, listRef.object());
-                        QObjectSerializer::fromJson(listItem, listItemObject, factory);
-                        if (canAddObjects)
-                            propertyObjects.append(listItemObject);
-                        else
-                            listRef.append(listItemObject);
-                    } else {
-                        QObject *listItemObject = listRef.at(i);
-                        if (listItemObject == nullptr)
-                            continue;
-                        QObjectSerializer::fromJson(listItem, listItemObject, factory);
-                    }
+        if (planProp.kind == SerializationPlan::Property::ListKind) {
+            // Decoded lists carry one decoded object per item, others only the raw array.
+            const QJsonArray list = jsonPropValue.toArray();
+            const int nrItems = decodedValue != nullptr && list.isEmpty()
+                    ? decodedValue->items.size()
+                    : list.size();
+
+            QQmlListReference listRef(object, prop.name());
+            const bool canAddObjects = interface
+                    && interface->canSetPropertyFromObjectList(propName) && listRef.canAppend();
+
+            QObjectFactory listItemFactory;
+            const QByteArray className(listRef.listElementType()->className());
+            listItemFactory.add(listRef.listElementType());
+
+            QList<QObject *> propertyObjects;
+            if (canAddObjects)
+                propertyObjects.reserve(nrItems);
+            else if (listRef.canAppend())
+                listRef.clear();
+
+            for (int i = 0; i < nrItems; i++) {
+                const QObjectSerializer::DecodedObject *listItemDecoded =
+                        decodedValue != nullptr && i < decodedValue->items.size()
+                        ? decodedValue->items.at(i).data()
+                        : nullptr;
+                const QJsonObject listItem = listItemDecoded != nullptr
+                        ? listItemDecoded->json
+                        : (i < list.size() ? list.at(i).toObject() : QJsonObject());
+
+                if (listRef.canAppend()) {
+                    QObject *listItemObject = listItemFactory.create(className, listRef.object());
+                    applyJson(listItem, listItemObject, factory, listItemDecoded);
+                    if (canAddObjects)
+                        propertyObjects.append(listItemObject);
+                    else
+                        listRef.append(listItemObject);
+                } else {
+                    QObject *listItemObject = listRef.at(i);
+                    if (listItemObject == nullptr)
+                        continue;
+                    applyJson(listItem, listItemObject, factory, listItemDecoded);
                 }
+            }
 
-                if (canAddObjects)
-                    interface->setPropertyFromObjectList(propName, propertyObjects);
+            if (canAddObjects)
+                interface->setPropertyFromObjectList(propName, propertyObjects);
 
-                continue;
-            }
+            continue;
+        }
 
-            if (prop.isEnumType() || prop.isFlagType()) {
-                const QByteArray key = jsonPropValue.toString().toLatin1();
-                const QMetaEnum enumerator = prop.enumerator();
-                const int value = prop.isFlagType()
-                        ? (key.isEmpty() ? 0 : enumerator.keysToValue(key))
-                        : enumerator.keyToValue(key);
-                prop.write(object, value);
+        if (planProp.kind == SerializationPlan::Property::EnumKind
+            || planProp.kind == SerializationPlan::Property::FlagKind) {
+            if (decodedValue != nullptr && decodedValue->decoded) {
+                prop.write(object, decodedValue->value);
                 continue;
             }
 
-            if (propType.flags() & QMetaType::PointerToQObject) {
-                QObjectFactory *usableFactory = factory;
-                QObjectFactory stopGapFactory;
-
-                const QVariant propValue = prop.read(object);
-                QObject *propObject = propValue.value<QObject *>();
-                if (propObject == nullptr) {
-                    if (factory == nullptr) {
-                        stopGapFactory.add(QMetaType::metaObjectForType(prop.userType()));
-                        usableFactory = &stopGapFactory;
-                    } else
-                        factory->add(QMetaType::metaObjectForType(prop.userType()));
-
-                    if (prop.isWritable() && usableFactory != nullptr) {
-                        const QByteArray className = QByteArray(prop.typeName()).replace('*', "");
-                        propObject = usableFactory->create(className, object);
-                        if (propObject == nullptr)
-                            continue;
-
-                        prop.write(object, QVariant::fromValue(propObject));
-                    } else
+            const QByteArray key = jsonPropValue.toString().toLatin1();
+            const QMetaEnum &enumerator = planProp.enumerator;
+            const int value = planProp.isFlagType
+                    ? (key.isEmpty() ? 0 : enumerator.keysToValue(key))
+                    : enumerator.keyToValue(key);
+            prop.write(object, value);
+            continue;
+        }
+
+        if (planProp.kind == SerializationPlan::Property::ObjectKind) {
+            QObjectFactory *usableFactory = factory;
+            QObjectFactory stopGapFactory;
+
+            const QVariant propValue = prop.read(object);
+            QObject *propObject = propValue.value<QObject *>();
+            if (propObject == nullptr) {
+                if (factory == nullptr) {
+                    stopGapFactory.add(planProp.objectMetaObject);
+                    usableFactory = &stopGapFactory;
+                } else
+                    factory->add(planProp.objectMetaObject);
+
+                if (planProp.isWritable && usableFactory != nullptr) {
+                    propObject = usableFactory->create(planProp.objectClassName, object);
+                    if (propObject == nullptr)
                         continue;
-                }
 
-                const QJsonObject propJson = jsonPropValue.toObject();
-                QObjectSerializer::fromJson(propJson, propObject, usableFactory);
-                continue;
+                    prop.write(object, QVariant::fromValue(propObject));
+                } else
+                    continue;
             }
 
-            switch (prop.userType()) {
-            case QMetaType::QJsonValue:
-                prop.write(object, QVariant::fromValue<QJsonValue>(jsonPropValue));
-                continue;
-            case QMetaType::QJsonObject:
-                prop.write(object, QVariant::fromValue<QJsonObject>(jsonPropValue.toObject()));
-                continue;
-            case QMetaType::QJsonArray:
-                prop.write(object, QVariant::fromValue<QJsonArray>(jsonPropValue.toArray()));
-                continue;
-            default:
-                break;
-            }
+            const QObjectSerializer::DecodedObject *propDecoded =
+                    decodedValue == nullptr ? nullptr : decodedValue->object.data();
+            const QJsonObject propJson =
+                    propDecoded != nullptr ? propDecoded->json : jsonPropValue.toObject();
+            applyJson(propJson, propObject, usableFactory, propDecoded);
+            continue;
+        }
+
+        if (decodedValue != nullptr && decodedValue->decoded) {
+            prop.write(object, decodedValue->value);
+            continue;
+        }
 
-            const QObjectSerializer::Helper *helper = ::Helpers()->findHelper(prop.userType());
-            const QJsonValue propJsonValue = json.value(propName);
-            const QVariant propValue = helper == nullptr
-                    ? propJsonValue.toVariant()
-                    : helper->fromJson(propJsonValue, prop.userType());
-            prop.write(object, propValue);
+        switch (planProp.userType) {
+        case QMetaType::QJsonValue:
+            prop.write(object, QVariant::fromValue<QJsonValue>(jsonPropValue));
+            continue;
+        case QMetaType::QJsonObject:
+            prop.write(object, QVariant::fromValue<QJsonObject>(jsonPropValue.toObject()));
+            continue;
+        case QMetaType::QJsonArray:
+            prop.write(object, QVariant::fromValue<QJsonArray>(jsonPropValue.toArray()));
+            continue;
+        default:
+            break;
         }
+
+        const QObjectSerializer::Helper *helper = planProp.helper;
+        const QVariant propValue = helper == nullptr
+                ? jsonPropValue.toVariant()
+                : helper->fromJson(jsonPropValue, planProp.userType);
+        prop.write(object, propValue);
     }
 
 #ifdef SERIALIZE_DYNAMIC_PROPERTIES
@@ -541,6 +832,17 @@ bool QObjectSerializer::fromJson(const QJsonObject &json, QObject *object, QObje
     return true;
 }
 
+bool QObjectSerializer::fromJson(const QJsonObject &json, QObject *object, QObjectFactory *factory)
+{
+    return applyJson(json, object, factory, nullptr);
+}
+
+bool QObjectSerializer::fromDecoded(const QJsonObject &json, const DecodedObjectPtr &decoded,
+                                    QObject *object, QObjectFactory *factory)
+{
+    return applyJson(decoded.isNull() ? json : decoded->json, object, factory, decoded.data());
+}
+
 QString QObjectSerializer::toJsonString(const QObject *object)
 {
     const QJsonObject json = QObjectSerializer::toJson(object);
@@ -883,15 +1185,14 @@ QVariant QRectFHelper::fromJson(const QJsonValue &value, int type) const
 
 QVariantMap QObjectSerializer::cacheDefaultPropertyValues(const QObject *object, bool readonly)
 {
-    static QMap<QByteArray, QVariantMap> defaultPropertyValueMap;
-
     QVariantMap ret;
     if (object == nullptr)
         return ret;
 
-    const QByteArray className(object->metaObject()->className());
-    if (defaultPropertyValueMap.contains(className) || readonly)
-        return defaultPropertyValueMap.value(className);
+    const QMetaObject *metaObject = object->metaObject();
+    const SerializationPlanPtr plan = ::SerializationPlans()->plan(metaObject);
+    if (plan->defaultValuesCached || readonly)
+        return plan->defaultValues;
 
     QObjectSerializer::Interface *interface = qobject_cast<QObjectSerializer::Interface *>(object);
 
@@ -957,7 +1258,14 @@ QVariantMap QObjectSerializer::cacheDefaultPropertyValues(const QObject *object,
         }
     }
 
-    defaultPropertyValueMap.insert(className, ret);
+    // Plans are shared, possibly across threads. So defaults go into a copy, which
+    // then replaces the cached plan.
+    SerializationPlan *newPlan = new SerializationPlan(*plan);
+    newPlan->defaultValuesCached = true;
+    newPlan->defaultValues = ret;
+    for (SerializationPlan::Property &planProp : newPlan->properties)
+        planProp.defaultValue = ret.value(planProp.name);
+    ::SerializationPlans()->replace(metaObject, SerializationPlanPtr(newPlan));
 
     return ret;
 }
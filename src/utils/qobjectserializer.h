@@ -19,6 +19,7 @@
 #include <QJsonValue>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QSharedPointer>
 
 #include "qobjectfactory.h"
 
@@ -56,6 +57,15 @@ bool fromJsonString(const QString &json, QObject *object, QObjectFactory *factor
 QJsonObject toJson(const QObject *object);
 bool fromJson(const QJsonObject &json, QObject *object, QObjectFactory *factory = nullptr);
 
+// Two phase deserialization. decode() does all the JSON lookups and value conversions
+// for an object tree up front, and may be called from any thread. fromDecoded() is then
+// left with creating objects and writing properties, in the object's thread.
+struct DecodedObject;
+typedef QSharedPointer<const DecodedObject> DecodedObjectPtr;
+DecodedObjectPtr decode(const QJsonObject &json, const QMetaObject *metaObject);
+bool fromDecoded(const QJsonObject &json, const DecodedObjectPtr &decoded, QObject *object,
+                 QObjectFactory *factory = nullptr);
+
 QVariantMap cacheDefaultPropertyValues(const QObject *object, bool readonly = false);
 };
 
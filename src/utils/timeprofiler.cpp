@@ -0,0 +1,382 @@
+/****************************************************************************
+**
+** Copyright (C) VCreate Logic Pvt. Ltd. Bengaluru
+** Author: Prashanth N Udupa (prashanth@scrite.io)
+**
+** This code is distributed under GPL v3. Complete text of the license
+** can be found here: https://www.gnu.org/licenses/gpl-3.0.txt
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "timeprofiler.h"
+#include "callgraph.h"
+#include "durationhistogram.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QtAlgorithms>
+#include <QCoreApplication>
+
+#include <chrono>
+#include <algorithm>
+
+namespace {
+
+qint64 nowNs()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                                - epoch)
+            .count();
+}
+
+struct ProfilerEvent
+{
+    const char *context = nullptr;
+    qint64 startNs = 0;
+    qint64 durationNs = 0;
+    bool traced = true;
+};
+
+struct TraceEvent
+{
+    const char *context = nullptr;
+    qint64 startNs = 0;
+    qint64 durationNs = 0;
+    int threadId = 0;
+};
+
+/**
+ * Single-producer single-consumer ring. Only the owning thread pushes events;
+ * draining always happens with the registry mutex held, so there is at most one
+ * consumer at any time.
+ */
+struct ThreadBuffer
+{
+    enum { Capacity = 4096 };
+
+    int threadId = 0;
+    QString threadName;
+    std::atomic<quint64> head { 0 };
+    std::atomic<quint64> tail { 0 };
+    ProfilerEvent events[Capacity];
+
+    // Scopes currently open on the owning thread. Accessed only by that thread.
+    QList<const char *> stack;
+};
+
+struct ProfilerRegistry
+{
+    enum { MaxTraceEvents = 250000 };
+
+    QMutex mutex;
+    int nextThreadId = 1;
+    QList<ThreadBuffer *> buffers;
+    QHash<const char *, DurationHistogram> histograms;
+    QVector<TraceEvent> trace;
+    quint64 droppedTraceEvents = 0;
+
+    // Must be called with mutex locked
+    void drain(ThreadBuffer *buffer)
+    {
+        const quint64 head = buffer->head.load(std::memory_order_acquire);
+        quint64 tail = buffer->tail.load(std::memory_order_relaxed);
+        for (; tail < head; ++tail) {
+            const ProfilerEvent &event = buffer->events[tail % ThreadBuffer::Capacity];
+            histograms[event.context].add(event.durationNs);
+
+            if (event.traced) {
+                if (trace.size() >= MaxTraceEvents) {
+                    // Keep the most recent half of the trace.
+                    const int nrDropped = trace.size() / 2;
+                    trace.remove(0, nrDropped);
+                    droppedTraceEvents += nrDropped;
+                }
+
+                TraceEvent traceEvent;
+                traceEvent.context = event.context;
+                traceEvent.startNs = event.startNs;
+                traceEvent.durationNs = event.durationNs;
+                traceEvent.threadId = buffer->threadId;
+                trace.append(traceEvent);
+            }
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+
+    void drainAll()
+    {
+        for (ThreadBuffer *buffer : qAsConst(buffers))
+            drain(buffer);
+    }
+};
+
+Q_GLOBAL_STATIC(ProfilerRegistry, profilerRegistry)
+
+struct ThreadBufferHandle
+{
+    ~ThreadBufferHandle()
+    {
+        if (buffer == nullptr)
+            return;
+
+        if (!profilerRegistry.isDestroyed()) {
+            ProfilerRegistry *registry = profilerRegistry;
+            QMutexLocker locker(&registry->mutex);
+            registry->drain(buffer);
+            registry->buffers.removeOne(buffer);
+        }
+
+        delete buffer;
+    }
+
+    ThreadBuffer *buffer = nullptr;
+};
+
+ThreadBuffer *threadBuffer()
+{
+    static thread_local ThreadBufferHandle handle;
+    if (handle.buffer == nullptr) {
+        ThreadBuffer *buffer = new ThreadBuffer;
+
+        const QThread *thread = QThread::currentThread();
+        if (qApp != nullptr && thread == qApp->thread())
+            buffer->threadName = QStringLiteral("GUI Thread");
+        else
+            buffer->threadName = thread->objectName();
+
+        ProfilerRegistry *registry = profilerRegistry;
+        QMutexLocker locker(&registry->mutex);
+        buffer->threadId = registry->nextThreadId++;
+        if (buffer->threadName.isEmpty())
+            buffer->threadName = QStringLiteral("Thread ") + QString::number(buffer->threadId);
+        registry->buffers.append(buffer);
+
+        handle.buffer = buffer;
+    }
+
+    return handle.buffer;
+}
+
+void appendJsonString(QByteArray &json, const QByteArray &text)
+{
+    json += '"';
+    for (const char c : text) {
+        switch (c) {
+        case '"':
+            json += "\\\"";
+            break;
+        case '\\':
+            json += "\\\\";
+            break;
+        case '\n':
+            json += "\\n";
+            break;
+        case '\t':
+            json += "\\t";
+            break;
+        default:
+            if (uchar(c) >= 0x20)
+                json += c;
+        }
+    }
+    json += '"';
+}
+
+} // namespace
+
+std::atomic<bool> &TimeProfiler::enabledFlag()
+{
+    static std::atomic<bool> flag(qEnvironmentVariableIsSet("SCRITE_PROFILING"));
+    return flag;
+}
+
+void TimeProfiler::setEnabled(bool val)
+{
+    enabledFlag().store(val, std::memory_order_relaxed);
+}
+
+QList<TimeProfiler::Stats> TimeProfiler::summary()
+{
+    QHash<QString, DurationHistogram> histograms;
+    {
+        ProfilerRegistry *registry = profilerRegistry;
+        QMutexLocker locker(&registry->mutex);
+        registry->drainAll();
+
+        auto it = registry->histograms.constBegin();
+        auto end = registry->histograms.constEnd();
+        for (; it != end; ++it) {
+            // The same function may show up under more than one string literal, for
+            // instance when an inline function is instantiated in several translation units.
+            histograms[QString::fromLatin1(it.key())].merge(it.value());
+        }
+    }
+
+    QList<Stats> ret;
+    ret.reserve(histograms.size());
+
+    auto it = histograms.constBegin();
+    auto end = histograms.constEnd();
+    for (; it != end; ++it) {
+        Stats stats;
+        stats.context = it.key();
+        stats.count = it.value().count;
+        stats.totalNs = it.value().totalNs;
+        stats.minNs = it.value().minNs;
+        stats.maxNs = it.value().maxNs;
+        stats.p50Ns = it.value().percentile(0.5);
+        stats.p99Ns = it.value().percentile(0.99);
+        ret.append(stats);
+    }
+
+    std::sort(ret.begin(), ret.end(),
+              [](const Stats &a, const Stats &b) { return a.totalNs > b.totalNs; });
+
+    return ret;
+}
+
+QByteArray TimeProfiler::toChromeTrace()
+{
+    QByteArray json;
+    json.reserve(1 << 20);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    auto separator = [&json, &first]() {
+        if (!first)
+            json += ",\n";
+        first = false;
+    };
+
+    {
+        ProfilerRegistry *registry = profilerRegistry;
+        QMutexLocker locker(&registry->mutex);
+        registry->drainAll();
+
+        for (const ThreadBuffer *buffer : qAsConst(registry->buffers)) {
+            separator();
+            json += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":";
+            json += QByteArray::number(buffer->threadId);
+            json += ",\"args\":{\"name\":";
+            appendJsonString(json, buffer->threadName.toUtf8());
+            json += "}}";
+        }
+
+        for (const TraceEvent &event : qAsConst(registry->trace)) {
+            separator();
+            json += "{\"ph\":\"X\",\"pid\":1,\"tid\":";
+            json += QByteArray::number(event.threadId);
+            json += ",\"ts\":";
+            json += QByteArray::number(double(event.startNs) / 1000.0, 'f', 3);
+            json += ",\"dur\":";
+            json += QByteArray::number(double(event.durationNs) / 1000.0, 'f', 3);
+            json += ",\"name\":";
+            appendJsonString(json, QByteArray(event.context));
+            json += "}";
+        }
+
+        if (registry->droppedTraceEvents > 0) {
+            separator();
+            json += "{\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":0,"
+                    "\"name\":\"dropped trace events\",\"args\":{\"count\":";
+            json += QByteArray::number(registry->droppedTraceEvents);
+            json += "}}";
+        }
+    }
+
+    const QList<CallGraph::Capture> captures = CallGraph::captures();
+    for (const CallGraph::Capture &capture : captures) {
+        separator();
+        json += "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":";
+        json += QByteArray::number(capture.threadId);
+        json += ",\"ts\":";
+        json += QByteArray::number(double(capture.firstCaptureNs) / 1000.0, 'f', 3);
+        json += ",\"name\":";
+        appendJsonString(json, capture.context.toUtf8());
+        json += ",\"args\":{\"count\":";
+        json += QByteArray::number(capture.count);
+        json += ",\"callers\":";
+        appendJsonString(json, capture.callers.join(QStringLiteral(" > ")).toUtf8());
+        json += "}}";
+    }
+
+    json += "]}";
+    return json;
+}
+
+bool TimeProfiler::saveChromeTrace(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly))
+        return false;
+
+    return file.write(TimeProfiler::toChromeTrace()) >= 0;
+}
+
+void TimeProfiler::reset()
+{
+    {
+        ProfilerRegistry *registry = profilerRegistry;
+        QMutexLocker locker(&registry->mutex);
+        registry->drainAll();
+        registry->histograms.clear();
+        registry->trace.clear();
+        registry->droppedTraceEvents = 0;
+    }
+
+    CallGraph::reset();
+}
+
+QList<const char *> TimeProfiler::currentStack()
+{
+    return threadBuffer()->stack;
+}
+
+qint64 TimeProfiler::timestampNs()
+{
+    return nowNs();
+}
+
+int TimeProfiler::currentThreadId()
+{
+    return threadBuffer()->threadId;
+}
+
+void TimeProfiler::begin(const char *context, Mode mode)
+{
+    threadBuffer()->stack.append(context);
+
+    m_mode = mode;
+    m_context = context;
+    m_startNs = nowNs();
+}
+
+void TimeProfiler::end()
+{
+    const qint64 endNs = nowNs();
+
+    ThreadBuffer *buffer = threadBuffer();
+    if (!buffer->stack.isEmpty())
+        buffer->stack.removeLast();
+
+    const quint64 head = buffer->head.load(std::memory_order_relaxed);
+    if (head - buffer->tail.load(std::memory_order_acquire) >= ThreadBuffer::Capacity) {
+        ProfilerRegistry *registry = profilerRegistry;
+        QMutexLocker locker(&registry->mutex);
+        registry->drain(buffer);
+    }
+
+    ProfilerEvent &event = buffer->events[head % ThreadBuffer::Capacity];
+    event.context = m_context;
+    event.startNs = m_startNs;
+    event.durationNs = endNs - m_startNs;
+    event.traced = m_mode == TraceMode;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
@@ -14,7 +14,84 @@
 #ifndef TIME_PROFILER_H
 #define TIME_PROFILER_H
 
-#define PROFILE_THIS_FUNCTION
-#define PROFILE_THIS_FUNCTION2
+#include <atomic>
+
+#include <QList>
+#include <QString>
+#include <QByteArray>
+
+/**
+ * Low overhead scoped profiler.
+ *
+ * Each thread records its scoped timings into its own lock-free ring buffer. Ring
+ * buffers are drained into per-function histograms (and a bounded trace) whenever
+ * they fill up, or when someone asks for a summary or a trace. Profiling is off by
+ * default; it can be switched on at runtime with TimeProfiler::setEnabled(), or at
+ * launch by setting the SCRITE_PROFILING environment variable. When profiling is
+ * off, a scope costs one relaxed atomic load.
+ */
+class TimeProfiler
+{
+public:
+    static bool isEnabled() { return enabledFlag().load(std::memory_order_relaxed); }
+    static void setEnabled(bool val);
+
+    enum Mode {
+        TraceMode, // contributes to histograms and to the trace
+        HistogramMode // contributes to histograms only, for very frequently called functions
+    };
+
+    explicit TimeProfiler(const char *context, Mode mode = TraceMode)
+    {
+        if (isEnabled())
+            this->begin(context, mode);
+    }
+    ~TimeProfiler()
+    {
+        if (m_context != nullptr)
+            this->end();
+    }
+
+    struct Stats
+    {
+        QString context;
+        quint64 count = 0;
+        qint64 totalNs = 0;
+        qint64 minNs = 0;
+        qint64 maxNs = 0;
+        qint64 p50Ns = 0;
+        qint64 p99Ns = 0;
+    };
+
+    // Sorted by total time spent, highest first
+    static QList<Stats> summary();
+
+    // Chrome trace-event JSON, loadable in chrome://tracing or https://ui.perfetto.dev
+    static QByteArray toChromeTrace();
+    static bool saveChromeTrace(const QString &fileName);
+
+    static void reset();
+
+    // Names of profiled scopes currently open on the calling thread, outermost first.
+    static QList<const char *> currentStack();
+
+    // Clock and thread identifiers used in the trace, for use by CallGraph
+    static qint64 timestampNs();
+    static int currentThreadId();
+
+private:
+    static std::atomic<bool> &enabledFlag();
+    void begin(const char *context, Mode mode);
+    void end();
+
+private:
+    const char *m_context = nullptr;
+    qint64 m_startNs = 0;
+    Mode m_mode = TraceMode;
+};
+
+#define PROFILE_THIS_FUNCTION TimeProfiler _timeProfiler_(Q_FUNC_INFO, TimeProfiler::TraceMode)
+#define PROFILE_THIS_FUNCTION2                                                                     \
+    TimeProfiler _timeProfiler_(Q_FUNC_INFO, TimeProfiler::HistogramMode)
 
 #endif // TIME_PROFILER_H